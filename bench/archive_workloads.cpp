@@ -0,0 +1,479 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#if __has_include(<sys/resource.h>)
+#include <sys/resource.h>
+#endif
+
+#include "squeeze/squeeze.h"
+#include "squeeze/compression/config.h"
+#include "squeeze/version.h"
+#include "squeeze/wrap/file_squeeze.h"
+
+#include "test_common/test_data.h"
+#include "test_tools/generators/data_gen.h"
+#include "test_tools/generators/mockfs_gen.h"
+#include "test_tools/generators/prng.h"
+
+namespace {
+
+using namespace squeeze;
+using test_common::TestData;
+using test_tools::generators::PRNG;
+using test_tools::generators::MockFSParams;
+namespace mock = test_tools::mock;
+namespace fs = std::filesystem;
+
+constexpr PRNG::SeedType workload_prng_seed = 1234;
+/** Max number of the paths to look up in the find phase. */
+constexpr std::size_t max_nr_finds = 1000;
+/** Max size of the contents of a mock file system generated at once, before it's written out. */
+constexpr std::size_t max_chunk_size = 256 << 20;
+
+/** A file tree of a realistic size distribution to run the workload on. */
+struct Scenario {
+    std::string_view name;
+    MockFSParams params;
+    /** Whether the file sizes get scaled, rather than the number of files. */
+    bool scale_file_sizes = false;
+};
+
+const Scenario scenarios[] = {
+    {
+        .name = "tiny_files",
+        .params = {.nr_regular_files = 1'000'000, .nr_symlinks = 10'000,
+                   .min_file_size = 0, .max_file_size = 4 << 10, .max_breadth = 8, .depth = 4},
+    },
+    {
+        .name = "huge_files",
+        .params = {.nr_regular_files = 10, .nr_symlinks = 0,
+                   .min_file_size = 128 << 20, .max_file_size = 512 << 20, .max_breadth = 2, .depth = 2},
+        .scale_file_sizes = true,
+    },
+    {
+        .name = "mixed",
+        .params = {.nr_regular_files = 10'000, .nr_symlinks = 100,
+                   .min_file_size = 0, .max_file_size = 4 << 20, .max_breadth = 6, .depth = 4},
+    },
+};
+
+/** Counters of the I/O of the process, all of its threads included. */
+struct IOCounters {
+    uint64_t read_syscalls = 0;
+    uint64_t write_syscalls = 0;
+    uint64_t read_bytes = 0;
+    uint64_t write_bytes = 0;
+};
+
+/** Read the I/O counters of the process, only available on Linux. */
+std::optional<IOCounters> read_io_counters()
+{
+#if defined(__linux__)
+    std::ifstream io("/proc/self/io");
+    IOCounters counters;
+    std::string key;
+    uint64_t value;
+    bool found = false;
+    while (io >> key >> value) {
+        if (key == "syscr:")
+            counters.read_syscalls = value, found = true;
+        else if (key == "syscw:")
+            counters.write_syscalls = value;
+        else if (key == "rchar:")
+            counters.read_bytes = value;
+        else if (key == "wchar:")
+            counters.write_bytes = value;
+    }
+    if (found)
+        return counters;
+#endif
+    return std::nullopt;
+}
+
+/** Reset the peak resident set size of the process to the current one, so that the peak of each phase
+ * gets measured. Only possible on Linux, the peak of the whole run is measured otherwise. */
+void reset_peak_rss()
+{
+#if defined(__linux__)
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif
+}
+
+std::optional<uint64_t> read_peak_rss()
+{
+#if defined(__linux__)
+    std::ifstream status("/proc/self/status");
+    for (std::string line; std::getline(status, line);) {
+        if (not line.starts_with("VmHWM:"))
+            continue;
+        uint64_t kib = 0;
+        const char *begin = line.data() + line.find_first_not_of(' ', 6);
+        if (std::from_chars(begin, line.data() + line.size(), kib).ec == std::errc())
+            return kib << 10;
+    }
+#endif
+#if __has_include(<sys/resource.h>)
+    rusage usage {};
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+        return uint64_t(usage.ru_maxrss) << 10;
+#endif
+    return std::nullopt;
+}
+
+struct PhaseResult {
+    std::string_view name;
+    double seconds = 0;
+    std::size_t nr_operations = 0;
+    std::size_t nr_failed = 0;
+    std::optional<uint64_t> peak_rss;
+    std::optional<IOCounters> io;
+};
+
+/** Run a phase of the workload, the function returning the number of the failed operations. */
+template<typename F>
+PhaseResult run_phase(std::string_view name, std::size_t nr_operations, F&& f)
+{
+    PhaseResult result;
+    result.name = name;
+    result.nr_operations = nr_operations;
+    reset_peak_rss();
+    const std::optional<IOCounters> io_before = read_io_counters();
+    const auto start = std::chrono::steady_clock::now();
+    result.nr_failed = f();
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.peak_rss = read_peak_rss();
+    if (const std::optional<IOCounters> io_after = read_io_counters(); io_before && io_after)
+        result.io = IOCounters {
+            .read_syscalls = io_after->read_syscalls - io_before->read_syscalls,
+            .write_syscalls = io_after->write_syscalls - io_before->write_syscalls,
+            .read_bytes = io_after->read_bytes - io_before->read_bytes,
+            .write_bytes = io_after->write_bytes - io_before->write_bytes,
+        };
+    return result;
+}
+
+/** A regular file of a generated tree, by its path relative to the working directory of the scenario. */
+struct TreeFile {
+    std::string path;
+    std::size_t size;
+};
+
+/** Write a mock file system out to the real one under the given directory. The mock permissions are
+ * dropped in favor of the default ones, as the tree has to be readable for appending it. */
+void write_mockfs(const mock::FileSystem& mockfs, const fs::path& dir, std::vector<TreeFile>& files)
+{
+    fs::create_directories(dir);
+    mockfs.list_recursively<mock::Directory, mock::RegularFile, mock::Symlink>(
+        [&dir](const std::string& path, const std::shared_ptr<mock::Directory>&)
+        {
+            fs::create_directories(dir / path);
+        },
+        [&dir, &files](const std::string& path, const std::shared_ptr<mock::RegularFile>& regular_file)
+        {
+            const std::string_view contents = regular_file->contents.view();
+            std::ofstream(dir / path, std::ios_base::binary).write(contents.data(), contents.size());
+            files.push_back({(dir / path).generic_string(), contents.size()});
+        },
+        [&dir](const std::string& path, const std::shared_ptr<mock::Symlink>& symlink)
+        {
+            std::error_code ec;
+            fs::create_symlink(symlink->target, dir / path, ec);
+        }
+    );
+}
+
+/** Generate the tree of the scenario under the given directory, in chunks of subdirectories,
+ * as the whole mock file system of a large scenario doesn't fit in memory. */
+std::vector<TreeFile> gen_tree(const MockFSParams& params, const fs::path& dir, const PRNG& prng)
+{
+    const std::size_t chunk_nr_files = std::clamp<std::size_t>(max_chunk_size / std::max<std::size_t>(
+                params.max_file_size, 1), 1, 1 << 16);
+    std::vector<TreeFile> files;
+    files.reserve(params.nr_regular_files);
+    for (std::size_t i = 0, chunk = 0; i < params.nr_regular_files; i += chunk_nr_files, ++chunk) {
+        MockFSParams chunk_params = params;
+        chunk_params.nr_regular_files = std::min(chunk_nr_files, params.nr_regular_files - i);
+        chunk_params.nr_symlinks = params.nr_symlinks * chunk_params.nr_regular_files / params.nr_regular_files;
+        const mock::FileSystem mockfs = gen_mockfs(chunk_params, TestData::get_data_seed(), prng);
+        write_mockfs(mockfs, dir / ("part" + std::to_string(chunk)), files);
+    }
+    return files;
+}
+
+/** Pick the given fraction of the files, at least one of them. */
+std::vector<const TreeFile *> pick_files(const std::vector<TreeFile>& files, double fraction, const PRNG& prng)
+{
+    std::vector<const TreeFile *> picked;
+    const auto nr_picks = std::max<std::size_t>(1, std::llround(double(files.size()) * fraction));
+    for (std::size_t i = 0; i < files.size() && picked.size() < nr_picks; ++i)
+        if (prng(std::size_t(0), files.size() - i - 1) < nr_picks - picked.size())
+            picked.push_back(&files[i]);
+    return picked;
+}
+
+template<typename Stats>
+std::size_t count_failed(const Stats& stats)
+{
+    return std::count_if(stats.begin(), stats.end(), [](const auto& stat) { return stat.failed(); });
+}
+
+struct ScenarioResult {
+    std::string_view name;
+    std::size_t nr_regular_files = 0;
+    uint64_t total_size = 0;
+    std::size_t nr_entries = 0;
+    uint64_t archive_size = 0;
+    std::vector<PhaseResult> phases;
+};
+
+ScenarioResult run_scenario(const Scenario& scenario, double scale, const CompressionParams& compression,
+                            const fs::path& dir)
+{
+    MockFSParams params = scenario.params;
+    if (scenario.scale_file_sizes) {
+        params.min_file_size = std::llround(double(params.min_file_size) * scale);
+        params.max_file_size = std::max<std::size_t>(std::llround(double(params.max_file_size) * scale), 1);
+    } else {
+        params.nr_regular_files = std::max<std::size_t>(std::llround(double(params.nr_regular_files) * scale), 1);
+        params.nr_symlinks = std::llround(double(params.nr_symlinks) * scale);
+    }
+
+    const PRNG prng(workload_prng_seed);
+    fs::remove_all(dir);
+    fs::create_directories(dir / "extracted");
+    const fs::path cwd = fs::current_path();
+    fs::current_path(dir);
+
+    ScenarioResult result;
+    result.name = scenario.name;
+    const std::vector<TreeFile> files = gen_tree(params, "tree", prng);
+    result.nr_regular_files = files.size();
+    for (const auto& file : files)
+        result.total_size += file.size;
+
+    std::fstream archive("archive.sqz", std::ios_base::in | std::ios_base::out |
+                                        std::ios_base::binary | std::ios_base::trunc);
+    Squeeze sqz(archive);
+    wrap::FileSqueeze fsqz(sqz);
+    auto truncate_archive = [&archive]()
+    {
+        archive.flush();
+        fs::resize_file("archive.sqz", archive.tellp());
+    };
+    auto make_back_inserter_lambda = [](auto& container)
+    {
+        return [&container]{ container.emplace_back(); return &container.back(); };
+    };
+
+    result.phases.push_back(run_phase("append", files.size(), [&]()
+    {
+        std::deque<Writer::Stat> stats;
+        fsqz.will_append_recursively("tree", compression, make_back_inserter_lambda(stats));
+        fsqz.update();
+        truncate_archive();
+        return count_failed(stats);
+    }));
+
+    result.phases.push_back(run_phase("list", 0, [&]()
+    {
+        for (auto scanner = sqz.scan(); scanner.next();)
+            ++result.nr_entries;
+        return std::size_t(0);
+    }));
+    result.phases.back().nr_operations = result.nr_entries;
+
+    const auto found_files = pick_files(files, double(max_nr_finds) / double(files.size()), prng);
+    result.phases.push_back(run_phase("find", found_files.size(), [&]()
+    {
+        std::size_t nr_failed = 0;
+        for (const TreeFile *file : found_files)
+            nr_failed += sqz.find(file->path) == sqz.end();
+        return nr_failed;
+    }));
+
+    // the updated files get new contents of the same sizes, generated ahead of the timing
+    const auto updated_files = pick_files(files, 0.1, prng);
+    for (const TreeFile *file : updated_files) {
+        const std::vector<char> data = test_tools::generators::gen_data(prng, TestData::get_data_seed(),
+                                                                        file->size);
+        std::ofstream(file->path, std::ios_base::binary).write(data.data(), data.size());
+    }
+    result.phases.push_back(run_phase("update_10_percent", updated_files.size(), [&]()
+    {
+        std::deque<Writer::Stat> stats;
+        for (const TreeFile *file : updated_files)
+            fsqz.will_append(fs::path(file->path), compression, &stats.emplace_back());
+        fsqz.update();
+        truncate_archive();
+        return count_failed(stats);
+    }));
+
+    const auto removed_files = pick_files(files, 0.01, prng);
+    result.phases.push_back(run_phase("remove_1_percent", removed_files.size(), [&]()
+    {
+        std::deque<Writer::Stat> stats;
+        for (const TreeFile *file : removed_files)
+            fsqz.will_remove(file->path, &stats.emplace_back());
+        fsqz.update();
+        truncate_archive();
+        return count_failed(stats);
+    }));
+
+    fs::current_path("extracted");
+    result.phases.push_back(run_phase("extract_all", result.nr_entries, [&]()
+    {
+        std::deque<Reader::Stat> stats;
+        fsqz.extract_all(make_back_inserter_lambda(stats));
+        return count_failed(stats);
+    }));
+
+    result.archive_size = fs::file_size(dir / "archive.sqz");
+    fs::current_path(cwd);
+    return result;
+}
+
+template<typename T>
+void print_json_value(std::ostream& os, const std::optional<T>& value)
+{
+    if (value)
+        os << *value;
+    else
+        os << "null";
+}
+
+constexpr std::pair<std::string_view, uint64_t IOCounters::*> io_counter_keys[] = {
+    {"read_syscalls", &IOCounters::read_syscalls},
+    {"write_syscalls", &IOCounters::write_syscalls},
+    {"read_bytes", &IOCounters::read_bytes},
+    {"write_bytes", &IOCounters::write_bytes},
+};
+
+void print_json(std::ostream& os, double scale, const CompressionParams& compression,
+                const std::vector<ScenarioResult>& results)
+{
+    os << "{\n"
+       << "  \"version\": \"" << version.get_major() << '.' << version.get_minor() << '.' << version.get_patch()
+       << "\",\n"
+       << "  \"scale\": " << scale << ",\n"
+       << "  \"compression\": {\"method\": \"deflate\", \"level\": " << int(compression.level) << "},\n"
+       << "  \"scenarios\": [";
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const ScenarioResult& result = results[i];
+        os << (i ? ",\n" : "\n")
+           << "    {\n"
+           << "      \"name\": \"" << result.name << "\",\n"
+           << "      \"regular_files\": " << result.nr_regular_files << ",\n"
+           << "      \"total_size\": " << result.total_size << ",\n"
+           << "      \"entries\": " << result.nr_entries << ",\n"
+           << "      \"archive_size\": " << result.archive_size << ",\n"
+           << "      \"phases\": [";
+        for (std::size_t j = 0; j < result.phases.size(); ++j) {
+            const PhaseResult& phase = result.phases[j];
+            os << (j ? ",\n" : "\n")
+               << "        {\"name\": \"" << phase.name << "\", \"seconds\": " << phase.seconds
+               << ", \"operations\": " << phase.nr_operations << ", \"failed\": " << phase.nr_failed
+               << ", \"peak_rss\": ";
+            print_json_value(os, phase.peak_rss);
+            for (auto [key, counter] : io_counter_keys) {
+                os << ", \"" << key << "\": ";
+                print_json_value(os, phase.io ? std::optional((*phase.io).*counter) : std::nullopt);
+            }
+            os << '}';
+        }
+        os << "\n      ]\n    }";
+    }
+    os << "\n  ]\n}\n";
+}
+
+void usage()
+{
+    std::cerr <<
+R""""(Usage: bench_archive [-options]
+Run the archive workloads of appending a generated file tree, listing, finding, updating 10% and removing 1%
+of its files, and extracting it all, on the scenarios of 1M tiny files, 10 huge files and a mixed tree.
+Print the time, the peak RSS, the read and write syscall counts of each phase as JSON.
+Options:
+    --scenario <name>   Run only the given scenario, one of tiny_files, huge_files, mixed, may be repeated
+    --scale <factor>    Scale the scenarios, i.e. the numbers of files, or the file sizes of huge_files (1.0)
+    --level <level>     Compression level of Deflate (8)
+    --dir <dir>         Directory to generate the trees and the archives in (a temporary one)
+    --keep              Keep the generated trees and archives
+    -h, --help          Display usage information
+)"""";
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::vector<const Scenario *> selected_scenarios;
+    double scale = 1.0;
+    CompressionParams compression {.method = compression::CompressionMethod::Deflate, .level = 8};
+    fs::path dir = fs::temp_directory_path() / "sqz_bench_archive";
+    bool keep = false;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const std::string_view value = i + 1 < argc ? argv[i + 1] : "";
+        bool valid = not value.empty();
+        if (arg == "--scenario") {
+            auto it = std::find_if(std::begin(scenarios), std::end(scenarios),
+                                   [value](const auto& scenario) { return scenario.name == value; });
+            valid = valid && it != std::end(scenarios);
+            if (valid)
+                selected_scenarios.push_back(&*it);
+        } else if (arg == "--scale") {
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), scale);
+            valid = valid && ec == std::errc() && ptr == value.data() + value.size() && scale > 0;
+        } else if (arg == "--level") {
+            unsigned level = 0;
+            auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), level);
+            compression.level = static_cast<uint8_t>(level);
+            valid = valid && ec == std::errc() && ptr == value.data() + value.size() &&
+                    level <= compression::max_level_per_method[2];
+        } else if (arg == "--dir") {
+            dir = fs::absolute(value);
+        } else if (arg == "--keep") {
+            keep = true;
+            --i;
+        } else {
+            valid = false;
+        }
+        if (not valid) {
+            usage();
+            return arg == "-h" || arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+        ++i;
+    }
+    if (selected_scenarios.empty())
+        for (const auto& scenario : scenarios)
+            selected_scenarios.push_back(&scenario);
+
+    std::vector<ScenarioResult> results;
+    bool succeeded = true;
+    for (const Scenario *scenario : selected_scenarios) {
+        results.push_back(run_scenario(*scenario, scale, compression, dir / scenario->name));
+        for (const auto& phase : results.back().phases)
+            succeeded = succeeded && phase.nr_failed == 0;
+        if (not keep)
+            fs::remove_all(dir / scenario->name);
+    }
+    if (not keep)
+        fs::remove_all(dir);
+
+    print_json(std::cout, scale, compression, results);
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
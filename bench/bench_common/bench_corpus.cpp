@@ -0,0 +1,182 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "bench_corpus.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+
+#include "squeeze/utils/endian.h"
+
+#include "bench_data.h"
+#include "test_tools/generators/data_gen.h"
+#include "test_tools/generators/prng.h"
+
+namespace squeeze::bench_common {
+
+using test_tools::generators::PRNG;
+using test_tools::generators::gen_alphanumeric_string;
+
+namespace {
+
+constexpr PRNG::SeedType corpus_prng_seed = 4321;
+
+std::vector<std::string> gen_words(const PRNG& prng, std::size_t nr_words, std::size_t min_size, std::size_t max_size)
+{
+    std::vector<std::string> words(nr_words);
+    for (auto& word : words)
+        word = gen_alphanumeric_string(prng(min_size, max_size), prng);
+    return words;
+}
+
+/** Lines of C-like code of nested blocks with the identifiers out of a limited vocabulary. */
+std::vector<char> gen_source(std::size_t size)
+{
+    static constexpr std::array keywords = {"if", "for", "while", "return", "const", "auto", "int", "std::size_t",
+                                            "else", "static", "inline", "template", "struct", "switch", "case"};
+    const PRNG prng(corpus_prng_seed);
+    const auto identifiers = gen_words(prng, 512, 3, 16);
+
+    std::string source;
+    source.reserve(size + 256);
+    std::size_t depth = 0;
+    while (source.size() < size) {
+        source.append(depth * 4, ' ');
+        const int kind = prng(0, 9);
+        if (kind == 0 && depth < 6) {
+            source += keywords[prng(std::size_t(0), std::size_t(2))];
+            source += " (" + identifiers[prng(std::size_t(0), identifiers.size() - 1)] + " < " +
+                      std::to_string(prng(0, 1000)) + ") {\n";
+            ++depth;
+        } else if (kind == 1 && depth > 0) {
+            source.resize(source.size() - 4);
+            source += "}\n";
+            --depth;
+        } else {
+            source += keywords[prng(std::size_t(3), keywords.size() - 1)];
+            source += ' ' + identifiers[prng(std::size_t(0), identifiers.size() - 1)] + " = " +
+                      identifiers[prng(std::size_t(0), identifiers.size() - 1)] + '(' +
+                      identifiers[prng(std::size_t(0), identifiers.size() - 1)] + ", " +
+                      std::to_string(prng(0, 255)) + ");\n";
+        }
+    }
+    source.resize(size);
+    return std::vector<char>(source.begin(), source.end());
+}
+
+/** XML records of a few fields each, with the values drawn out of limited vocabularies. */
+std::vector<char> gen_xml(std::size_t size)
+{
+    const PRNG prng(corpus_prng_seed);
+    const auto names = gen_words(prng, 256, 4, 12);
+    const auto cities = gen_words(prng, 32, 5, 10);
+
+    std::string xml = "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<records>\n";
+    xml.reserve(size + 256);
+    for (uint64_t id = 0; xml.size() < size; ++id) {
+        xml += "  <record id=\"" + std::to_string(id) + "\">\n";
+        xml += "    <name>" + names[prng(std::size_t(0), names.size() - 1)] + "</name>\n";
+        xml += "    <city>" + cities[prng(std::size_t(0), cities.size() - 1)] + "</city>\n";
+        xml += "    <amount>" + std::to_string(prng(0, 100000)) + "</amount>\n";
+        xml += "  </record>\n";
+    }
+    xml.resize(size);
+    return std::vector<char>(xml.begin(), xml.end());
+}
+
+/** Fixed-size little-endian binary records of a database table, with sequential keys and dates. */
+std::vector<char> gen_records(std::size_t size)
+{
+    struct Record {
+        uint32_t id;
+        uint32_t date;
+        uint32_t amount;
+        uint8_t category;
+        char name[15];
+    };
+    static_assert(sizeof(Record) == 28);
+
+    const PRNG prng(corpus_prng_seed);
+    const auto names = gen_words(prng, 1024, 4, 14);
+
+    std::vector<char> data;
+    data.reserve(size + sizeof(Record));
+    uint32_t date = 20240101;
+    for (uint32_t id = 0; data.size() < size; ++id) {
+        Record record {};
+        date += prng(0, 2);
+        record.id = id;
+        record.date = date;
+        record.amount = prng(0U, 1U << prng(4, 20));
+        record.category = static_cast<uint8_t>(prng(0, 7));
+        const std::string& name = names[prng(std::size_t(0), names.size() - 1)];
+        std::memcpy(record.name, name.data(), std::min(name.size(), sizeof(record.name)));
+        record.id = utils::to_endian_val<std::endian::little>(record.id);
+        record.date = utils::to_endian_val<std::endian::little>(record.date);
+        record.amount = utils::to_endian_val<std::endian::little>(record.amount);
+        const char *bytes = reinterpret_cast<const char *>(&record);
+        data.insert(data.end(), bytes, bytes + sizeof(record));
+    }
+    data.resize(size);
+    return data;
+}
+
+/** A 16-bit little-endian grayscale image of smooth gradients with some sensor noise, like a medical scan. */
+std::vector<char> gen_image(std::size_t size)
+{
+    constexpr std::size_t width = 512;
+    const PRNG prng(corpus_prng_seed);
+    std::vector<char> data(size);
+    for (std::size_t i = 0; i + 1 < size; i += 2) {
+        const std::size_t x = (i / 2) % width, y = (i / 2) / width;
+        const auto pixel = static_cast<uint16_t>((x * 7 + y * 3 + (x * y) / 64) % 4096 + prng(0, 15));
+        data[i] = static_cast<char>(pixel & 0xFF);
+        data[i + 1] = static_cast<char>(pixel >> 8);
+    }
+    return data;
+}
+
+}
+
+std::vector<CorpusFile> gen_corpus(std::size_t file_size)
+{
+    std::vector<CorpusFile> corpus;
+    corpus.push_back({"text", get_bench_data(BenchDataType::Text, file_size)});
+    corpus.push_back({"source", gen_source(file_size)});
+    corpus.push_back({"xml", gen_xml(file_size)});
+    corpus.push_back({"records", gen_records(file_size)});
+    corpus.push_back({"image", gen_image(file_size)});
+    corpus.push_back({"noisy_text", get_bench_data(BenchDataType::NoisyText, file_size)});
+    corpus.push_back({"incompressible", get_bench_data(BenchDataType::Incompressible, file_size)});
+    corpus.push_back({"repetitive", get_bench_data(BenchDataType::Repetitive, file_size)});
+    return corpus;
+}
+
+std::vector<CorpusFile> load_corpus(const std::filesystem::path& dir, std::size_t max_file_size)
+{
+    std::vector<CorpusFile> corpus;
+    std::error_code ec;
+    for (const auto& dir_entry : std::filesystem::directory_iterator(dir, ec)) {
+        if (not dir_entry.is_regular_file())
+            continue;
+        std::ifstream file(dir_entry.path(), std::ios_base::binary);
+        if (not file)
+            return {};
+        CorpusFile& corpus_file = corpus.emplace_back();
+        corpus_file.name = dir_entry.path().filename().string();
+        corpus_file.data.resize(std::min<std::size_t>(dir_entry.file_size(), max_file_size));
+        file.read(corpus_file.data.data(), static_cast<std::streamsize>(corpus_file.data.size()));
+        corpus_file.data.resize(static_cast<std::size_t>(file.gcount()));
+    }
+    if (ec)
+        return {};
+    std::sort(corpus.begin(), corpus.end(), [](const auto& a, const auto& b) { return a.name < b.name; });
+    return corpus;
+}
+
+}
@@ -0,0 +1,28 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace squeeze::bench_common {
+
+/** A named input of a corpus. */
+struct CorpusFile {
+    std::string name;
+    std::vector<char> data;
+};
+
+/** Generate a corpus modeled after the Silesia one, with the files of the given size each, deterministically:
+ * natural-language-like text, source-code-like text, XML, binary records of a database,
+ * a 16-bit grayscale image, executable-like noisy data, as well as incompressible and repetitive data. */
+std::vector<CorpusFile> gen_corpus(std::size_t file_size);
+
+/** Load the regular files of the given directory as a corpus, e.g. the actual Silesia corpus,
+ * reading at most the given size of each. Returns an empty corpus on failure. */
+std::vector<CorpusFile> load_corpus(const std::filesystem::path& dir, std::size_t max_file_size);
+
+}
@@ -0,0 +1,117 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "bench_data.h"
+
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <utility>
+
+#include "test_common/test_data.h"
+#include "test_tools/generators/data_gen.h"
+#include "test_tools/generators/prng.h"
+
+namespace squeeze::bench_common {
+
+using test_tools::generators::PRNG;
+
+namespace {
+
+constexpr PRNG::SeedType bench_data_prng_seed = 1234;
+constexpr unsigned char noisy_text_noise_probability = 16;
+constexpr std::size_t repetitive_period = 37;
+
+std::vector<char> gen_bench_data(BenchDataType type, std::size_t size)
+{
+    const PRNG prng(bench_data_prng_seed);
+    switch (type) {
+    case BenchDataType::Text:
+        return test_tools::generators::gen_data(prng, test_common::TestData::get_data_seed(), size);
+    case BenchDataType::NoisyText:
+        return test_tools::generators::gen_data(prng, test_common::TestData::get_data_seed(), size,
+                                                noisy_text_noise_probability);
+    case BenchDataType::Incompressible:
+    {
+        std::vector<char> data(size);
+        for (char& c : data)
+            c = static_cast<char>(prng(0, 255));
+        return data;
+    }
+    case BenchDataType::Repetitive:
+    {
+        const std::string pattern = test_tools::generators::gen_alphanumeric_string(repetitive_period, prng);
+        std::vector<char> data(size);
+        for (std::size_t i = 0; i < size; ++i)
+            data[i] = pattern[i % pattern.size()];
+        return data;
+    }
+    default:
+        return {};
+    }
+}
+
+}
+
+std::vector<int64_t> get_bench_data_type_args()
+{
+    std::vector<int64_t> args(nr_bench_data_types);
+    std::iota(args.begin(), args.end(), 0);
+    return args;
+}
+
+std::string_view get_bench_data_type_name(BenchDataType type)
+{
+    switch (type) {
+    case BenchDataType::Text:
+        return "text";
+    case BenchDataType::NoisyText:
+        return "noisy_text";
+    case BenchDataType::Incompressible:
+        return "incompressible";
+    case BenchDataType::Repetitive:
+        return "repetitive";
+    default:
+        return "unknown";
+    }
+}
+
+const std::vector<char>& get_bench_data(BenchDataType type, std::size_t size)
+{
+    static std::mutex mutex;
+    static std::map<std::pair<BenchDataType, std::size_t>, std::vector<char>> cache;
+
+    std::scoped_lock lock(mutex);
+    auto [it, inserted] = cache.try_emplace(std::make_pair(type, size));
+    if (inserted)
+        it->second = gen_bench_data(type, size);
+    return it->second;
+}
+
+const std::vector<char>& get_bench_data(benchmark::State& state, int arg_idx, std::size_t size)
+{
+    const auto type = static_cast<BenchDataType>(state.range(arg_idx));
+    state.SetLabel(std::string(get_bench_data_type_name(type)));
+    return get_bench_data(type, size);
+}
+
+uint64_t get_total_size(const std::vector<std::vector<char>>& blocks)
+{
+    uint64_t size = 0;
+    for (const auto& block : blocks)
+        size += block.size();
+    return size;
+}
+
+void set_throughput(benchmark::State& state, uint64_t input_size, uint64_t output_size)
+{
+    // shown in decimal units, e.g. 40.6M/s, which is MB/s
+    state.counters["throughput"] = benchmark::Counter(static_cast<double>(input_size),
+                                                      benchmark::Counter::kIsIterationInvariantRate,
+                                                      benchmark::Counter::kIs1000);
+    if (output_size != 0)
+        state.counters["ratio"] = static_cast<double>(input_size) / static_cast<double>(output_size);
+}
+
+}
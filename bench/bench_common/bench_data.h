@@ -0,0 +1,45 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+namespace squeeze::bench_common {
+
+/** Kinds of the data the benchmarks run on. */
+enum class BenchDataType {
+    Text, /** Generated from the test data seed, as the tests do, without noise */
+    NoisyText, /** Generated from the test data seed with some noise applied */
+    Incompressible, /** Uniformly random bytes */
+    Repetitive, /** A short random string repeated over and over */
+};
+
+constexpr int64_t nr_bench_data_types = 4;
+
+/** The benchmark argument values of all the data types. */
+std::vector<int64_t> get_bench_data_type_args();
+
+std::string_view get_bench_data_type_name(BenchDataType type);
+
+/** Get the data of the given type and size, generated deterministically once and kept for the later calls. */
+const std::vector<char>& get_bench_data(BenchDataType type, std::size_t size);
+
+/** Get the data of the type passed as the given benchmark argument, labeling the benchmark with the type name. */
+const std::vector<char>& get_bench_data(benchmark::State& state, int arg_idx, std::size_t size);
+
+/** Report the throughput of processing the input in MB/s, and the compression ratio of the input size
+ * to the output size if the output size is non-zero, both per iteration. */
+void set_throughput(benchmark::State& state, uint64_t input_size, uint64_t output_size = 0);
+
+/** Get the total size of the blocks the data was processed in. */
+uint64_t get_total_size(const std::vector<std::vector<char>>& blocks);
+
+constexpr uint64_t default_bench_data_size = 1 << 20;
+
+}
@@ -0,0 +1,101 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "squeeze/compression/deflate.h"
+#include "squeeze/compression/config.h"
+
+#include "bench_common/bench_data.h"
+
+namespace squeeze::compression::bench {
+
+using namespace bench_common;
+
+namespace {
+
+/** Deflate the data block by block, each block as a final one, the way the blocks get encoded
+ * on their own by encode(). Returns the encoded blocks appended to the buffers. */
+bool deflate_blocks(const std::vector<char>& data, std::size_t block_size, std::size_t level,
+                    std::vector<std::vector<char>>& blocks)
+{
+    DeflateParams params = get_deflate_params_for_level(level);
+    params.header_bits = DeflateHeaderBits::FinalBlock | DeflateHeaderBits::DynamicHuffman;
+    blocks.resize((data.size() + block_size - 1) / block_size);
+    auto block_it = blocks.begin();
+    for (auto it = data.begin(); it != data.end(); ++block_it) {
+        const auto it_end = it + std::min<std::ptrdiff_t>(block_size, data.end() - it);
+        block_it->clear();
+        auto [in_it, out_it, s] = deflate(params, it, it_end, std::back_inserter(*block_it));
+        if (s.failed() || in_it != it_end) [[unlikely]]
+            return false;
+        it = it_end;
+    }
+    return true;
+}
+
+}
+
+static void BM_DeflateEncode(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size);
+    const auto block_size = static_cast<std::size_t>(state.range(1));
+    const auto level = static_cast<std::size_t>(state.range(2));
+
+    std::vector<std::vector<char>> blocks;
+    for (auto _ : state) {
+        if (not deflate_blocks(data, block_size, level, blocks)) [[unlikely]] {
+            state.SkipWithError("failed deflating");
+            break;
+        }
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, data.size(), get_total_size(blocks));
+}
+
+static void BM_DeflateDecode(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size);
+    const auto block_size = static_cast<std::size_t>(state.range(1));
+    const auto level = static_cast<std::size_t>(state.range(2));
+
+    std::vector<std::vector<char>> blocks;
+    if (not deflate_blocks(data, block_size, level, blocks)) [[unlikely]] {
+        state.SkipWithError("failed deflating");
+        return;
+    }
+
+    std::vector<char> output(data.size());
+    for (auto _ : state) {
+        auto out_it = output.begin();
+        for (const auto& block : blocks) {
+            const auto out_it_end = out_it + std::min<std::ptrdiff_t>(block_size, output.end() - out_it);
+            auto [rest_out_it, in_it, header_bits, s] = inflate(out_it, out_it_end, block.begin(), block.end());
+            if (s.failed() || rest_out_it != out_it_end) [[unlikely]] {
+                state.SkipWithError("failed inflating");
+                break;
+            }
+            out_it = out_it_end;
+        }
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, data.size(), get_total_size(blocks));
+}
+
+BENCHMARK(BM_DeflateEncode)
+    ->ArgNames({"data", "block_size", "level"})
+    ->ArgsProduct({get_bench_data_type_args(), {16 << 10, 64 << 10}, {0, 2, 4, 6, 8}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_DeflateDecode)
+    ->ArgNames({"data", "block_size", "level"})
+    ->ArgsProduct({get_bench_data_type_args(), {16 << 10, 64 << 10}, {0, 4, 8}})
+    ->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "squeeze/compression/huffman_15.h"
+
+#include "bench_common/bench_data.h"
+
+namespace squeeze::compression::bench {
+
+using namespace bench_common;
+
+namespace {
+
+/** Encode the data block by block, each block with its own code, as the Huffman compression does. */
+bool huffman15_encode_blocks(const std::vector<char>& data, std::size_t block_size,
+                             std::vector<std::vector<char>>& blocks)
+{
+    blocks.resize((data.size() + block_size - 1) / block_size);
+    auto block_it = blocks.begin();
+    for (auto it = data.begin(); it != data.end(); ++block_it) {
+        const auto it_end = it + std::min<std::ptrdiff_t>(block_size, data.end() - it);
+        block_it->clear();
+        auto [in_it, out_it, s] = huffman15_encode(it, it_end, std::back_inserter(*block_it));
+        if (s.failed() || in_it != it_end) [[unlikely]]
+            return false;
+        it = it_end;
+    }
+    return true;
+}
+
+}
+
+static void BM_Huffman15Encode(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size);
+    const auto block_size = static_cast<std::size_t>(state.range(1));
+
+    std::vector<std::vector<char>> blocks;
+    for (auto _ : state) {
+        if (not huffman15_encode_blocks(data, block_size, blocks)) [[unlikely]] {
+            state.SkipWithError("failed encoding");
+            break;
+        }
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, data.size(), get_total_size(blocks));
+}
+
+static void BM_Huffman15Decode(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size);
+    const auto block_size = static_cast<std::size_t>(state.range(1));
+
+    std::vector<std::vector<char>> blocks;
+    if (not huffman15_encode_blocks(data, block_size, blocks)) [[unlikely]] {
+        state.SkipWithError("failed encoding");
+        return;
+    }
+
+    std::vector<char> output(data.size());
+    for (auto _ : state) {
+        auto out_it = output.begin();
+        for (const auto& block : blocks) {
+            const auto out_it_end = out_it + std::min<std::ptrdiff_t>(block_size, output.end() - out_it);
+            auto [rest_out_it, in_it, s] = huffman15_decode(out_it, out_it_end, block.begin(), block.end());
+            if (s.failed() || rest_out_it != out_it_end) [[unlikely]] {
+                state.SkipWithError("failed decoding");
+                break;
+            }
+            out_it = out_it_end;
+        }
+        benchmark::DoNotOptimize(output.data());
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, data.size(), get_total_size(blocks));
+}
+
+BENCHMARK(BM_Huffman15Encode)
+    ->ArgNames({"data", "block_size"})
+    ->ArgsProduct({get_bench_data_type_args(), {4 << 10, 32 << 10, 128 << 10}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_Huffman15Decode)
+    ->ArgNames({"data", "block_size"})
+    ->ArgsProduct({get_bench_data_type_args(), {4 << 10, 32 << 10, 128 << 10}})
+    ->Unit(benchmark::kMillisecond);
+
+}
@@ -0,0 +1,68 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "squeeze/compression/huffman.h"
+
+#include "test_tools/generators/prng.h"
+
+namespace squeeze::compression::bench {
+
+using test_tools::generators::PRNG;
+
+namespace {
+
+/** Generate the frequencies of the given number of symbols, roughly geometric as of the real data,
+ * with the given share of them being zero. */
+std::vector<Huffman<>::Freq> gen_freqs(std::size_t nr_freqs, unsigned zero_percentage)
+{
+    const PRNG prng(1234);
+    std::vector<Huffman<>::Freq> freqs(nr_freqs);
+    for (auto& freq : freqs)
+        freq = prng(0U, 99U) < zero_percentage ? 0 : (1U << prng(0U, 16U)) + prng(0U, 255U);
+    return freqs;
+}
+
+}
+
+/** Finding the code lengths of the deflate literal/length alphabet, as done for every block. */
+static void BM_HuffmanPackageMerge(benchmark::State& state)
+{
+    constexpr std::size_t nr_freqs = 286;
+    const auto freqs = gen_freqs(nr_freqs, static_cast<unsigned>(state.range(0)));
+    std::vector<Huffman<>::CodeLen> code_lens(nr_freqs);
+    for (auto _ : state) {
+        Huffman<>::find_code_lengths<nr_freqs>(freqs.begin(), code_lens.begin());
+        benchmark::DoNotOptimize(code_lens.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * nr_freqs);
+}
+
+/** Finding the code lengths of an alphabet of a runtime-known size, e.g. of the bytes. */
+static void BM_HuffmanPackageMergeDynamic(benchmark::State& state)
+{
+    const auto nr_freqs = static_cast<std::size_t>(state.range(0));
+    const auto freqs = gen_freqs(nr_freqs, static_cast<unsigned>(state.range(1)));
+    std::vector<Huffman<>::CodeLen> code_lens(nr_freqs);
+    for (auto _ : state) {
+        Huffman<>::find_code_lengths(freqs.begin(), nr_freqs, code_lens.begin());
+        benchmark::DoNotOptimize(code_lens.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * nr_freqs);
+}
+
+BENCHMARK(BM_HuffmanPackageMerge)
+    ->ArgNames({"zero_pct"})
+    ->Args({0})->Args({50})->Args({90});
+
+BENCHMARK(BM_HuffmanPackageMergeDynamic)
+    ->ArgNames({"nr_freqs", "zero_pct"})
+    ->ArgsProduct({{30, 256, 1024}, {0, 50}});
+
+}
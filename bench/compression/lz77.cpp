@@ -0,0 +1,87 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <iterator>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "squeeze/compression/lz77.h"
+#include "squeeze/compression/deflate_lz77.h"
+#include "squeeze/compression/config.h"
+
+#include "bench_common/bench_data.h"
+
+namespace squeeze::compression::bench {
+
+using namespace bench_common;
+
+namespace {
+
+void lz77_encode(const std::vector<char>& data, std::size_t level, std::vector<DeflateLZ77::PackedToken>& tokens)
+{
+    tokens.clear();
+    auto encoder = DeflateLZ77::make_encoder(get_lz77_encoder_params_for(level), data.begin(), data.end());
+    encoder.encode(std::back_inserter(tokens));
+}
+
+}
+
+/** The ratio reported is of the data size to the size of the packed tokens it's encoded to. */
+static void BM_LZ77Encode(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size);
+    const auto level = static_cast<std::size_t>(state.range(1));
+
+    std::vector<DeflateLZ77::PackedToken> tokens;
+    tokens.reserve(data.size());
+    for (auto _ : state) {
+        lz77_encode(data, level, tokens);
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, data.size(), tokens.size() * sizeof(DeflateLZ77::PackedToken));
+}
+
+static void BM_LZ77Decode(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size);
+    const auto level = static_cast<std::size_t>(state.range(1));
+
+    std::vector<DeflateLZ77::PackedToken> tokens;
+    lz77_encode(data, level, tokens);
+
+    std::vector<char> output;
+    output.reserve(data.size());
+    for (auto _ : state) {
+        output.clear();
+        auto decoder = DeflateLZ77::make_decoder(std::back_inserter(output));
+        for (std::size_t i = 0; i < tokens.size(); ++i) {
+            const DeflateLZ77::PackedToken token = tokens[i];
+            if (not token.is_len_dist()) {
+                decoder.decode_once(token.get_literal());
+                continue;
+            }
+            const DeflateLZ77::DistExtra dist_extra = tokens[++i].get_dist_extra();
+            if (decoder.decode_once(token.get_len_sym(), token.get_len_extra(),
+                                    token.get_dist_sym(), dist_extra).failed()) [[unlikely]] {
+                state.SkipWithError("failed decoding");
+                break;
+            }
+        }
+        benchmark::ClobberMemory();
+    }
+    set_throughput(state, data.size(), tokens.size() * sizeof(DeflateLZ77::PackedToken));
+}
+
+BENCHMARK(BM_LZ77Encode)
+    ->ArgNames({"data", "level"})
+    ->ArgsProduct({get_bench_data_type_args(), {0, 2, 4, 6, 8}})
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_LZ77Decode)
+    ->ArgNames({"data", "level"})
+    ->ArgsProduct({get_bench_data_type_args(), {0, 8}})
+    ->Unit(benchmark::kMillisecond);
+
+}
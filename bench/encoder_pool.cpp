@@ -0,0 +1,89 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <algorithm>
+#include <future>
+#include <span>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "squeeze/encoder_pool.h"
+#include "squeeze/compression/config.h"
+
+#include "bench_common/bench_data.h"
+
+namespace squeeze::bench {
+
+using namespace bench_common;
+
+/** Encoding the data split into blocks of the compression block size, scheduled all at once,
+ * as the appender does for the content of a file. */
+static void BM_EncoderPoolEncodeBlocks(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size * 4);
+    const CompressionParams compression {
+        .method = compression::CompressionMethod::Deflate, .level = static_cast<uint8_t>(state.range(1))
+    };
+    const std::size_t block_size = compression::get_block_size(compression);
+
+    EncoderPool encoder_pool;
+    std::vector<std::future<EncodedBuffer>> futures;
+    uint64_t encoded_size = 0;
+    for (auto _ : state) {
+        futures.clear();
+        for (std::size_t pos = 0; pos < data.size(); pos += block_size) {
+            const std::size_t size = std::min(block_size, data.size() - pos);
+            futures.push_back(encoder_pool.schedule_buffer_encode(
+                        Buffer(data.begin() + pos, data.begin() + pos + size), compression));
+        }
+        encoded_size = 0;
+        for (auto& future : futures) {
+            auto [encoded, s] = future.get();
+            if (s.failed()) [[unlikely]] {
+                state.SkipWithError("failed encoding");
+                break;
+            }
+            encoded_size += encoded.size();
+        }
+    }
+    set_throughput(state, data.size(), encoded_size);
+}
+
+/** Encoding many small independent buffers into one arena. */
+static void BM_EncoderPoolEncodeBatch(benchmark::State& state)
+{
+    const std::vector<char>& data = get_bench_data(state, 0, default_bench_data_size * 4);
+    const auto buffer_size = static_cast<std::size_t>(state.range(1));
+    const CompressionParams compression {.method = compression::CompressionMethod::Deflate, .level = 4};
+
+    std::vector<std::span<const char>> inputs;
+    for (std::size_t pos = 0; pos < data.size(); pos += buffer_size)
+        inputs.emplace_back(data.data() + pos, std::min(buffer_size, data.size() - pos));
+
+    EncoderPool encoder_pool;
+    Buffer arena;
+    std::vector<uint64_t> offsets;
+    for (auto _ : state) {
+        if (encoder_pool.encode_batch(inputs, arena, offsets, compression).failed()) [[unlikely]] {
+            state.SkipWithError("failed encoding");
+            break;
+        }
+    }
+    set_throughput(state, data.size(), arena.size());
+}
+
+BENCHMARK(BM_EncoderPoolEncodeBlocks)
+    ->ArgNames({"data", "level"})
+    ->ArgsProduct({get_bench_data_type_args(), {1, 4, 8}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+BENCHMARK(BM_EncoderPoolEncodeBatch)
+    ->ArgNames({"data", "buffer_size"})
+    ->ArgsProduct({get_bench_data_type_args(), {256, 4 << 10}})
+    ->Unit(benchmark::kMillisecond)
+    ->UseRealTime();
+
+}
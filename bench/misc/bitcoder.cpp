@@ -0,0 +1,87 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <cstdint>
+#include <iterator>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "squeeze/misc/bitcoder.h"
+
+#include "test_tools/generators/prng.h"
+
+namespace squeeze::misc::bench {
+
+using test_tools::generators::PRNG;
+
+namespace {
+
+constexpr std::size_t nr_codes = 1 << 16;
+
+/** Codes of random bit widths within [1, max_nr_bits], as of Huffman codes along with their extra bits. */
+struct Codes {
+    std::vector<uint16_t> bits;
+    std::vector<uint8_t> nr_bits;
+    uint64_t total_nr_bits = 0;
+};
+
+Codes gen_codes(std::size_t max_nr_bits)
+{
+    const PRNG prng(1234);
+    Codes codes;
+    codes.bits.resize(nr_codes);
+    codes.nr_bits.resize(nr_codes);
+    for (std::size_t i = 0; i < nr_codes; ++i) {
+        codes.nr_bits[i] = static_cast<uint8_t>(prng(std::size_t(1), max_nr_bits));
+        codes.bits[i] = static_cast<uint16_t>(prng(0U, (1U << codes.nr_bits[i]) - 1));
+        codes.total_nr_bits += codes.nr_bits[i];
+    }
+    return codes;
+}
+
+}
+
+static void BM_BitEncoder(benchmark::State& state)
+{
+    const Codes codes = gen_codes(static_cast<std::size_t>(state.range(0)));
+    std::vector<char> output;
+    output.reserve(codes.total_nr_bits / CHAR_BIT + 1);
+    for (auto _ : state) {
+        output.clear();
+        auto bit_encoder = make_bit_encoder(std::back_inserter(output));
+        for (std::size_t i = 0; i < nr_codes; ++i)
+            bit_encoder.encode_bits(codes.bits[i], codes.nr_bits[i]);
+        bit_encoder.finalize();
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * nr_codes);
+    state.SetBytesProcessed(state.iterations() * output.size());
+}
+
+static void BM_BitDecoder(benchmark::State& state)
+{
+    const Codes codes = gen_codes(static_cast<std::size_t>(state.range(0)));
+    std::vector<char> input;
+    auto bit_encoder = make_bit_encoder(std::back_inserter(input));
+    for (std::size_t i = 0; i < nr_codes; ++i)
+        bit_encoder.encode_bits(codes.bits[i], codes.nr_bits[i]);
+    bit_encoder.finalize();
+
+    for (auto _ : state) {
+        auto bit_decoder = make_bit_decoder(input.begin(), input.end());
+        uint16_t bits = 0;
+        for (std::size_t i = 0; i < nr_codes; ++i) {
+            bit_decoder.decode_bits(bits, codes.nr_bits[i]);
+            benchmark::DoNotOptimize(bits);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * nr_codes);
+    state.SetBytesProcessed(state.iterations() * input.size());
+}
+
+BENCHMARK(BM_BitEncoder)->ArgName("max_nr_bits")->Arg(1)->Arg(8)->Arg(15);
+BENCHMARK(BM_BitDecoder)->ArgName("max_nr_bits")->Arg(1)->Arg(8)->Arg(15);
+
+}
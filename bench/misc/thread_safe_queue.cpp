@@ -0,0 +1,55 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <thread>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+
+#include "squeeze/misc/thread_safe_queue.h"
+
+namespace squeeze::misc::bench {
+
+namespace {
+
+constexpr std::size_t nr_items = 1 << 16;
+
+}
+
+/** Pushing and popping on the same thread, i.e. the uncontended cost of an operation. */
+static void BM_ThreadSafeQueuePushPop(benchmark::State& state)
+{
+    ThreadSafeQueue<std::size_t> queue;
+    for (auto _ : state) {
+        for (std::size_t i = 0; i < nr_items; ++i)
+            queue.push(std::size_t(i));
+        for (std::size_t i = 0; i < nr_items; ++i)
+            benchmark::DoNotOptimize(queue.try_pop());
+    }
+    state.SetItemsProcessed(state.iterations() * nr_items);
+}
+
+/** Producer threads pushing concurrently while the benchmark thread waits for and pops the items. */
+static void BM_ThreadSafeQueueProducerConsumer(benchmark::State& state)
+{
+    const auto nr_producers = static_cast<std::size_t>(state.range(0));
+    for (auto _ : state) {
+        ThreadSafeQueue<std::size_t> queue;
+        std::vector<std::jthread> producers;
+        for (std::size_t p = 0; p < nr_producers; ++p)
+            producers.emplace_back([&queue, nr_producers]()
+            {
+                for (std::size_t i = 0; i < nr_items / nr_producers; ++i)
+                    queue.push(std::size_t(i));
+            });
+        for (std::size_t i = 0; i < nr_items / nr_producers * nr_producers; ++i)
+            benchmark::DoNotOptimize(queue.try_wait_and_pop());
+    }
+    state.SetItemsProcessed(state.iterations() * nr_items);
+}
+
+BENCHMARK(BM_ThreadSafeQueuePushPop);
+BENCHMARK(BM_ThreadSafeQueueProducerConsumer)->ArgName("producers")->Arg(1)->Arg(2)->Arg(4)->UseRealTime();
+
+}
@@ -0,0 +1,315 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <zlib.h>
+
+#include "squeeze/compression/config.h"
+#include "squeeze/compression/deflate.h"
+#include "squeeze/compression/huffman_15.h"
+
+#include "bench_common/bench_corpus.h"
+
+namespace {
+
+using namespace squeeze;
+using namespace squeeze::bench_common;
+
+/** Result of compressing and decompressing a corpus file with a codec at a level. */
+struct CodecResult {
+    std::string_view codec;
+    int level = 0;
+    std::size_t input_size = 0;
+    std::size_t output_size = 0;
+    double compress_seconds = 0;
+    double decompress_seconds = 0;
+    bool round_trip = false;
+};
+
+/** Measure the average time of running the function, running it repeatedly for at least the given time. */
+template<typename F>
+double measure(F&& f, double min_seconds)
+{
+    using Clock = std::chrono::steady_clock;
+    std::size_t nr_runs = 0;
+    const auto start = Clock::now();
+    std::chrono::duration<double> elapsed {};
+    do {
+        f();
+        ++nr_runs;
+        elapsed = Clock::now() - start;
+    } while (elapsed.count() < min_seconds);
+    return elapsed.count() / static_cast<double>(nr_runs);
+}
+
+/** Deflate the data as a single raw stream of blocks of the compression block size of the level,
+ * each block primed with the data preceding it, the way the blocks of an entry are deflated. */
+bool squeeze_deflate(std::span<const char> data, int level, std::vector<char>& output)
+{
+    using compression::DeflateHeaderBits;
+    const std::size_t block_size = compression::get_block_size({compression::CompressionMethod::Deflate,
+                                                                static_cast<uint8_t>(level)});
+    output.clear();
+    auto bit_encoder = misc::make_bit_encoder(std::back_inserter(output));
+    for (std::size_t pos = 0; pos < data.size() || pos == 0; pos += block_size) {
+        const std::size_t size = std::min(block_size, data.size() - pos);
+        compression::DeflateParams params = compression::get_deflate_params_for_level(level);
+        params.header_bits = DeflateHeaderBits::DynamicHuffman |
+            (pos + size == data.size() ? DeflateHeaderBits::FinalBlock : DeflateHeaderBits{});
+        const std::size_t dictionary_size = std::min(pos, compression::max_dictionary_size);
+        const auto block = data.subspan(pos, size);
+        auto [in_it, s] = compression::deflate(params, bit_encoder, block.begin(), block.end(),
+                                               data.subspan(pos - dictionary_size, dictionary_size));
+        if (s.failed()) [[unlikely]]
+            return false;
+        if (size == 0)
+            break;
+    }
+    bit_encoder.finalize();
+    return true;
+}
+
+/** Inflate a raw stream of blocks till the final one, each block primed with the data decoded before it. */
+bool squeeze_inflate(std::span<const char> input, std::vector<char>& output)
+{
+    using compression::DeflateHeaderBits;
+    auto bit_decoder = misc::make_bit_decoder(input.begin(), input.end());
+    auto out_it = output.begin();
+    while (true) {
+        const std::size_t pos = out_it - output.begin();
+        const std::size_t dictionary_size = std::min(pos, compression::max_dictionary_size);
+        auto [block_out_it, header_bits, s] = compression::inflate(out_it, output.end(), bit_decoder,
+                std::span<const char>(output).subspan(pos - dictionary_size, dictionary_size));
+        if (s.failed()) [[unlikely]]
+            return false;
+        out_it = block_out_it;
+        if ((header_bits & DeflateHeaderBits::FinalBlock) == DeflateHeaderBits::FinalBlock)
+            return out_it == output.end();
+    }
+}
+
+/** Huffman encode the data as a single bit stream of blocks of the compression block size of the level,
+ * each block with its own code and the final one terminated, as the Huffman compression does. */
+bool squeeze_huffman_encode(std::span<const char> data, int level, std::vector<char>& output)
+{
+    const std::size_t block_size = compression::get_block_size({compression::CompressionMethod::Huffman,
+                                                                static_cast<uint8_t>(level)});
+    output.clear();
+    auto bit_encoder = misc::make_bit_encoder(std::back_inserter(output));
+    for (std::size_t pos = 0; pos < data.size(); pos += block_size) {
+        const auto block = data.subspan(pos, std::min(block_size, data.size() - pos));
+        auto [in_it, s] = pos + block.size() == data.size() ?
+            compression::huffman15_encode<true>(bit_encoder, block.begin(), block.end())
+            :
+            compression::huffman15_encode<false>(bit_encoder, block.begin(), block.end())
+        ;
+        if (s.failed()) [[unlikely]]
+            return false;
+    }
+    bit_encoder.finalize();
+    return true;
+}
+
+bool squeeze_huffman_decode(std::span<const char> input, int level, std::vector<char>& output)
+{
+    const std::size_t block_size = compression::get_block_size({compression::CompressionMethod::Huffman,
+                                                                static_cast<uint8_t>(level)});
+    auto bit_decoder = misc::make_bit_decoder(input.begin(), input.end());
+    for (auto out_it = output.begin(); out_it != output.end();) {
+        const auto out_it_end = out_it + std::min<std::ptrdiff_t>(block_size, output.end() - out_it);
+        auto [rest_out_it, s] = out_it_end == output.end() ?
+            compression::huffman15_decode<true>(out_it, out_it_end, bit_decoder)
+            :
+            compression::huffman15_decode<false>(out_it, out_it_end, bit_decoder)
+        ;
+        if (s.failed() || rest_out_it != out_it_end) [[unlikely]]
+            return false;
+        out_it = out_it_end;
+    }
+    return true;
+}
+
+/** Deflate the data as a raw stream, i.e. without the zlib header and trailer, as Squeeze does. */
+bool zlib_deflate(std::span<const char> data, int level, int strategy, std::vector<char>& output)
+{
+    z_stream stream {};
+    if (deflateInit2(&stream, level, Z_DEFLATED, -MAX_WBITS, 8, strategy) != Z_OK) [[unlikely]]
+        return false;
+    output.resize(deflateBound(&stream, static_cast<uLong>(data.size())));
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    const int ret = ::deflate(&stream, Z_FINISH);
+    output.resize(stream.total_out);
+    deflateEnd(&stream);
+    return ret == Z_STREAM_END;
+}
+
+bool zlib_inflate(std::span<const char> input, std::vector<char>& output)
+{
+    z_stream stream {};
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) [[unlikely]]
+        return false;
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(input.data()));
+    stream.avail_in = static_cast<uInt>(input.size());
+    stream.next_out = reinterpret_cast<Bytef *>(output.data());
+    stream.avail_out = static_cast<uInt>(output.size());
+    const int ret = ::inflate(&stream, Z_FINISH);
+    const bool finished = ret == Z_STREAM_END && stream.total_out == output.size();
+    inflateEnd(&stream);
+    return finished;
+}
+
+template<typename Compress, typename Decompress>
+CodecResult run_codec(std::string_view codec, int level, const std::vector<char>& data, double min_seconds,
+                      Compress&& compress, Decompress&& decompress)
+{
+    CodecResult result {.codec = codec, .level = level, .input_size = data.size()};
+    std::vector<char> compressed, decompressed(data.size());
+    bool succeeded = true;
+    result.compress_seconds = measure([&]() { succeeded = compress(data, compressed) && succeeded; },
+                                      min_seconds);
+    result.output_size = compressed.size();
+    result.decompress_seconds = measure([&]() { succeeded = decompress(compressed, decompressed) && succeeded; },
+                                        min_seconds);
+    result.round_trip = succeeded && decompressed == data;
+    return result;
+}
+
+void print_result(std::string_view file_name, const CodecResult& result)
+{
+    auto mb_per_second = [&result](double seconds)
+    {
+        return seconds > 0 ? static_cast<double>(result.input_size) / seconds / 1e6 : 0.0;
+    };
+    std::cout << std::left << std::setw(16) << file_name << std::setw(18) << result.codec
+              << std::right << std::setw(6) << result.level
+              << std::setw(12) << result.input_size << std::setw(12) << result.output_size
+              << std::fixed << std::setprecision(3)
+              << std::setw(9) << (result.output_size ? double(result.input_size) / result.output_size : 0.0)
+              << std::setprecision(2)
+              << std::setw(12) << mb_per_second(result.compress_seconds)
+              << std::setw(12) << mb_per_second(result.decompress_seconds)
+              << "  " << (result.round_trip ? "ok" : "FAILED") << '\n';
+}
+
+void print_header()
+{
+    std::cout << std::left << std::setw(16) << "file" << std::setw(18) << "codec"
+              << std::right << std::setw(6) << "level" << std::setw(12) << "size" << std::setw(12) << "compressed"
+              << std::setw(9) << "ratio" << std::setw(12) << "comp MB/s" << std::setw(12) << "decomp MB/s"
+              << "  round trip\n";
+}
+
+/** Decode the raw deflate stream of each codec with the other one, to catch the formats drifting apart.
+ * Squeeze doesn't decode the stored and the fixed Huffman blocks zlib emits for the data that
+ * doesn't compress, or is too small to, and zlib doesn't decode the run blocks of Squeeze. */
+void print_cross_decode(std::string_view file_name, const std::vector<char>& data)
+{
+    std::vector<char> compressed, decompressed(data.size());
+    const bool squeeze_to_zlib = squeeze_deflate(data, 4, compressed) && zlib_inflate(compressed, decompressed) &&
+                                 decompressed == data;
+    std::fill(decompressed.begin(), decompressed.end(), 0);
+    const bool zlib_to_squeeze = zlib_deflate(data, 6, Z_DEFAULT_STRATEGY, compressed) &&
+                                 squeeze_inflate(compressed, decompressed) && decompressed == data;
+    std::cout << std::left << std::setw(16) << file_name
+              << std::setw(22) << (squeeze_to_zlib ? "ok" : "incompatible")
+              << (zlib_to_squeeze ? "ok" : "incompatible") << '\n';
+}
+
+void usage()
+{
+    std::cerr <<
+R""""(Usage: bench_zlib [-options]
+Compare the Squeeze Deflate and Huffman codecs against zlib on a corpus, reporting the compression ratios
+and the throughputs, and check whether the raw deflate streams of each one decode with the other one.
+Options:
+    --corpus <dir>      Use the files of the directory, e.g. the Silesia corpus, instead of generating a corpus
+    --size <bytes>      Size of each generated corpus file, or the max size read of each given one (4 MiB)
+    --min-time <ms>     Min time to run each measurement for, repeatedly (200 ms)
+    -h, --help          Display usage information
+)"""";
+}
+
+bool parse_size(std::string_view str, std::size_t& size)
+{
+    auto [ptr, ec] = std::from_chars(str.data(), str.data() + str.size(), size);
+    return ec == std::errc() && ptr == str.data() + str.size();
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    std::string corpus_dir;
+    std::size_t file_size = 4 << 20;
+    std::size_t min_time_ms = 200;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        const bool has_value = i + 1 < argc;
+        if (arg == "--corpus" && has_value) {
+            corpus_dir = argv[++i];
+        } else if (arg == "--size" && has_value && parse_size(argv[i + 1], file_size)) {
+            ++i;
+        } else if (arg == "--min-time" && has_value && parse_size(argv[i + 1], min_time_ms)) {
+            ++i;
+        } else {
+            usage();
+            return arg == "-h" || arg == "--help" ? EXIT_SUCCESS : EXIT_FAILURE;
+        }
+    }
+
+    const std::vector<CorpusFile> corpus = corpus_dir.empty() ? gen_corpus(file_size) :
+                                                                load_corpus(corpus_dir, file_size);
+    if (corpus.empty()) {
+        std::cerr << "Error: no corpus files - " << corpus_dir << '\n';
+        return EXIT_FAILURE;
+    }
+    const double min_seconds = static_cast<double>(min_time_ms) / 1e3;
+
+    std::cout << "zlib " << zlibVersion() << '\n';
+    print_header();
+    bool succeeded = true;
+    for (const auto& [name, data] : corpus) {
+        std::vector<CodecResult> results;
+        for (int level = 0; level <= compression::max_level_per_method[2]; level += 2)
+            results.push_back(run_codec("squeeze-deflate", level, data, min_seconds,
+                [level](const auto& in, auto& out) { return squeeze_deflate(in, level, out); },
+                [](const auto& in, auto& out) { return squeeze_inflate(in, out); }));
+        for (int level = 1; level <= Z_BEST_COMPRESSION; level += 2)
+            results.push_back(run_codec("zlib-deflate", level, data, min_seconds,
+                [level](const auto& in, auto& out) { return zlib_deflate(in, level, Z_DEFAULT_STRATEGY, out); },
+                [](const auto& in, auto& out) { return zlib_inflate(in, out); }));
+        for (int level : {1, 4, 8})
+            results.push_back(run_codec("squeeze-huffman", level, data, min_seconds,
+                [level](const auto& in, auto& out) { return squeeze_huffman_encode(in, level, out); },
+                [level](const auto& in, auto& out) { return squeeze_huffman_decode(in, level, out); }));
+        results.push_back(run_codec("zlib-huffman", Z_DEFAULT_COMPRESSION, data, min_seconds,
+            [](const auto& in, auto& out) { return zlib_deflate(in, Z_DEFAULT_COMPRESSION, Z_HUFFMAN_ONLY, out); },
+            [](const auto& in, auto& out) { return zlib_inflate(in, out); }));
+
+        for (const auto& result : results) {
+            print_result(name, result);
+            succeeded = succeeded && result.round_trip;
+        }
+    }
+
+    std::cout << '\n' << std::left << std::setw(16) << "file" << std::setw(22) << "squeeze -> zlib"
+              << "zlib -> squeeze" << '\n';
+    for (const auto& [name, data] : corpus)
+        print_cross_decode(name, data);
+
+    return succeeded ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstddef>
+
+#include "printing.h"
+
+namespace squeeze {
+
+/** Solid mode parameters.
+ * In solid mode the contents of consecutive regular files are concatenated into solid groups,
+ * each compressed as a single stream and stored in a hidden blob entry, while the file entries
+ * themselves only refer to their ranges within the groups. This lets the compression
+ * make use of the redundancy across the files. */
+struct SolidParams {
+    /** Max size of a solid group. Zero disables the solid mode. */
+    std::size_t group_size = 0;
+    /** Order the files by their extensions to bring similar contents closer together. */
+    bool sort_by_extension = false;
+};
+
+/** Solid group size used when the solid mode is enabled without specifying one. */
+inline constexpr std::size_t default_solid_group_size = std::size_t(4) << 20;
+
+/** Deduplication parameters.
+ * With deduplication the contents of regular files are split into content-defined chunks,
+ * each stored once in a hidden blob entry named after the chunk hash, while the file entries
+ * themselves only refer to the chunks. Chunks already present in the archive, or repeated
+ * within the appended files, are referred to instead of being stored again.
+ * Combined with the solid mode, the new chunks are grouped into the solid groups, in which case
+ * only the chunks repeated within the same batch of appends are deduplicated. */
+struct DedupParams {
+    /** Average chunk size. Zero disables the chunking. */
+    std::size_t avg_chunk_size = 0;
+    /** Deduplicate whole files only, without chunking: the first file of a content is stored as is,
+     * while the following ones of the same content within the same batch of appends refer to its content,
+     * see EntryContentLayout::Duplicate. Cheaper than the chunking, as the files are hashed while being read,
+     * and only those of the sizes met already are hashed ahead. Applies to seekable targets only,
+     * and only the seekable contents may turn out to be duplicates, as those need to be hashed ahead.
+     * Combined with the solid mode, the files of the same content refer to the same blob data instead. */
+    bool whole_files = false;
+};
+
+/** Average chunk size used when the deduplication is enabled without specifying one. */
+inline constexpr std::size_t default_dedup_avg_chunk_size = std::size_t(1) << 15;
+
+/** Delta update parameters.
+ * With delta updates, updating a regular file entry encodes its new content using the previous
+ * content as a base: each block of the new content is primed with the base data around the same
+ * position as a preset dictionary, so the unchanged data costs only a few back references.
+ * The base is kept in a hidden blob entry referred to by the updated entry, and is reused by the
+ * subsequent updates until the deltas grow too large relative to it, after which the entry is
+ * rebased onto its latest previous content. An unchanged content is stored as before instead.
+ * The delta updates are appended ahead of the rest, one by one, so only a single base is held in memory.
+ * Applies to the compression methods supporting preset dictionaries, i.e. Deflate, only,
+ * and only to the entries storing their contents themselves, rather than referring to blobs as in solid
+ * or dedup mode. */
+struct DeltaParams {
+    bool enabled = false;
+    /** Max size of a delta in percents of the encoded size of its base before rebasing. */
+    unsigned max_delta_percent = 50;
+};
+
+/** Parameters of the append operations. */
+struct AppendParams {
+    SolidParams solid {};
+    DedupParams dedup {};
+    DeltaParams delta {};
+    /** Encode the entry headers in the compact format, with varints and front-coded paths.
+     * See EntryHeader for the format details. */
+    bool compact_headers = false;
+
+    /** Whether the appended contents may be stored in blob entries. */
+    inline bool stores_blobs() const noexcept
+    {
+        return solid.group_size != 0 || dedup.avg_chunk_size != 0 || dedup.whole_files || delta.enabled;
+    }
+};
+
+}
+
+template<> inline void squeeze::print_to(std::ostream& os, const SolidParams& solid)
+{
+    print_to(os, "{ group_size=", solid.group_size, ", sort_by_extension=", solid.sort_by_extension, " }");
+}
+
+template<> inline void squeeze::print_to(std::ostream& os, const DedupParams& dedup)
+{
+    print_to(os, "{ avg_chunk_size=", dedup.avg_chunk_size, ", whole_files=", dedup.whole_files, " }");
+}
+
+template<> inline void squeeze::print_to(std::ostream& os, const DeltaParams& delta)
+{
+    print_to(os, "{ enabled=", delta.enabled, ", max_delta_percent=", delta.max_delta_percent, " }");
+}
+
+template<> inline void squeeze::print_to(std::ostream& os, const AppendParams& params)
+{
+    print_to(os, "{ solid=", params.solid, ", dedup=", params.dedup, ", delta=", params.delta,
+                 ", compact_headers=", params.compact_headers, " }");
+}
@@ -9,12 +9,30 @@
 
 #include "common.h"
 #include "entry_header.h"
+#include "entry_reference.h"
 #include "misc/task_scheduler.h"
 
 namespace squeeze {
 
 class EntryAppendScheduler;
 
+/** State shared by the entry appends performed by a single run. */
+struct AppendRunState {
+    /** Path of the previously appended entry, the path of a compact header is front-coded against.
+     * The first entry of a run doesn't get any path prefix. */
+    std::string previous_path;
+    /** Whether the target isn't seekable, in which case the entry contents are framed, see EntryFrames. */
+    bool streaming = false;
+};
+
+/** Position and size of the encoded content of an entry, assigned once the entry gets appended. */
+struct AppendedContent {
+    uint64_t pos = npos;
+    uint64_t size = 0;
+
+    static constexpr uint64_t npos = uint64_t(-1);
+};
+
 /** This class is responsible for scheduling append operations and
  * providing run() method to execute the scheduled tasks.
  * Each append task is an entry append task which is itself a scheduler of type
@@ -29,13 +47,13 @@ public:
 
     /** EntryAppendScheduler wrapped as a task in a callable format. */
     struct Task {
-        Task(EntryHeader entry_header, Stat *stat) noexcept;
+        Task(EntryHeader entry_header, Stat *stat, AppendedContent *appended_content) noexcept;
         ~Task();
 
         Task(Task&&) = default;
         Task& operator=(Task&&) = default;
 
-        void operator()(std::ostream& target, bool& succeeded);
+        void operator()(std::ostream& target, bool& succeeded, AppendRunState& state);
 
         std::unique_ptr<EntryAppendScheduler> scheduler;
     };
@@ -45,8 +63,10 @@ public:
 
     /** Schedule (more like start scheduling) appending a new entry and finalize the previous append.
      * The runner is responsible for encoding the entry header and passing a status via
-     * the optional status pointer if needed. */
-    void schedule_entry_append(EntryHeader&& entry_header, Stat *error = nullptr);
+     * the optional status pointer if needed. The optional appended content gets assigned the range
+     * of the entry content once appended to a seekable target, and must outlive the run. */
+    void schedule_entry_append(EntryHeader&& entry_header, Stat *error = nullptr,
+                               AppendedContent *appended_content = nullptr);
     /** Schedule error raise operation. This is necessary if an error occurs during
      * the scheduling after it has already been partially done.
      * NOTE: calling the method after finalize_entry_append() will result in a null pointer access
@@ -65,19 +85,33 @@ public:
      * NOTE: calling the method after finalize_entry_append() will result in null pointer access
      * and therefore is undefined. It must be called only after schedule_entry_append(). */
     void schedule_string_append(std::string&& str);
+    /** Schedule file data append operation, taking over the file descriptor. The runner will copy the range
+     * of the file to the target right between the files, so the target must be a seekable file.
+     * NOTE: calling the method after finalize_entry_append() will result in null pointer access
+     * and therefore is undefined. It must be called only after schedule_entry_append(). */
+    void schedule_file_data_append(int fd, uint64_t pos, uint64_t size);
+    /** Schedule dependency check operation. The runner will fail the entry append if the
+     * dependency status, assigned by a previously run entry append, is a failure.
+     * The dependency status must outlive the run.
+     * NOTE: calling the method after finalize_entry_append() will result in null pointer access
+     * and therefore is undefined. It must be called only after schedule_entry_append(). */
+    void schedule_dependency_check(const Stat& dependency);
+    /** Schedule content reference append operation. The runner will append the reference to the content
+     * of a previously run entry append, see EntryReference, failing the entry append if that one wasn't
+     * appended. The appended content must outlive the run.
+     * NOTE: calling the method after finalize_entry_append() will result in null pointer access
+     * and therefore is undefined. It must be called only after schedule_entry_append(). */
+    void schedule_content_reference_append(const BlobId& blob_id, const AppendedContent& appended_content);
     /** Finalize the current entry append task. No more subsequent scheduling can be done on it.
      * The runner of the entry append task will return after completing all the pre-scheduled tasks. */
     void finalize_entry_append() noexcept;
 
     /** Run the scheduled tasks on the target output stream.
-     * Supposed to be called asynchronously while scheduling being done synchronously. */
-    inline bool run(std::ostream& target)
-    {
-        bool succeeded = true;
-        scheduler.run(target, succeeded);
-        scheduler.open();
-        return succeeded;
-    }
+     * Supposed to be called asynchronously while scheduling being done synchronously.
+     * The entries are written to the target in large batches, and the content sizes of those
+     * still in the batch are patched in memory. The entries appended to a non-seekable target,
+     * e.g. a pipe, have framed contents instead, as their content sizes can't be patched. */
+    bool run(std::ostream& target);
 
     /** Finalize the scheduler.
      * If the run() method was already running (perhaps in some other thread),
@@ -117,7 +151,7 @@ private:
     };
 
 public:
-    EntryAppendScheduler(EntryHeader entry_header, Stat *error);
+    EntryAppendScheduler(EntryHeader entry_header, Stat *error, AppendedContent *appended_content = nullptr);
     ~EntryAppendScheduler();
 
     /** Schedule error raise operation. The runner will set the error pointer if (valid) and return.
@@ -130,6 +164,14 @@ public:
     void schedule_buffer_append(Buffer&& buffer);
     /** Schedule string append operation. The runner will just append it to the target. */
     void schedule_string_append(std::string&& str);
+    /** Schedule file data append operation, taking over the file descriptor.
+     * The runner will copy the range of the file to the target right between the files. */
+    void schedule_file_data_append(int fd, uint64_t pos, uint64_t size);
+    /** Schedule dependency check operation. The runner will fail if the dependency status is a failure. */
+    void schedule_dependency_check(const Stat& dependency);
+    /** Schedule content reference append operation. The runner will append the reference to the appended
+     * content, failing if it hasn't been appended. */
+    void schedule_content_reference_append(const BlobId& blob_id, const AppendedContent& appended_content);
 
     /** Finalize the scheduler. No more block append operations can be scheduled afterwards. */
     inline void finalize() noexcept
@@ -137,17 +179,22 @@ public:
         scheduler.close();
     }
 
-    /** Run the scheduled tasks on the target output stream. */
-    inline bool run(std::ostream& target)
+    /** Run the scheduled tasks on the target output stream.
+     * The path of the previously appended entry is used for front-coding the path of
+     * a compact entry header, and gets updated with the path of the entry once appended. */
+    inline bool run(std::ostream& target, AppendRunState& state)
     {
-        return set_status(run_internal(target));
+        return set_status(run_internal(target, state));
     }
 
 private:
-    Stat run_internal(std::ostream& target);
+    Stat run_internal(std::ostream& target, AppendRunState& state);
+    /** Append the entry with its content framed, to a non-seekable target. */
+    Stat run_framed(std::ostream& target);
     bool set_status(Stat&& s);
 
     Stat *status;
+    AppendedContent *appended_content;
     EntryHeader entry_header;
     misc::TaskScheduler<Task> scheduler;
 };
@@ -5,11 +5,17 @@
 #pragma once
 
 #include <ostream>
+#include <span>
+#include <string>
 #include <vector>
 #include <memory>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 
 #include "entry_input.h"
+#include "append_params.h"
+#include "entry_reference.h"
 #include "status.h"
 #include "append_scheduler.h"
 #include "encoder_pool.h"
@@ -40,10 +46,41 @@ protected:
         Stat *status;
     };
 
+    struct ReferringEntry;
+    struct BlobState;
+
+    /** Base content a registered append gets delta encoded against. */
+    struct DeltaBase {
+        /** Identifier of the blob holding the base content. */
+        BlobId blob_id;
+        /** The uncompressed base content. */
+        std::string content;
+        /** The already encoded base content to append as the blob if it doesn't exist,
+         * or empty if the content has to be encoded. */
+        Buffer encoded;
+        /** Compression params of the encoded base content. */
+        CompressionParams compression;
+        /** Identifier of the base content if it's the previous content itself rather than an older one,
+         * so that an unchanged content can be told and stored as before instead of as a delta. */
+        BlobId content_id;
+    };
+
 public:
     explicit Appender(std::ostream& target);
     ~Appender();
 
+    /** Set the parameters of the append operations. */
+    inline void set_params(const AppendParams& params)
+    {
+        this->params = params;
+    }
+
+    /** Get the parameters of the append operations. */
+    inline const AppendParams& get_params() const
+    {
+        return params;
+    }
+
     /** Register a future append operation by creating an entry input with the supplied type and parameters.
      * The entry input memory will be managed by the interface. */
     template<typename T, typename ...Args>
@@ -94,16 +131,58 @@ protected:
         return scheduler.run(target);
     }
 
+    /** Looks into the target before it gets written concurrently by the scheduled tasks. */
+    void inspect_target();
     /** Schedules all registered appends. */
     bool schedule_appends();
     /** Schedules a single registered append. */
     bool schedule_append(FutureAppend& future_append);
+    /** Sets the original size of an entry its input didn't set it for, if it's known from its content. */
+    static void init_original_size(EntryHeader& entry_header, const EntryInput::ContentType& content);
+    /** Schedules a registered regular file stream append in solid mode.
+     * The stream is read into the current solid group and the entry append itself is deferred
+     * until all the blobs holding its content have been scheduled. */
+    bool schedule_solid_append(EntryHeader&& entry_header, std::istream& stream, Stat *status);
+    /** Schedules a registered regular file stream append with deduplication.
+     * The stream is split into chunks, the new ones of which are put into blobs, and the entry
+     * append itself is deferred until all the blobs holding its content have been scheduled. */
+    bool schedule_dedup_append(EntryHeader&& entry_header, std::istream& stream, Stat *status);
+    /** Schedules a registered regular file stream append with whole file deduplication.
+     * If the same content has been appended already within the batch, the entry refers to the content
+     * of that entry instead, in the Duplicate content layout, otherwise the content is appended as is.
+     * The stream content is hashed ahead only if its size has been met already, otherwise while it's read. */
+    bool schedule_whole_file_dedup_append(EntryHeader&& entry_header, std::istream& stream, Stat *status);
+    /** Schedules a registered regular file stream append in the Sparse content layout.
+     * The stream begins with the extent map, which is stored uncompressed ahead of the data. */
+    bool schedule_sparse_append(EntryHeader&& entry_header, std::istream& stream, Stat *status);
+    /** Schedules a registered regular file stream append delta encoded against the given base.
+     * The base blob gets appended first if it doesn't exist yet. */
+    bool schedule_delta_append(EntryHeader&& entry_header, std::istream& stream, Stat *status,
+                               DeltaBase& base);
+    /** Hashes the whole stream content and rewinds the stream back.
+     * Leaves the identifier null if the stream isn't seekable or is empty. */
+    static Stat hash_stream(std::istream& stream, BlobId& content_id);
+    /** Adds a chunk of the entry content, referring to the same chunk if met already. */
+    void add_chunk(ReferringEntry& entry, std::span<const char> chunk);
+    /** Schedules the current blob if the compression params of the following content differ. */
+    void switch_blob_compression(const CompressionParams& compression);
+    /** Fails the last deferred entry append. */
+    void fail_referring_entry(Stat&& error);
+    /** Schedules the current blob append, that is, of a solid group or of a single chunk. */
+    void schedule_blob();
+    /** Schedules the encodes of a blob content, each block primed with the content preceding it. */
+    void schedule_chained_encodes(std::span<const char> content, const CompressionParams& compression);
+    /** Schedules the deferred entry appends whose blobs have all been scheduled. */
+    void schedule_ready_referring_entries();
     /** Schedules a registered stream append. */
     bool schedule_append_stream(const CompressionParams& compression, std::istream& stream);
     /** Schedules a registered string append. */
     bool schedule_append_string(const CompressionParams& compression, const std::string& str);
     /** Schedules a registered stream's buffer appends. */
     bool schedule_buffer_appends(std::istream& stream);
+    /** Schedules the copy of the rest of a registered stream right between the files, if both the stream
+     * and the target are files and the rest is large enough. Returns false if it isn't scheduled. */
+    bool schedule_file_data_append(std::istream& stream);
     /** Schedules a registered stream's future buffer appends. */
     bool schedule_future_buffer_appends(const CompressionParams& compression, std::istream& stream);
 
@@ -115,10 +194,22 @@ protected:
     }
 
     std::ostream& target;
+    AppendParams params;
+    std::unique_ptr<BlobState> blob_state;
+    /** Identifiers of the blobs already existing in the target, which don't need to be appended
+     * again and which the new entries may refer to. Gets cleared after scheduling the appends. */
+    std::unordered_set<BlobId, BlobId::Hasher> known_blob_ids;
+    /** Bases of the registered appends to delta encode. Each one is released once its append is scheduled,
+     * and the rest get cleared after scheduling the appends. */
+    std::unordered_map<const EntryInput *, DeltaBase> delta_bases;
     std::vector<std::unique_ptr<EntryInput>> owned_entry_inputs;
     std::vector<FutureAppend> future_appends;
     AppendScheduler scheduler;
     std::optional<EncoderPool> encoder_pool;
+    /** Whether the target is a regular file, which the stored file contents are copied to right from the files */
+    bool target_is_file = false;
+    /** Whether the target is seekable, so that the entries can refer to the positions of the earlier contents */
+    bool target_is_seekable = false;
 };
 
 }
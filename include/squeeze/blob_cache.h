@@ -0,0 +1,64 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <list>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "entry_reference.h"
+
+namespace squeeze {
+
+/** Cache of the decoded blob contents, bounded by their total size. The least recently used blobs
+ * are evicted once the capacity is exceeded, except for the last inserted one, which is kept
+ * regardless of its size, so that a blob larger than the capacity is still usable. */
+class BlobCache {
+public:
+    explicit BlobCache(std::size_t capacity = default_capacity) : capacity(capacity)
+    {
+    }
+
+    BlobCache(const BlobCache&) = delete;
+    BlobCache& operator=(const BlobCache&) = delete;
+
+    /** Look up a blob, marking it as the most recently used one.
+     * Returns nullptr if it isn't cached. The content is valid until the next insertion. */
+    const std::string *find(const BlobId& blob_id);
+    /** Insert a blob as the most recently used one, evicting the least recently used ones if needed.
+     * The content is valid until the next insertion. */
+    const std::string& insert(const BlobId& blob_id, std::string&& content);
+    void clear() noexcept;
+
+    /** Set the capacity, evicting the blobs exceeding it right away. */
+    void set_capacity(std::size_t capacity);
+
+    inline std::size_t get_capacity() const noexcept
+    {
+        return capacity;
+    }
+
+    /** Get the total size of the cached blob contents. */
+    inline std::size_t get_size() const noexcept
+    {
+        return size;
+    }
+
+    static constexpr std::size_t default_capacity = std::size_t(64) << 20;
+
+private:
+    void evict();
+
+    using Blobs = std::list<std::pair<BlobId, std::string>>;
+
+    /** The blobs ordered from the most to the least recently used one. */
+    Blobs blobs;
+    std::unordered_map<BlobId, Blobs::iterator, BlobId::Hasher> index;
+    std::size_t size = 0;
+    std::size_t capacity;
+};
+
+}
@@ -11,11 +11,15 @@
 
 namespace squeeze::compression {
 
+static_assert(max_dictionary_size == DeflateLZ77::search_size);
+
 /** Additional compression-related flags. */
 enum class CompressionFlags {
     None = 0,
     FinalBlock = 1, /** Compress as a final block of data. */
     ExpectFinalBlock = FinalBlock, /** Expect to compress the final block of data. */
+    ExpectTerminator = 2, /** Expect the final block to be terminated even if it fills the output up,
+                           * e.g. as the output is sized to fit the data exactly. */
 };
 SQUEEZE_DEFINE_ENUM_LOGIC_BITWISE_OPERATORS(CompressionFlags);
 
@@ -55,14 +59,18 @@ struct DecompressionResult {
     StatStr status = success;
 };
 
-/** The compressor interface. */
+/** The compressor interface.
+ * An optional preset dictionary can be provided which is the data that logically precedes
+ * the compressed input, so that the compressed data may refer to it. Only the LZ77-based methods
+ * make use of it, others ignore it. */
 template<std::output_iterator<char> OutIt, typename... OutItEnd>
     requires (sizeof...(OutItEnd) <= 1)
 class Compressor {
 public:
     using BitEncoder = misc::BitEncoder<char, CHAR_BIT, OutIt, OutItEnd...>;
 
-    explicit Compressor(BitEncoder& bit_encoder) : bit_encoder(bit_encoder)
+    explicit Compressor(BitEncoder& bit_encoder, std::span<const char> dictionary = {})
+        : bit_encoder(bit_encoder), dictionary(dictionary)
     {
     }
 
@@ -107,12 +115,17 @@ private:
     template<std::input_iterator InIt>
     std::tuple<InIt, CompressionResult> compress_huffman(InIt in_it, InIt in_it_end, bool final_block)
     {
+        const stats::StageTimer timer;
+        const InIt in_it_begin = in_it;
+        const auto out_it = bit_encoder.get_it();
         CompressionResult result;
         std::tie(in_it, result.status) = final_block ?
             huffman15_encode<true>(bit_encoder, in_it, in_it_end)
             :
             huffman15_encode<false>(bit_encoder, in_it, in_it_end)
         ;
+        timer.record(StatsStage::HuffmanEncode, stats::count_bytes(in_it_begin, in_it),
+                     stats::count_bytes(out_it, bit_encoder.get_it()));
         return std::make_tuple(in_it, std::exchange(result, CompressionResult()));
     }
 
@@ -123,20 +136,24 @@ private:
         using enum DeflateHeaderBits;
         DeflateParams deflate_params = get_deflate_params_for_level(level);
         deflate_params.header_bits = DynamicHuffman | utils::switch_flag(FinalBlock, final_block);
-        return deflate(deflate_params, bit_encoder, in_it, in_it_end);
+        return deflate(deflate_params, bit_encoder, in_it, in_it_end, dictionary);
     }
 
     BitEncoder& bit_encoder;
+    std::span<const char> dictionary;
 };
 
-/** The decompressor interface. */
+/** The decompressor interface.
+ * An optional preset dictionary can be provided which must be the same as the one
+ * used by the compressor. */
 template<std::input_iterator InIt, typename... InItEnd>
     requires (sizeof...(InItEnd) <= 1)
 class Decompressor {
 public:
     using BitDecoder = misc::BitDecoder<char, CHAR_BIT, InIt, InItEnd...>;
 
-    explicit Decompressor(BitDecoder& bit_decoder) : bit_decoder(bit_decoder)
+    explicit Decompressor(BitDecoder& bit_decoder, std::span<const char> dictionary = {})
+        : bit_decoder(bit_decoder), dictionary(dictionary)
     {
     }
 
@@ -170,7 +187,8 @@ public:
         if constexpr (method == None)
             throw Exception<Decompressor>("None compression not supported in this method");
         else if constexpr (method == Huffman)
-            return decompress_huffman(out_it, out_it_end, utils::test_flag(flags, ExpectFinalBlock));
+            return decompress_huffman(out_it, out_it_end, utils::test_flag(flags, ExpectFinalBlock),
+                                      utils::test_flag(flags, CompressionFlags::ExpectTerminator));
         else if constexpr (method == Deflate)
             return decompress_deflate(out_it, out_it_end, params.level);
         else
@@ -180,11 +198,11 @@ public:
 private:
     template<std::output_iterator<char> OutIt>
     std::tuple<OutIt, DecompressionResult> decompress_huffman(OutIt out_it, OutIt out_it_end,
-            bool expect_final_block)
+            bool expect_final_block, bool expect_terminator)
     {
         DecompressionResult result;
         std::tie(out_it, result.status) = expect_final_block ?
-            huffman15_decode<true>(out_it, out_it_end, bit_decoder)
+            huffman15_decode<true>(out_it, out_it_end, bit_decoder, expect_terminator)
             :
             huffman15_decode<false>(out_it, out_it_end, bit_decoder)
         ;
@@ -197,13 +215,14 @@ private:
     {
         DecompressionResult result;
         DeflateHeaderBits header_bits {};
-        std::tie(out_it, header_bits, result.status) = inflate(out_it, out_it_end, bit_decoder);
+        std::tie(out_it, header_bits, result.status) = inflate(out_it, out_it_end, bit_decoder, dictionary);
         const bool final_block = utils::test_flag(header_bits, DeflateHeaderBits::FinalBlock);
         result.flags = utils::switch_flag(DecompressionResult::FinalBlock, final_block);
         return std::make_tuple(out_it, std::exchange(result, DecompressionResult()));
     }
 
     BitDecoder& bit_decoder;
+    std::span<const char> dictionary;
 };
 
 /** Compress data from the given input data to the given bit encoder using
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <array>
+#include <cstdint>
 #include <utility>
 
 #include "params.h"
@@ -51,6 +53,10 @@ constexpr std::array<std::size_t, deflate_nr_levels> deflate_block_sizes_per_lev
         64 << 10,
 };
 
+/** Max size of a preset dictionary LZ77-based compression methods can make use of,
+ * which is the size of the LZ77 search window. */
+constexpr std::size_t max_dictionary_size = 1 << 15;
+
 constexpr std::array<uint8_t, 3> min_level_per_method = {0, 1, 0};
 constexpr std::array<uint8_t, 3> max_level_per_method = {0, huffman_nr_levels - 1, deflate_nr_levels - 1};
 
@@ -87,6 +93,27 @@ constexpr std::size_t get_block_size(CompressionParams params)
     }
 }
 
+/** Block size of a content encoded as a delta against a base content.
+ * Each block is primed with the base data around the block position, which is why
+ * the blocks are kept within half of the dictionary size to leave room for some drift. */
+constexpr std::size_t get_delta_block_size(CompressionParams params)
+{
+    return std::min(get_block_size(params), max_dictionary_size / 2);
+}
+
+/** Get the range of the base content used as the preset dictionary of the delta block at the
+ * given position: the max dictionary size window centered around the block position, clipped to
+ * the base bounds. The size of the block being encoded doesn't matter, only the nominal one does. */
+constexpr std::pair<uint64_t, uint64_t> get_delta_dictionary_range(uint64_t base_size,
+        uint64_t block_pos, std::size_t block_size)
+{
+    const uint64_t margin = (max_dictionary_size - std::min(block_size, max_dictionary_size)) / 2;
+    uint64_t begin = std::min(block_pos > margin ? block_pos - margin : 0, base_size);
+    const uint64_t end = std::min<uint64_t>(begin + max_dictionary_size, base_size);
+    begin = end > max_dictionary_size ? end - max_dictionary_size : 0;
+    return std::make_pair(begin, end);
+}
+
 constexpr LZ77EncoderParams get_lz77_encoder_params_for(std::size_t level)
 {
     if (level >= lz77_nr_levels)
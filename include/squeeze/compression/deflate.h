@@ -8,7 +8,12 @@
 #include "deflate_lz77.h"
 #include "deflate_policy.h"
 #include "deflate_params.h"
+#include "squeeze/stats.h"
 
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
 #include <span>
 
 namespace squeeze::compression {
@@ -108,20 +113,32 @@ public:
         return static_cast<LitLenSym>(len_sym) + literal_term_alphabet_size;
     }
 
-    /** Make an encoder using the given bit encoder. */
+    /** Make an encoder using the given bit encoder and an optional preset dictionary. */
     template<typename Char, std::size_t char_size, std::output_iterator<Char> OutIt, typename OutItEnd>
-    inline static auto make_encoder(misc::BitEncoder<Char, char_size, OutIt, OutItEnd>& bit_encoder)
+    inline static auto make_encoder(misc::BitEncoder<Char, char_size, OutIt, OutItEnd>& bit_encoder,
+            std::span<const Literal> dictionary = {})
     {
-        return Encoder<Char, char_size, OutIt, OutItEnd>(bit_encoder);
+        return Encoder<Char, char_size, OutIt, OutItEnd>(bit_encoder, dictionary);
     }
 
-    /** Make a decoder using the given bit decoder. */
+    /** Make a decoder using the given bit decoder and an optional preset dictionary. */
     template<typename Char, std::size_t char_size, std::input_iterator InIt, typename InItEnd>
-    inline static auto make_decoder(misc::BitDecoder<Char, char_size, InIt, InItEnd>& bit_decoder)
+    inline static auto make_decoder(misc::BitDecoder<Char, char_size, InIt, InItEnd>& bit_decoder,
+            std::span<const Literal> dictionary = {})
     {
-        return Decoder<Char, char_size, InIt, InItEnd>(bit_decoder);
+        return Decoder<Char, char_size, InIt, InItEnd>(bit_decoder, dictionary);
     }
 
+    /** Check if the data is a run of a single repeated byte, so that it can be encoded as a run block.
+     * The data is compared with itself shifted by one byte, letting the vectorized memcmp() do the scan. */
+    inline static bool is_run(std::span<const Literal> data)
+    {
+        return not data.empty() && data.size() <= max_run_size &&
+            std::memcmp(data.data(), data.data() + 1, data.size() - 1) == 0;
+    }
+
+    /** Max size of a run block. */
+    static constexpr std::size_t max_run_size = UINT32_MAX;
     /** Size of alphabet of literals and the terminator symbol combined. */
     static constexpr std::size_t literal_term_alphabet_size = 257;
     /** Length alphabet size. */
@@ -175,7 +192,9 @@ private:
     }
 };
 
-/** The Deflate::Encoder class. Supports encoding data, header_bits, and both at once. */
+/** The Deflate::Encoder class. Supports encoding data, header_bits, and both at once.
+ * An optional preset dictionary may be provided which the LZ77 encoder gets primed with,
+ * so that the encoded data may refer to it. The decoder must be given the same dictionary. */
 template<DeflatePolicy Policy>
 template<typename Char, std::size_t char_size, std::output_iterator<Char> OutIt, typename ...OutItEnd>
     requires ((sizeof(Char) <= sizeof(unsigned long long) * CHAR_BIT) && sizeof...(OutItEnd) <= 1)
@@ -189,7 +208,8 @@ private:
     using IntermediateData = std::vector<PackedToken>;
 
 public:
-    explicit Encoder(BitEncoder& bit_encoder) : bit_encoder(bit_encoder)
+    explicit Encoder(BitEncoder& bit_encoder, std::span<const Literal> dictionary = {})
+        : bit_encoder(bit_encoder), dictionary(dictionary)
     {
     }
 
@@ -198,6 +218,16 @@ public:
         requires (sizeof...(InItEnd) <= 1)
     Stat encode(const DeflateParams& params, InIt in_it, InItEnd... in_it_end)
     {
+        // constant data is encoded as a run block, bypassing the LZ77 and Huffman coding
+        if constexpr (std::contiguous_iterator<InIt> && sizeof...(InItEnd) == 1 &&
+                      (std::same_as<InIt, InItEnd> && ...)) {
+            if ((params.header_bits & DeflateHeaderBits::TypeMask) == DeflateHeaderBits::DynamicHuffman) {
+                const std::span<const Literal> data(std::to_address(in_it), std::to_address(in_it_end)...);
+                if (is_run(data))
+                    return encode_run(params.header_bits, data.front(), data.size());
+            }
+        }
+
         Stat s = success;
         (s = encode_header_bits(params.header_bits)) &&
         (s = encode_data(params, in_it, in_it_end...));
@@ -209,13 +239,29 @@ public:
     {
         // non-compressed blocks are not supported (BTYPE=00)
         // compression with static Huffman codes are not supported (BTYPE=01)
-        // supporting only a compression with dynamic Huffman codes (BTYPE=10)
+        // supporting a compression with dynamic Huffman codes (BTYPE=10)
+        // and the non-standard run blocks in place of the reserved type (BTYPE=11)
         if (bit_encoder.template encode_bits<3>(static_cast<uint8_t>(header_bits))) [[likely]]
             return success;
         else
             return "failed encoding header bits";
     }
 
+    /** Encode a run block of the given byte repeated the given number of times. */
+    Stat encode_run(DeflateHeaderBits header_bits, Literal byte, std::size_t size)
+    {
+        assert(size <= max_run_size);
+        header_bits = (header_bits & DeflateHeaderBits::FinalBlock) | DeflateHeaderBits::Run;
+        Stat s = encode_header_bits(header_bits);
+        if (s.failed()) [[unlikely]]
+            return s;
+        if (bit_encoder.template encode_bits<8>(static_cast<uint8_t>(byte)) &&
+            bit_encoder.template encode_bits<32>(static_cast<uint32_t>(size))) [[likely]]
+            return success;
+        else
+            return "failed encoding run";
+    }
+
     /** Encode data only. */
     template<std::input_iterator InIt, typename... InItEnd>
         requires (sizeof...(InItEnd) <= 1)
@@ -230,16 +276,24 @@ private:
         requires (sizeof...(InItEnd) <= 1)
     IntermediateData lz77_encode(const LZ77EncoderParams& params, InIt in_it, InItEnd... in_it_end)
     {
+        const stats::StageTimer timer;
+        uint64_t bytes_in = 0;
+        if constexpr (sizeof...(InItEnd) == 1)
+            bytes_in = stats::count_bytes(in_it, in_it_end...);
         auto lz77_encoder = DeflateLZ77::make_encoder(params, in_it, in_it_end...);
+        lz77_encoder.prime(dictionary);
         IntermediateData lz77_output;
         PackedToken extra_token = lz77_encoder.encode(std::back_inserter(lz77_output));
         assert(extra_token.is_none());
+        timer.record(StatsStage::LZ77Encode, bytes_in, lz77_output.size() * sizeof(PackedToken));
         return lz77_output;
     }
 
     /** Apply Huffman encoding on the intermediate data. */
     Stat huffman_encode(const IntermediateData& data)
     {
+        const stats::StageTimer timer;
+        const OutIt out_it = bit_encoder.get_it();
         std::array<CodeLen, litlen_alphabet_size + dist_alphabet_size> code_lens_storage {};
         auto [litlen_code_lens, dist_code_lens] = huffman_find_code_lens(data, code_lens_storage);
 
@@ -251,9 +305,11 @@ private:
         Stat s = huffman_encode_code_lens(nr_litlen_codes, nr_dist_codes, both_code_lens);
         if (s.failed()) [[unlikely]]
             return {"failed encoding code lengths", s};
-        if (huffman_encode_syms(data, litlen_code_lens, dist_code_lens)) [[likely]]
+        if (huffman_encode_syms(data, litlen_code_lens, dist_code_lens)) [[likely]] {
+            timer.record(StatsStage::HuffmanEncode, data.size() * sizeof(PackedToken),
+                         stats::count_bytes(out_it, bit_encoder.get_it()));
             return success;
-        else
+        } else
             return "failed encoding literal/length and distance symbols and extra bits";
     }
 
@@ -403,6 +459,7 @@ private:
     }
 
     BitEncoder& bit_encoder;
+    std::span<const Literal> dictionary;
 };
 
 /** The Deflate::Decoder class. Supports decoding data, header_bits, and both at once. */
@@ -414,7 +471,8 @@ public:
     using Stat = StatStr;
     using BitDecoder = misc::BitDecoder<Char, char_size, InIt, InItEnd...>;
 
-    explicit Decoder(BitDecoder& bit_decoder) : bit_decoder(bit_decoder)
+    explicit Decoder(BitDecoder& bit_decoder, std::span<const Literal> dictionary = {})
+        : bit_decoder(bit_decoder), dictionary(dictionary)
     {
     }
 
@@ -427,10 +485,12 @@ public:
             return std::make_tuple(out_it, header_bits, std::move(s));
 
         const DeflateHeaderBits block_type = header_bits & DeflateHeaderBits::TypeMask;
-        if (block_type != DeflateHeaderBits::DynamicHuffman)
+        if (block_type == DeflateHeaderBits::Run)
+            std::tie(out_it, s) = decode_run(out_it, out_it_end...);
+        else if (block_type == DeflateHeaderBits::DynamicHuffman)
+            std::tie(out_it, s) = decode_data(out_it, out_it_end...);
+        else
             return std::make_tuple(out_it, header_bits, "unsupported block type");
-
-        std::tie(out_it, s) = decode_data(out_it, out_it_end...);
         return std::make_tuple(out_it, header_bits, std::move(s));
     }
 
@@ -450,6 +510,26 @@ public:
         return lz77_huffman_decode(out_it, out_it_end...);
     }
 
+    /** Decode the data of a run block by filling the output with the repeated byte. */
+    template<std::output_iterator<char> OutIt, typename... OutItEnd>
+    std::tuple<OutIt, Stat> decode_run(OutIt out_it, OutItEnd... out_it_end)
+    {
+        uint8_t byte = 0;
+        uint32_t size = 0;
+        const bool decoded = bit_decoder.template decode_bits<8>(byte) &&
+                             bit_decoder.template decode_bits<32>(size);
+        if (not decoded) [[unlikely]]
+            return std::make_tuple(out_it, Stat("failed decoding run"));
+
+        if constexpr (std::random_access_iterator<OutIt> && (std::same_as<OutIt, OutItEnd> && ...)) {
+            if (((std::distance(out_it, out_it_end) < static_cast<std::ptrdiff_t>(size)) || ...)) [[unlikely]]
+                return std::make_tuple(out_it, Stat("run exceeds the output size"));
+        }
+        // compiles down to memset for contiguous outputs
+        out_it = std::fill_n(out_it, size, static_cast<char>(byte));
+        return std::make_tuple(out_it, Stat(success));
+    }
+
 private:
     /** Decode the data by Huffman and LZ77. Unlike encoding, decoding is not split
      * into separate steps for LZ77 and Huffman coding, but rather each LZ77 token
@@ -549,12 +629,15 @@ private:
             OutIt out_it, OutItEnd... out_it_end)
     {
         auto lz77_decoder = DeflateLZ77::make_decoder(out_it, out_it_end...);
+        lz77_decoder.prime(dictionary);
         Stat s = success;
 
         auto litlen_decoder = Huffman_::make_decoder(litlen_tree_node, bit_decoder);
         auto dist_decoder = Huffman_::make_decoder(dist_tree_node, bit_decoder);
 
-        while (not lz77_decoder.is_finished() && bit_decoder.is_valid()) {
+        // the block is decoded up to its terminator, even if the output is full by then, so that the input
+        // is left right past the block, and the input running out before it is an error
+        while (true) {
             std::optional<LitLenSym> opt_litlen_sym = litlen_decoder.decode_sym();
             if (!opt_litlen_sym) {
                 s = {"failed decoding literal/length symbol"};
@@ -563,10 +646,13 @@ private:
 
             const LitLenSym litlen_sym = *opt_litlen_sym;
 
-            if (is_literal(litlen_sym)) {
-                lz77_decoder.decode_once(get_literal(litlen_sym));
-            } else if (is_term(litlen_sym)) {
+            if (is_term(litlen_sym)) {
                 break;
+            } else if (lz77_decoder.is_finished()) [[unlikely]] {
+                s = "data exceeds the output size";
+                break;
+            } else if (is_literal(litlen_sym)) {
+                lz77_decoder.decode_once(get_literal(litlen_sym));
             } else if (is_len_sym(litlen_sym)) {
                 const LenSym len_sym = get_len_sym(litlen_sym);
                 LenExtra len_extra = 0;
@@ -588,6 +674,8 @@ private:
                 break;
             }
         }
+        if (s.successful() && lz77_decoder.is_finished()) [[unlikely]]
+            s = "data exceeds the output size";
 
         return std::make_tuple(lz77_decoder.get_it(), std::exchange(s, success));
     }
@@ -630,9 +718,10 @@ private:
     }
 
     BitDecoder& bit_decoder;
+    std::span<const Literal> dictionary;
 };
 
-/** Deflate data and write it to the bit encoder.
+/** Deflate data and write it to the bit encoder, optionally priming the encoder with a preset dictionary.
  * Return the input iterator and status at the point when encoding stopped. */
 template<typename Char = char, std::size_t char_size = sizeof(Char) * CHAR_BIT,
          DeflatePolicy Policy = BasicDeflatePolicy,
@@ -641,13 +730,13 @@ template<typename Char = char, std::size_t char_size = sizeof(Char) * CHAR_BIT,
     requires ((sizeof(Char) <= sizeof(unsigned long long) * CHAR_BIT) && sizeof...(OutItEnd) <= 1)
 inline std::tuple<InIt, StatStr> deflate(const DeflateParams& params,
         misc::BitEncoder<char, CHAR_BIT, OutIt, OutItEnd...>& bit_encoder,
-        InIt in_it, InIt in_it_end)
+        InIt in_it, InIt in_it_end, std::span<const DeflateLZ77::Literal> dictionary = {})
 {
-    auto encoder = Deflate<Policy>::make_encoder(bit_encoder);
+    auto encoder = Deflate<Policy>::make_encoder(bit_encoder, dictionary);
     return std::make_tuple(in_it_end, encoder.encode(params, in_it, in_it_end));
 }
 
-/** Inflate data by reading it form the bit decoder.
+/** Inflate data by reading it form the bit decoder, optionally priming the decoder with a preset dictionary.
  * Return the output iterator, header bits and status at the point when decoding stopped. */
 template<typename Char = char, std::size_t char_size = sizeof(Char) *  CHAR_BIT,
          DeflatePolicy Policy = BasicDeflatePolicy,
@@ -655,9 +744,10 @@ template<typename Char = char, std::size_t char_size = sizeof(Char) *  CHAR_BIT,
          std::input_iterator InIt = typename std::vector<Char>::iterator, typename ...InItEnd>
     requires ((sizeof(Char) <= sizeof(unsigned long long) * CHAR_BIT) && sizeof...(InItEnd) <= 1)
 std::tuple<OutIt, DeflateHeaderBits, StatStr> inflate(OutIt out_it, OutIt out_it_end,
-        misc::BitDecoder<Char, char_size, InIt, InItEnd...>& bit_decoder)
+        misc::BitDecoder<Char, char_size, InIt, InItEnd...>& bit_decoder,
+        std::span<const DeflateLZ77::Literal> dictionary = {})
 {
-    return Deflate<Policy>::make_decoder(bit_decoder).decode(out_it, out_it_end);
+    return Deflate<Policy>::make_decoder(bit_decoder, dictionary).decode(out_it, out_it_end);
 }
 
 /** Deflate data. Return (InIt, OutIt, Stat) triple at the point when encoding stopped. */
@@ -379,6 +379,12 @@ public:
         return {};
     }
 
+    /** Prime the encoder with a preset dictionary. */
+    inline void prime(std::span<const Literal> dictionary)
+    {
+        internal.prime(dictionary);
+    }
+
     /** Check if the encoder has finished encoding with the current sequence. */
     inline bool is_finished() const noexcept
     {
@@ -459,6 +465,12 @@ public:
             return s;
     }
 
+    /** Prime the decoder with a preset dictionary. */
+    inline void prime(std::span<const Literal> dictionary)
+    {
+        internal.prime(dictionary);
+    }
+
     /** Check if the decoder has finished processing tokens. */
     inline bool is_finished() const noexcept
     {
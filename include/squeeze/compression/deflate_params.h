@@ -15,7 +15,8 @@ enum class DeflateHeaderBits : std::uint8_t {
     Store = 0b00, // not supported
     FixedHuffman = 0b01, // not supported
     DynamicHuffman = 0b10, // supported
-    Reserved = 0b11, // should not be used
+    Reserved = 0b11, // reserved by the spec, used for the run blocks below
+    Run = Reserved, // non-standard: a run of a single repeated byte, followed by the byte and the run size
     TypeMask = 0b11, // type bitmask
     FinalBlock = 0b100, // indicates a final block of data
 };
@@ -46,8 +47,8 @@ template<> inline void squeeze::print_to(std::ostream& os, const compression::De
     case DynamicHuffman:
         type_str = "DYNAMIC_HUFFMAN";
         break;
-    case Reserved:
-        type_str = "RESERVED";
+    case Run:
+        type_str = "RUN";
         break;
     default:
         break;
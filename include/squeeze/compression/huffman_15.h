@@ -5,6 +5,7 @@
 #pragma once
 
 #include <array>
+#include <optional>
 #include <tuple>
 
 #include "huffman.h"
@@ -135,9 +136,10 @@ public:
         return DHuffman::make_decoder(bit_decoder).decode_code_lens(cl_it, cl_it_end);
     }
 
-    /** Decode data. Decodes the code lengths and the main data. */
+    /** Decode data. Decodes the code lengths and the main data.
+     * If expecting a terminator, it's also read past the output filled up when the term past end is set. */
     template<bool expect_term, std::output_iterator<char> OutIt>
-    std::tuple<OutIt, Stat> decode_data(OutIt out_it, OutIt out_it_end)
+    std::tuple<OutIt, Stat> decode_data(OutIt out_it, OutIt out_it_end, bool term_past_end = false)
     {
         std::array<CodeLen, alphabet_size> code_lens {};
         Stat s = decode_code_lens(code_lens.begin(), code_lens.end());
@@ -155,10 +157,22 @@ public:
             return {out_it, Stat{"failed building a Huffman tree", st}};
 
         auto huffman_decoder = Huffman<Policy>::make_decoder(tree.get_root(), bit_decoder);
-        if constexpr (expect_term)
-            out_it = huffman_decoder.decode_syms(out_it, out_it_end, term_sym);
-        else
+        if constexpr (expect_term) {
+            // unlike the terminator, the input running out before the output is full is an error,
+            // so that the data cut short isn't mistaken for the whole of it
+            for (; out_it != out_it_end || term_past_end; ++out_it) {
+                std::optional<unsigned int> sym = huffman_decoder.decode_sym();
+                if (not sym.has_value()) [[unlikely]]
+                    return {out_it, "failed decoding symbol"};
+                if (*sym == term_sym)
+                    break;
+                if (out_it == out_it_end) [[unlikely]]
+                    return {out_it, "data exceeds the output size"};
+                *out_it = static_cast<char>(static_cast<int>(*sym));
+            }
+        } else {
             out_it = huffman_decoder.decode_syms(out_it, out_it_end);
+        }
         return {out_it, success};
     }
 
@@ -183,7 +197,8 @@ inline std::tuple<InIt, StatStr> huffman15_encode(
         template encode_data<use_term>(in_it, in_it_end);
 }
 
-/** Decode data using Huffman15 with the given bit encoder.
+/** Decode data using Huffman15 with the given bit encoder, reading the terminator past the output
+ * filled up if the term past end is set.
  * Return the output iterator and status at the point when decoding stopped. */
 template<bool expect_term = true, typename Char = char, std::size_t char_size = sizeof(Char) * CHAR_BIT,
         HuffmanPolicy Policy = BasicHuffmanPolicy<15>, HuffmanPolicy CodeLenPolicy = BasicHuffmanPolicy<7>,
@@ -194,10 +209,11 @@ template<bool expect_term = true, typename Char = char, std::size_t char_size =
               (Policy::code_len_limit == 15 && CodeLenPolicy::code_len_limit == 7) &&
               sizeof...(InItEnd) <= 1)
 inline std::tuple<OutIt, StatStr> huffman15_decode(
-        OutIt out_it, OutIt out_it_end, misc::BitDecoder<Char, char_size, InIt, InItEnd...>& bit_decoder)
+        OutIt out_it, OutIt out_it_end, misc::BitDecoder<Char, char_size, InIt, InItEnd...>& bit_decoder,
+        bool term_past_end = false)
 {
     return Huffman15<Policy, CodeLenPolicy>::make_decoder(bit_decoder).
-        template decode_data<expect_term>(out_it, out_it_end);
+        template decode_data<expect_term>(out_it, out_it_end, term_past_end);
 }
 
 /** Encode data using Huffman15. Return (InIt, OutIt, Stat) triple at the point when encoding stopped. */
@@ -10,6 +10,7 @@
 #include <utility>
 #include <array>
 #include <algorithm>
+#include <span>
 
 #include "lz77_policy.h"
 #include "lz77_params.h"
@@ -155,6 +156,23 @@ public:
         }
     }
 
+    /** Prime the encoder with a preset dictionary, i.e. data that logically precedes the input
+     * and that matches are allowed to refer to. Only the last search_size symbols are used.
+     * Must be called before encoding anything. */
+    void prime(std::span<const Sym> dictionary)
+    {
+        if (dictionary.size() > search_size)
+            dictionary = dictionary.last(search_size);
+
+        for (std::size_t i = 0; i < dictionary.size(); ++i) {
+            search_window.push_sym(dictionary[i]);
+            if (i + 1 < min_match_len)
+                continue;
+            const std::size_t pos = search_window.get_end_pos() - min_match_len;
+            update_hash_chain(get_chain_index_for(search_window.get_pivot() - min_match_len), pos);
+        }
+    }
+
     /** Check if the encoder has finished encoding with the current sequence. */
     inline bool is_finished() const noexcept
     {
@@ -487,6 +505,17 @@ public:
         }
     }
 
+    /** Prime the decoder with a preset dictionary. Must be the same dictionary the encoder
+     * was primed with and must be called before decoding anything. */
+    void prime(std::span<const Sym> dictionary)
+    {
+        if (dictionary.size() > search_size)
+            dictionary = dictionary.last(search_size);
+
+        for (const Sym& sym : dictionary)
+            search_window.push_sym(sym);
+    }
+
     /** Check if the decoder has finished processing tokens. If there's an unprocessed
      * partial token, the decoder will request more output space to continue decoding. */
     inline bool is_finished() const noexcept
@@ -6,7 +6,9 @@
 
 #include <algorithm>
 #include <istream>
+#include <limits>
 #include <ostream>
+#include <span>
 
 #include "compression/params.h"
 #include "status.h"
@@ -16,8 +18,33 @@ namespace squeeze {
 using compression::CompressionParams;
 using DecodeStat = StatStr;
 
-/** Decode a char stream of a given size from another char stream using the compression info provided. */
+/** Size to decode a char stream of when its size isn't known up front, e.g. of a framed entry content
+ * read sequentially, in which case the stream is decoded till its end. */
+constexpr std::size_t unknown_size = std::numeric_limits<std::size_t>::max();
+
+/** Decode a char stream of a given size, or of unknown_size, from another char stream
+ * using the compression info provided. */
 DecodeStat decode(std::ostream& out, std::size_t size, std::istream& in,
         const CompressionParams& compression);
 
+/** Decode single buffer encoded by encode() or encode_buffer() into the given preallocated output
+ * without any intermediate buffers, setting the size decoded. Fails if the output is too small. */
+DecodeStat decode_buffer(std::span<const char> in, std::span<char> out, std::size_t& decoded_size,
+        const CompressionParams& compression);
+
+/** Decode a char stream of a given size, or of unknown_size, from another char stream
+ * using the compression info provided,
+ * where each block has been encoded with the data preceding it as a preset dictionary.
+ * See the encode_buffer() overload that accepts a dictionary. */
+DecodeStat decode_chained(std::ostream& out, std::size_t size, std::istream& in,
+        const CompressionParams& compression);
+
+/** Decode a char stream of a given size, or of unknown_size, from another char stream
+ * using the compression info provided,
+ * where each block of get_delta_block_size() has been encoded with the range of the given base content
+ * around the block position as a preset dictionary, see get_delta_dictionary_range().
+ * Only the methods supporting dictionaries, i.e. Deflate, are supported. */
+DecodeStat decode_delta(std::ostream& out, std::size_t size, std::istream& in,
+        const CompressionParams& compression, std::span<const char> base);
+
 }
@@ -5,6 +5,7 @@
 #pragma once
 
 #include <istream>
+#include <span>
 
 #include "common.h"
 #include "status.h"
@@ -18,6 +19,21 @@ using EncodeStat = StatStr;
 /** Encode single buffer using the compression info provided. */
 EncodeStat encode_buffer(const Buffer& in, Buffer& out, const CompressionParams& compression);
 
+/** Encode single buffer using the compression info provided, priming the encoder with a preset dictionary.
+ * The dictionary is the data that logically precedes the buffer, e.g. the tail of the previous buffer,
+ * so that the buffer can be encoded independently while still referring to the data preceding it. */
+EncodeStat encode_buffer(const Buffer& in, Buffer& out, const CompressionParams& compression,
+                         std::span<const char> dictionary);
+
+/** Encode single buffer of any size block by block, like encode(), into the given preallocated output
+ * without any intermediate buffers, setting the size encoded. Fails if the output is too small,
+ * which compress_bound() sized output never is. */
+EncodeStat encode_buffer(std::span<const char> in, std::span<char> out, std::size_t& encoded_size,
+                         const CompressionParams& compression);
+
+/** Get the max size the data of a given size can take once encoded, to size the output of encoding it. */
+std::size_t compress_bound(std::size_t size, const CompressionParams& compression);
+
 /** Encode a char stream of a given size into another char stream using the compression info provided.
  * Unlike the EncoderPool, doesn't use multithreading. */
 EncodeStat encode(std::istream& in, std::size_t size, std::ostream& out,
@@ -6,6 +6,9 @@
 
 #include <future>
 #include <concepts>
+#include <cstdint>
+#include <span>
+#include <vector>
 
 #include "encode.h"
 #include "misc/thread_pool.h"
@@ -28,6 +31,21 @@ public:
     ~EncoderPool();
 
     std::future<EncodedBuffer> schedule_buffer_encode(Buffer&& input, const CompressionParams& compression);
+    /** Schedule a buffer encode with the encoder primed with a preset dictionary.
+     * See the encode_buffer() overload that accepts a dictionary. */
+    std::future<EncodedBuffer> schedule_buffer_encode(Buffer&& input, const CompressionParams& compression,
+                                                      Buffer&& dictionary);
+
+    /** Encode many independent buffers at once, e.g. small messages, into one contiguous arena, replacing its
+     * content, with the i-th encoded buffer taking the [offsets[i], offsets[i + 1]) range of it.
+     * Rather than scheduling a task per buffer, the batch is split into coarse chunks of consecutive buffers,
+     * which the worker threads and the calling one take in turn and encode in place into the arena.
+     * Each buffer is encoded like by the span overload of encode_buffer(). Blocks until the batch is encoded. */
+    Stat encode_batch(std::span<const std::span<const char>> inputs, Buffer& arena, std::vector<uint64_t>& offsets,
+                      const CompressionParams& compression);
+
+    /** Min size of the input data of a chunk of the batch taken by a thread at once. */
+    static constexpr std::size_t min_batch_chunk_size = 1 << 16;
 
     template<std::output_iterator<Buffer> It>
     Stat schedule_stream_encode(std::istream& stream, const CompressionParams& compression, It it)
@@ -50,7 +68,10 @@ private:
 
     misc::ThreadPool& thread_pool;
     misc::TaskScheduler<Task> scheduler;
+    /** Number of the threads running the tasks, counted from being assigned them till done touching the pool */
     std::atomic_size_t nr_running_threads = 0;
+    /** Number of the threads taking the tasks from the scheduler at the moment */
+    std::atomic_size_t nr_active_threads = 0;
 };
 
 }
\ No newline at end of file
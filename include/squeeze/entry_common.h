@@ -34,6 +34,16 @@ enum class EntryType : uint8_t {
     RegularFile,
     Directory,
     Symlink,
+    Blob, /** Hidden entry holding data that other entries refer to. */
+};
+
+/** Layout of the entry content. */
+enum class EntryContentLayout : uint8_t {
+    Plain = 0, /** The content is the (compressed) data itself. */
+    References, /** The content is a list of references to data held by blob entries. */
+    Delta, /** The content is a reference to a base blob followed by the data encoded as a delta against it. */
+    Sparse, /** The content is a map of the data extents followed by their (compressed) data, leaving out the holes. */
+    Duplicate, /** The content is a reference to the same (compressed) content of an earlier entry, see EntryReference. */
 };
 
 struct EntryAttributes {
@@ -68,5 +78,6 @@ struct EntryAttributes {
 };
 
 template<> void print_to(std::ostream& os, const EntryAttributes& attributes);
+template<> void print_to(std::ostream& os, const EntryContentLayout& content_layout);
 
 }
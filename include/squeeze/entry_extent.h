@@ -0,0 +1,98 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include "common.h"
+#include "status.h"
+
+namespace squeeze {
+
+/** Range of data within a sparse content, the rest of which are holes of zeros. */
+struct EntryExtent {
+    uint64_t offset = 0; /** Offset of the data within the content */
+    uint64_t size = 0; /** Size of the data */
+};
+
+/** Map of the data extents of a sparse content.
+ * Entries with the Sparse content layout store the encoded map at the beginning of their content
+ * uncompressed, followed by the (compressed) data of the extents concatenated. */
+struct EntryExtentMap {
+    uint64_t size = 0; /** Full size of the content, including the holes */
+    std::vector<EntryExtent> extents; /** Data extents, ordered and non-overlapping */
+
+    /** Size of the encoded map fields preceding the extents */
+    static constexpr std::size_t encoded_prefix_size = sizeof(size) + sizeof(uint64_t);
+    /** Size of an encoded extent */
+    static constexpr std::size_t encoded_extent_size = sizeof(EntryExtent::offset) + sizeof(EntryExtent::size);
+
+    /** Get the size of the encoded map. */
+    inline uint64_t get_encoded_size() const
+    {
+        return encoded_prefix_size + extents.size() * encoded_extent_size;
+    }
+
+    /** Get the size of the data of all the extents. */
+    uint64_t get_data_size() const;
+
+    /** Encode the map by appending it to the output buffer. */
+    static void encode(Buffer& output, const EntryExtentMap& map);
+    /** Decode a map, validating the extents are ordered and within the content size. */
+    static StatStr decode(std::istream& input, EntryExtentMap& map);
+};
+
+/** Input stream buffer presenting a stream in the Sparse content layout: the encoded extent map
+ * followed by the data of the extents, leaving out the holes between them.
+ * Reads past the end of the underlying stream, e.g. if it got truncated meanwhile, yield zeros. */
+class SparseInputStreambuf : public std::streambuf {
+public:
+    SparseInputStreambuf(std::istream& stream, const EntryExtentMap& map);
+
+protected:
+    int_type underflow() override;
+
+private:
+    std::istream& stream;
+    std::vector<EntryExtent> extents;
+    std::size_t extent_index = 0;
+    uint64_t extent_read = 0;
+    Buffer buffer;
+};
+
+/** Output stream buffer writing the data of the extents of a sparse content to a stream,
+ * skipping the holes between them with the given function instead of writing zeros. */
+class SparseOutputStreambuf : public std::streambuf {
+public:
+    /** Skips a hole of the given size in the stream, returns false on failure. */
+    using HoleSkipper = std::function<bool (std::ostream& stream, uint64_t size)>;
+
+    SparseOutputStreambuf(std::ostream& stream, const EntryExtentMap& map, HoleSkipper&& skip_hole);
+
+    /** Skip the trailing hole, if any, after all the extents have been written. */
+    bool finish();
+
+protected:
+    std::streamsize xsputn(const char_type *s, std::streamsize n) override;
+    int_type overflow(int_type ch) override;
+    /** Only reports the current position, as the output is sequential. */
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    std::ostream& stream;
+    const EntryExtentMap& map;
+    HoleSkipper skip_hole;
+    std::size_t extent_index = 0;
+    uint64_t extent_written = 0;
+    uint64_t pos = 0;
+};
+
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+#include "common.h"
+#include "entry_header.h"
+#include "status.h"
+
+namespace squeeze {
+
+/** Framing of the contents of the entries appended to non-seekable streams, where the content size can't be
+ * patched into the header once the content is written. Such entries are marked as framed in their headers,
+ * and their content is written as frames, each prefixed by its size, terminated by an empty frame
+ * followed by the size of the whole content. */
+struct EntryFrames {
+    using FrameSizeType = uint32_t;
+
+    /** Max size of a frame. Larger writes are split into several frames. */
+    static constexpr std::size_t max_frame_size = 1 << 20;
+    /** Size of the terminating empty frame and the content size following it */
+    static constexpr std::size_t trailer_size = sizeof(FrameSizeType) + sizeof(uint64_t);
+
+    /** Measure the frames of a framed entry, starting at the current position of the input,
+     * setting the content size and the framing size of the entry header. Validates the content size
+     * following the frames, and leaves the input positioned past it. */
+    static StatStr measure(std::istream& input, EntryHeader& entry_header);
+    /** Read the content size following the terminating empty frame, from the input positioned past it. */
+    static bool read_content_size(std::istream& input, uint64_t& content_size);
+};
+
+/** Output stream buffer writing the data to a stream as frames, one for each write. */
+class FramedOutputStreambuf : public std::streambuf {
+public:
+    explicit FramedOutputStreambuf(std::ostream& stream) : stream(stream)
+    {
+    }
+
+    /** Terminate the frames, writing the trailer. */
+    bool finish();
+
+protected:
+    std::streamsize xsputn(const char_type *s, std::streamsize n) override;
+    int_type overflow(int_type ch) override;
+    /** Only reports the current position within the content, as the output is sequential. */
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    std::ostream& stream;
+    uint64_t content_size = 0;
+};
+
+/** Input stream buffer reading the content of a framed entry from the frames starting at the given position.
+ * The stream is repositioned for each frame, so it may be used for other reads in between. */
+class FramedInputStreambuf : public std::streambuf {
+public:
+    FramedInputStreambuf(std::istream& stream, uint64_t pos) : stream(stream), frame_pos(pos)
+    {
+    }
+
+    /** Get the size of the content read so far, which is the whole content size once the frames end.
+     * The stream is then positioned past the terminating empty frame, at the content size. */
+    inline uint64_t get_read_size() const
+    {
+        return content_pos + (gptr() - eback());
+    }
+
+protected:
+    int_type underflow() override;
+    /** Only reports the current position within the content, as the input is sequential. */
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    std::istream& stream;
+    uint64_t frame_pos; /** Position of the next frame in the stream */
+    uint64_t content_pos = 0; /** Position of the beginning of the current frame within the content */
+    bool finished = false;
+    Buffer buffer;
+};
+
+/** Input stream reading the content of an entry from the source, positioned at the content:
+ * either right from the source, or through the frames of a framed entry. */
+class EntryContentStream : public std::istream {
+public:
+    EntryContentStream(std::istream& source, uint64_t content_pos, bool framed);
+
+private:
+    FramedInputStreambuf framed_streambuf;
+};
+
+}
@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <algorithm>
 #include <string>
+#include <string_view>
 #include <istream>
 #include <ostream>
 
@@ -13,50 +15,131 @@
 
 #include "compression/params.h"
 #include "status.h"
+#include "utils/varint.h"
 
 namespace squeeze {
 
 using compression::CompressionParams;
 
-/** Struct that contains the entry header data. */
+/** Struct that contains the entry header data.
+ *
+ * Headers are encoded either in the fixed format, with fixed-width fields and the full path,
+ * or in the compact one (from compact_header_version onwards), told apart by the compact_flag bit
+ * of the encoded version. The compact format encodes the integers as LEB128 varints and the path
+ * front-coded: the size of the prefix it shares with the path of the previous entry followed by
+ * the rest of it. The content size gets a varint padded to get_compact_content_size_width(),
+ * so that it can be re-encoded in place once the content is written.
+ *
+ * Either format may mark the content as framed (from framed_content_version onwards) by the framed_flag
+ * bit of the encoded version, for the entries written to non-seekable streams. The encoded content size
+ * is meaningless then, and the content size and framing size are measured from the frames, see EntryFrames. */
 struct EntryHeader {
+    using EncodedPathSizeType = uint16_t;
+
     SemVer version; /** Version of squeeze that created the entry */
     uint64_t content_size = 0; /** Entry content size */
     CompressionParams compression; /** Compression used */
     EntryAttributes attributes; /** Entry attributes including its file type and permissions */
+    EntryContentLayout content_layout = EntryContentLayout::Plain; /** Layout of the entry content */
+    uint64_t original_size = unknown_original_size; /** Size of the decoded content, e.g. the file size */
+    bool compact = false; /** Whether the header is encoded in the compact format */
+    bool framed = false; /** Whether the content is framed, see EntryFrames */
+    uint64_t framing_size = 0; /** Size of the framing of a framed content, in addition to the content size */
+    /** Size of the path prefix shared with the previous entry, which isn't encoded in compact headers */
+    EncodedPathSizeType path_prefix_size = 0;
     std::string path; /** The path itself */
 
+    /** Check if the original size is known. It isn't for entries of older versions,
+     * nor for those appended from input streams of unknown size. */
+    inline bool has_original_size() const
+    {
+        return original_size != unknown_original_size;
+    }
+
     /** Get the header size, including the path length */
     inline uint64_t get_encoded_header_size() const
     {
-        return encoded_static_size + path.size();
+        if (compact)
+            return get_encoded_compact_size();
+        return get_encoded_static_size(version) + path.size();
     }
 
-    /** Get full size of the entry, including the content size. */
+    /** Get full size of the entry, including the content size and its framing, if any. */
     inline uint64_t get_encoded_full_size() const
     {
-        return get_encoded_header_size() + content_size;
+        return get_encoded_header_size() + content_size + framing_size;
     }
 
     /** Encode the content size.
      * This is useful as the entry header is usually encoded and written before
      * the content but the content size might be unknown before being encoded,
-     * thus it might need a re-encoding after the content is encoded and written. */
+     * thus it might need a re-encoding after the content is encoded and written.
+     * Applies to the fixed header format only. */
     static StatStr encode_content_size(std::ostream& output, uint64_t content_size);
     /** Decode the content size. Just mirrors encode_content_size method. */
     static StatStr decode_content_size(std::istream& output, uint64_t& content_size);
+    /** Re-encode the content size of the given header, in either format. */
+    static StatStr encode_content_size(std::ostream& output, const EntryHeader& entry_header);
 
-    /** Encode the entry header. */
+    /** Encode the entry header. A compact header is encoded with its path_prefix_size,
+     * which must be set against the path of the previous entry beforehand. */
     static StatStr encode(std::ostream& output, const EntryHeader& entry_header);
-    /** Decode the entry header. */
-    static StatStr decode(std::istream& input, EntryHeader& entry_header);
+    /** Decode the entry header. A compact header with a path prefix needs the path of the previous entry.
+     * The content size of a framed entry is left unknown, to be measured with EntryFrames::measure(). */
+    static StatStr decode(std::istream& input, EntryHeader& entry_header, std::string_view previous_path = {});
 
-    using EncodedPathSizeType = uint16_t;
+    /** Get the size of the prefix shared by the paths, as used for front-coding them. */
+    static EncodedPathSizeType get_shared_path_prefix_size(std::string_view lhs, std::string_view rhs);
+
+    /** The first version that encodes the content layout.
+     * Entries of older versions are assumed to have plain content layout. */
+    static constexpr SemVer content_layout_version {0, 2, 0};
+    /** The first version that encodes the original size.
+     * Entries of older versions are assumed to have an unknown original size. */
+    static constexpr SemVer original_size_version {0, 3, 0};
+    /** The first version that supports the compact header format. */
+    static constexpr SemVer compact_header_version {0, 4, 0};
+    /** The first version that supports framed contents. */
+    static constexpr SemVer framed_content_version {0, 5, 0};
+
+    /** Bit of the encoded version marking compact headers. Older versions reject it as a version
+     * too high, and it limits the major version to 11 bits. */
+    static constexpr uint32_t compact_flag = uint32_t(1) << 31;
+    /** Bit of the encoded version marking framed contents, which further limits the major version to 10 bits. */
+    static constexpr uint32_t framed_flag = uint32_t(1) << 30;
+
+    /** Original size of the entries it isn't known for */
+    static constexpr uint64_t unknown_original_size = uint64_t(-1);
 
-    /** Size of the static part of the encoded header */
-    static constexpr std::size_t encoded_static_size =
-        sizeof(version) + sizeof(content_size) + sizeof(compression) +
-        sizeof(attributes) + sizeof(EncodedPathSizeType);
+    /** Size of the static part of the encoded header of the given version */
+    static constexpr std::size_t get_encoded_static_size(SemVer version)
+    {
+        return sizeof(version) + sizeof(content_size) + sizeof(compression) + sizeof(attributes) +
+            (version >= content_layout_version ? sizeof(content_layout) : 0) +
+            (version >= original_size_version ? sizeof(original_size) : 0) + sizeof(EncodedPathSizeType);
+    }
+
+    /** Width of the padded varint of the content size of a compact header.
+     * It has enough room for the content sizes the original size may turn into,
+     * including the worst-case compression expansion and the references to the blobs. */
+    static constexpr std::size_t get_compact_content_size_width(uint64_t original_size)
+    {
+        constexpr uint64_t max_expansion = 64, expansion_margin = uint64_t(1) << 20;
+        if (original_size > (uint64_t(-1) - expansion_margin) / max_expansion)
+            return utils::max_varint_size;
+        return utils::get_varint_size(original_size * max_expansion + expansion_margin);
+    }
+
+private:
+    /** Get the size of the header encoded in the compact format */
+    inline uint64_t get_encoded_compact_size() const
+    {
+        const std::size_t suffix_size = path.size() - std::min<std::size_t>(path_prefix_size, path.size());
+        return sizeof(version) + get_compact_content_size_width(original_size) + sizeof(compression) +
+            utils::get_varint_size(attributes.data) + sizeof(content_layout) +
+            utils::get_varint_size(original_size + 1) + utils::get_varint_size(path_prefix_size) +
+            utils::get_varint_size(suffix_size) + suffix_size;
+    }
 };
 
 template<> void print_to(std::ostream& os, const EntryHeader& header);
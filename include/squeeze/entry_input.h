@@ -5,12 +5,15 @@
 #pragma once
 
 #include <fstream>
+#include <optional>
 #include <variant>
 
 #include "entry_common.h"
 #include "entry_header.h"
+#include "entry_extent.h"
 #include "status.h"
 #include "compression/params.h"
+#include "utils/io.h"
 
 namespace squeeze {
 
@@ -81,8 +84,13 @@ public:
 
 protected:
     Stat init_entry_header(EntryHeader& entry_header);
+    /** Present the file content in the Sparse content layout if the file has holes. */
+    void init_sparse_content(EntryHeader& entry_header, ContentType& content);
 
-    std::optional<std::ifstream> file;
+    std::optional<utils::StatsInputFilebuf> filebuf;
+    std::optional<std::istream> file;
+    std::optional<SparseInputStreambuf> sparse_streambuf;
+    std::optional<std::istream> sparse_stream;
 };
 
 static constexpr EntryAttributes default_attributes = {
@@ -7,6 +7,8 @@
 #include <cstdint>
 #include <iterator>
 #include <istream>
+#include <string>
+#include <string_view>
 
 #include "entry_header.h"
 
@@ -21,6 +23,9 @@ public:
     using reference = const value_type&;
 
     explicit EntryIterator(std::istream& source);
+    /** Iterator starting at the entry at the given position, e.g. one found by EntryScanner.
+     * The path of the previous entry is needed if the entry has a compact header. */
+    EntryIterator(std::istream& source, uint64_t pos, std::string_view previous_path);
 
     EntryIterator& operator++() noexcept;
     EntryIterator operator++(int) noexcept;
@@ -45,9 +50,20 @@ public:
         return pos_and_entry_header.first != other.pos_and_entry_header.first;
     }
 
+    /** Get the path of the entry preceding the current one, or an empty one for the first entry. */
+    inline const std::string& get_previous_path() const noexcept
+    {
+        return previous_path;
+    }
+
     static constexpr uint64_t npos = uint64_t(-1);
     static const EntryIterator end;
 
+    /** Min size of the content of an entry for hinting the source file to read the next header ahead. */
+    static constexpr uint64_t next_header_advice_min_gap = 1 << 17;
+    /** Size of the range of the source file hinted to be read ahead at the next header. */
+    static constexpr uint64_t next_header_advice_size = 1 << 12;
+
 private:
     EntryIterator() : source(nullptr), pos_and_entry_header(npos, std::move(EntryHeader()))
     {
@@ -58,6 +74,7 @@ private:
 private:
     std::istream *source;
     value_type pos_and_entry_header;
+    std::string previous_path;
 };
 
 inline const EntryIterator EntryIterator::end {};
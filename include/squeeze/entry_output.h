@@ -8,6 +8,7 @@
 #include <fstream>
 
 #include "entry_header.h"
+#include "utils/mapped_file.h"
 
 namespace squeeze {
 
@@ -23,6 +24,9 @@ public:
     virtual Stat init(EntryHeader&& entry_header, std::ostream *& stream) = 0;
     /** Initialize the entry output as a symlink by passing entry header and a symlink target. */
     virtual Stat init_symlink(EntryHeader&& entry_header, const std::string& target) = 0;
+    /** Skip a hole of zeros of the given size in the output stream of a sparse entry.
+     * By default writes the zeros, outputs able to leave the holes unallocated may override it. */
+    virtual Stat skip_hole(std::ostream& stream, uint64_t size);
     /** Finalize the entry output. This can be used to do some post-processing tasks. */
     virtual Stat finalize() = 0;
     /** De-initialize the entry output. This always needs to be called if an init(_symlink) method
@@ -32,17 +36,36 @@ public:
     virtual ~EntryOutput() = default;
 };
 
-/** Derived class of EntryOutput that creates a file for storing extracted data. */
+/** Derived class of EntryOutput that creates a file for storing extracted data.
+ * Large regular files are written through a memory mapping, where supported, see utils::MappedFileStreambuf,
+ * so that their data gets decoded right into the mapped pages. */
 class FileEntryOutput : public EntryOutput {
 public:
     virtual Stat init(EntryHeader&& entry_header, std::ostream *& stream) override;
     virtual Stat init_symlink(EntryHeader&& entry_header, const std::string& target) override;
+    /** Seeks past the hole, leaving it unallocated in the file system, if supported. */
+    virtual Stat skip_hole(std::ostream& stream, uint64_t size) override;
     virtual Stat finalize() override;
     virtual void deinit() noexcept override;
 
+    /** Min size of a regular file, original or, if unknown, encoded, to write it through a memory mapping. */
+    static constexpr uint64_t mapped_output_min_size = 1 << 20;
+
 private:
+    /** Check whether to write the regular file through a memory mapping. */
+    bool use_mapped_output() const;
+    /** Create the regular file to write through a memory mapping. Returns false if it can't be mapped,
+     * e.g. if its space can't be allocated, in which case it's to be written as usual instead. */
+    bool init_mapped(std::ostream *& stream);
+    /** Preallocate the file up to its original size, if known, as a hint to the file system. */
+    void preallocate();
+
     std::optional<std::ofstream> file;
+    utils::MappedFileStreambuf mapped_file;
+    std::optional<std::ostream> mapped_stream;
     std::optional<EntryHeader> final_entry_header;
+    /** Whether the file may have been left shorter than its content by skipping a trailing hole. */
+    bool skipped_hole = false;
 };
 
 /** Derived class of EntryOutput that relies on a pre-existing stream for storing extracted data.*/
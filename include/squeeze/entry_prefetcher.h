@@ -0,0 +1,63 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <istream>
+#include <mutex>
+#include <thread>
+
+namespace squeeze {
+
+/** Background reader of the entries ahead of the one being extracted, so that their data is already
+ * in the page cache by the time the decoder gets to it, which pays off on cold caches, slow disks and
+ * network file systems. The entries are traversed on a thread of its own with the positional reads of
+ * the source file, independently of the source stream, up to a number of entries ahead of the position
+ * reported by advance(). Stays inactive if the source isn't a file, see is_active(). */
+class EntryPrefetcher {
+public:
+    explicit EntryPrefetcher(std::istream& source, std::size_t nr_entries_ahead = default_nr_entries_ahead);
+    /** Stops the prefetching, waiting for the current read to finish. */
+    ~EntryPrefetcher();
+
+    EntryPrefetcher(const EntryPrefetcher&) = delete;
+    EntryPrefetcher& operator=(const EntryPrefetcher&) = delete;
+
+    /** Report the position of the entry about to be read, letting the prefetching go on past it. */
+    void advance(uint64_t pos);
+
+    inline bool is_active() const noexcept
+    {
+        return thread.joinable();
+    }
+
+    /** Get the number of the entries read ahead so far. */
+    inline std::size_t get_nr_entries_prefetched() const noexcept
+    {
+        return nr_entries_prefetched.load(std::memory_order::relaxed);
+    }
+
+    static constexpr std::size_t default_nr_entries_ahead = 16;
+    /** Max size of an entry to read ahead, only the beginning of a larger one is read, the rest is hinted. */
+    static constexpr uint64_t max_entry_read_size = 1 << 26;
+
+private:
+    void run();
+    /** Read the range of the source file, unless stopped meanwhile. */
+    void read_range(uint64_t pos, uint64_t size);
+
+    int fd = -1;
+    const std::size_t nr_entries_ahead;
+    std::mutex mutex;
+    std::condition_variable cv;
+    uint64_t current_pos = 0;
+    bool stopping = false;
+    std::atomic_size_t nr_entries_prefetched = 0;
+    std::thread thread;
+};
+
+}
@@ -0,0 +1,71 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "status.h"
+#include "misc/hash.h"
+
+namespace squeeze {
+
+/** Identifier of a blob entry, which is the hash of the blob's uncompressed content.
+ * The path of a blob entry is the hexadecimal representation of its identifier. */
+struct BlobId {
+    misc::Hash128 hash {};
+
+    /** Make the identifier of the given content. */
+    static BlobId of(std::span<const char> content);
+    /** Parse the identifier from a blob entry path. */
+    static std::optional<BlobId> from_path(std::string_view path);
+    /** Get the blob entry path of the identifier. */
+    std::string to_path() const;
+
+    /** Check if the identifier is null, that is, refers to no blob. */
+    inline bool is_null() const noexcept
+    {
+        return hash[0] == 0 && hash[1] == 0;
+    }
+
+    inline bool operator==(const BlobId& other) const noexcept = default;
+
+    struct Hasher {
+        inline std::size_t operator()(const BlobId& blob_id) const noexcept
+        {
+            return static_cast<std::size_t>(blob_id.hash[0]);
+        }
+    };
+};
+
+/** Reference to a range of data within the uncompressed content of a blob entry.
+ * Entries with the References content layout store a list of these as their content
+ * and their data is the concatenation of the referred ranges.
+ * An entry with the Duplicate content layout stores a single one instead, referring to the encoded content
+ * of an earlier regular file entry, compressed the same way as the referring entry: the identifier is the hash
+ * of the uncompressed content, and the offset and the size are the position and the size of the encoded one. */
+struct EntryReference {
+    BlobId blob_id; /** Identifier of the blob the data is held by */
+    uint64_t offset = 0; /** Offset of the data within the blob content */
+    uint64_t size = 0; /** Size of the data */
+
+    /** Size of an encoded reference */
+    static constexpr std::size_t encoded_size = sizeof(blob_id.hash) + sizeof(offset) + sizeof(size);
+
+    /** Encode the reference by appending it to the output buffer. */
+    static void encode(Buffer& output, const EntryReference& reference);
+    /** Decode a reference. */
+    static StatStr decode(std::istream& input, EntryReference& reference);
+    /** Decode the whole list of references of the given encoded content size. */
+    static StatStr decode_list(std::istream& input, uint64_t content_size, std::vector<EntryReference>& references);
+};
+
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <limits>
+#include <string>
+#include <string_view>
+
+#include "common.h"
+#include "entry_header.h"
+#include "entry_iterator.h"
+#include "utils/io.h"
+
+namespace squeeze {
+
+/** Sequential scanner of the entry headers, a lighter alternative to EntryIterator for listing
+ * and searching the entries. Instead of seeking to every entry and reading its header field by field
+ * from the source, it reads the source through a large buffer, skipping the contents within it,
+ * and decodes the headers from the buffer into a single reused header. Thus scanning allocates
+ * nothing per entry, and the path only gets copied if the caller keeps it.
+ * The source must not be modified while scanning, though it may be read in between. */
+class EntryScanner {
+public:
+    explicit EntryScanner(std::istream& source, std::size_t buffer_size = default_buffer_size);
+
+    EntryScanner(const EntryScanner&) = delete;
+    EntryScanner& operator=(const EntryScanner&) = delete;
+
+    /** Scan the next entry, the first one on the first call.
+     * Returns false past the last entry or on a corrupted one. */
+    bool next();
+
+    /** Get the position of the current entry, npos before the first one and past the last one. */
+    inline uint64_t get_pos() const noexcept
+    {
+        return pos;
+    }
+
+    /** Get the header of the current entry, valid until the next one is scanned. */
+    inline const EntryHeader& get_header() const noexcept
+    {
+        return entry_header;
+    }
+
+    /** Get the path of the current entry, valid until the next one is scanned. */
+    inline std::string_view get_path() const noexcept
+    {
+        return entry_header.path;
+    }
+
+    /** Get an iterator pointing to the current entry, e.g. to extract it. */
+    inline EntryIterator get_iterator() const
+    {
+        return EntryIterator(source, pos, previous_path);
+    }
+
+    static constexpr uint64_t npos = EntryIterator::npos;
+
+    /** Default size of the buffer the source is read through */
+    static constexpr std::size_t default_buffer_size = 1 << 20;
+    /** Upper bound of the encoded header size in either format, with the longest path. */
+    static constexpr std::size_t max_header_size = 64 + std::numeric_limits<EntryHeader::EncodedPathSizeType>::max();
+
+private:
+    /** Make sure the buffer holds the header at the given position, unless the source ends before it.
+     * The source is read ahead by an amount doubling for each sequential read, up to the buffer size. */
+    bool fill(uint64_t header_pos);
+
+private:
+    std::istream& source;
+    Buffer buffer;
+    uint64_t buffer_pos = 0; /** Position of the buffer data in the source */
+    std::size_t buffer_data_size = 0; /** Size of the data read into the buffer */
+    bool buffer_eof = false; /** Whether the buffer data reaches the end of the source */
+    std::size_t read_ahead_size = max_header_size;
+
+    utils::SpanInputStreambuf header_streambuf;
+    std::istream header_stream;
+
+    uint64_t pos = npos;
+    bool started = false;
+    EntryHeader entry_header;
+    std::string previous_path;
+};
+
+}
@@ -4,8 +4,17 @@
 
 #pragma once
 
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "blob_cache.h"
 #include "entry_iterator.h"
 #include "entry_output.h"
+#include "entry_prefetcher.h"
+#include "entry_reference.h"
+#include "entry_extent.h"
 
 namespace squeeze {
 
@@ -21,6 +30,7 @@ public:
     /** Construct the interface by passing a reference to the ostream source to read from. */
     explicit Extracter(std::istream& source) : source(source)
     {}
+    virtual ~Extracter() = default;
 
     /** Extract an entry from the given iterator to a file. */
     Stat extract(const EntryIterator& it);
@@ -29,11 +39,73 @@ public:
     /** Extract an entry from the given iterator to the given entry output. */
     Stat extract(const EntryIterator& it, EntryOutput& entry_output);
 
+    /** Read the references stored as the content of an entry with the References content layout,
+     * or the reference to the base blob of an entry with the Delta content layout,
+     * or the reference to the referred content of an entry with the Duplicate content layout. */
+    Stat read_references(const EntryIterator& it, std::vector<EntryReference>& references);
+
+    /** Start reading the entries ahead of the ones being extracted in the background, see EntryPrefetcher,
+     * which pays off for extracting many of them in their order, e.g. all of them, from a cold source. */
+    void start_prefetching(std::size_t nr_entries_ahead = EntryPrefetcher::default_nr_entries_ahead);
+    void stop_prefetching() noexcept;
+
+    /** Hint the readahead of the content of each entry extracted from a file source up to the given size
+     * ahead of the decoding, see utils::ReadaheadInputStreambuf, which pays off for large entries on slow disks.
+     * 0, the default, disables the hints. */
+    inline void set_readahead(std::size_t readahead_size = default_readahead_size) noexcept
+    {
+        this->readahead_size = readahead_size;
+    }
+
+    static constexpr std::size_t default_readahead_size = 1 << 22;
+
+    /** Set the max total size of the decoded blobs kept for the subsequent references, see BlobCache. */
+    inline void set_blob_cache_capacity(std::size_t capacity)
+    {
+        blob_cache.set_capacity(capacity);
+    }
+
 protected:
-    Stat extract_stream(const EntryHeader& entry_header, std::ostream& output);
-    Stat extract_symlink(const EntryHeader& entry_header, std::string& target);
+    /** Extract an entry of the given header from the input positioned at its content. */
+    Stat extract_entry(const EntryHeader& entry_header, std::istream& input, EntryOutput& entry_output);
+    Stat extract_stream(const EntryHeader& entry_header, std::istream& input, std::ostream& output);
+    Stat extract_references(const EntryHeader& entry_header, std::istream& input, std::ostream& output);
+    Stat extract_delta(const EntryHeader& entry_header, std::istream& input, std::ostream& output);
+    /** Extract the content of an entry with the Duplicate content layout, decoding the referred content. */
+    Stat extract_duplicate(const EntryHeader& entry_header, std::istream& input, std::ostream& output);
+    Stat extract_sparse(const EntryHeader& entry_header, std::istream& input, std::ostream& output,
+                        EntryOutput& entry_output);
+    Stat extract_symlink(const EntryHeader& entry_header, std::istream& input, std::string& target);
+
+    /** Decode the encoded content of another entry referred by an entry with the Duplicate content layout. */
+    virtual Stat decode_referred_content(const EntryReference& reference, const CompressionParams& compression,
+                                         std::ostream& output);
+    /** Decode the content of the blob with the given identifier, caching the recently decoded ones.
+     * The blob content is valid until the next blob is loaded. */
+    virtual Stat load_blob(const BlobId& blob_id, std::string_view& blob);
+    /** Decode the content of a blob of the given header from the input positioned at it. */
+    static Stat decode_blob(const EntryHeader& entry_header, std::istream& input, std::string& blob);
+    /** Check if a content can be decoded into a buffer allocated ahead by its original size. The size comes
+     * from the source, so a corrupted one must not make a huge allocation, the larger contents grow instead. */
+    static inline bool can_preallocate(const EntryHeader& entry_header) noexcept
+    {
+        return entry_header.has_original_size() && entry_header.original_size <= max_preallocated_size;
+    }
+    /** Find the position of the blob with the given identifier, (re)indexing the blobs if needed. */
+    Stat find_blob(const BlobId& blob_id, uint64_t& pos, EntryHeader& entry_header);
+    /** Index the positions of all the blobs in the source. */
+    void index_blobs();
+
+    static constexpr uint64_t max_preallocated_size = uint64_t(64) << 20;
 
     std::istream& source;
+    /** Positions of the blobs in the source. May get outdated if the source gets modified. */
+    std::unordered_map<BlobId, uint64_t, BlobId::Hasher> blob_positions;
+    bool blobs_indexed = false;
+    /** The recently decoded blobs, as the references to a blob tend to be close to each other. */
+    BlobCache blob_cache;
+    std::optional<EntryPrefetcher> prefetcher;
+    std::size_t readahead_size = 0;
 };
 
 }
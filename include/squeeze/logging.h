@@ -31,6 +31,7 @@
 #define SPDLOG_ACTIVE_LEVEL SQUEEZE_LOG_LEVEL
 
 #include <spdlog/spdlog.h>
+#include <spdlog/sinks/stdout_color_sinks.h>
 
 #include <type_traits>
 #include <string>
@@ -71,6 +72,14 @@ inline void init_logging()
 #endif
 }
 
+/** Make the logs go to the standard error output, e.g. when the standard output is taken by the data. */
+inline void redirect_logging_to_stderr()
+{
+    // new loggers get the level and the pattern set globally
+    auto logger = spdlog::get("stderr");
+    spdlog::set_default_logger(logger ? std::move(logger) : spdlog::stderr_color_mt("stderr"));
+}
+
 }
 
 #else
@@ -102,6 +111,10 @@ inline void init_logging()
 {
 }
 
+inline void redirect_logging_to_stderr()
+{
+}
+
 }
 
 #endif /** SQUEEZE_USE_LOGGING */
@@ -90,7 +90,11 @@ public:
     /** Zero-pad remaining bits and flush them. */
     inline std::size_t finalize()
     {
-        if (seq.is_valid() and char_size != mid_off) {
+        if (char_size != mid_off) {
+            if (not seq.is_valid()) [[unlikely]] {
+                overflown = true;
+                return char_size - mid_off;
+            }
             *seq.it = mid_chr << mid_off; ++seq.it;
             reset();
         }
@@ -122,6 +126,12 @@ public:
         return seq.is_valid();
     }
 
+    /** Check if the bounded output has run out while encoding, having the bits past its end dropped. */
+    inline bool has_overflown() const noexcept
+    {
+        return overflown;
+    }
+
     /** Continue by using a different unbounded iterator. */
     template<std::output_iterator<Char> NextOutIt>
     inline auto continue_by(NextOutIt it) const
@@ -155,8 +165,10 @@ private:
 
         if (0 == mid_off) {
             mid_off = char_size;
-            if (not seq.is_valid())
+            if (not seq.is_valid()) [[unlikely]] {
+                overflown = true;
                 return;
+            }
             *seq.it = mid_chr; ++seq.it;
         }
     }
@@ -170,11 +182,15 @@ private:
     }
 
     /** Encode remainder bits left after previous two operations. These won't be flushed immediately
-     * and wait for upcoming bits to combine with and flush together. */
+     * and wait for upcoming bits to combine with and flush together. The bits left whole characters
+     * long, when the output has run out, are dropped. */
     template<typename Bitset>
     inline void encode_remainder_bits(const Bitset& bits, std::size_t& nr_bits)
     {
-        assert(nr_bits < char_size);
+        if (nr_bits >= char_size) [[unlikely]] {
+            overflown = true;
+            return;
+        }
         mid_chr = (mid_chr << nr_bits) | (static_cast<Char>(bits.to_ullong()) & ((Char(1) << nr_bits) - 1));
         mid_off -= nr_bits;
         nr_bits = 0;
@@ -186,6 +202,8 @@ private:
      * Can also be thought of as a position of the unwritten bit stream within the mid char.
      * It's the opposite of Decoder::mid_pos and its initial value is char_size. */
     std::size_t mid_off = char_size;
+    /** Whether any bits have been dropped for the output running out. */
+    bool overflown = false;
     /** Output character sequence. */
     Seq seq;
 };
@@ -364,16 +382,17 @@ private:
     }
 
     /** Decode remainder bits that won't fully consume the fetched character.
-     * Store the unused bits in the mid character to be processed later. */
+     * Store the unused bits in the mid character to be processed later.
+     * Leaves the bits undecoded if the input has run out, whole characters of them included. */
     template<typename Bitset>
     inline void decode_remainder_bits(Bitset& bits, std::size_t& nr_bits)
     {
-        assert(nr_bits < char_size);
-        assert(nr_bits != 0);
-
         if (not seq.is_valid())
             return;
 
+        assert(nr_bits < char_size);
+        assert(nr_bits != 0);
+
         mid_chr = *seq.it; ++seq.it;
 
         mid_pos = char_size - nr_bits;
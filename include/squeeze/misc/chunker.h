@@ -0,0 +1,47 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+namespace squeeze::misc {
+
+/** Content-defined chunker based on the FastCDC algorithm.
+ * Chunk boundaries are found with a gear rolling hash, so they depend only on the nearby content
+ * and mostly survive insertions and deletions elsewhere. Normalized chunking is used: a stricter
+ * mask below the average chunk size and a looser one above it, which narrows the chunk size spread. */
+class Chunker {
+public:
+    /** Construct the chunker by the average chunk size, which gets rounded up to a power of two.
+     * The min and max chunk sizes are respectively a quarter and four times of the average. */
+    explicit Chunker(std::size_t avg_size);
+
+    /** Find the size of the chunk at the beginning of the data.
+     * The data must be at least of the max chunk size unless it's the remainder of the content. */
+    std::size_t find_chunk_size(std::span<const char> data) const noexcept;
+
+    inline std::size_t get_min_size() const noexcept
+    {
+        return min_size;
+    }
+
+    inline std::size_t get_avg_size() const noexcept
+    {
+        return avg_size;
+    }
+
+    inline std::size_t get_max_size() const noexcept
+    {
+        return max_size;
+    }
+
+private:
+    std::size_t min_size, avg_size, max_size;
+    uint64_t mask_s, mask_l;
+};
+
+}
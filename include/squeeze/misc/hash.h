@@ -0,0 +1,41 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+namespace squeeze::misc {
+
+/** 128-bit hash value. */
+using Hash128 = std::array<uint64_t, 2>;
+
+/** Calculate the 128-bit MurmurHash3 (x64 variant) of the given data.
+ * It's not a cryptographic hash, but it's fast and good enough for identifying
+ * contents with a negligible probability of collision. */
+Hash128 murmur3_128(std::span<const char> data, uint64_t seed = 0);
+
+/** Incremental calculation of the 128-bit MurmurHash3 (x64 variant),
+ * for data that comes in pieces. Results in the same hash as murmur3_128() of the whole data. */
+class Murmur3Hasher {
+public:
+    explicit Murmur3Hasher(uint64_t seed = 0);
+
+    /** Feed the next piece of the data. */
+    void update(std::span<const char> data);
+    /** Get the hash of the data fed so far. */
+    Hash128 digest() const;
+
+private:
+    void process_block(const char *block);
+
+    uint64_t h1, h2;
+    uint64_t length = 0;
+    std::array<char, 16> tail {};
+    std::size_t tail_size = 0;
+};
+
+}
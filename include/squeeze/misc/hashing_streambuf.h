@@ -0,0 +1,86 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+#include <vector>
+
+#include "hash.h"
+
+namespace squeeze::misc {
+
+/** Input stream buffer hashing the data read from the source stream on its way through,
+ * so that the data can be identified while it's read for another purpose, rather than read twice.
+ * A source read error is reported as an input error of the stream reading through the buffer. */
+class HashingInputStreambuf : public std::streambuf {
+public:
+    explicit HashingInputStreambuf(std::istream& source, std::size_t buffer_size = default_buffer_size)
+        : source(source), buffer(buffer_size)
+    {
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+    /** Get the hash of the data read from the source so far. */
+    inline Hash128 digest() const
+    {
+        return hasher.digest();
+    }
+
+    /** Get the size of the data read from the source so far. */
+    inline uint64_t get_read_size() const noexcept
+    {
+        return read_size;
+    }
+
+    static constexpr std::size_t default_buffer_size = BUFSIZ;
+
+protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char_type *s, std::streamsize n) override;
+
+private:
+    /** Read from the source, hashing the data read. */
+    std::streamsize read_source(char *s, std::streamsize n);
+
+    std::istream& source;
+    std::vector<char> buffer;
+    Murmur3Hasher hasher;
+    uint64_t read_size = 0;
+};
+
+/** Output stream buffer hashing the data written to the target stream on its way through,
+ * so that the data can be verified while it's written. Writes straight through, without buffering. */
+class HashingOutputStreambuf : public std::streambuf {
+public:
+    explicit HashingOutputStreambuf(std::ostream& target) : target(target)
+    {
+    }
+
+    /** Get the hash of the data written to the target so far. */
+    inline Hash128 digest() const
+    {
+        return hasher.digest();
+    }
+
+    /** Get the size of the data written to the target so far. */
+    inline uint64_t get_written_size() const noexcept
+    {
+        return written_size;
+    }
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char_type *s, std::streamsize n) override;
+
+private:
+    std::ostream& target;
+    Murmur3Hasher hasher;
+    uint64_t written_size = 0;
+};
+
+}
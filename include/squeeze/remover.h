@@ -5,8 +5,10 @@
 #pragma once
 
 #include <istream>
+#include <string_view>
 #include <vector>
 #include <queue>
+#include <unordered_set>
 
 #include "entry_iterator.h"
 #include "status.h"
@@ -28,6 +30,15 @@ protected:
         bool operator()(const FutureRemove& a, const FutureRemove& b);
     };
 
+    /** Data between the removed entries moved to the left by the removes. */
+    struct Move {
+        uint64_t pos, end;
+        /** Distance the header at the beginning of the data has been moved by. */
+        uint64_t header_distance;
+        /** Distance the rest of the data has been moved by, differing if the header has been re-encoded. */
+        uint64_t distance;
+    };
+
 public:
     explicit Remover(std::iostream& target);
     ~Remover();
@@ -35,6 +46,14 @@ public:
     /** Register a future remove operation by providing an iterator pointing to the entry to be removed.
      * Pass an optional pointer to a future status to assign when the task is done. */
     void will_remove(const EntryIterator& it, Stat *err = nullptr);
+    /** Check if a future remove operation has been registered for the entry at the given position. */
+    inline bool will_be_removed(uint64_t pos) const
+    {
+        return future_remove_positions.contains(pos);
+    }
+
+    /** Check if any future remove operation has been registered. */
+    bool has_future_removes() const;
 
     /** Remove an entry immediately by passing an iterator pointing to it. */
     Stat remove(const EntryIterator& it);
@@ -45,8 +64,25 @@ public:
     bool perform_removes();
 
 protected:
+    /** Perform the registered removes, treating the given position as the end of the stream. */
+    bool perform_removes(uint64_t end_pos);
+    /** Get an iterator to the first entry registered to be removed, or EntryIterator::end if there are none. */
+    EntryIterator get_first_future_remove() const;
+    /** Get the position the data at the given position has been moved to by the last performed removes,
+     * or EntryIterator::npos if the data has been removed. */
+    uint64_t get_moved_pos(uint64_t pos) const;
+    /** Re-encode the compact header of the entry at the source position, following the removed entry,
+     * to the destination position, front-coding its path against the given previous path instead.
+     * Sets the lengths of the header and the re-encoded one, or zeros if there's nothing to re-encode. */
+    Stat reencode_following_header(uint64_t dst_pos, uint64_t src_pos, uint64_t len,
+                                   std::string_view removed_path, std::string_view previous_path,
+                                   uint64_t& header_len, uint64_t& new_header_len);
+
     std::iostream& target;
     std::priority_queue<FutureRemove, std::vector<FutureRemove>, FutureRemoveCompare> future_removes;
+    std::unordered_set<uint64_t> future_remove_positions;
+    /** Data moved by the last performed removes, in the order of their positions. */
+    std::vector<Move> moves;
 
 };
 
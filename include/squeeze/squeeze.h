@@ -4,6 +4,9 @@
 
 #pragma once
 
+#include <span>
+#include <utility>
+
 #include "reader.h"
 #include "writer.h"
 #include "entry.h"
@@ -23,11 +26,61 @@ public:
     /** The update method functions similarly to write(), but it handles cases where append
      * operations are registered for entries that already exist with the same path in the stream.
      * It ensures that these existing entries are removed before being re-appended,
-     * effectively updating the entries.
+     * effectively updating the entries. With delta updates enabled, the updated regular files
+     * get delta encoded against their previous contents, see DeltaParams.
+     * Blob entries no longer referred to by any of
+     * the remaining entries are removed as well.
      * The method guarantees that the put pointer of the target stream
      * will be at the new end of the stream.
      * Returns true if fully successful, or false if errors occurred and may need further checking. */
     bool update();
+
+    /** Same as Writer::write(), but also removes the blob entries no longer referred to
+     * by any of the remaining entries, if there are any to remove, and keeps the duplicate entries
+     * referring to the contents of the removed or moved entries valid, see prepare_duplicates(). */
+    bool write();
+
+    /** Same as Remover::will_remove(), but also keeps track of whether any blob entry may
+     * no longer be referred to once the entry is removed. */
+    void will_remove(const EntryIterator& it, Remover::Stat *err = nullptr);
+    /** Same as Remover::remove(), but also removes the blob entries no longer referred to. */
+    Remover::Stat remove(const EntryIterator& it);
+    /** Same as Remover::perform_removes(), but also removes the blob entries no longer referred to,
+     * and keeps the duplicate entries valid. */
+    bool perform_removes();
+
+protected:
+    /** Append the updated regular files to delta encode, registered among the future appends, ahead of
+     * the rest of the appends and removes, each one loading its base only right before its append. */
+    bool perform_delta_updates(std::span<const std::pair<FutureAppend *, EntryIterator>> delta_updates);
+    /** Load the previous content of an updated entry for its new version to be delta encoded against.
+     * An entry already delta encoded keeps its base unless the delta has grown too large. */
+    StatStr load_delta_base(const EntryIterator& it, DeltaBase& base);
+    /** Remove the blob entries no longer referred to by any entry, if there may be any. */
+    bool remove_unreferred_blobs();
+    /** Prepare the duplicate entries, see EntryContentLayout::Duplicate, for the registered removes.
+     * Only the entries following the first removed one get moved, and so do the duplicates following their
+     * contents. The first remaining duplicate of a removed content takes it over, being appended past
+     * the given end position as a plain entry in place of the duplicate, while the rest refer to it.
+     * The references to the moved contents are noted to be updated once the removes are performed.
+     * The end position is advanced past the appended entries, and is found if given as npos. */
+    bool prepare_duplicates(uint64_t& end_pos);
+    /** Update the noted references of the duplicate entries to the positions the removes moved them to. */
+    bool update_duplicates();
+
+    /** Whether some blob entries may no longer be referred to, either because entries referring to
+     * blobs have been removed, or because blobs have been appended, some of which may be left
+     * unreferred by failed appends, or duplicate existing ones. */
+    bool blobs_may_be_unreferred = false;
+
+    /** Reference of a duplicate entry to update once the entries get moved by the removes. */
+    struct MovedDuplicate {
+        /** Position of the reference, that is, of the duplicate entry content. */
+        uint64_t pos;
+        EntryReference reference;
+    };
+
+    std::vector<MovedDuplicate> moved_duplicates;
 };
 
 }
@@ -0,0 +1,130 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+
+#include "printing.h"
+
+namespace squeeze {
+
+/** Stages of the encoding and the decoding pipelines which the statistics are collected of. */
+enum class StatsStage {
+    FileRead,       /** Reading the contents of the files appended. */
+    LZ77Encode,     /** LZ77 encoding of the Deflate blocks. */
+    HuffmanEncode,  /** Huffman encoding of the Deflate blocks and of the Huffman ones. */
+    AppendWait,     /** Waiting of the appending thread for the blocks being encoded. */
+    AppendWrite,    /** Writing of the appended data out to the target, batched, by the appending thread. */
+    Decode,         /** Decoding of the encoded contents. */
+};
+
+inline constexpr std::size_t nr_stats_stages = 6;
+
+/** Counters of a pipeline stage. The sizes are in bytes, and those of the data not sized
+ * upfront, e.g. the one read through input iterators, are left out. */
+struct StageStats {
+    uint64_t nr_calls = 0;
+    uint64_t bytes_in = 0;
+    uint64_t bytes_out = 0;
+    uint64_t nanoseconds = 0;
+};
+
+/** Snapshot of the counters of all the pipeline stages. */
+struct Stats {
+    inline StageStats& operator[](StatsStage stage) noexcept
+    {
+        return stages[static_cast<std::size_t>(stage)];
+    }
+
+    inline const StageStats& operator[](StatsStage stage) const noexcept
+    {
+        return stages[static_cast<std::size_t>(stage)];
+    }
+
+    std::array<StageStats, nr_stats_stages> stages {};
+};
+
+/** Whether the statistics are collected, otherwise they're compiled out and stay zero. */
+#ifdef SQUEEZE_USE_STATS
+inline constexpr bool stats_enabled = true;
+#else
+inline constexpr bool stats_enabled = false;
+#endif
+
+/** Take a snapshot of the counters, summed over all the threads. The counters updated concurrently
+ * are read one by one, so the snapshot is exact only when the pipeline is idle. */
+Stats get_stats();
+/** Zero the counters. Updates made concurrently may be partially lost. */
+void reset_stats();
+
+template<> void print_to(std::ostream& os, const StatsStage& stage);
+
+namespace stats {
+
+/** Count the bytes between the iterators if it can be done without consuming them, otherwise 0. */
+template<typename It, typename ItEnd>
+inline uint64_t count_bytes(const It& it, const ItEnd& it_end)
+{
+    if constexpr (std::sized_sentinel_for<ItEnd, It>)
+        return static_cast<uint64_t>(it_end - it);
+    else
+        return 0;
+}
+
+#ifdef SQUEEZE_USE_STATS
+
+/** Add a call to the counters of the stage, in the shard of the calling thread. */
+void record(StatsStage stage, uint64_t bytes_in, uint64_t bytes_out, uint64_t nanoseconds) noexcept;
+
+/** Timer of a stage, started on construction. */
+class StageTimer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    StageTimer() noexcept : start(Clock::now())
+    {
+    }
+
+    inline uint64_t get_nanoseconds() const noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+    }
+
+    /** Record a call of the stage taking the time elapsed since the start. */
+    inline void record(StatsStage stage, uint64_t bytes_in, uint64_t bytes_out) const noexcept
+    {
+        stats::record(stage, bytes_in, bytes_out, get_nanoseconds());
+    }
+
+private:
+    Clock::time_point start;
+};
+
+#else
+
+inline void record(StatsStage, uint64_t, uint64_t, uint64_t) noexcept
+{
+}
+
+class StageTimer {
+public:
+    inline uint64_t get_nanoseconds() const noexcept
+    {
+        return 0;
+    }
+
+    inline void record(StatsStage, uint64_t, uint64_t) const noexcept
+    {
+    }
+};
+
+#endif /** SQUEEZE_USE_STATS */
+
+}
+
+}
@@ -0,0 +1,131 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+
+#include "extracter.h"
+#include "entry_frames.h"
+#include "utils/io.h"
+
+namespace squeeze {
+
+/** Forward-only counterpart of Extracter, reading the entries sequentially from a source that doesn't need
+ * to be seekable, e.g. the standard input or a pipe, so the entries can be extracted as the source arrives.
+ * The entries are visited one by one with next(), and each one may be extracted, at most once, or skipped.
+ * The blobs are decoded and kept in memory as they go by, since the entries referring to them follow them.
+ * Their total size is bounded by the blob cache capacity, the least recently used ones being evicted beyond it,
+ * after which extracting an entry referring to an evicted blob fails, as the source can't be read again.
+ * So are the encoded plain contents of the regular files, for the duplicate entries referring to them,
+ * in a cache of the same capacity, which the contents larger than it don't get into.
+ * The content size of a framed entry isn't known until the content is read, so it's reported as unknown_size,
+ * unless the content is small enough to be read ahead, i.e. of a symlink, a blob or a list of references. */
+class StreamExtracter : protected Extracter {
+public:
+    using Stat = Extracter::Stat;
+
+    /** Construct the interface by passing a reference to the istream source to read from. */
+    explicit StreamExtracter(std::istream& source);
+
+    StreamExtracter(const StreamExtracter&) = delete;
+    StreamExtracter& operator=(const StreamExtracter&) = delete;
+
+    /** Read the next entry header, the first one on the first call, skipping the rest of the current entry.
+     * Returns false past the last entry or on a corrupted one. */
+    bool next();
+
+    /** Get the position of the current entry relative to where the reading started,
+     * npos before the first one and past the last one. */
+    inline uint64_t get_pos() const noexcept
+    {
+        return pos;
+    }
+
+    /** Get the header of the current entry, valid until the next one is read. */
+    inline const EntryHeader& get_header() const noexcept
+    {
+        return entry_header;
+    }
+
+    /** Get the path of the current entry, valid until the next one is read. */
+    inline std::string_view get_path() const noexcept
+    {
+        return entry_header.path;
+    }
+
+    /** Check if the reading stopped on a corrupted entry or on a source error rather than at the end. */
+    inline bool is_corrupted() const noexcept
+    {
+        return corrupted;
+    }
+
+    /** Extract the current entry to a file. */
+    Stat extract();
+    /** Extract the current entry to the given custom output stream. */
+    Stat extract(std::ostream& output);
+    /** Extract the current entry to the given entry output. */
+    Stat extract(EntryOutput& entry_output);
+
+    /** Set the max total size of the decoded blobs kept for the following references, see BlobCache,
+     * and of the encoded contents kept for the following duplicate entries. */
+    inline void set_blob_cache_capacity(std::size_t capacity)
+    {
+        Extracter::set_blob_cache_capacity(capacity);
+        content_cache.set_capacity(capacity);
+    }
+
+    static constexpr uint64_t npos = EntryIterator::npos;
+
+protected:
+    /** Decode the referred content kept when it went by. */
+    Stat decode_referred_content(const EntryReference& reference, const CompressionParams& compression,
+                                 std::ostream& output) override;
+    /** Get the blob decoded when it went by. */
+    Stat load_blob(const BlobId& blob_id, std::string_view& blob) override;
+
+private:
+    /** Get the stream buffer to read the current entry content from. */
+    std::streambuf *get_content_streambuf();
+    /** Read the content of the current entry ahead, if it's framed and needs its content size. */
+    Stat read_ahead_content();
+    /** Check if the content of the current entry may be referred by a following duplicate entry and be kept. */
+    bool can_be_referred() const noexcept;
+    /** Read the content of the current entry into the content cache, to be read from there. */
+    Stat read_referable_content();
+    /** Skip the rest of the current entry content. */
+    bool skip_content();
+    /** Read the trailing content size of the current framed entry, whose frames have all been read. */
+    bool read_frames_trailer();
+
+    utils::ForwardInputStreambuf forward_streambuf;
+    std::istream forward_source;
+    std::istream& original_source;
+
+    uint64_t pos = npos;
+    bool started = false;
+    bool corrupted = false;
+    bool content_read = false; /** Whether the current entry content has been read, e.g. extracted */
+    EntryHeader entry_header;
+    std::string previous_path;
+
+    std::optional<FramedInputStreambuf> framed_streambuf;
+    /** Content of the current framed entry read ahead, if any */
+    std::optional<std::string> read_ahead;
+    utils::SpanInputStreambuf read_ahead_streambuf;
+    /** Whether the content of the current entry is kept in the content cache, read ahead into it */
+    bool content_kept = false;
+    /** Encoded contents gone by, by their positions, for the duplicate entries referring to them */
+    BlobCache content_cache;
+
+    /** Identifiers of the blobs gone by, telling the evicted blobs from the missing ones */
+    std::unordered_set<BlobId, BlobId::Hasher> passed_blob_ids;
+};
+
+}
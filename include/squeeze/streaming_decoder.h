@@ -0,0 +1,111 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <streambuf>
+
+#include "common.h"
+#include "decode.h"
+
+namespace squeeze {
+
+/** Incremental decoder of the encoded data fed into it piece by piece as it arrives, e.g. in network-sized
+ * chunks, so that the encoded data doesn't have to be reassembled whole before being decoded.
+ * Accepts the output of encode() and StreamingEncoder. The encoded blocks are independent of each other,
+ * so the state kept between the feeds is the encoded tail of the block not fully arrived yet, which gets
+ * decoded once it's complete. Whether it is can only be told by decoding it, so the incomplete block is
+ * retried only after it grows by a half, keeping the retries amortized linear in the block size. */
+class StreamingDecoder {
+public:
+    using Stat = DecodeStat;
+
+    explicit StreamingDecoder(const CompressionParams& compression);
+
+    StreamingDecoder(const StreamingDecoder&) = delete;
+    StreamingDecoder& operator=(const StreamingDecoder&) = delete;
+
+    /** Feed the next piece of the encoded data, appending the data decoded so far to the output. */
+    Stat feed(std::span<const char> data, Buffer& output);
+    /** Decode the rest of the encoded data, which must have been fed whole by now,
+     * appending it to the output, after which nothing can be fed anymore. */
+    Stat finish(Buffer& output);
+
+    /** Get the size of the encoded data fed so far. */
+    inline uint64_t get_input_size() const noexcept
+    {
+        return input_size;
+    }
+
+    /** Get the size of the data decoded so far. */
+    inline uint64_t get_output_size() const noexcept
+    {
+        return output_size;
+    }
+
+    /** Get the size of the encoded data fed but not decoded yet. */
+    inline std::size_t get_pending_size() const noexcept
+    {
+        return pending.size() - pending_pos;
+    }
+
+private:
+    /** Decode the complete blocks of the pending data, or all of it if it's final. */
+    Stat decode_pending(Buffer& output, bool final);
+
+    const CompressionParams compression;
+    const std::size_t block_size;
+    /** Encoded data fed but not decoded yet, starting at the pending position */
+    Buffer pending;
+    std::size_t pending_pos = 0;
+    /** Pending size to reach before retrying to decode the incomplete block */
+    std::size_t retry_size = 0;
+    Buffer block;
+    uint64_t input_size = 0;
+    uint64_t output_size = 0;
+    bool finished = false;
+    /** Whether an error has been met, after which nothing gets decoded anymore */
+    bool failed = false;
+};
+
+/** Output stream buffer decoding the encoded data written through it with a StreamingDecoder
+ * and writing the decoded data to the given output, so that the existing std::ostream code,
+ * e.g. receiving the data, can decompress in place. pubsync(), e.g. by std::ostream::flush(),
+ * decodes the complete blocks written so far, and finish() must be called once done writing. */
+class DecoderStreambuf : public std::streambuf {
+public:
+    DecoderStreambuf(std::ostream& output, const CompressionParams& compression,
+                     std::size_t buffer_size = default_buffer_size);
+    /** Pushes the rest of the data to the decoder, without finishing the decoding. */
+    ~DecoderStreambuf() override;
+
+    /** Decode and write out the rest of the data, after which nothing can be written anymore. */
+    StreamingDecoder::Stat finish();
+
+    inline const StreamingDecoder& get_decoder() const noexcept
+    {
+        return decoder;
+    }
+
+    static constexpr std::size_t default_buffer_size = 1 << 16;
+
+protected:
+    int sync() override;
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char_type *s, std::streamsize n) override;
+
+private:
+    /** Push the data of the put area, or the given data, to the decoder and write out the decoded data. */
+    bool push(std::span<const char> data = {});
+
+    std::ostream& output;
+    StreamingDecoder decoder;
+    Buffer buffer;
+    Buffer decoded;
+};
+
+}
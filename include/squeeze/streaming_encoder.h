@@ -0,0 +1,122 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <future>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <streambuf>
+
+#include "common.h"
+#include "encoder_pool.h"
+
+namespace squeeze {
+
+/** Incremental encoder of the data pushed into it piece by piece, e.g. generated on the fly,
+ * so that the whole data doesn't have to be known, nor kept in memory, up front.
+ * The data is gathered into blocks of the compression block size, which get encoded in the background
+ * by an EncoderPool and written to the output in order. The number of the blocks being encoded at once
+ * is bounded, so a write may wait for the earlier blocks to be written out.
+ * The output is the same as of encode(), except for the blocks cut short by flush(),
+ * and is decodable by decode() given the input size, see get_input_size(). */
+class StreamingEncoder {
+public:
+    using Stat = EncodeStat;
+
+    StreamingEncoder(std::ostream& output, const CompressionParams& compression);
+    StreamingEncoder(std::ostream& output, const CompressionParams& compression, EncoderPool& encoder_pool);
+    /** Finishes the encoding if it hasn't been finished, ignoring the errors. */
+    ~StreamingEncoder();
+
+    StreamingEncoder(const StreamingEncoder&) = delete;
+    StreamingEncoder& operator=(const StreamingEncoder&) = delete;
+
+    /** Push the data to encode. */
+    Stat write(std::span<const char> data);
+    /** Encode the data pushed so far, cutting the current block short, wait for all the blocks
+     * to be encoded, and write them out, flushing the output as well. */
+    Stat flush();
+    /** Encode and write out the rest of the data, after which nothing can be written anymore. */
+    Stat finish();
+
+    /** Get the size of the data pushed so far. */
+    inline uint64_t get_input_size() const noexcept
+    {
+        return input_size;
+    }
+
+    /** Get the size of the encoded data written out so far. */
+    inline uint64_t get_output_size() const noexcept
+    {
+        return output_size;
+    }
+
+    /** Max number of the blocks being encoded at once, per thread of the encoder pool. */
+    static constexpr std::size_t max_pending_blocks_per_thread = 2;
+
+private:
+    /** Schedule the encode of the current block, writing out the encoded blocks beforehand
+     * as long as too many of them are pending. */
+    Stat schedule_block();
+    /** Write out the encoded blocks at the front, either the ones already done, or all of them. */
+    Stat write_out(bool wait_for_all);
+    /** Write out the encoded block at the front, waiting for it. */
+    Stat write_out_front();
+
+    std::ostream& output;
+    const CompressionParams compression;
+    std::optional<EncoderPool> own_encoder_pool;
+    EncoderPool& encoder_pool;
+    const std::size_t block_size;
+    const std::size_t max_pending_blocks;
+    Buffer block;
+    std::deque<std::future<EncodedBuffer>> pending_blocks;
+    uint64_t input_size = 0;
+    uint64_t output_size = 0;
+    bool finished = false;
+    /** Whether an error has been met, after which nothing gets written anymore */
+    bool failed = false;
+};
+
+/** Output stream buffer compressing the data written through it with a StreamingEncoder,
+ * so that the existing std::ostream code can compress in place.
+ * The data is gathered in the put area and pushed to the encoder when it fills up. pubsync(), e.g. by
+ * std::ostream::flush(), flushes the encoder as well, and finish() must be called once done writing. */
+class EncoderStreambuf : public std::streambuf {
+public:
+    EncoderStreambuf(std::ostream& output, const CompressionParams& compression,
+                     std::size_t buffer_size = default_buffer_size);
+    EncoderStreambuf(std::ostream& output, const CompressionParams& compression, EncoderPool& encoder_pool,
+                     std::size_t buffer_size = default_buffer_size);
+    /** Pushes the rest of the data to the encoder, which finishes the encoding if it hasn't been finished. */
+    ~EncoderStreambuf() override;
+
+    /** Encode and write out the rest of the data, after which nothing can be written anymore. */
+    StreamingEncoder::Stat finish();
+
+    inline const StreamingEncoder& get_encoder() const noexcept
+    {
+        return encoder;
+    }
+
+    static constexpr std::size_t default_buffer_size = 1 << 16;
+
+protected:
+    int sync() override;
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char_type *s, std::streamsize n) override;
+
+private:
+    /** Push the data of the put area to the encoder. */
+    bool push();
+
+    StreamingEncoder encoder;
+    Buffer buffer;
+};
+
+}
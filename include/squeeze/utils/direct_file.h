@@ -0,0 +1,116 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <ios>
+#include <streambuf>
+
+#include "squeeze/status.h"
+
+namespace squeeze::utils {
+
+/** Stream buffer reading and writing a file with direct I/O, bypassing the page cache, so that
+ * streaming a very large archive through doesn't evict everything else cached on the host.
+ * The file is accessed through two windows of aligned buffers, taken from a pool, with large aligned
+ * positional reads and writes: one for reading and one for writing, with their own positions, as with
+ * std::stringstream, so that moving data within the file doesn't fetch a window anew on every switch
+ * between the source and the destination. The data read within the writing window is read from it,
+ * pending writes included. The unaligned head and tail of the data written are completed from
+ * the file, and the file is truncated back to the size written up to on pubsync() and close().
+ * Only supported where O_DIRECT is, see is_supported(), and the file system may refuse it as well. */
+class DirectFileStreambuf : public std::streambuf {
+public:
+    DirectFileStreambuf() = default;
+    /** Closes the file if open, ignoring the errors. */
+    ~DirectFileStreambuf() override;
+
+    DirectFileStreambuf(const DirectFileStreambuf&) = delete;
+    DirectFileStreambuf& operator=(const DirectFileStreambuf&) = delete;
+
+    /** Open the file for reading, and for writing if the mode has out, creating it if it has trunc. */
+    StatCode open(const std::filesystem::path& path, std::ios_base::openmode open_mode);
+    /** Write out the pending data, truncate the file to the size written up to and close it. */
+    StatCode close();
+    /** Resize the open file, e.g. cutting off what's left past the data moved back by removing entries,
+     * as std::filesystem::resize_file() would, which mustn't be used while the file is open here. */
+    StatCode resize(uint64_t size);
+
+    inline bool is_open() const noexcept
+    {
+        return fd >= 0;
+    }
+
+    static constexpr bool is_supported() noexcept
+    {
+#if defined(__linux__)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    /** Alignment of the buffer, the file positions and the sizes of the reads and writes. */
+    static constexpr std::size_t alignment = 1 << 12;
+    /** Size of the window, i.e. of the reads and the writes, except the last ones. */
+    static constexpr std::size_t window_size = 1 << 22;
+
+protected:
+    int sync() override;
+    int_type underflow() override;
+    int_type overflow(int_type ch) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    /** Get the reading position, whether the get area is set or not. */
+    inline uint64_t get_read_pos() const noexcept
+    {
+        if (eback() == nullptr)
+            return read_pos;
+        const uint64_t area_pos = eback() == write_window ? write_window_pos : read_window_pos;
+        return area_pos + static_cast<uint64_t>(gptr() - eback());
+    }
+
+    /** Get the writing position, whether the put area is set or not. */
+    inline uint64_t get_write_pos() const noexcept
+    {
+        if (pbase() == nullptr)
+            return write_pos;
+        return write_window_pos + static_cast<uint64_t>(pptr() - write_window);
+    }
+
+    /** Unset the get area, keeping the reading position, so that it's set anew on the next read. */
+    void drop_get_area() noexcept;
+    /** Account the data put since the last time as written, extending the file size. */
+    void note_written() noexcept;
+    /** Set the put area at the position, moving the writing window to cover it if needed. */
+    bool seek_write(uint64_t pos);
+    /** Write out the written part of the writing window, dropping the read data it overlaps. */
+    bool write_out();
+    /** Write out the writing window and move it to cover the given position, reading it from the file. */
+    bool move_write_window(uint64_t pos);
+    /** Move the reading window to cover the given position, reading it from the file. */
+    bool move_read_window(uint64_t pos);
+    /** Read the data of the file in the range into the buffer, the gaps past the end of the file as zeros. */
+    bool read_in(char *buffer, uint64_t pos, std::size_t data_size);
+
+    int fd = -1;
+    bool writable = false;
+    char *read_window = nullptr;
+    uint64_t read_window_pos = 0;
+    std::size_t read_data_size = 0; /** Size of the data read into the reading window, zero when dropped */
+    uint64_t read_pos = 0; /** Reading position, while the get area isn't set */
+    char *write_window = nullptr;
+    uint64_t write_window_pos = 0;
+    uint64_t write_pos = 0; /** Writing position, while the put area isn't set */
+    std::size_t dirty_begin = window_size, dirty_end = 0; /** Range of the writing window not written out yet */
+    uint64_t file_size = 0; /** Size of the file up to the furthest point written */
+    bool padded = false; /** Whether the file has been written out past its size, up to the alignment */
+};
+
+}
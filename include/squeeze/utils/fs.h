@@ -4,21 +4,103 @@
 
 #pragma once
 
+#include <streambuf>
 #include <string_view>
 #include <variant>
+#include <vector>
 #include <fstream>
 #include <filesystem>
 
 #include "squeeze/status.h"
 #include "squeeze/entry_common.h"
+#include "squeeze/entry_extent.h"
 
 namespace squeeze::utils {
 
 std::variant<std::fstream, StatCode> make_regular_file(std::string_view path);
 std::variant<std::ofstream, StatCode> make_regular_file_out(std::string_view path);
+/** Make way for a regular file about to be created anew, making its parent directories
+ * and removing the existing one, as make_regular_file_out() does before creating it. */
+StatCode prepare_regular_file_out(const std::filesystem::path& path);
 StatCode make_directory(std::string_view path, EntryPermissions perms);
 StatCode make_symlink(std::string_view path, std::string_view link_to, EntryPermissions perms);
 StatCode set_permissions(const std::filesystem::path& path, EntryPermissions perms);
+/** Get the size and the data extents of a regular file, that is, the ranges not covered by holes.
+ * Where holes can't be queried, the whole file is reported as a single extent. */
+StatCode get_data_extents(const std::filesystem::path& path, EntryExtentMap& map);
+/** Reserve the storage for a regular file about to be written up to the given size,
+ * without changing its size. Does nothing where preallocation isn't supported. */
+StatCode preallocate_file(const std::filesystem::path& path, uint64_t size);
+
+/** Get the descriptor of the open file underlying the stream, if its buffer is a std::filebuf
+ * and the standard library exposes it, otherwise -1. The buffered data isn't accounted for. */
+int get_file_descriptor(std::ios& stream);
+/** Check whether the file descriptor is open and refers to a regular file. */
+bool is_regular_file(int fd);
+/** Duplicate the file descriptor, so it outlives the stream it came from. Returns -1 on failure. */
+int duplicate_file_descriptor(int fd);
+void close_file_descriptor(int fd) noexcept;
+/** Copy a range of a file to another one at the given positions, leaving their file offsets unspecified.
+ * The data is moved right in the kernel with copy_file_range(), which may share the extents on the file
+ * systems supporting reflinks, or with sendfile(), and is only read and written through as a last resort. */
+StatCode copy_file_data(int src_fd, uint64_t src_pos, int dst_fd, uint64_t dst_pos, uint64_t size);
+
+/** Min size of the data to copy between files with copy_file_data() rather than through the streams. */
+static constexpr uint64_t min_file_copy_size = 1 << 16;
+
+/** Hint that the file is going to be read mostly sequentially, e.g. by widening its readahead.
+ * Does nothing where the hints aren't supported, or for a negative file descriptor. */
+void advise_sequential(int fd);
+/** Hint that the range of the file is going to be read soon, so it may start getting read in the background.
+ * Does nothing where the hints aren't supported, or for a negative file descriptor. */
+void advise_will_need(int fd, uint64_t pos, uint64_t size);
+
+/** Input stream buffer reading a file with the positional reads, so that it doesn't share the file offset
+ * with anything else using the same file, e.g. a stream on another thread. Doesn't own the file descriptor. */
+class PositionalInputStreambuf : public std::streambuf {
+public:
+    explicit PositionalInputStreambuf(int fd, std::size_t buffer_size = default_buffer_size);
+
+    static constexpr std::size_t default_buffer_size = 1 << 16;
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    int fd;
+    std::vector<char> buffer;
+    uint64_t buffer_pos = 0; /** Position of the buffer in the file */
+};
+
+/** Input stream buffer reading through the source stream of a file, hinting the readahead of the file only
+ * up to a window ahead of the position read up to, renewed as the reading goes on, rather than of a whole
+ * large range at once, which would have it read far ahead of its use, evicting the cache meanwhile.
+ * The source is sought to the position of the buffer before each read, as it may get moved in between.
+ * The file positions are the source positions shifted by the file offset, and aren't hinted past the end. */
+class ReadaheadInputStreambuf : public std::streambuf {
+public:
+    ReadaheadInputStreambuf(std::istream& source, int fd, uint64_t file_offset, uint64_t file_end,
+                            uint64_t window_size, std::size_t buffer_size = default_buffer_size);
+
+    static constexpr std::size_t default_buffer_size = 1 << 16;
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    std::istream& source;
+    int fd;
+    uint64_t file_offset;
+    uint64_t file_end;
+    uint64_t window_size;
+    std::vector<char> buffer;
+    uint64_t buffer_pos = 0; /** Position of the buffer in the source */
+    uint64_t hinted_end = 0; /** End of the file range hinted so far */
+};
 
 void convert(const EntryPermissions& from, std::filesystem::perms& to);
 void convert(const std::filesystem::perms& from, EntryPermissions& to);
@@ -4,16 +4,28 @@
 
 #pragma once
 
+#include <fstream>
 #include <iostream>
+#include <span>
+#include <streambuf>
+#include <vector>
 
 #include "squeeze/status.h"
 
 namespace squeeze::utils {
 
 StatStr iosmove(std::iostream& ios, std::streampos dst, std::streampos src, std::streamsize len);
+/** Copy the given length from the source stream position to the destination one. Large enough
+ * copies between file streams are done right between the files, see copy_file_data() in fs.h. */
 StatStr ioscopy(std::istream& src_stream, std::streampos src_pos,
              std::ostream& dst_stream, std::streampos dst_pos,
              std::streamsize cpy_len);
+/** Copy the rest of the source stream, from the current position till its end, to the destination one. */
+StatStr ioscopy_till_end(std::istream& src_stream, std::ostream& dst_stream);
+
+/** Get the size of the rest of the stream, from the current position to the end.
+ * Returns -1 if the stream isn't seekable. */
+std::streamsize get_remaining_size(std::istream& stream);
 
 template<std::ios::iostate include_bits, std::ios::iostate exclude_bits = std::ios::goodbit>
     bool validate_stream_bits(std::ios& stream)
@@ -38,4 +50,173 @@ inline bool validate_stream_fail_eof(std::ios& stream)
     return validate_stream_bits<std::ios::failbit | std::ios::badbit | std::ios::eofbit>(stream);
 }
 
+/** Output stream buffer the data can be produced right into, e.g. decoded, rather than copied into it,
+ * by reserving the room for it at the current position and committing the size produced there afterwards. */
+class DirectOutputStreambuf : public std::streambuf {
+public:
+    /** Get the room of at least the given size at the current position, or an empty span if it can't be made. */
+    virtual std::span<char> reserve(std::size_t size) = 0;
+
+    /** Advance the current position past the data produced into the reserved room, at most of its size. */
+    inline void commit(std::size_t size)
+    {
+        pbump(static_cast<int>(size));
+    }
+};
+
+/** Output stream buffer writing into a preallocated buffer, failing the writes past its end. */
+class SpanOutputStreambuf : public std::streambuf {
+public:
+    explicit SpanOutputStreambuf(std::span<char> span)
+    {
+        setp(span.data(), span.data() + span.size());
+    }
+
+    /** Get the size of the data written so far. */
+    inline std::size_t get_written_size() const
+    {
+        return pptr() - pbase();
+    }
+
+protected:
+    /** Only reports the current position, as the output is sequential. */
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (off == 0 && dir == std::ios_base::cur && (which & std::ios_base::out))
+            return pos_type(static_cast<off_type>(get_written_size()));
+        return pos_type(off_type(-1));
+    }
+
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(sp) - static_cast<off_type>(get_written_size()), std::ios_base::cur, which);
+    }
+};
+
+/** Input stream buffer reading from a memory span in place, without copying it. */
+class SpanInputStreambuf : public std::streambuf {
+public:
+    explicit SpanInputStreambuf(std::span<const char> span = {})
+    {
+        reset(span);
+    }
+
+    /** Start reading from another span. */
+    inline void reset(std::span<const char> span)
+    {
+        char *data = const_cast<char *>(span.data());
+        setg(data, data, data + span.size());
+    }
+
+    /** Get the size of the data read so far. */
+    inline std::size_t get_read_size() const
+    {
+        return gptr() - eback();
+    }
+
+protected:
+    /** Only reports the current position, as the input is sequential. */
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override
+    {
+        if (off == 0 && dir == std::ios_base::cur && (which & std::ios_base::in))
+            return pos_type(static_cast<off_type>(get_read_size()));
+        return pos_type(off_type(-1));
+    }
+
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override
+    {
+        return seekoff(off_type(sp) - static_cast<off_type>(get_read_size()), std::ios_base::cur, which);
+    }
+};
+
+/** Input stream buffer reading a source stream forward only, e.g. a pipe, through a buffer.
+ * The positions are counted from where the reading started. The seeks forward are emulated
+ * by skipping the data, while the seeks backward are possible only within the buffer. */
+class ForwardInputStreambuf : public std::streambuf {
+public:
+    explicit ForwardInputStreambuf(std::istream& source, std::size_t buffer_size = default_buffer_size)
+        : source(source), buffer(buffer_size)
+    {
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+
+    static constexpr std::size_t default_buffer_size = 1 << 16;
+
+protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char_type *s, std::streamsize n) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    inline off_type get_pos() const
+    {
+        return buffer_pos + (gptr() - eback());
+    }
+
+    std::istream& source;
+    std::vector<char> buffer;
+    off_type buffer_pos = 0; /** Position of the buffer data in the source */
+};
+
+/** Output stream buffer coalescing the writes to a target stream into large batches written at once.
+ * Seeks within the batch not written out yet, e.g. for patching the data just written, are done
+ * in memory, and so are the position queries. The writes larger than the batch go directly to the target.
+ * The batch gets written out on pubsync() and on destruction, before which the target mustn't be used.
+ * For a non-seekable target, the positions are relative to where the writing started, only the seeks
+ * within the batch are possible, and the data past the position the batch was rewound to gets discarded. */
+class BatchOutputStreambuf : public std::streambuf {
+public:
+    explicit BatchOutputStreambuf(std::ostream& target, std::size_t batch_size = default_batch_size);
+    ~BatchOutputStreambuf() override;
+
+    /** Check whether the target is seekable, otherwise the seeks are limited to the batch. */
+    inline bool is_seekable() const noexcept
+    {
+        return seekable;
+    }
+
+    /** Write a range of the given file at the current position right between the files, after writing
+     * the batch out, see copy_file_data() in fs.h. Fails if the target isn't a seekable file. */
+    StatStr write_file_data(int fd, uint64_t pos, uint64_t size);
+
+    static constexpr std::size_t default_batch_size = 1 << 20;
+
+protected:
+    int sync() override;
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char_type *s, std::streamsize n) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    /** Write the batch out, up to the furthest point written, and continue at the current position. */
+    bool write_out();
+
+    std::ostream& target;
+    std::vector<char> batch;
+    off_type batch_pos; /** Position of the batch in the target */
+    bool seekable;
+    std::size_t batch_data_size = 0; /** Size of the batch data up to the furthest point written */
+};
+
+#ifdef SQUEEZE_USE_STATS
+
+/** File stream buffer counting the reads of the file in the FileRead stage statistics, see stats.h.
+ * Being a std::filebuf, the file descriptor stays reachable, see get_file_descriptor() in fs.h. */
+class StatsInputFilebuf : public std::filebuf {
+protected:
+    int_type underflow() override;
+    std::streamsize xsgetn(char_type *s, std::streamsize n) override;
+
+private:
+    bool reading = false; /** Whether within xsgetn(), which may refill the buffer through underflow() */
+};
+
+#else
+
+using StatsInputFilebuf = std::filebuf;
+
+#endif /** SQUEEZE_USE_STATS */
+
 }
@@ -0,0 +1,80 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+#include "io.h"
+#include "squeeze/status.h"
+
+namespace squeeze::utils {
+
+/** Output stream buffer writing a file through a shared memory mapping of it, with the put area being
+ * the mapped pages, so that the data gets written right into the page cache without the write calls.
+ * The file is sized up front to the expected size, if known, and grown in large steps past it, then gets
+ * truncated to the size written up to on close(). The space of the file is allocated before it's mapped,
+ * on Linux, so that running out of it fails the open or the write rather than raising SIGBUS on the mapped pages.
+ * Only supported where mmap() is, see is_supported(). */
+class MappedFileStreambuf : public DirectOutputStreambuf {
+public:
+    MappedFileStreambuf() = default;
+    /** Closes the file if open, ignoring the errors. */
+    ~MappedFileStreambuf() override;
+
+    MappedFileStreambuf(const MappedFileStreambuf&) = delete;
+    MappedFileStreambuf& operator=(const MappedFileStreambuf&) = delete;
+
+    /** Create the file anew, or truncate the existing one, and map it up to the expected size, if not 0,
+     * failing if the space for it can't be allocated. */
+    StatCode open(const std::filesystem::path& path, uint64_t expected_size);
+    /** Unmap the file, truncate it to the size written up to and close it. */
+    StatCode close();
+
+    inline bool is_open() const noexcept
+    {
+        return fd >= 0;
+    }
+
+    static constexpr bool is_supported() noexcept
+    {
+#if __has_include(<sys/mman.h>)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    std::span<char> reserve(std::size_t size) override;
+
+    /** Min size to grow the file by once it's written past its mapped size. */
+    static constexpr uint64_t grow_step = 1 << 26;
+
+protected:
+    int_type overflow(int_type ch) override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type sp, std::ios_base::openmode which) override;
+
+private:
+    inline uint64_t get_pos() const noexcept
+    {
+        return pptr() - map;
+    }
+
+    /** Grow the file and its mapping to fit the given size, keeping the current position. */
+    bool grow(uint64_t size);
+    /** Map the file up to the map size, continuing at the given position. */
+    bool map_file(uint64_t pos);
+    /** Unmap the file, recording the size written up to. */
+    void unmap_file() noexcept;
+
+    int fd = -1;
+    char *map = nullptr;
+    uint64_t map_size = 0;
+    uint64_t data_size = 0; /** Size of the data up to the furthest point written, as of the last unmap */
+};
+
+}
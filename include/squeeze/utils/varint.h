@@ -0,0 +1,55 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+
+namespace squeeze::utils {
+
+/** Max size of an encoded 64-bit varint. */
+constexpr std::size_t max_varint_size = 10;
+
+/** Get the size of the (unsigned LEB128) varint encoding of the value. */
+constexpr std::size_t get_varint_size(uint64_t val) noexcept
+{
+    std::size_t size = 1;
+    while (val >>= 7)
+        ++size;
+    return size;
+}
+
+/** Encode the value as an unsigned LEB128 varint, 7 bits per byte starting from the lowest ones,
+ * with the highest bit of each byte set if more bytes follow.
+ * The encoding can be padded to the given size with redundant continuation bytes,
+ * which lets the value be re-encoded in place later, as long as it fits. */
+template<std::output_iterator<char> OutIt>
+constexpr OutIt encode_varint(OutIt it, uint64_t val, std::size_t padded_size = 0)
+{
+    const std::size_t size = std::max(get_varint_size(val), padded_size);
+    for (std::size_t i = 1; i < size; ++i, val >>= 7)
+        *it++ = static_cast<char>(0x80 | (val & 0x7F));
+    *it++ = static_cast<char>(val & 0x7F);
+    return it;
+}
+
+/** Decode an unsigned LEB128 varint, padded or not, advancing the iterator past it.
+ * Returns the size of the encoding, or zero if the input ended or the encoding is too long. */
+template<std::input_iterator InIt>
+constexpr std::size_t decode_varint(InIt& it, InIt end, uint64_t& val)
+{
+    val = 0;
+    for (std::size_t i = 0; i < max_varint_size && it != end; ++i) {
+        const auto byte = static_cast<uint8_t>(*it);
+        ++it;
+        val |= uint64_t(byte & 0x7F) << (7 * i);
+        if ((byte & 0x80) == 0)
+            return i + 1;
+    }
+    return 0;
+}
+
+}
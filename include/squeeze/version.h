@@ -46,6 +46,8 @@ struct SemVer {
         return data & 0x3FF;
     }
 
+    inline constexpr auto operator<=>(const SemVer& other) const noexcept = default;
+
     uint32_t data = 0;
 };
 
@@ -32,6 +32,13 @@ public:
      * get_stat_ptr() is supposed to provide a pointer to the subsequent status. */
     void extract_all(const std::function<Stat *()>& get_stat_ptr = [](){return nullptr;});
 
+    /** Set the number of entries to read ahead in the background while extracting many of them,
+     * see Extracter::start_prefetching(). 0, the default, disables prefetching. */
+    inline void set_prefetching(std::size_t nr_entries_ahead) noexcept
+    {
+        prefetch_entries = nr_entries_ahead;
+    }
+
     inline auto& get_wrappee()
     {
         return reader;
@@ -39,6 +46,7 @@ public:
 
 private:
     Reader& reader;
+    std::size_t prefetch_entries = 0;
 };
 
 }
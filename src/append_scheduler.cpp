@@ -4,7 +4,10 @@
 
 #include "squeeze/append_scheduler.h"
 
+#include "squeeze/entry_frames.h"
 #include "squeeze/logging.h"
+#include "squeeze/stats.h"
+#include "squeeze/utils/fs.h"
 #include "squeeze/utils/io.h"
 #include "squeeze/utils/overloaded.h"
 
@@ -61,11 +64,13 @@ public:
     Stat run(std::ostream& target)
     {
         SQUEEZE_TRACE("Waiting for future to complete.");
+        const stats::StageTimer wait_timer;
         auto [buffer, s] = future_buffer.get();
         if (s.failed()) {
             SQUEEZE_ERROR("Buffer encoding failed");
             return {"buffer encoding failed", s};
         }
+        wait_timer.record(StatsStage::AppendWait, 0, buffer.size());
 
         SQUEEZE_TRACE("Got a buffer with size={}", buffer.size());
 
@@ -128,6 +133,100 @@ private:
     std::string str;
 };
 
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::FileDataAppender::"
+
+/** File data appender task, owning the file descriptor. */
+class FileDataAppender final : public BlockAppender {
+public:
+    FileDataAppender(int fd, uint64_t pos, uint64_t size) : fd(fd), pos(pos), size(size)
+    {
+    }
+
+    ~FileDataAppender() override
+    {
+        utils::close_file_descriptor(fd);
+    }
+
+    Stat run(std::ostream& target)
+    {
+        SQUEEZE_TRACE("Got file data at pos={} with size={}", pos, size);
+
+        auto *batch = dynamic_cast<utils::BatchOutputStreambuf *>(target.rdbuf());
+        if (batch == nullptr) [[unlikely]] {
+            SQUEEZE_ERROR("The target isn't batched");
+            return "the target isn't batched";
+        }
+        Stat s = batch->write_file_data(fd, pos, size);
+        if (s.failed()) [[unlikely]] {
+            SQUEEZE_ERROR("Failed appending file data");
+            return {"failed appending file data", s};
+        }
+        return success;
+    }
+
+private:
+    int fd;
+    uint64_t pos;
+    uint64_t size;
+};
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::DependencyChecker::"
+
+/** Dependency checker task. */
+class DependencyChecker final : public BlockAppender {
+public:
+    explicit DependencyChecker(const Stat& dependency) : dependency(dependency)
+    {
+    }
+
+    Stat run(std::ostream&)
+    {
+        if (dependency.failed()) [[unlikely]] {
+            SQUEEZE_ERROR("The dependency failed: {}", stringify(dependency));
+            return "failed appending the blob the entry content refers to";
+        }
+        return success;
+    }
+
+private:
+    const Stat& dependency;
+};
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::ContentReferenceAppender::"
+
+/** Content reference appender task. */
+class ContentReferenceAppender final : public BlockAppender {
+public:
+    ContentReferenceAppender(const BlobId& blob_id, const AppendedContent& appended_content)
+        : blob_id(blob_id), appended_content(appended_content)
+    {
+    }
+
+    Stat run(std::ostream& target)
+    {
+        if (appended_content.pos == AppendedContent::npos) [[unlikely]] {
+            SQUEEZE_ERROR("The referred content hasn't been appended");
+            return "the referred content hasn't been appended";
+        }
+
+        Buffer reference;
+        EntryReference::encode(reference, {blob_id, appended_content.pos, appended_content.size});
+        target.write(reference.data(), reference.size());
+        if (utils::validate_stream_fail_eof(target)) [[unlikely]] {
+            SQUEEZE_ERROR("Failed appending content reference");
+            return "failed appending content reference";
+        }
+        return success;
+    }
+
+private:
+    BlobId blob_id;
+    const AppendedContent& appended_content;
+};
+
 #undef SQUEEZE_LOG_FUNC_PREFIX
 #define SQUEEZE_LOG_FUNC_PREFIX "squeeze::AppendScheduler::EntryAppendTask::"
 
@@ -143,8 +242,9 @@ inline Stat EntryAppendScheduler::Task::operator()(std::ostream& target)
     return block_appender->run(target);
 }
 
-EntryAppendScheduler::EntryAppendScheduler(EntryHeader entry_header, Stat *error)
-    : entry_header(entry_header), status(error)
+EntryAppendScheduler::EntryAppendScheduler(EntryHeader entry_header, Stat *error,
+                                           AppendedContent *appended_content)
+    : status(error), appended_content(appended_content), entry_header(entry_header)
 {
 }
 
@@ -173,6 +273,22 @@ inline void EntryAppendScheduler::schedule_string_append(std::string&& str)
     scheduler.schedule(std::make_unique<StringAppender>(std::move(str)));
 }
 
+inline void EntryAppendScheduler::schedule_file_data_append(int fd, uint64_t pos, uint64_t size)
+{
+    scheduler.schedule(std::make_unique<FileDataAppender>(fd, pos, size));
+}
+
+inline void EntryAppendScheduler::schedule_dependency_check(const Stat& dependency)
+{
+    scheduler.schedule(std::make_unique<DependencyChecker>(dependency));
+}
+
+inline void EntryAppendScheduler::schedule_content_reference_append(const BlobId& blob_id,
+                                                                    const AppendedContent& appended_content)
+{
+    scheduler.schedule(std::make_unique<ContentReferenceAppender>(blob_id, appended_content));
+}
+
 bool EntryAppendScheduler::set_status(Stat&& s)
 {
     if (!status)
@@ -184,10 +300,24 @@ bool EntryAppendScheduler::set_status(Stat&& s)
     return status->successful();
 }
 
-Stat EntryAppendScheduler::run_internal(std::ostream& target)
+Stat EntryAppendScheduler::run_internal(std::ostream& target, AppendRunState& state)
 {
     SQUEEZE_INFO("Appending {}", entry_header.path);
 
+    // blobs are looked up by their positions, so they are kept decodable on their own
+    if (entry_header.compact && entry_header.attributes.get_type() != EntryType::Blob)
+        entry_header.path_prefix_size =
+            EntryHeader::get_shared_path_prefix_size(state.previous_path, entry_header.path);
+    else
+        entry_header.path_prefix_size = 0;
+
+    if (state.streaming) {
+        Stat s = run_framed(target);
+        if (s.successful())
+            state.previous_path = entry_header.path;
+        return s;
+    }
+
     const std::streampos initial_pos = target.tellp();
     SQUEEZE_DEBUG("initial_pos = {}", static_cast<long long>(initial_pos));
 
@@ -216,8 +346,8 @@ Stat EntryAppendScheduler::run_internal(std::ostream& target)
 
     entry_header.content_size = final_pos - content_pos;
     SQUEEZE_DEBUG("Encoding entry_header.content_size={}", entry_header.content_size);
-    ehs = EntryHeader::encode_content_size(target, entry_header.content_size);
-    if (s.failed()) {
+    ehs = EntryHeader::encode_content_size(target, entry_header);
+    if (ehs.failed()) [[unlikely]] {
         target.seekp(initial_pos);
         SQUEEZE_ERROR("Failed encoding content size");
         return {"failed encoding content size", std::move(ehs)};
@@ -225,20 +355,58 @@ Stat EntryAppendScheduler::run_internal(std::ostream& target)
 
     target.seekp(final_pos);
 
+    if (appended_content)
+        *appended_content = {static_cast<uint64_t>(content_pos), entry_header.content_size};
+    state.previous_path = entry_header.path;
     return success;
 }
 
-AppendScheduler::Task::Task(EntryHeader entry_header, Stat *error) noexcept
-    : scheduler(std::make_unique<EntryAppendScheduler>(entry_header, error))
+Stat EntryAppendScheduler::run_framed(std::ostream& target)
+{
+    const std::streampos initial_pos = target.tellp();
+    entry_header.framed = true;
+    entry_header.content_size = 0;
+
+    SQUEEZE_TRACE("Encoding entry_header = {}", stringify(entry_header));
+    StatStr ehs = EntryHeader::encode(target, entry_header);
+    if (ehs.failed()) [[unlikely]] {
+        target.seekp(initial_pos);
+        SQUEEZE_ERROR("Failed encoding the entry header");
+        return {"failed encoding the entry header", ehs};
+    }
+
+    SQUEEZE_TRACE("Running scheduled tasks");
+    FramedOutputStreambuf framed_streambuf(target);
+    std::ostream framed_target(&framed_streambuf);
+    Stat s = scheduler.run_till_error(framed_target);
+    if (s.failed()) [[unlikely]] {
+        // the entry can be dropped only while it's still in the batch, otherwise its frames are terminated
+        // to keep the following entries readable, leaving the entry with a truncated content
+        target.seekp(initial_pos);
+        if (utils::validate_stream_fail(target))
+            framed_streambuf.finish();
+        SQUEEZE_ERROR("Failed appending content");
+        return {"failed appending content", s};
+    }
+
+    if (not framed_streambuf.finish()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed terminating the content frames");
+        return "failed terminating the content frames";
+    }
+    return success;
+}
+
+AppendScheduler::Task::Task(EntryHeader entry_header, Stat *error, AppendedContent *appended_content) noexcept
+    : scheduler(std::make_unique<EntryAppendScheduler>(entry_header, error, appended_content))
 {
 }
 
 AppendScheduler::Task::~Task() = default;
 
-void AppendScheduler::Task::operator()(std::ostream& target, bool& succeeded)
+void AppendScheduler::Task::operator()(std::ostream& target, bool& succeeded, AppendRunState& state)
 {
     SQUEEZE_TRACE();
-    succeeded = scheduler->run(target) && succeeded;
+    succeeded = scheduler->run(target, state) && succeeded;
 }
 
 AppendScheduler::AppendScheduler() noexcept = default;
@@ -248,11 +416,31 @@ AppendScheduler::~AppendScheduler()
     finalize();
 }
 
-void AppendScheduler::schedule_entry_append(EntryHeader&& entry_header, Stat *error)
+bool AppendScheduler::run(std::ostream& target)
+{
+    SQUEEZE_TRACE();
+    bool succeeded = true;
+    {
+        utils::BatchOutputStreambuf batch(target);
+        std::ostream batch_target(&batch);
+        AppendRunState state;
+        state.streaming = not batch.is_seekable();
+        scheduler.run(batch_target, succeeded, state);
+        if (batch.pubsync() != 0) [[unlikely]] {
+            SQUEEZE_ERROR("Failed writing out the appended entries");
+            succeeded = false;
+        }
+    }
+    scheduler.open();
+    return succeeded;
+}
+
+void AppendScheduler::schedule_entry_append(EntryHeader&& entry_header, Stat *error,
+                                            AppendedContent *appended_content)
 {
     SQUEEZE_TRACE();
     finalize_entry_append();
-    Task task {entry_header, error};
+    Task task {entry_header, error, appended_content};
     last_entry_append_scheduler = task.scheduler.get();
     // last_entry_append_scheduler is safe to use until finalize() or finalize_entry_append() are called
     scheduler.schedule(std::move(task));
@@ -286,6 +474,28 @@ void AppendScheduler::schedule_string_append(std::string&& str)
     last_entry_append_scheduler->schedule_string_append(std::move(str));
 }
 
+void AppendScheduler::schedule_file_data_append(int fd, uint64_t pos, uint64_t size)
+{
+    SQUEEZE_TRACE();
+    assert(last_entry_append_scheduler != nullptr);
+    last_entry_append_scheduler->schedule_file_data_append(fd, pos, size);
+}
+
+void AppendScheduler::schedule_dependency_check(const Stat& dependency)
+{
+    SQUEEZE_TRACE();
+    assert(last_entry_append_scheduler != nullptr);
+    last_entry_append_scheduler->schedule_dependency_check(dependency);
+}
+
+void AppendScheduler::schedule_content_reference_append(const BlobId& blob_id,
+                                                        const AppendedContent& appended_content)
+{
+    SQUEEZE_TRACE();
+    assert(last_entry_append_scheduler != nullptr);
+    last_entry_append_scheduler->schedule_content_reference_append(blob_id, appended_content);
+}
+
 void AppendScheduler::finalize_entry_append() noexcept
 {
     if (last_entry_append_scheduler)
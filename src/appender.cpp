@@ -4,13 +4,28 @@
 
 #include "squeeze/appender.h"
 
+#include <algorithm>
+#include <cassert>
+#include <deque>
+#include <filesystem>
+#include <numeric>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "squeeze/entry_reference.h"
+#include "squeeze/entry_extent.h"
+#include "squeeze/misc/chunker.h"
+#include "squeeze/misc/hash.h"
+#include "squeeze/misc/hashing_streambuf.h"
 #include "squeeze/logging.h"
 #include "squeeze/utils/overloaded.h"
 #include "squeeze/utils/defer.h"
 #include "squeeze/utils/defer_macros.h"
 #include "squeeze/utils/iterator.h"
 #include "squeeze/utils/io.h"
+#include "squeeze/utils/fs.h"
 #include "squeeze/misc/singleton.h"
+#include "squeeze/compression/config.h"
 
 namespace squeeze {
 
@@ -19,6 +34,57 @@ namespace squeeze {
 
 using Stat = Appender::Stat;
 
+/** Regular file entry whose content is held by blobs and which only refers to them. */
+struct Appender::ReferringEntry {
+    /** Range of the entry content within a blob. */
+    struct Segment {
+        /** Index of the blob scheduled within the current batch, or npos if the blob already exists. */
+        std::size_t blob;
+        /** Identifier of the already existing blob. */
+        BlobId blob_id;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    ReferringEntry(EntryHeader&& entry_header, Stat *status)
+        : entry_header(std::move(entry_header)), status(status)
+    {
+    }
+
+    EntryHeader entry_header;
+    Stat *status;
+    std::vector<Segment> segments;
+};
+
+/** State of the blob appends throughout a single scheduling of the appends. */
+struct Appender::BlobState {
+    /** Content of the current blob, a solid group or a single chunk. */
+    Buffer group;
+    /** Compression params of the current blob. */
+    CompressionParams compression;
+    /** Identifiers of the already scheduled blobs. */
+    std::vector<BlobId> blob_ids;
+    /** Append statuses of the already scheduled blobs, referred to by the entries. */
+    std::deque<Stat> blob_statuses;
+    /** Entries waiting for their blobs to get scheduled. */
+    std::deque<ReferringEntry> entries;
+    /** Chunks met within the current batch, by their hashes. */
+    std::unordered_map<BlobId, ReferringEntry::Segment, BlobId::Hasher> chunks;
+    /** Whole file contents met within the current batch in solid mode, by their hashes. */
+    std::unordered_map<BlobId, std::vector<ReferringEntry::Segment>, BlobId::Hasher> files;
+    /** Contents of the entries appended as the first copies of whole files within the current batch,
+     * assigned by their appends, referred to by the entries holding the same content. */
+    std::deque<AppendedContent> appended_contents;
+    /** Whole file contents appended within the current batch, by their hashes, along with their compression. */
+    std::unordered_map<BlobId, std::pair<const AppendedContent *, CompressionParams>, BlobId::Hasher>
+        appended_files;
+    /** Sizes of the whole file contents met within the current batch. Only the contents of the sizes met
+     * already may be duplicates, so only those are hashed ahead, the rest are hashed while being read. */
+    std::unordered_set<uint64_t> file_sizes;
+};
+
 Appender::Appender(std::ostream& target) : target(target)
 {
 }
@@ -46,6 +112,7 @@ bool Appender::perform_appends()
         return true;
     }
 
+    inspect_target();
     std::future<bool> fut_succeeded = std::async(std::launch::async,
                                                  [this]{ return perform_scheduled_appends();});
     bool succeeded = schedule_appends();
@@ -57,6 +124,12 @@ bool Appender::perform_appends()
     return succeeded;
 }
 
+void Appender::inspect_target()
+{
+    target_is_file = utils::is_regular_file(utils::get_file_descriptor(target));
+    target_is_seekable = target.tellp() != std::streampos(-1);
+}
+
 Stat Appender::append(EntryInput& entry_input)
 {
     Stat stat;
@@ -68,9 +141,41 @@ Stat Appender::append(EntryInput& entry_input)
 bool Appender::schedule_appends()
 {
     bool succeeded = true;
-    DEFER( scheduler.finalize(); future_appends.clear(); owned_entry_inputs.clear(); );
-    for (auto& future_append : future_appends)
-        succeeded = schedule_append(future_append) && succeeded;
+    DEFER( scheduler.finalize(); future_appends.clear(); owned_entry_inputs.clear(); known_blob_ids.clear();
+           delta_bases.clear(); );
+    if (params.solid.group_size == 0 && params.dedup.avg_chunk_size == 0 && not params.dedup.whole_files &&
+            delta_bases.empty()) {
+        for (auto& future_append : future_appends)
+            succeeded = schedule_append(future_append) && succeeded;
+        return succeeded;
+    }
+
+    // the statuses of the previous blobs are no longer referred to by any task at this point
+    blob_state = std::make_unique<BlobState>();
+
+    std::vector<std::size_t> order(future_appends.size());
+    std::iota(order.begin(), order.end(), 0);
+    if (params.solid.group_size != 0 && params.solid.sort_by_extension) {
+        auto get_key = [this](std::size_t i)
+        {
+            const std::filesystem::path path = future_appends[i].entry_input.get_path();
+            return std::make_pair(path.extension(), path.filename());
+        };
+        std::stable_sort(order.begin(), order.end(),
+            [&get_key](std::size_t lhs, std::size_t rhs)
+            {
+                return get_key(lhs) < get_key(rhs);
+            }
+        );
+    }
+
+    for (std::size_t i : order)
+        succeeded = schedule_append(future_appends[i]) && succeeded;
+
+    if (not blob_state->group.empty())
+        schedule_blob();
+    schedule_ready_referring_entries();
+    assert(blob_state->entries.empty());
     return succeeded;
 }
 
@@ -91,8 +196,49 @@ bool Appender::schedule_append(FutureAppend& future_append)
         return false;
     }
 
+    if (not entry_header.has_original_size())
+        init_original_size(entry_header, content);
+    entry_header.compact = params.compact_headers;
     SQUEEZE_DEBUG("entry_header={}", stringify(entry_header));
 
+    if (entry_header.attributes.get_type() == EntryType::RegularFile &&
+            std::holds_alternative<std::istream *>(content)) {
+        std::istream& stream = *std::get<std::istream *>(content);
+        if (entry_header.content_layout == EntryContentLayout::Sparse)
+            return schedule_sparse_append(std::move(entry_header), stream, future_append.status);
+        if (auto node = delta_bases.extract(&future_append.entry_input); not node.empty() &&
+                entry_header.compression.method == compression::CompressionMethod::Deflate) {
+            DeltaBase& base = node.mapped();
+            BlobId content_id;
+            if (not base.content_id.is_null() && entry_header.original_size == base.content.size()) {
+                if (Stat s = hash_stream(stream, content_id); s.failed()) [[unlikely]] {
+                    SQUEEZE_ERROR("Failed hashing the content of {}", entry_header.path);
+                    if (future_append.status)
+                        *future_append.status = {"failed hashing the content", std::move(s)};
+                    return false;
+                }
+            }
+            if (content_id.is_null() || content_id != base.content_id)
+                return schedule_delta_append(std::move(entry_header), stream, future_append.status, base);
+
+            // an unchanged content is stored as before, its encoded content being reused if there's one
+            SQUEEZE_DEBUG("Content of {} unchanged, not delta encoding it", entry_header.path);
+            if (not base.encoded.empty() && base.compression.method == entry_header.compression.method &&
+                    base.compression.level == entry_header.compression.level) {
+                scheduler.schedule_entry_append(std::move(entry_header), future_append.status);
+                scheduler.schedule_buffer_append(std::move(base.encoded));
+                return true;
+            }
+        }
+        if (params.dedup.avg_chunk_size != 0)
+            return schedule_dedup_append(std::move(entry_header), stream, future_append.status);
+        if (params.solid.group_size != 0 &&
+                entry_header.compression.method != compression::CompressionMethod::None)
+            return schedule_solid_append(std::move(entry_header), stream, future_append.status);
+        if (params.dedup.whole_files && target_is_seekable)
+            return schedule_whole_file_dedup_append(std::move(entry_header), stream, future_append.status);
+    }
+
     CompressionParams compression = entry_header.compression;
     scheduler.schedule_entry_append(std::move(entry_header), future_append.status);
 
@@ -113,6 +259,420 @@ bool Appender::schedule_append(FutureAppend& future_append)
     );
 }
 
+void Appender::init_original_size(EntryHeader& entry_header, const EntryInput::ContentType& content)
+{
+    std::visit(utils::Overloaded {
+            [&entry_header](std::istream *stream)
+            {
+                // left unknown for the streams that can't be measured without consuming them
+                if (const std::streamsize size = utils::get_remaining_size(*stream); size >= 0)
+                    entry_header.original_size = size;
+            },
+            [&entry_header](const std::string& str)
+            {
+                entry_header.original_size = str.size();
+            },
+            [&entry_header](std::monostate)
+            {
+                entry_header.original_size = 0;
+            },
+        }, content
+    );
+}
+
+bool Appender::schedule_solid_append(EntryHeader&& entry_header, std::istream& stream, Stat *status)
+{
+    SQUEEZE_TRACE("Scheduling solid append of {}", entry_header.path);
+
+    BlobState& state = *blob_state;
+    switch_blob_compression(entry_header.compression);
+
+    ReferringEntry& entry = state.entries.emplace_back(std::move(entry_header), status);
+
+    BlobId content_id;
+    const bool hashed_ahead = params.dedup.whole_files && entry.entry_header.has_original_size() &&
+        state.file_sizes.contains(entry.entry_header.original_size);
+    if (hashed_ahead) {
+        Stat s = hash_stream(stream, content_id);
+        if (s.failed()) [[unlikely]] {
+            fail_referring_entry(std::move(s));
+            return false;
+        }
+        if (auto it = state.files.find(content_id); it != state.files.end()) {
+            SQUEEZE_TRACE("Content of {} met already", entry.entry_header.path);
+            entry.segments = it->second;
+            schedule_ready_referring_entries();
+            return true;
+        }
+    }
+
+    misc::Murmur3Hasher hasher;
+    uint64_t content_size = 0;
+    while (true) {
+        const std::size_t offset = state.group.size();
+        state.group.resize(params.solid.group_size);
+        stream.read(state.group.data() + offset, state.group.size() - offset);
+        if (utils::validate_stream_fail(stream)) [[unlikely]] {
+            state.group.resize(offset);
+            fail_referring_entry("input read error");
+            return false;
+        }
+
+        const std::size_t size = stream.gcount();
+        state.group.resize(offset + size);
+        if (size != 0)
+            entry.segments.push_back({state.blob_ids.size(), {}, offset, size});
+        if (params.dedup.whole_files && not hashed_ahead)
+            hasher.update(std::span(state.group.data() + offset, size));
+        content_size += size;
+
+        if (state.group.size() < params.solid.group_size)
+            break;
+        schedule_blob();
+    }
+
+    if (params.dedup.whole_files) {
+        // empty contents are left as is
+        if (not hashed_ahead && content_size != 0)
+            content_id = {hasher.digest()};
+        if (not content_id.is_null())
+            state.files.emplace(content_id, entry.segments);
+        state.file_sizes.insert(content_size);
+    }
+    schedule_ready_referring_entries();
+    return true;
+}
+
+bool Appender::schedule_whole_file_dedup_append(EntryHeader&& entry_header, std::istream& stream, Stat *status)
+{
+    SQUEEZE_TRACE("Scheduling whole file deduplicated append of {}", entry_header.path);
+
+    BlobState& state = *blob_state;
+
+    BlobId content_id;
+    if (entry_header.has_original_size() && state.file_sizes.contains(entry_header.original_size)) {
+        Stat s = hash_stream(stream, content_id);
+        if (s.failed()) [[unlikely]] {
+            SQUEEZE_ERROR("Failed hashing the content of {}", entry_header.path);
+            if (status)
+                *status = {"failed hashing the content of '" + entry_header.path + '\'', std::move(s)};
+            return false;
+        }
+        if (auto it = state.appended_files.find(content_id); it != state.appended_files.end()) {
+            SQUEEZE_TRACE("Content of {} met already", entry_header.path);
+            auto& [appended_content, compression] = it->second;
+            // the entry holding the content is appended by then, as the appends are run in order
+            entry_header.compression = compression;
+            entry_header.content_layout = EntryContentLayout::Duplicate;
+            scheduler.schedule_entry_append(std::move(entry_header), status);
+            scheduler.schedule_content_reference_append(content_id, *appended_content);
+            return true;
+        }
+    }
+
+    const CompressionParams compression = entry_header.compression;
+    AppendedContent& appended_content = state.appended_contents.emplace_back();
+    scheduler.schedule_entry_append(std::move(entry_header), status, &appended_content);
+    if (not content_id.is_null()) {
+        state.appended_files.try_emplace(content_id, &appended_content, compression);
+        return schedule_append_stream(compression, stream);
+    }
+
+    // hashed on the way to being appended, so that it's read only once
+    misc::HashingInputStreambuf hashing_streambuf(stream);
+    std::istream hashing_stream(&hashing_streambuf);
+    if (not schedule_append_stream(compression, hashing_stream)) [[unlikely]]
+        return false;
+    // empty contents are left as is
+    if (hashing_streambuf.get_read_size() != 0)
+        state.appended_files.try_emplace(BlobId{hashing_streambuf.digest()}, &appended_content, compression);
+    state.file_sizes.insert(hashing_streambuf.get_read_size());
+    return true;
+}
+
+bool Appender::schedule_sparse_append(EntryHeader&& entry_header, std::istream& stream, Stat *status)
+{
+    SQUEEZE_TRACE("Scheduling sparse append of {}", entry_header.path);
+
+    EntryExtentMap map;
+    Stat s = EntryExtentMap::decode(stream, map);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed reading the extent map of {}", entry_header.path);
+        if (status)
+            *status = {"failed reading the extent map of '" + entry_header.path + '\'', std::move(s)};
+        return false;
+    }
+
+    // the map is stored uncompressed, followed by the data of the extents
+    Buffer encoded_map;
+    EntryExtentMap::encode(encoded_map, map);
+    const CompressionParams compression = entry_header.compression;
+    scheduler.schedule_entry_append(std::move(entry_header), status);
+    scheduler.schedule_buffer_append(std::move(encoded_map));
+    return schedule_append_stream(compression, stream);
+}
+
+bool Appender::schedule_delta_append(EntryHeader&& entry_header, std::istream& stream, Stat *status,
+                                     DeltaBase& base)
+{
+    SQUEEZE_TRACE("Scheduling delta append of {} against {}", entry_header.path, base.blob_id.to_path());
+
+    BlobState& state = *blob_state;
+    Stat *base_status = nullptr;
+    if (not known_blob_ids.contains(base.blob_id)) {
+        const bool encoded = not base.encoded.empty();
+        EntryHeader blob_header {
+            .version = version,
+            .compression = encoded ? base.compression : entry_header.compression,
+            .attributes = {EntryType::Blob, EntryPermissions::None},
+            .original_size = base.content.size(),
+            .compact = params.compact_headers,
+            .path = base.blob_id.to_path(),
+        };
+        base_status = &state.blob_statuses.emplace_back();
+        scheduler.schedule_entry_append(std::move(blob_header), base_status);
+        if (encoded)
+            scheduler.schedule_buffer_append(std::move(base.encoded));
+        else
+            schedule_chained_encodes(base.content, entry_header.compression);
+    }
+
+    Buffer reference;
+    EntryReference::encode(reference, {base.blob_id, 0, base.content.size()});
+
+    const CompressionParams compression = entry_header.compression;
+    entry_header.content_layout = EntryContentLayout::Delta;
+    scheduler.schedule_entry_append(std::move(entry_header), status);
+    if (base_status)
+        scheduler.schedule_dependency_check(*base_status);
+    scheduler.schedule_buffer_append(std::move(reference));
+
+    const std::size_t block_size = compression::get_delta_block_size(compression);
+    for (uint64_t pos = 0;; pos += block_size) {
+        Buffer block(block_size);
+        stream.read(block.data(), block.size());
+        if (utils::validate_stream_fail(stream)) [[unlikely]] {
+            scheduler.schedule_error_raise("input read error");
+            return false;
+        }
+        block.resize(stream.gcount());
+        if (block.empty())
+            break;
+
+        auto [dictionary_begin, dictionary_end] =
+            compression::get_delta_dictionary_range(base.content.size(), pos, block_size);
+        Buffer dictionary(base.content.begin() + dictionary_begin, base.content.begin() + dictionary_end);
+        const bool last = block.size() < block_size;
+        scheduler.schedule_buffer_append(get_encoder_pool().schedule_buffer_encode(
+                std::move(block), compression, std::move(dictionary)));
+        if (last)
+            break;
+    }
+    return true;
+}
+
+Stat Appender::hash_stream(std::istream& stream, BlobId& content_id)
+{
+    content_id = {};
+    const std::streampos initial_pos = stream.tellg();
+    if (initial_pos == std::streampos(-1)) {
+        SQUEEZE_TRACE("Stream not seekable, not hashing");
+        return success;
+    }
+
+    misc::Murmur3Hasher hasher;
+    uint64_t size = 0;
+    Buffer buffer(BUFSIZ);
+    do {
+        stream.read(buffer.data(), buffer.size());
+        if (utils::validate_stream_fail(stream)) [[unlikely]]
+            return "input read error";
+        hasher.update(std::span(buffer.data(), stream.gcount()));
+        size += stream.gcount();
+    } while (stream.gcount() == static_cast<std::streamsize>(buffer.size()));
+
+    stream.clear();
+    stream.seekg(initial_pos);
+    if (stream.fail()) [[unlikely]]
+        return "input seek error";
+
+    // empty contents are left as is
+    if (size != 0)
+        content_id = {hasher.digest()};
+    return success;
+}
+
+bool Appender::schedule_dedup_append(EntryHeader&& entry_header, std::istream& stream, Stat *status)
+{
+    SQUEEZE_TRACE("Scheduling deduplicated append of {}", entry_header.path);
+
+    BlobState& state = *blob_state;
+    switch_blob_compression(entry_header.compression);
+
+    const misc::Chunker chunker(params.dedup.avg_chunk_size);
+    ReferringEntry& entry = state.entries.emplace_back(std::move(entry_header), status);
+
+    Buffer buffer(chunker.get_max_size());
+    std::size_t buffer_size = 0;
+    bool eof = false;
+    while (true) {
+        if (not eof) {
+            stream.read(buffer.data() + buffer_size, buffer.size() - buffer_size);
+            if (utils::validate_stream_fail(stream)) [[unlikely]] {
+                fail_referring_entry("input read error");
+                return false;
+            }
+            buffer_size += stream.gcount();
+            eof = buffer_size < buffer.size();
+        }
+        if (buffer_size == 0)
+            break;
+
+        const std::size_t chunk_size = chunker.find_chunk_size(std::span(buffer.data(), buffer_size));
+        add_chunk(entry, std::span(buffer.data(), chunk_size));
+
+        std::copy(buffer.begin() + chunk_size, buffer.begin() + buffer_size, buffer.begin());
+        buffer_size -= chunk_size;
+    }
+
+    schedule_ready_referring_entries();
+    return true;
+}
+
+void Appender::add_chunk(ReferringEntry& entry, std::span<const char> chunk)
+{
+    BlobState& state = *blob_state;
+    const BlobId chunk_id = BlobId::of(chunk);
+
+    if (auto it = state.chunks.find(chunk_id); it != state.chunks.end()) {
+        SQUEEZE_TRACE("Chunk {} met already", chunk_id.to_path());
+        entry.segments.push_back(it->second);
+        return;
+    }
+
+    ReferringEntry::Segment segment;
+    if (known_blob_ids.contains(chunk_id)) {
+        SQUEEZE_TRACE("Chunk {} exists already", chunk_id.to_path());
+        segment = {ReferringEntry::npos, chunk_id, 0, chunk.size()};
+    } else if (params.solid.group_size != 0) {
+        if (state.group.size() + chunk.size() > params.solid.group_size && not state.group.empty())
+            schedule_blob();
+        segment = {state.blob_ids.size(), {}, state.group.size(), chunk.size()};
+        state.group.insert(state.group.end(), chunk.begin(), chunk.end());
+    } else {
+        segment = {state.blob_ids.size(), {}, 0, chunk.size()};
+        state.group.assign(chunk.begin(), chunk.end());
+        schedule_blob();
+    }
+
+    state.chunks.emplace(chunk_id, segment);
+    entry.segments.push_back(segment);
+}
+
+void Appender::switch_blob_compression(const CompressionParams& compression)
+{
+    BlobState& state = *blob_state;
+    if (not state.group.empty() && (state.compression.method != compression.method ||
+                                    state.compression.level != compression.level)) {
+        schedule_blob();
+        schedule_ready_referring_entries();
+    }
+    state.compression = compression;
+}
+
+void Appender::fail_referring_entry(Stat&& error)
+{
+    BlobState& state = *blob_state;
+    ReferringEntry& entry = state.entries.back();
+    SQUEEZE_ERROR("Failed reading the content of {}", entry.entry_header.path);
+    if (entry.status)
+        *entry.status = {"failed appending entry '" + entry.entry_header.path + '\'', std::move(error)};
+    state.entries.pop_back();
+}
+
+void Appender::schedule_blob()
+{
+    BlobState& state = *blob_state;
+    const BlobId blob_id = BlobId::of(state.group);
+
+    if (known_blob_ids.contains(blob_id)) {
+        SQUEEZE_TRACE("Blob {} exists already", blob_id.to_path());
+        state.blob_statuses.emplace_back(success);
+        state.blob_ids.push_back(blob_id);
+        state.group.clear();
+        return;
+    }
+
+    SQUEEZE_TRACE("Scheduling blob {} of size={}", blob_id.to_path(), state.group.size());
+
+    EntryHeader blob_header {
+        .version = version,
+        .compression = state.compression,
+        .attributes = {EntryType::Blob, EntryPermissions::None},
+        .original_size = state.group.size(),
+        .compact = params.compact_headers,
+        .path = blob_id.to_path(),
+    };
+    scheduler.schedule_entry_append(std::move(blob_header), &state.blob_statuses.emplace_back());
+
+    if (state.compression.method == compression::CompressionMethod::None)
+        scheduler.schedule_buffer_append(std::move(state.group));
+    else
+        schedule_chained_encodes(state.group, state.compression);
+
+    state.blob_ids.push_back(blob_id);
+    state.group.clear();
+}
+
+void Appender::schedule_chained_encodes(std::span<const char> content, const CompressionParams& compression)
+{
+    // each block gets the preceding blob content as a preset dictionary, so that the blocks
+    // can still be encoded in parallel while making use of the redundancy across them
+    const std::size_t block_size = compression::get_block_size(compression);
+    for (std::size_t pos = 0; pos < content.size(); pos += block_size) {
+        const auto block_begin = content.begin() + pos;
+        const auto block_end = content.begin() + std::min(pos + block_size, content.size());
+        const auto dictionary_begin = block_begin - std::min(pos, compression::max_dictionary_size);
+        scheduler.schedule_buffer_append(get_encoder_pool().schedule_buffer_encode(
+                Buffer(block_begin, block_end), compression, Buffer(dictionary_begin, block_begin)));
+    }
+}
+
+void Appender::schedule_ready_referring_entries()
+{
+    BlobState& state = *blob_state;
+    auto is_scheduled = [&state](const ReferringEntry::Segment& segment)
+    {
+        return segment.blob == ReferringEntry::npos || segment.blob < state.blob_ids.size();
+    };
+
+    while (not state.entries.empty()) {
+        ReferringEntry& entry = state.entries.front();
+        if (not std::all_of(entry.segments.begin(), entry.segments.end(), is_scheduled))
+            break;
+
+        SQUEEZE_TRACE("Scheduling referring entry {}", entry.entry_header.path);
+
+        Buffer references;
+        references.reserve(entry.segments.size() * EntryReference::encoded_size);
+        for (const auto& segment : entry.segments) {
+            const bool known = segment.blob == ReferringEntry::npos;
+            EntryReference::encode(references, {known ? segment.blob_id : state.blob_ids[segment.blob],
+                                                segment.offset, segment.size});
+        }
+
+        entry.entry_header.content_layout = EntryContentLayout::References;
+        scheduler.schedule_entry_append(std::move(entry.entry_header), entry.status);
+        for (const auto& segment : entry.segments)
+            if (segment.blob != ReferringEntry::npos)
+                scheduler.schedule_dependency_check(state.blob_statuses[segment.blob]);
+        if (not references.empty())
+            scheduler.schedule_buffer_append(std::move(references));
+
+        state.entries.pop_front();
+    }
+}
+
 bool Appender::schedule_append_stream(const CompressionParams& compression, std::istream& stream)
 {
     SQUEEZE_TRACE("Scheduling append ");
@@ -131,6 +691,9 @@ bool Appender::schedule_append_string(const CompressionParams& compression, cons
 
 bool Appender::schedule_buffer_appends(std::istream& stream)
 {
+    if (schedule_file_data_append(stream))
+        return true;
+
     Buffer buffer(BUFSIZ);
     while (true) {
         stream.read(reinterpret_cast<char *>(buffer.data()), BUFSIZ);
@@ -151,6 +714,28 @@ bool Appender::schedule_buffer_appends(std::istream& stream)
     return true;
 }
 
+bool Appender::schedule_file_data_append(std::istream& stream)
+{
+    const int fd = utils::get_file_descriptor(stream);
+    if (fd < 0 || not target_is_file)
+        return false;
+    const std::streampos pos = stream.tellg();
+    const std::streamsize size = utils::get_remaining_size(stream);
+    if (pos < 0 || size < 0 || static_cast<uint64_t>(size) < utils::min_file_copy_size) {
+        stream.clear();
+        return false;
+    }
+    // the stream gets closed once scheduled, while the copy happens on run
+    const int dup_fd = utils::duplicate_file_descriptor(fd);
+    if (dup_fd < 0) [[unlikely]]
+        return false;
+
+    SQUEEZE_TRACE("Scheduling file data append with size={}", static_cast<long long>(size));
+    scheduler.schedule_file_data_append(dup_fd, static_cast<uint64_t>(pos), static_cast<uint64_t>(size));
+    stream.seekg(0, std::ios_base::end);
+    return true;
+}
+
 bool Appender::schedule_future_buffer_appends(
         const CompressionParams& compression, std::istream& stream)
 {
@@ -0,0 +1,61 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/blob_cache.h"
+
+#include "squeeze/logging.h"
+
+namespace squeeze {
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::BlobCache::"
+
+const std::string *BlobCache::find(const BlobId& blob_id)
+{
+    auto it = index.find(blob_id);
+    if (it == index.end())
+        return nullptr;
+    blobs.splice(blobs.begin(), blobs, it->second);
+    return &it->second->second;
+}
+
+const std::string& BlobCache::insert(const BlobId& blob_id, std::string&& content)
+{
+    if (auto it = index.find(blob_id); it != index.end()) {
+        size -= it->second->second.size();
+        blobs.erase(it->second);
+        index.erase(it);
+    }
+    size += content.size();
+    blobs.emplace_front(blob_id, std::move(content));
+    index.emplace(blob_id, blobs.begin());
+    evict();
+    return blobs.front().second;
+}
+
+void BlobCache::clear() noexcept
+{
+    blobs.clear();
+    index.clear();
+    size = 0;
+}
+
+void BlobCache::set_capacity(std::size_t capacity)
+{
+    this->capacity = capacity;
+    evict();
+}
+
+void BlobCache::evict()
+{
+    while (size > capacity && blobs.size() > 1) {
+        auto& [blob_id, content] = blobs.back();
+        SQUEEZE_TRACE("Evicting blob {}", blob_id.to_path());
+        size -= content.size();
+        index.erase(blob_id);
+        blobs.pop_back();
+    }
+}
+
+}
@@ -7,58 +7,185 @@
 #include "squeeze/common.h"
 #include "squeeze/compression/compression.h"
 #include "squeeze/logging.h"
+#include "squeeze/stats.h"
 #include "squeeze/utils/io.h"
 #include "squeeze/misc/substream.h"
 
 namespace squeeze {
 
-StatStr decode(std::ostream& out, std::size_t size, std::istream& in,
-        const CompressionParams& compression)
+namespace {
+
+enum class BlockDictionary {
+    None,       /** The blocks are decoded independently. */
+    Chained,    /** Each block is primed with the tail of the data preceding it. */
+    Delta,      /** Each block is primed with the part of a base content around the block position. */
+};
+
+/** Decode the stream block by block. If chained, each block is decoded with the tail of
+ * the previously decoded data as its preset dictionary, which is kept at the beginning
+ * of the output buffer in front of the block being decoded. If delta, each block is decoded
+ * with the range of the base content given by get_delta_dictionary_range() instead. */
+StatStr decode_blocks(std::ostream& out, std::size_t size, std::istream& in,
+        const CompressionParams& compression, BlockDictionary block_dictionary,
+        std::span<const char> base = {})
 {
     using namespace compression;
     using CompressionFlags::ExpectFinalBlock;
-    SQUEEZE_TRACE();
-
-    if (compression.method == CompressionMethod::None) {
-        SQUEEZE_TRACE("Compression method is none, plain copying...");
-        StatStr s = utils::ioscopy(in, in.tellg(), out, out.tellp(), size);
-        return s ? success : StatStr{"failed copying stream", s};
-    }
 
-    const std::size_t outbuf_size = get_block_size(compression);
-    Buffer outbuf(outbuf_size);
+    const bool chained = block_dictionary == BlockDictionary::Chained;
+    const bool delta = block_dictionary == BlockDictionary::Delta;
+    const std::size_t block_size = delta ? get_delta_block_size(compression) : get_block_size(compression);
+    Buffer outbuf((chained ? max_dictionary_size : 0) + block_size);
+    std::size_t dict_size = 0;
+    uint64_t block_pos = 0;
     misc::InputSubstream insub(in, size);
+    // the chained blocks need the previous data in front of them, so only the others are decoded in place
+    auto *direct_out = chained ? nullptr : dynamic_cast<utils::DirectOutputStreambuf *>(out.rdbuf());
 
-    auto out_it = outbuf.begin();
-    auto out_it_end = outbuf.end();
+    // only the decompression is timed, not the reads and the writes around it
+    uint64_t nanoseconds = 0;
+
+    char *out_it = outbuf.data();
     auto in_it = insub.begin();
     auto in_it_end = insub.end();
 
     while (in_it != in_it_end) {
+        char *block_begin = outbuf.data() + dict_size;
+        if (direct_out) {
+            const std::span<char> reserved = direct_out->reserve(block_size);
+            if (reserved.size() >= block_size)
+                block_begin = reserved.data();
+        }
+        const bool in_place = block_begin != outbuf.data() + dict_size;
+        std::span<const char> dictionary(outbuf.data(), dict_size);
+        if (delta) {
+            auto [dict_begin, dict_end] = get_delta_dictionary_range(base.size(), block_pos, block_size);
+            dictionary = base.subspan(dict_begin, dict_end - dict_begin);
+        }
+
+        auto bit_decoder = misc::make_bit_decoder(in_it, in_it_end);
+        const stats::StageTimer timer;
         DecompressionResult result;
-        std::tie(out_it, in_it, result) =
-            decompress(out_it, out_it_end, compression, ExpectFinalBlock, in_it, in_it_end);
+        std::tie(out_it, result) = Decompressor(bit_decoder, dictionary)
+            .decompress(block_begin, block_begin + block_size, compression, ExpectFinalBlock);
+        nanoseconds += timer.get_nanoseconds();
         if (result.status.failed()) [[unlikely]] {
             SQUEEZE_ERROR("Failed decoding buffer");
             return {"failed decoding buffer", result.status};
         }
 
         if (in_it == in_it_end) {
-            if (utils::validate_stream_fail(in)) [[unlikely]] {
+            // a stream of an unknown size is expected to reach its end
+            if (size == unknown_size ? utils::validate_stream_bad(in) : utils::validate_stream_fail(in)) [[unlikely]] {
                 SQUEEZE_ERROR("Input read error");
                 return "input read error";
             }
         }
 
-        out.write(outbuf.data(), std::distance(outbuf.begin(), out_it));
-        if (utils::validate_stream_fail_eof(out)) [[unlikely]] {
-            SQUEEZE_ERROR("Output write error");
-            return "output write error";
+        if (in_place) {
+            direct_out->commit(out_it - block_begin);
+        } else {
+            out.write(block_begin, out_it - block_begin);
+            if (utils::validate_stream_fail_eof(out)) [[unlikely]] {
+                SQUEEZE_ERROR("Output write error");
+                return "output write error";
+            }
+        }
+        block_pos += out_it - block_begin;
+
+        if (chained) {
+            dict_size = std::min<std::size_t>(out_it - outbuf.data(), max_dictionary_size);
+            std::copy(out_it - dict_size, out_it, outbuf.data());
         }
-        out_it = outbuf.begin();
     }
 
+    stats::record(StatsStage::Decode, size == unknown_size ? 0 : size, block_pos, nanoseconds);
     return success;
 }
 
 }
+
+StatStr decode(std::ostream& out, std::size_t size, std::istream& in,
+        const CompressionParams& compression)
+{
+    SQUEEZE_TRACE();
+
+    if (compression.method == compression::CompressionMethod::None) {
+        SQUEEZE_TRACE("Compression method is none, plain copying...");
+        StatStr s = size == unknown_size ? utils::ioscopy_till_end(in, out) :
+                                           utils::ioscopy(in, in.tellg(), out, out.tellp(), size);
+        return s ? success : StatStr{"failed copying stream", s};
+    }
+
+    return decode_blocks(out, size, in, compression, BlockDictionary::None);
+}
+
+StatStr decode_buffer(std::span<const char> in, std::span<char> out, std::size_t& decoded_size,
+        const CompressionParams& compression)
+{
+    using namespace compression;
+    using enum CompressionFlags;
+
+    decoded_size = 0;
+    if (compression.method == CompressionMethod::None) {
+        if (in.size() > out.size()) [[unlikely]]
+            return "output buffer too small";
+        std::copy(in.begin(), in.end(), out.begin());
+        decoded_size = in.size();
+        return success;
+    }
+
+    const stats::StageTimer timer;
+    const std::size_t block_size = get_block_size(compression);
+    const char *in_it = in.data(), *in_it_end = in.data() + in.size();
+    while (in_it != in_it_end) {
+        if (decoded_size == out.size()) [[unlikely]]
+            return "output buffer too small";
+
+        char *block_begin = out.data() + decoded_size;
+        char *block_end = block_begin + std::min(block_size, out.size() - decoded_size);
+        // a block not fitting the output is the final one if any, whose terminator may follow the output
+        const bool short_block = static_cast<std::size_t>(block_end - block_begin) < block_size;
+        auto bit_decoder = misc::make_bit_decoder(in_it, in_it_end);
+        auto [out_it, result] = Decompressor(bit_decoder)
+            .decompress(block_begin, block_end, compression,
+                        ExpectFinalBlock | utils::switch_flag(ExpectTerminator, short_block));
+        if (result.status.failed()) [[unlikely]]
+            return {"failed decoding block", std::move(result.status)};
+
+        decoded_size += out_it - block_begin;
+        in_it = bit_decoder.get_it();
+    }
+    timer.record(StatsStage::Decode, in.size(), decoded_size);
+    return success;
+}
+
+StatStr decode_chained(std::ostream& out, std::size_t size, std::istream& in,
+        const CompressionParams& compression)
+{
+    SQUEEZE_TRACE();
+
+    if (compression.method == compression::CompressionMethod::None) {
+        SQUEEZE_TRACE("Compression method is none, plain copying...");
+        StatStr s = size == unknown_size ? utils::ioscopy_till_end(in, out) :
+                                           utils::ioscopy(in, in.tellg(), out, out.tellp(), size);
+        return s ? success : StatStr{"failed copying stream", s};
+    }
+
+    return decode_blocks(out, size, in, compression, BlockDictionary::Chained);
+}
+
+StatStr decode_delta(std::ostream& out, std::size_t size, std::istream& in,
+        const CompressionParams& compression, std::span<const char> base)
+{
+    SQUEEZE_TRACE();
+
+    if (compression.method != compression::CompressionMethod::Deflate) [[unlikely]] {
+        SQUEEZE_ERROR("Delta decoding requires a dictionary supporting compression method");
+        return "delta decoding requires a dictionary supporting compression method";
+    }
+
+    return decode_blocks(out, size, in, compression, BlockDictionary::Delta, base);
+}
+
+}
@@ -4,25 +4,109 @@
 
 #include "squeeze/encode.h"
 
+#include <algorithm>
+
 #include "squeeze/logging.h"
 #include "squeeze/compression/compression.h"
 #include "squeeze/utils/io.h"
 
 namespace squeeze {
 
+namespace {
+
+/** Max size of the encoded block headers, e.g. the code lengths, and the padding past the encoded data,
+ * which doesn't take more than 9 bits per byte, as neither does a fixed-length code of the alphabets. */
+constexpr std::size_t max_block_overhead = 1 << 10;
+
+/** Encode a block of the data to the given bit encoder. */
+template<typename BitEncoder>
+EncodeStat encode_block(std::span<const char> in, BitEncoder& bit_encoder, const CompressionParams& compression,
+                        std::span<const char> dictionary)
+{
+    using namespace compression;
+    using enum compression::CompressionFlags;
+
+    const bool final_block = in.size() < compression::get_block_size(compression);
+    const CompressionFlags flags = utils::switch_flag(FinalBlock, final_block);
+
+    CompressionResult result;
+    std::tie(std::ignore, result) = Compressor(bit_encoder, dictionary)
+        .compress(in.begin(), in.end(), compression, flags);
+    bit_encoder.finalize();
+    return std::move(result.status);
+}
+
+/** Encode a block of the data into the given output, setting the size encoded. */
+EncodeStat encode_block(std::span<const char> in, std::span<char> out, std::size_t& encoded_size,
+                        const CompressionParams& compression, std::span<const char> dictionary)
+{
+    auto bit_encoder = misc::make_bit_encoder(out.data(), out.data() + out.size());
+    EncodeStat s = encode_block(in, bit_encoder, compression, dictionary);
+    if (s.failed()) [[unlikely]]
+        return s;
+    if (bit_encoder.has_overflown()) [[unlikely]]
+        return "output buffer too small";
+    encoded_size = bit_encoder.get_it() - out.data();
+    return success;
+}
+
+}
+
 EncodeStat encode_buffer(const Buffer& in, Buffer& out, const CompressionParams& compression)
+{
+    return encode_buffer(in, out, compression, {});
+}
+
+EncodeStat encode_buffer(const Buffer& in, Buffer& out, const CompressionParams& compression,
+                         std::span<const char> dictionary)
 {
     if (compression.method == compression::CompressionMethod::None) {
-        std::copy(in.begin(), in.end(), std::back_inserter(out));
+        out.insert(out.end(), in.begin(), in.end());
         return success;
     }
 
-    using namespace compression;
-    using enum compression::CompressionFlags;
+    // encoded in place rather than appended char by char, and trimmed to the size encoded afterwards
+    const std::size_t out_pos = out.size();
+    out.resize(out_pos + in.size() + in.size() / 8 + max_block_overhead);
+    std::size_t encoded_size = 0;
+    EncodeStat s = encode_block(in, std::span(out).subspan(out_pos), encoded_size, compression, dictionary);
+    out.resize(out_pos + encoded_size);
+    return s;
+}
 
-    const bool final_block = in.size() < compression::get_block_size(compression);
-    const CompressionFlags flags = utils::switch_flag(FinalBlock, final_block);
-    return std::get<2>(compress(in.begin(), in.end(), compression, flags, std::back_inserter(out))).status;
+EncodeStat encode_buffer(std::span<const char> in, std::span<char> out, std::size_t& encoded_size,
+                         const CompressionParams& compression)
+{
+    encoded_size = 0;
+    if (compression.method == compression::CompressionMethod::None) {
+        if (in.size() > out.size()) [[unlikely]]
+            return "output buffer too small";
+        std::copy(in.begin(), in.end(), out.begin());
+        encoded_size = in.size();
+        return success;
+    }
+
+    const std::size_t block_size = compression::get_block_size(compression);
+    while (not in.empty()) {
+        const std::size_t size = std::min(block_size, in.size());
+        std::size_t block_encoded_size = 0;
+        EncodeStat s = encode_block(in.first(size), out.subspan(encoded_size), block_encoded_size,
+                                    compression, {});
+        if (s.failed()) [[unlikely]]
+            return {"failed encoding block", s};
+        in = in.subspan(size);
+        encoded_size += block_encoded_size;
+    }
+    return success;
+}
+
+std::size_t compress_bound(std::size_t size, const CompressionParams& compression)
+{
+    if (compression.method == compression::CompressionMethod::None)
+        return size;
+    const std::size_t block_size = compression::get_block_size(compression);
+    const std::size_t nr_blocks = std::max<std::size_t>((size + block_size - 1) / block_size, 1);
+    return size + size / 8 + nr_blocks * max_block_overhead;
 }
 
 EncodeStat encode(std::istream& in, std::size_t size, std::ostream& out,
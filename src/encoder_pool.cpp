@@ -4,6 +4,11 @@
 
 #include "squeeze/encoder_pool.h"
 
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
 #include "squeeze/logging.h"
 #include "squeeze/compression/config.h"
 #include "squeeze/utils/io.h"
@@ -16,10 +21,11 @@ namespace squeeze {
 struct EncoderPool::Task {
     Buffer input;
     CompressionParams compression;
+    Buffer dictionary;
     std::promise<EncodedBuffer> output_promise;
 
-    Task(Buffer&& input, CompressionParams&& compression)
-        : input(std::move(input)), compression(std::move(compression))
+    Task(Buffer&& input, CompressionParams&& compression, Buffer&& dictionary = {})
+        : input(std::move(input)), compression(std::move(compression)), dictionary(std::move(dictionary))
     {
     }
 
@@ -27,7 +33,7 @@ struct EncoderPool::Task {
     {
         try {
             Buffer output;
-            Stat stat = encode_buffer(input, output, compression);
+            Stat stat = encode_buffer(input, output, compression, dictionary);
             output_promise.set_value(std::make_pair(std::move(output), std::move(stat)));
         } catch (...) {
             output_promise.set_exception(std::current_exception());
@@ -35,6 +41,51 @@ struct EncoderPool::Task {
     }
 };
 
+namespace {
+
+/** State of a batch encode shared with the worker threads, which may only get to it once it's done,
+ * in which case there are no chunks left for them to take. */
+struct BatchEncode {
+    std::span<const std::span<const char>> inputs;
+    std::span<char> arena;
+    CompressionParams compression;
+    /** Offsets of the arena ranges the inputs are encoded into, sized to fit the encoded inputs */
+    std::vector<uint64_t> range_offsets;
+    std::vector<std::size_t> encoded_sizes;
+    /** Ends of the input index ranges of the chunks */
+    std::vector<std::size_t> chunk_ends;
+    std::atomic_size_t next_chunk = 0;
+    std::atomic_size_t nr_chunks_left = 0;
+    std::mutex stat_mutex;
+    EncodeStat stat = success;
+
+    /** Take and encode the chunks till none is left. */
+    void run()
+    {
+        for (std::size_t chunk = next_chunk.fetch_add(1, std::memory_order::relaxed); chunk < chunk_ends.size();
+             chunk = next_chunk.fetch_add(1, std::memory_order::relaxed)) {
+            encode_chunk(chunk);
+            if (nr_chunks_left.fetch_sub(1, std::memory_order::acq_rel) == 1)
+                nr_chunks_left.notify_all();
+        }
+    }
+
+    void encode_chunk(std::size_t chunk)
+    {
+        for (std::size_t i = chunk == 0 ? 0 : chunk_ends[chunk - 1]; i < chunk_ends[chunk]; ++i) {
+            const std::span<char> range = arena.subspan(range_offsets[i], range_offsets[i + 1] - range_offsets[i]);
+            EncodeStat s = encode_buffer(inputs[i], range, encoded_sizes[i], compression);
+            if (s.failed()) [[unlikely]] {
+                std::scoped_lock lock(stat_mutex);
+                if (stat.successful())
+                    stat = std::move(s);
+            }
+        }
+    }
+};
+
+}
+
 #undef SQUEEZE_LOG_FUNC_PREFIX
 #define SQUEEZE_LOG_FUNC_PREFIX "squeeze::EncoderPool::"
 
@@ -55,12 +106,14 @@ EncoderPool::~EncoderPool()
 void EncoderPool::wait_for_tasks() noexcept
 {
     while (true) {
-        size_t curr_nr_running_threads = nr_running_threads.load(std::memory_order::relaxed);
+        size_t curr_nr_running_threads = nr_running_threads.load(std::memory_order::acquire);
         if (curr_nr_running_threads == 0) {
             if (scheduler.get_nr_tasks_left() == 0)
                 break;
-            else
-                try_another_thread();
+            // the tasks left are run right here, as there may be no thread to assign them to
+            nr_running_threads.fetch_add(1, std::memory_order::acquire);
+            threaded_task_run();
+            continue;
         }
         nr_running_threads.wait(curr_nr_running_threads, std::memory_order::acquire);
     }
@@ -77,6 +130,76 @@ std::future<EncodedBuffer> EncoderPool::
     return future_output;
 }
 
+std::future<EncodedBuffer> EncoderPool::
+    schedule_buffer_encode(Buffer&& input, const CompressionParams& compression, Buffer&& dictionary)
+{
+    SQUEEZE_TRACE();
+    Task task {std::move(input), CompressionParams(compression), std::move(dictionary)};
+    auto future_output = task.output_promise.get_future();
+    scheduler.schedule(std::move(task));
+    try_another_thread();
+    return future_output;
+}
+
+EncodeStat EncoderPool::encode_batch(std::span<const std::span<const char>> inputs, Buffer& arena,
+                                     std::vector<uint64_t>& offsets, const CompressionParams& compression)
+{
+    SQUEEZE_TRACE("Encoding a batch of {} buffers", inputs.size());
+
+    auto batch = std::make_shared<BatchEncode>();
+    batch->compression = compression;
+    batch->range_offsets.resize(inputs.size() + 1);
+    batch->encoded_sizes.resize(inputs.size());
+
+    // the chunks are cut at the input size of a few of them per thread, so that they still balance the load
+    uint64_t total_size = 0;
+    for (const auto& input : inputs)
+        total_size += input.size();
+    const std::size_t nr_threads = std::max<std::size_t>(misc::get_nr_available_cpu_cores(), 1);
+    const uint64_t chunk_size = std::max<uint64_t>(total_size / (nr_threads * 4), min_batch_chunk_size);
+
+    uint64_t curr_chunk_size = 0;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        batch->range_offsets[i + 1] = batch->range_offsets[i] + compress_bound(inputs[i].size(), compression);
+        curr_chunk_size += inputs[i].size();
+        if (curr_chunk_size >= chunk_size || i + 1 == inputs.size()) {
+            batch->chunk_ends.push_back(i + 1);
+            curr_chunk_size = 0;
+        }
+    }
+
+    arena.resize(batch->range_offsets.back());
+    batch->inputs = inputs;
+    batch->arena = arena;
+    batch->nr_chunks_left.store(batch->chunk_ends.size(), std::memory_order::relaxed);
+
+    // the calling thread takes the chunks as well, so the batch gets encoded even if all the workers are busy
+    for (std::size_t i = 1; i < std::min(batch->chunk_ends.size(), nr_threads); ++i)
+        if (not thread_pool.try_assign_task([batch]() { batch->run(); }))
+            break;
+    batch->run();
+    for (std::size_t left; (left = batch->nr_chunks_left.load(std::memory_order::acquire)) != 0;)
+        batch->nr_chunks_left.wait(left, std::memory_order::acquire);
+
+    if (batch->stat.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed encoding batch");
+        arena.clear();
+        offsets.clear();
+        return {"failed encoding batch", std::move(batch->stat)};
+    }
+
+    // the encoded buffers are moved down to follow each other right away
+    offsets.resize(inputs.size() + 1);
+    offsets[0] = 0;
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        const auto range_begin = arena.begin() + batch->range_offsets[i];
+        std::copy(range_begin, range_begin + batch->encoded_sizes[i], arena.begin() + offsets[i]);
+        offsets[i + 1] = offsets[i] + batch->encoded_sizes[i];
+    }
+    arena.resize(offsets.back());
+    return success;
+}
+
 EncodeStat EncoderPool::schedule_stream_encode_step(std::future<EncodedBuffer>& future_output,
         std::istream& stream, const CompressionParams& compression)
 {
@@ -104,16 +227,33 @@ EncodeStat EncoderPool::schedule_stream_encode_step(std::future<EncodedBuffer>&
 
 void EncoderPool::try_another_thread()
 {
-    thread_pool.try_assign_task([this](){ threaded_task_run(); });
+    // the thread is counted as running since being assigned the task rather than since starting it,
+    // so that the pool doesn't get destroyed in between
+    nr_running_threads.fetch_add(1, std::memory_order::acquire);
+    if (thread_pool.try_assign_task([this](){ threaded_task_run(); }))
+        return;
+    // all the threads may be busy, even the last one running the tasks of this pool but leaving already,
+    // in which case nothing would pick the task just scheduled up, so the calling thread runs it instead
+    if (nr_active_threads.load(std::memory_order::seq_cst) == 0) {
+        threaded_task_run();
+        return;
+    }
+    nr_running_threads.fetch_sub(1, std::memory_order::release);
+    nr_running_threads.notify_all();
 }
 
 void EncoderPool::threaded_task_run()
 {
     SQUEEZE_DEBUG("Number of running threads: {}", nr_running_threads.load(std::memory_order::acquire));
-    nr_running_threads.fetch_add(1, std::memory_order::acquire);
     DEFER ( nr_running_threads.fetch_sub(1, std::memory_order::release);
             nr_running_threads.notify_all(); );
-    scheduler.run<misc::TaskRunPolicy::NoWait>();
+    // a task scheduled while the last active thread was leaving is picked up by that thread on its way out,
+    // as the scheduling thread saw it still active and didn't run the task on its own
+    do {
+        nr_active_threads.fetch_add(1, std::memory_order::seq_cst);
+        scheduler.run<misc::TaskRunPolicy::NoWait>();
+        nr_active_threads.fetch_sub(1, std::memory_order::seq_cst);
+    } while (scheduler.get_nr_tasks_left() != 0);
 }
 
 }
\ No newline at end of file
@@ -19,6 +19,9 @@ template<> void print_to(std::ostream& os, const EntryAttributes& attributes)
     case EntryType::Symlink:
         str[0] = 'l';
         break;
+    case EntryType::Blob:
+        str[0] = 'b';
+        break;
     default:
         break;
     }
@@ -44,4 +47,22 @@ template<> void print_to(std::ostream& os, const EntryAttributes& attributes)
     os << str;
 }
 
+template<> void print_to(std::ostream& os, const EntryContentLayout& content_layout)
+{
+    switch (content_layout) {
+    case EntryContentLayout::Plain:
+        return print_to(os, "plain");
+    case EntryContentLayout::References:
+        return print_to(os, "references");
+    case EntryContentLayout::Delta:
+        return print_to(os, "delta");
+    case EntryContentLayout::Sparse:
+        return print_to(os, "sparse");
+    case EntryContentLayout::Duplicate:
+        return print_to(os, "duplicate");
+    default:
+        return print_to(os, "[unknown]");
+    }
+}
+
 }
@@ -0,0 +1,177 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/entry_extent.h"
+
+#include <algorithm>
+
+#include "squeeze/utils/io.h"
+#include "squeeze/utils/endian.h"
+
+namespace squeeze {
+
+namespace {
+
+template<std::integral T>
+void encode_integral(Buffer& output, T val)
+{
+    val = utils::to_endian_val<std::endian::little>(val);
+    const char *data = reinterpret_cast<const char *>(&val);
+    output.insert(output.end(), data, data + sizeof(val));
+}
+
+template<std::integral T>
+StatStr decode_integral(std::istream& input, T& val)
+{
+    input.read(reinterpret_cast<char *>(&val), sizeof(val));
+    val = utils::from_endian_val<std::endian::little>(val);
+    if (utils::validate_stream_fail_eof(input)) [[unlikely]]
+        return "input read error";
+    else
+        return success;
+}
+
+}
+
+uint64_t EntryExtentMap::get_data_size() const
+{
+    uint64_t data_size = 0;
+    for (const auto& extent : extents)
+        data_size += extent.size;
+    return data_size;
+}
+
+void EntryExtentMap::encode(Buffer& output, const EntryExtentMap& map)
+{
+    encode_integral(output, map.size);
+    encode_integral(output, static_cast<uint64_t>(map.extents.size()));
+    for (const auto& extent : map.extents) {
+        encode_integral(output, extent.offset);
+        encode_integral(output, extent.size);
+    }
+}
+
+StatStr EntryExtentMap::decode(std::istream& input, EntryExtentMap& map)
+{
+    uint64_t nr_extents = 0;
+    StatStr s = decode_integral(input, map.size);
+    if (s.successful())
+        s = decode_integral(input, nr_extents);
+    if (s.failed()) [[unlikely]]
+        return s;
+
+    // not reserved upfront, as the number may be corrupted
+    map.extents.clear();
+    uint64_t end = 0;
+    for (uint64_t i = 0; i < nr_extents; ++i) {
+        EntryExtent& extent = map.extents.emplace_back();
+        s = decode_integral(input, extent.offset);
+        if (s.successful())
+            s = decode_integral(input, extent.size);
+        if (s.failed()) [[unlikely]]
+            return s;
+        if (extent.offset < end || extent.offset > map.size || extent.size > map.size - extent.offset) [[unlikely]]
+            return "invalid extent";
+        end = extent.offset + extent.size;
+    }
+    return success;
+}
+
+SparseInputStreambuf::SparseInputStreambuf(std::istream& stream, const EntryExtentMap& map)
+    : stream(stream), extents(map.extents)
+{
+    EntryExtentMap::encode(buffer, map);
+    setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+}
+
+SparseInputStreambuf::int_type SparseInputStreambuf::underflow()
+{
+    while (extent_index < extents.size() && extent_read == extents[extent_index].size) {
+        ++extent_index;
+        extent_read = 0;
+    }
+    if (extent_index == extents.size())
+        return traits_type::eof();
+
+    const EntryExtent& extent = extents[extent_index];
+    buffer.resize(std::min<uint64_t>(BUFSIZ, extent.size - extent_read));
+    stream.clear();
+    stream.seekg(extent.offset + extent_read);
+    stream.read(buffer.data(), buffer.size());
+    std::fill(buffer.begin() + stream.gcount(), buffer.end(), '\0');
+    extent_read += buffer.size();
+
+    setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+    return traits_type::to_int_type(buffer.front());
+}
+
+SparseOutputStreambuf::SparseOutputStreambuf(std::ostream& stream, const EntryExtentMap& map,
+                                             HoleSkipper&& skip_hole)
+    : stream(stream), map(map), skip_hole(std::move(skip_hole))
+{
+}
+
+bool SparseOutputStreambuf::finish()
+{
+    if (pos < map.size) {
+        if (not skip_hole(stream, map.size - pos))
+            return false;
+        pos = map.size;
+    }
+    return true;
+}
+
+std::streamsize SparseOutputStreambuf::xsputn(const char_type *s, std::streamsize n)
+{
+    std::streamsize written = 0;
+    while (written < n) {
+        while (extent_index < map.extents.size() && extent_written == map.extents[extent_index].size) {
+            ++extent_index;
+            extent_written = 0;
+        }
+        // the data doesn't fit into the extents
+        if (extent_index == map.extents.size()) [[unlikely]]
+            break;
+
+        const EntryExtent& extent = map.extents[extent_index];
+        if (pos < extent.offset) {
+            if (not skip_hole(stream, extent.offset - pos)) [[unlikely]]
+                break;
+            pos = extent.offset;
+        }
+
+        const auto size = static_cast<std::streamsize>(
+                std::min<uint64_t>(n - written, extent.size - extent_written));
+        stream.write(s + written, size);
+        if (not stream) [[unlikely]]
+            break;
+        written += size;
+        extent_written += size;
+        pos += size;
+    }
+    return written;
+}
+
+SparseOutputStreambuf::int_type SparseOutputStreambuf::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+    const char_type c = traits_type::to_char_type(ch);
+    return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+}
+
+SparseOutputStreambuf::pos_type SparseOutputStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                               std::ios_base::openmode which)
+{
+    if (off == 0 && dir == std::ios_base::cur && (which & std::ios_base::out))
+        return pos_type(static_cast<off_type>(pos));
+    return pos_type(off_type(-1));
+}
+
+SparseOutputStreambuf::pos_type SparseOutputStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    return seekoff(off_type(sp) - static_cast<off_type>(pos), std::ios_base::cur, which);
+}
+
+}
@@ -0,0 +1,161 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/entry_frames.h"
+
+#include <algorithm>
+
+#include "squeeze/utils/io.h"
+#include "squeeze/utils/endian.h"
+
+namespace squeeze {
+
+namespace {
+
+template<std::integral T>
+bool write_integral(std::ostream& output, T val)
+{
+    val = utils::to_endian_val<std::endian::little>(val);
+    output.write(reinterpret_cast<const char *>(&val), sizeof(val));
+    return not utils::validate_stream_fail_eof(output);
+}
+
+template<std::integral T>
+bool read_integral(std::istream& input, T& val)
+{
+    input.read(reinterpret_cast<char *>(&val), sizeof(val));
+    val = utils::from_endian_val<std::endian::little>(val);
+    return not utils::validate_stream_fail_eof(input);
+}
+
+}
+
+StatStr EntryFrames::measure(std::istream& input, EntryHeader& entry_header)
+{
+    uint64_t content_size = 0, framing_size = trailer_size;
+    while (true) {
+        FrameSizeType frame_size = 0;
+        if (not read_integral(input, frame_size)) [[unlikely]]
+            return "input read error";
+        if (frame_size == 0)
+            break;
+        if (frame_size > max_frame_size) [[unlikely]]
+            return "invalid frame size";
+        input.seekg(frame_size, std::ios_base::cur);
+        content_size += frame_size;
+        framing_size += sizeof(FrameSizeType);
+    }
+
+    uint64_t trailing_content_size = 0;
+    if (not read_content_size(input, trailing_content_size)) [[unlikely]]
+        return "input read error";
+    if (trailing_content_size != content_size) [[unlikely]]
+        return "framed content size mismatch";
+
+    entry_header.content_size = content_size;
+    entry_header.framing_size = framing_size;
+    return success;
+}
+
+bool EntryFrames::read_content_size(std::istream& input, uint64_t& content_size)
+{
+    return read_integral(input, content_size);
+}
+
+bool FramedOutputStreambuf::finish()
+{
+    return write_integral(stream, EntryFrames::FrameSizeType(0)) && write_integral(stream, content_size);
+}
+
+std::streamsize FramedOutputStreambuf::xsputn(const char_type *s, std::streamsize n)
+{
+    std::streamsize written = 0;
+    while (written < n) {
+        const auto frame_size = static_cast<EntryFrames::FrameSizeType>(
+                std::min<std::streamsize>(n - written, EntryFrames::max_frame_size));
+        if (not write_integral(stream, frame_size)) [[unlikely]]
+            break;
+        stream.write(s + written, frame_size);
+        if (utils::validate_stream_fail_eof(stream)) [[unlikely]]
+            break;
+        written += frame_size;
+        content_size += frame_size;
+    }
+    return written;
+}
+
+FramedOutputStreambuf::int_type FramedOutputStreambuf::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+    const char_type c = traits_type::to_char_type(ch);
+    return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+}
+
+FramedOutputStreambuf::pos_type FramedOutputStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                               std::ios_base::openmode which)
+{
+    if (off == 0 && dir == std::ios_base::cur && (which & std::ios_base::out))
+        return pos_type(static_cast<off_type>(content_size));
+    return pos_type(off_type(-1));
+}
+
+FramedOutputStreambuf::pos_type FramedOutputStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    return seekoff(off_type(sp) - static_cast<off_type>(content_size), std::ios_base::cur, which);
+}
+
+FramedInputStreambuf::int_type FramedInputStreambuf::underflow()
+{
+    if (finished)
+        return traits_type::eof();
+
+    content_pos += buffer.size();
+    buffer.clear();
+    setg(buffer.data(), buffer.data(), buffer.data());
+
+    EntryFrames::FrameSizeType frame_size = 0;
+    stream.clear();
+    stream.seekg(frame_pos);
+    if (not read_integral(stream, frame_size) || frame_size == 0 || frame_size > EntryFrames::max_frame_size) {
+        finished = true;
+        return traits_type::eof();
+    }
+    buffer.resize(frame_size);
+    stream.read(buffer.data(), buffer.size());
+    if (utils::validate_stream_fail_eof(stream)) [[unlikely]] {
+        buffer.clear();
+        finished = true;
+        return traits_type::eof();
+    }
+    frame_pos += sizeof(frame_size) + frame_size;
+
+    setg(buffer.data(), buffer.data(), buffer.data() + buffer.size());
+    return traits_type::to_int_type(buffer.front());
+}
+
+FramedInputStreambuf::pos_type FramedInputStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                             std::ios_base::openmode which)
+{
+    const auto pos = static_cast<off_type>(content_pos + (gptr() - eback()));
+    if (off == 0 && dir == std::ios_base::cur && (which & std::ios_base::in))
+        return pos_type(pos);
+    return pos_type(off_type(-1));
+}
+
+FramedInputStreambuf::pos_type FramedInputStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    const auto pos = static_cast<off_type>(content_pos + (gptr() - eback()));
+    return seekoff(off_type(sp) - pos, std::ios_base::cur, which);
+}
+
+EntryContentStream::EntryContentStream(std::istream& source, uint64_t content_pos, bool framed)
+    : std::istream(nullptr), framed_streambuf(source, content_pos)
+{
+    source.clear();
+    source.seekg(content_pos);
+    rdbuf(framed ? &framed_streambuf : source.rdbuf());
+}
+
+}
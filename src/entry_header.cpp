@@ -6,6 +6,7 @@
 
 #include <limits>
 #include <algorithm>
+#include <iterator>
 
 #include "squeeze/exception.h"
 #include "squeeze/utils/io.h"
@@ -49,6 +50,29 @@ StatStr decode_integral(std::istream& input, T& val)
     return stat;
 }
 
+StatStr encode_varint(std::ostream& output, uint64_t val, std::size_t padded_size = 0)
+{
+    char buffer[utils::max_varint_size];
+    const char *end = utils::encode_varint(buffer, val, padded_size);
+    output.write(buffer, end - buffer);
+    if (utils::validate_stream_fail_eof(output)) [[unlikely]]
+        return "output write error";
+    else
+        return success;
+}
+
+StatStr decode_varint(std::istream& input, uint64_t& val, std::size_t *size = nullptr)
+{
+    std::istreambuf_iterator<char> it(input), end;
+    const std::size_t decoded_size = utils::decode_varint(it, end, val);
+    if (size)
+        *size = decoded_size;
+    if (decoded_size == 0) [[unlikely]]
+        return it == end ? "input read error" : "invalid varint";
+    else
+        return success;
+}
+
 StatStr encode_compression_params(std::ostream& output, const CompressionParams& params)
 {
     using compression::CompressionMethod;
@@ -95,7 +119,7 @@ StatStr decode_compression_params(std::istream& input, CompressionParams& params
     return s;
 }
 
-StatStr encode_entry_attributes(std::ostream& output, EntryAttributes attributes)
+StatStr encode_entry_attributes(std::ostream& output, EntryAttributes attributes, bool compact)
 {
     switch (attributes.get_type()) {
         using enum EntryType;
@@ -103,21 +127,34 @@ StatStr encode_entry_attributes(std::ostream& output, EntryAttributes attributes
     case RegularFile:
     case Directory:
     case Symlink:
+    case Blob:
         break;
     default: [[unlikely]]
         throw Exception<EntryHeader>("invalid entry type");
     }
+    if (compact)
+        return encode_varint(output, attributes.data);
     return encode_integral(output, attributes.data);
 }
 
-StatStr decode_entry_attributes(std::istream& input, EntryAttributes& attributes)
+StatStr decode_entry_attributes(std::istream& input, EntryAttributes& attributes, bool compact)
 {
-    StatStr s = decode_integral(input, attributes.data);
+    StatStr s = success;
+    if (compact) {
+        uint64_t data = 0;
+        s = decode_varint(input, data);
+        if (s && data > std::numeric_limits<decltype(attributes.data)>::max()) [[unlikely]]
+            s = "invalid entry attributes";
+        attributes.data = static_cast<decltype(attributes.data)>(data);
+    } else {
+        s = decode_integral(input, attributes.data);
+    }
     switch (attributes.get_type()) {
     case EntryType::None:
     case EntryType::RegularFile:
     case EntryType::Directory:
     case EntryType::Symlink:
+    case EntryType::Blob:
         break;
     default: [[unlikely]]
         if (s)
@@ -128,6 +165,183 @@ StatStr decode_entry_attributes(std::istream& input, EntryAttributes& attributes
     return s;
 }
 
+StatStr encode_content_layout(std::ostream& output, SemVer version, EntryContentLayout content_layout)
+{
+    switch (content_layout) {
+        using enum EntryContentLayout;
+    case Plain:
+    case References:
+    case Delta:
+    case Sparse:
+    case Duplicate:
+        break;
+    default: [[unlikely]]
+        throw Exception<EntryHeader>("invalid content layout");
+    }
+
+    if (version < EntryHeader::content_layout_version) {
+        if (content_layout != EntryContentLayout::Plain) [[unlikely]]
+            throw Exception<EntryHeader>("content layout not supported by the entry version");
+        return success;
+    }
+    return encode_integral(output, static_cast<std::underlying_type_t<EntryContentLayout>>(content_layout));
+}
+
+StatStr decode_content_layout(std::istream& input, SemVer version, EntryContentLayout& content_layout)
+{
+    content_layout = EntryContentLayout::Plain;
+    if (version < EntryHeader::content_layout_version)
+        return success;
+
+    std::underlying_type_t<EntryContentLayout> content_layout_int {};
+    StatStr s = decode_integral(input, content_layout_int);
+    content_layout = static_cast<EntryContentLayout>(content_layout_int);
+
+    switch (content_layout) {
+        using enum EntryContentLayout;
+    case Plain:
+    case References:
+    case Delta:
+    case Sparse:
+    case Duplicate:
+        break;
+    default: [[unlikely]]
+        if (s)
+            s = "invalid content layout";
+        content_layout = EntryContentLayout::Plain;
+        break;
+    }
+    return s;
+}
+
+StatStr encode_original_size(std::ostream& output, SemVer version, uint64_t original_size)
+{
+    // older versions just don't store it, as it's only a hint
+    if (version < EntryHeader::original_size_version)
+        return success;
+    return encode_integral(output, original_size);
+}
+
+StatStr decode_original_size(std::istream& input, SemVer version, uint64_t& original_size)
+{
+    original_size = EntryHeader::unknown_original_size;
+    if (version < EntryHeader::original_size_version)
+        return success;
+    return decode_integral(input, original_size);
+}
+
+StatStr encode_compact_original_size(std::ostream& output, uint64_t original_size)
+{
+    // shifted by one so that the unknown size wraps around to zero
+    return encode_varint(output, original_size + 1);
+}
+
+StatStr decode_compact_original_size(std::istream& input, uint64_t& original_size)
+{
+    StatStr s = decode_varint(input, original_size);
+    original_size -= 1;
+    return s;
+}
+
+StatStr encode_compact_path(std::ostream& output, const std::string& path, std::size_t prefix_size)
+{
+    static constexpr size_t path_size_limit =
+        std::numeric_limits<EntryHeader::EncodedPathSizeType>::max();
+
+    if (path.size() > path_size_limit)
+        throw Exception<EntryHeader>("path too long, must not exceed " + stringify(path_size_limit));
+    if (prefix_size > path.size())
+        throw Exception<EntryHeader>("path prefix longer than the path");
+
+    StatStr s;
+    (s = encode_varint(output, prefix_size)) &&
+    (s = encode_varint(output, path.size() - prefix_size));
+    if (s.failed()) [[unlikely]]
+        return s;
+
+    output.write(path.data() + prefix_size, path.size() - prefix_size);
+
+    if (utils::validate_stream_fail_eof(output)) [[unlikely]]
+        return "output write error";
+    else
+        return success;
+}
+
+StatStr decode_compact_path(std::istream& input, std::string_view previous_path,
+                            std::string& path, EntryHeader::EncodedPathSizeType& prefix_size)
+{
+    uint64_t prefix_size_val = 0, suffix_size = 0;
+    StatStr s;
+    (s = decode_varint(input, prefix_size_val)) &&
+    (s = decode_varint(input, suffix_size));
+    if (s.failed()) [[unlikely]]
+        return s;
+    if (prefix_size_val > previous_path.size()) [[unlikely]]
+        return "path prefix out of range";
+    if (suffix_size > std::numeric_limits<EntryHeader::EncodedPathSizeType>::max() - prefix_size_val) [[unlikely]]
+        return "path too long";
+
+    // reuses the path storage, assign() copes with the previous path referring to the path itself
+    path.assign(previous_path.data(), prefix_size_val);
+    path.resize(prefix_size_val + suffix_size);
+    input.read(path.data() + prefix_size_val, suffix_size);
+    prefix_size = static_cast<EntryHeader::EncodedPathSizeType>(prefix_size_val);
+
+    if (utils::validate_stream_fail_eof(input)) [[unlikely]]
+        return "input read error";
+    else
+        return success;
+}
+
+uint32_t get_encoded_version(const EntryHeader& entry_header)
+{
+    if (entry_header.version.data & (EntryHeader::compact_flag | EntryHeader::framed_flag)) [[unlikely]]
+        throw Exception<EntryHeader>("entry version too high to be encoded");
+    if (entry_header.framed && entry_header.version < EntryHeader::framed_content_version) [[unlikely]]
+        throw Exception<EntryHeader>("framed content not supported by the entry version");
+    return entry_header.version.data | (entry_header.compact ? EntryHeader::compact_flag : 0) |
+        (entry_header.framed ? EntryHeader::framed_flag : 0);
+}
+
+StatStr encode_compact(std::ostream& output, const EntryHeader& entry_header)
+{
+    if (entry_header.version < EntryHeader::compact_header_version) [[unlikely]]
+        throw Exception<EntryHeader>("compact header not supported by the entry version");
+
+    const std::size_t content_size_width = EntryHeader::get_compact_content_size_width(entry_header.original_size);
+    if (utils::get_varint_size(entry_header.content_size) > content_size_width) [[unlikely]]
+        return "content size too large for the compact header";
+
+    StatStr s;
+    (s = encode_integral(output, get_encoded_version(entry_header))) &&
+    (s = encode_varint(output, entry_header.content_size, content_size_width)) &&
+    (s = encode_compression_params(output, entry_header.compression)) &&
+    (s = encode_entry_attributes(output, entry_header.attributes, true)) &&
+    (s = encode_content_layout(output, entry_header.version, entry_header.content_layout)) &&
+    (s = encode_compact_original_size(output, entry_header.original_size)) &&
+    (s = encode_compact_path(output, entry_header.path, entry_header.path_prefix_size));
+    return s;
+}
+
+StatStr decode_compact(std::istream& input, EntryHeader& entry_header, std::string_view previous_path)
+{
+    if (entry_header.version < EntryHeader::compact_header_version) [[unlikely]]
+        return "compact header of a version not supporting it";
+
+    std::size_t content_size_width = 0;
+    StatStr s;
+    (s = decode_varint(input, entry_header.content_size, &content_size_width)) &&
+    (s = decode_compression_params(input, entry_header.compression)) &&
+    (s = decode_entry_attributes(input, entry_header.attributes, true)) &&
+    (s = decode_content_layout(input, entry_header.version, entry_header.content_layout)) &&
+    (s = decode_compact_original_size(input, entry_header.original_size)) &&
+    (s = decode_compact_path(input, previous_path, entry_header.path, entry_header.path_prefix_size));
+    if (s && content_size_width != EntryHeader::get_compact_content_size_width(entry_header.original_size))
+        [[unlikely]]
+        s = "invalid content size width";
+    return s;
+}
+
 StatStr encode_path(std::ostream& output, const std::string& path)
 {
     static constexpr size_t path_size_limit =
@@ -167,6 +381,18 @@ StatStr decode_path(std::istream& input, std::string& path)
 
 }
 
+StatStr EntryHeader::encode_content_size(std::ostream& output, const EntryHeader& entry_header)
+{
+    if (not entry_header.compact)
+        return encode_content_size(output, entry_header.content_size);
+
+    const std::size_t content_size_width = get_compact_content_size_width(entry_header.original_size);
+    if (utils::get_varint_size(entry_header.content_size) > content_size_width) [[unlikely]]
+        return "content size too large for the compact header";
+    output.seekp(output.tellp() + static_cast<std::streamoff>(sizeof(EntryHeader::version)));
+    return encode_varint(output, entry_header.content_size, content_size_width);
+}
+
 StatStr EntryHeader::encode_content_size(std::ostream &output, uint64_t content_size)
 {
     output.seekp(output.tellp() + static_cast<std::streamoff>(sizeof(EntryHeader::version)));
@@ -181,33 +407,67 @@ StatStr EntryHeader::decode_content_size(std::istream &input, uint64_t& content_
 
 StatStr EntryHeader::encode(std::ostream& output, const EntryHeader& entry_header)
 {
+    if (entry_header.compact)
+        return encode_compact(output, entry_header);
+
     StatStr s;
-    (s = encode_integral(output, entry_header.version.data)) &&
+    (s = encode_integral(output, get_encoded_version(entry_header))) &&
     (s = encode_integral(output, entry_header.content_size)) &&
     (s = encode_compression_params(output, entry_header.compression)) &&
-    (s = encode_entry_attributes(output, entry_header.attributes)) &&
+    (s = encode_entry_attributes(output, entry_header.attributes, false)) &&
+    (s = encode_content_layout(output, entry_header.version, entry_header.content_layout)) &&
+    (s = encode_original_size(output, entry_header.version, entry_header.original_size)) &&
     (s = encode_path(output, entry_header.path));
     return s;
 }
 
-StatStr EntryHeader::decode(std::istream& input, EntryHeader& entry_header)
+StatStr EntryHeader::decode(std::istream& input, EntryHeader& entry_header, std::string_view previous_path)
 {
-    StatStr s;
-    (s = decode_integral(input, entry_header.version.data)) &&
+    StatStr s = decode_integral(input, entry_header.version.data);
+    if (s.failed()) [[unlikely]]
+        return s;
+    entry_header.compact = entry_header.version.data & compact_flag;
+    entry_header.framed = entry_header.version.data & framed_flag;
+    entry_header.version.data &= ~(compact_flag | framed_flag);
+    entry_header.framing_size = 0;
+    if (entry_header.version > squeeze::version) [[unlikely]]
+        return "unsupported entry version";
+    if (entry_header.framed && entry_header.version < framed_content_version) [[unlikely]]
+        return "framed content of a version not supporting it";
+
+    if (entry_header.compact)
+        return decode_compact(input, entry_header, previous_path);
+
+    entry_header.path_prefix_size = 0;
     (s = decode_integral(input, entry_header.content_size)) &&
     (s = decode_compression_params(input, entry_header.compression)) &&
-    (s = decode_entry_attributes(input, entry_header.attributes)) &&
+    (s = decode_entry_attributes(input, entry_header.attributes, false)) &&
+    (s = decode_content_layout(input, entry_header.version, entry_header.content_layout)) &&
+    (s = decode_original_size(input, entry_header.version, entry_header.original_size)) &&
     (s = decode_path(input, entry_header.path));
     return s;
 }
 
+EntryHeader::EncodedPathSizeType EntryHeader::get_shared_path_prefix_size(std::string_view lhs, std::string_view rhs)
+{
+    const std::size_t max_size = std::min({lhs.size(), rhs.size(),
+                                           std::size_t(std::numeric_limits<EncodedPathSizeType>::max())});
+    const auto [lhs_it, rhs_it] = std::mismatch(lhs.begin(), lhs.begin() + max_size, rhs.begin());
+    return static_cast<EncodedPathSizeType>(lhs_it - lhs.begin());
+}
+
 template<> void print_to(std::ostream& os, const EntryHeader& header)
 {
     print_to(os,
         "{ content_size=", header.content_size,
-        ", version=", version.get_major(), '.', version.get_minor(), '.', version.get_patch(),
+        ", version=", header.version.get_major(), '.', header.version.get_minor(), '.',
+                      header.version.get_patch(),
         ", compression=", header.compression,
         ", attributes=", header.attributes,
+        ", content_layout=", header.content_layout,
+        ", original_size=", header.has_original_size() ? stringify(header.original_size) : "unknown",
+        ", compact=", header.compact,
+        ", framed=", header.framed,
         ", path=", header.path, " }");
 }
 
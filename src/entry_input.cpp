@@ -8,6 +8,7 @@
 
 #include "squeeze/logging.h"
 #include "squeeze/utils/fs.h"
+#include "squeeze/utils/io.h"
 #include "squeeze/exception.h"
 #include "squeeze/version.h"
 
@@ -56,10 +57,14 @@ Stat FileEntryInput::init(EntryHeader& entry_header, ContentType& content)
     }
     case RegularFile:
         SQUEEZE_TRACE("'{}' is a regular file", path);
-        file = std::ifstream(path, std::ios_base::binary | std::ios_base::in);
-        if (!*file)
+        if (not filebuf.emplace().open(path, std::ios_base::binary | std::ios_base::in))
             return "failed opening a file: " + path;
+        file.emplace(&*filebuf);
         content = &*file;
+        // set before the content gets replaced by a sparse stream, the size of which isn't known
+        if (const std::streamsize size = utils::get_remaining_size(*file); size >= 0)
+            entry_header.original_size = size;
+        init_sparse_content(entry_header, content);
         break;
     default:
         throw Exception<EntryInput>("unexpected file type");
@@ -71,7 +76,23 @@ Stat FileEntryInput::init(EntryHeader& entry_header, ContentType& content)
 
 void FileEntryInput::deinit() noexcept
 {
+    sparse_stream.reset();
+    sparse_streambuf.reset();
     file.reset();
+    filebuf.reset();
+}
+
+void FileEntryInput::init_sparse_content(EntryHeader& entry_header, ContentType& content)
+{
+    EntryExtentMap map;
+    if (utils::get_data_extents(path, map).failed() || map.get_data_size() == map.size)
+        return;
+
+    SQUEEZE_TRACE("'{}' is sparse, with {} of {} bytes of data", path, map.get_data_size(), map.size);
+    sparse_streambuf.emplace(*file, map);
+    sparse_stream.emplace(&*sparse_streambuf);
+    entry_header.content_layout = EntryContentLayout::Sparse;
+    content = &*sparse_stream;
 }
 
 Stat FileEntryInput::init_entry_header(EntryHeader& entry_header)
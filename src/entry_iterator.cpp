@@ -4,15 +4,27 @@
 
 #include "squeeze/entry_iterator.h"
 
+#include "squeeze/entry_frames.h"
+#include "squeeze/utils/fs.h"
+
 namespace squeeze {
 
 EntryIterator::EntryIterator(std::istream& source)
     : source(&source), pos_and_entry_header(npos, EntryHeader())
 {
+    // a traversal goes through the source from its beginning forward
+    utils::advise_sequential(utils::get_file_descriptor(source));
     pos_and_entry_header.first = 0;
     read_current();
 }
 
+EntryIterator::EntryIterator(std::istream& source, uint64_t pos, std::string_view previous_path)
+    : source(&source), pos_and_entry_header(pos, EntryHeader())
+{
+    pos_and_entry_header.second.path = previous_path;
+    read_current();
+}
+
 EntryIterator& EntryIterator::operator++() noexcept
 {
     pos_and_entry_header.first += pos_and_entry_header.second.get_encoded_full_size();
@@ -30,10 +42,21 @@ EntryIterator EntryIterator::operator++(int) noexcept
 void EntryIterator::read_current()
 {
     source->seekg(pos_and_entry_header.first);
-    if (EntryHeader::decode(*source, pos_and_entry_header.second).failed()) {
+    // the path of the previous entry is the context of the front-coded path of a compact header
+    EntryHeader& entry_header = pos_and_entry_header.second;
+    previous_path.swap(entry_header.path);
+    if (EntryHeader::decode(*source, entry_header, previous_path).failed() ||
+            (entry_header.framed && EntryFrames::measure(*source, entry_header).failed())) {
         pos_and_entry_header.first = npos;
         source->clear();
+        return;
     }
+
+    // the content skipped over may be too large for the readahead to cover the next header
+    if (entry_header.content_size >= next_header_advice_min_gap)
+        utils::advise_will_need(utils::get_file_descriptor(*source),
+                                pos_and_entry_header.first + entry_header.get_encoded_full_size(),
+                                next_header_advice_size);
 }
 
 }
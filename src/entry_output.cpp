@@ -3,18 +3,41 @@
 // See the LICENSE file in the top-level directory for more information.
 
 #include "squeeze/entry_output.h"
+
+#include <algorithm>
+#include <filesystem>
+
 #include "squeeze/logging.h"
 #include "squeeze/exception.h"
 #include "squeeze/utils/fs.h"
 #include "squeeze/utils/overloaded.h"
+#include "squeeze/utils/io.h"
 
 namespace squeeze {
 
 #undef SQUEEZE_LOG_FUNC_PREFIX
-#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::FileEntryOutput::"
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::EntryOutput::"
 
 using Stat = EntryOutput::Stat;
 
+Stat EntryOutput::skip_hole(std::ostream& stream, uint64_t size)
+{
+    static constexpr char zeros[BUFSIZ] {};
+    while (size != 0) {
+        const std::size_t chunk_size = std::min<uint64_t>(size, sizeof(zeros));
+        stream.write(zeros, chunk_size);
+        if (utils::validate_stream_fail_eof(stream)) [[unlikely]] {
+            SQUEEZE_ERROR("Output write error");
+            return "output write error";
+        }
+        size -= chunk_size;
+    }
+    return success;
+}
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::FileEntryOutput::"
+
 Stat FileEntryOutput::init(EntryHeader&& entry_header, std::ostream *& stream)
 {
     switch (entry_header.attributes.get_type()) {
@@ -24,11 +47,15 @@ Stat FileEntryOutput::init(EntryHeader&& entry_header, std::ostream *& stream)
         {
             SQUEEZE_TRACE("'{}' is a regular file", entry_header.path);
             this->final_entry_header = std::move(entry_header);
+            skipped_hole = false;
+            if (use_mapped_output() && init_mapped(stream))
+                return success;
             return std::visit(utils::Overloaded {
                     [this, &stream](std::ofstream&& f) -> Stat
                     {
                         file = std::move(f);
                         stream = &*file;
+                        preallocate();
                         return success;
                     },
                     [this](StatCode&& stat) -> Stat
@@ -54,6 +81,47 @@ Stat FileEntryOutput::init(EntryHeader&& entry_header, std::ostream *& stream)
     }
 }
 
+bool FileEntryOutput::use_mapped_output() const
+{
+    // the holes of sparse files are skipped by seeking the regular output past them,
+    // and the stored contents are copied right between the files, see utils::ioscopy()
+    if (not utils::MappedFileStreambuf::is_supported() ||
+            final_entry_header->content_layout == EntryContentLayout::Sparse ||
+            final_entry_header->compression.method == compression::CompressionMethod::None)
+        return false;
+    return (final_entry_header->has_original_size() ?
+            final_entry_header->original_size : final_entry_header->content_size) >= mapped_output_min_size;
+}
+
+bool FileEntryOutput::init_mapped(std::ostream *& stream)
+{
+    SQUEEZE_TRACE("Writing '{}' through a memory mapping", final_entry_header->path);
+    const std::filesystem::path path(final_entry_header->path);
+    StatCode sc = utils::prepare_regular_file_out(path);
+    if (sc.successful())
+        sc = mapped_file.open(path, final_entry_header->has_original_size() ? final_entry_header->original_size : 0);
+    if (sc.failed()) {
+        SQUEEZE_DEBUG("Failed mapping '{}', writing it as usual: {}", final_entry_header->path, stringify(sc));
+        return false;
+    }
+    // the mapped file is allocated up to its original size already
+    stream = &mapped_stream.emplace(&mapped_file);
+    return true;
+}
+
+void FileEntryOutput::preallocate()
+{
+    // sparse files are left to allocate only their data
+    if (not final_entry_header->has_original_size() || final_entry_header->original_size == 0 ||
+            final_entry_header->content_layout == EntryContentLayout::Sparse)
+        return;
+
+    StatCode sc = utils::preallocate_file(final_entry_header->path, final_entry_header->original_size);
+    if (sc.failed()) {
+        SQUEEZE_DEBUG("Failed preallocating {}: {}", final_entry_header->path, stringify(sc));
+    }
+}
+
 Stat FileEntryOutput::init_symlink(EntryHeader&& entry_header, const std::string &target)
 {
     SQUEEZE_TRACE("'{}' is a symlink", entry_header.path);
@@ -64,12 +132,48 @@ Stat FileEntryOutput::init_symlink(EntryHeader&& entry_header, const std::string
         return success;
 }
 
+Stat FileEntryOutput::skip_hole(std::ostream& stream, uint64_t size)
+{
+    // the file is created anew, so seeking past its end leaves a hole
+    stream.seekp(static_cast<std::streamoff>(size), std::ios_base::cur);
+    if (stream.fail()) {
+        stream.clear();
+        return EntryOutput::skip_hole(stream, size);
+    }
+    skipped_hole = true;
+    return success;
+}
+
 Stat FileEntryOutput::finalize()
 {
     SQUEEZE_TRACE();
     if (not final_entry_header)
         return success;
 
+    if (mapped_file.is_open()) {
+        mapped_stream.reset();
+        StatCode sc = mapped_file.close();
+        if (sc.failed()) {
+            SQUEEZE_ERROR("Failed closing the mapped file");
+            return {"failed closing the mapped file", sc};
+        }
+    }
+
+    if (skipped_hole && file) {
+        // a trailing hole is only seeked past, so the file gets extended up to the current position
+        const std::streamoff size = file->tellp();
+        file->flush();
+        std::error_code ec;
+        if (size >= 0 && not file->fail())
+            std::filesystem::resize_file(final_entry_header->path, size, ec);
+        else
+            ec = std::make_error_code(std::errc::io_error);
+        if (ec) {
+            SQUEEZE_ERROR("Failed resizing file");
+            return {"failed resizing file", StatCode(ec)};
+        }
+    }
+
     StatCode sc = utils::set_permissions(final_entry_header->path,
             final_entry_header->attributes.get_permissions());
     if (sc.failed()) {
@@ -82,6 +186,8 @@ Stat FileEntryOutput::finalize()
 void FileEntryOutput::deinit() noexcept
 {
     file.reset();
+    mapped_stream.reset();
+    mapped_file.close();
 }
 
 Stat CustomStreamEntryOutput::init(EntryHeader&& entry_header, std::ostream *&stream)
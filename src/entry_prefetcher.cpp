@@ -0,0 +1,110 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/entry_prefetcher.h"
+
+#include <algorithm>
+#include <deque>
+
+#include "squeeze/logging.h"
+#include "squeeze/entry_iterator.h"
+#include "squeeze/utils/fs.h"
+
+namespace squeeze {
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::EntryPrefetcher::"
+
+EntryPrefetcher::EntryPrefetcher(std::istream& source, std::size_t nr_entries_ahead)
+    : nr_entries_ahead(std::max<std::size_t>(nr_entries_ahead, 1))
+{
+    const int source_fd = utils::get_file_descriptor(source);
+    // the descriptor is duplicated, as the source may get closed before the prefetching stops
+    if (source_fd < 0 || (fd = utils::duplicate_file_descriptor(source_fd)) < 0) {
+        SQUEEZE_DEBUG("The source isn't a file, not prefetching");
+        return;
+    }
+    thread = std::thread(&EntryPrefetcher::run, this);
+}
+
+EntryPrefetcher::~EntryPrefetcher()
+{
+    if (thread.joinable()) {
+        {
+            std::scoped_lock lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        thread.join();
+    }
+    if (fd >= 0)
+        utils::close_file_descriptor(fd);
+}
+
+void EntryPrefetcher::advance(uint64_t pos)
+{
+    if (not is_active())
+        return;
+    {
+        std::scoped_lock lock(mutex);
+        current_pos = pos;
+    }
+    cv.notify_all();
+}
+
+void EntryPrefetcher::run()
+{
+    SQUEEZE_TRACE();
+
+    utils::PositionalInputStreambuf streambuf(fd);
+    std::istream input(&streambuf);
+    // end positions of the entries read ahead of the current position
+    std::deque<uint64_t> ahead;
+    for (EntryIterator it(input); it != EntryIterator::end; ++it) {
+        const uint64_t pos = it->first, size = it->second.get_encoded_full_size();
+        {
+            std::unique_lock lock(mutex);
+            cv.wait(lock, [&]
+                {
+                    while (not ahead.empty() && ahead.front() <= current_pos)
+                        ahead.pop_front();
+                    return stopping || ahead.size() < nr_entries_ahead;
+                });
+            if (stopping)
+                return;
+            // the entries already passed aren't worth reading anymore
+            if (pos + size <= current_pos)
+                continue;
+        }
+
+        SQUEEZE_TRACE("Prefetching the entry at pos={} with size={}", pos, size);
+        utils::advise_will_need(fd, pos, size);
+        read_range(pos, std::min(size, max_entry_read_size));
+        ahead.push_back(pos + size);
+        nr_entries_prefetched.fetch_add(1, std::memory_order::relaxed);
+    }
+}
+
+void EntryPrefetcher::read_range(uint64_t pos, uint64_t size)
+{
+    // read in steps, so that the prefetching stops soon once asked
+    static constexpr uint64_t step_size = 1 << 20;
+    utils::PositionalInputStreambuf streambuf(fd, std::min(size, step_size));
+    std::istream input(&streambuf);
+    input.seekg(static_cast<std::streamoff>(pos));
+    while (size != 0) {
+        {
+            std::scoped_lock lock(mutex);
+            if (stopping)
+                return;
+        }
+        const auto step = static_cast<std::streamsize>(std::min(size, step_size));
+        input.ignore(step);
+        if (input.gcount() != step)
+            return;
+        size -= step;
+    }
+}
+
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/entry_reference.h"
+
+#include <charconv>
+
+#include "squeeze/utils/io.h"
+#include "squeeze/utils/endian.h"
+
+namespace squeeze {
+
+namespace {
+
+template<std::integral T>
+void encode_integral(Buffer& output, T val)
+{
+    val = utils::to_endian_val<std::endian::little>(val);
+    const char *data = reinterpret_cast<const char *>(&val);
+    output.insert(output.end(), data, data + sizeof(val));
+}
+
+template<std::integral T>
+StatStr decode_integral(std::istream& input, T& val)
+{
+    input.read(reinterpret_cast<char *>(&val), sizeof(val));
+    val = utils::from_endian_val<std::endian::little>(val);
+    if (utils::validate_stream_fail_eof(input)) [[unlikely]]
+        return "input read error";
+    else
+        return success;
+}
+
+}
+
+BlobId BlobId::of(std::span<const char> content)
+{
+    return {misc::murmur3_128(content)};
+}
+
+std::optional<BlobId> BlobId::from_path(std::string_view path)
+{
+    static constexpr std::size_t nr_word_digits = sizeof(uint64_t) * 2;
+    if (path.size() != nr_word_digits * 2)
+        return std::nullopt;
+
+    BlobId blob_id;
+    for (std::size_t i = 0; i < 2; ++i) {
+        const char *first = path.data() + i * nr_word_digits;
+        const char *last = first + nr_word_digits;
+        auto [ptr, ec] = std::from_chars(first, last, blob_id.hash[i], 16);
+        if (ec != std::errc() || ptr != last)
+            return std::nullopt;
+    }
+    return blob_id;
+}
+
+std::string BlobId::to_path() const
+{
+    static constexpr char digits[] = "0123456789abcdef";
+    std::string path(sizeof(hash) * 2, '0');
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        const uint64_t word = hash[i / 16];
+        path[i] = digits[(word >> (60 - (i % 16) * 4)) & 0xF];
+    }
+    return path;
+}
+
+void EntryReference::encode(Buffer& output, const EntryReference& reference)
+{
+    encode_integral(output, reference.blob_id.hash[0]);
+    encode_integral(output, reference.blob_id.hash[1]);
+    encode_integral(output, reference.offset);
+    encode_integral(output, reference.size);
+}
+
+StatStr EntryReference::decode(std::istream& input, EntryReference& reference)
+{
+    StatStr s;
+    (s = decode_integral(input, reference.blob_id.hash[0])) &&
+    (s = decode_integral(input, reference.blob_id.hash[1])) &&
+    (s = decode_integral(input, reference.offset)) &&
+    (s = decode_integral(input, reference.size));
+    return s;
+}
+
+StatStr EntryReference::decode_list(std::istream& input, uint64_t content_size,
+        std::vector<EntryReference>& references)
+{
+    if (content_size % encoded_size != 0) [[unlikely]]
+        return "invalid size of the list of references";
+
+    references.resize(content_size / encoded_size);
+    for (auto& reference : references) {
+        StatStr s = decode(input, reference);
+        if (s.failed()) [[unlikely]]
+            return s;
+    }
+    return success;
+}
+
+}
@@ -0,0 +1,90 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/entry_scanner.h"
+
+#include <algorithm>
+#include <span>
+
+#include "squeeze/entry_frames.h"
+
+namespace squeeze {
+
+EntryScanner::EntryScanner(std::istream& source, std::size_t buffer_size)
+    : source(source), buffer(std::max(buffer_size, max_header_size)), header_stream(&header_streambuf)
+{
+}
+
+bool EntryScanner::next()
+{
+    uint64_t header_pos = 0;
+    if (started) {
+        if (pos == npos)
+            return false;
+        const uint64_t full_size = entry_header.get_encoded_full_size();
+        if (full_size >= npos - pos) [[unlikely]] {
+            pos = npos;
+            return false;
+        }
+        header_pos = pos + full_size;
+    }
+    started = true;
+    pos = npos;
+
+    if (not fill(header_pos))
+        return false;
+
+    const std::size_t offset = header_pos - buffer_pos;
+    header_streambuf.reset(std::span(buffer.data() + offset, buffer_data_size - offset));
+    header_stream.clear();
+    // the path of the previous entry is the context of the front-coded path of a compact header
+    previous_path.swap(entry_header.path);
+    if (EntryHeader::decode(header_stream, entry_header, previous_path).failed())
+        return false;
+    // the frames are measured right in the source, seeking from one to another
+    if (entry_header.framed) {
+        source.clear();
+        source.seekg(header_pos + entry_header.get_encoded_header_size());
+        if (EntryFrames::measure(source, entry_header).failed())
+            return false;
+    }
+
+    pos = header_pos;
+    return true;
+}
+
+bool EntryScanner::fill(uint64_t header_pos)
+{
+    const uint64_t buffer_end = buffer_pos + buffer_data_size;
+    const bool sequential = buffer_pos <= header_pos && header_pos <= buffer_end;
+    if (sequential && (buffer_eof || buffer_end - header_pos >= max_header_size))
+        return true;
+
+    // a header partially in the buffer is moved to its beginning, the rest of it gets read after
+    std::size_t kept_size = 0;
+    if (sequential) {
+        kept_size = static_cast<std::size_t>(buffer_end - header_pos);
+        std::copy(buffer.begin() + (header_pos - buffer_pos), buffer.begin() + buffer_data_size, buffer.begin());
+        read_ahead_size = std::min(read_ahead_size * 2, buffer.size());
+    } else {
+        read_ahead_size = max_header_size;
+    }
+    buffer_pos = header_pos;
+
+    const std::size_t read_size = read_ahead_size - kept_size;
+    source.clear();
+    source.seekg(buffer_pos + kept_size);
+    source.read(buffer.data() + kept_size, read_size);
+    const auto read = static_cast<std::size_t>(source.gcount());
+    buffer_data_size = kept_size + read;
+    buffer_eof = read < read_size;
+    if (utils::validate_stream_bad(source)) [[unlikely]] {
+        buffer_data_size = 0;
+        return false;
+    }
+    source.clear();
+    return true;
+}
+
+}
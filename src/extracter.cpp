@@ -4,12 +4,18 @@
 
 #include "squeeze/extracter.h"
 
+#include <sstream>
+
 #include "squeeze/logging.h"
 #include "squeeze/exception.h"
 #include "squeeze/utils/io.h"
+#include "squeeze/utils/fs.h"
 #include "squeeze/utils/defer.h"
 #include "squeeze/utils/defer_macros.h"
 #include "squeeze/decode.h"
+#include "squeeze/entry_frames.h"
+#include "squeeze/entry_scanner.h"
+#include "squeeze/misc/hashing_streambuf.h"
 
 namespace squeeze {
 
@@ -35,8 +41,23 @@ Stat Extracter::extract(const EntryIterator& it, EntryOutput& entry_output)
     SQUEEZE_INFO("Extracting {}", it->second.path);
 
     auto& [pos, entry_header] = *it;
-    source.seekg(pos + entry_header.get_encoded_header_size());
+    if (prefetcher)
+        prefetcher->advance(pos);
+    const uint64_t content_pos = pos + entry_header.get_encoded_header_size();
+    EntryContentStream input(source, content_pos, entry_header.framed);
+    const int fd = readahead_size != 0 ? utils::get_file_descriptor(source) : -1;
+    if (fd < 0)
+        return extract_entry(entry_header, input, entry_output);
+
+    // the positions within the framed content are only approximately those within the file, past the frame headers
+    utils::ReadaheadInputStreambuf readahead_streambuf(input, fd, entry_header.framed ? content_pos : 0,
+                                                       pos + entry_header.get_encoded_full_size(), readahead_size);
+    std::istream readahead_input(&readahead_streambuf);
+    return extract_entry(entry_header, readahead_input, entry_output);
+}
 
+Stat Extracter::extract_entry(const EntryHeader& entry_header, std::istream& input, EntryOutput& entry_output)
+{
     SQUEEZE_DEBUG("Entry header: {}", stringify(entry_header));
 
     switch (entry_header.attributes.get_type()) {
@@ -53,7 +74,9 @@ Stat Extracter::extract(const EntryIterator& it, EntryOutput& entry_output)
             return {"failed initializing entry output", s};
         }
         if (output) {
-            Stat s = extract_stream(entry_header, *output);
+            Stat s = entry_header.content_layout == EntryContentLayout::Sparse ?
+                extract_sparse(entry_header, input, *output, entry_output) :
+                extract_stream(entry_header, input, *output);
             if (s.failed()) {
                 SQUEEZE_ERROR("Failed extracting stream");
                 return {"failed extracting stream", s};
@@ -69,7 +92,7 @@ Stat Extracter::extract(const EntryIterator& it, EntryOutput& entry_output)
     case Symlink:
     {
         std::string target;
-        Stat stat = extract_symlink(entry_header, target);
+        Stat stat = extract_symlink(entry_header, input, target);
         if (stat.failed()) {
             SQUEEZE_ERROR("Failed extracting symlink");
             return {"failed extracting symlink", stat};
@@ -88,17 +111,60 @@ Stat Extracter::extract(const EntryIterator& it, EntryOutput& entry_output)
         }
         break;
     }
+    case Blob:
+        SQUEEZE_TRACE("Blob entries are not extracted on their own");
+        break;
     default:
         return Stat("invalid entry type");
     }
     return success;
 }
 
-Stat Extracter::extract_stream(const EntryHeader& entry_header, std::ostream& output)
+void Extracter::start_prefetching(std::size_t nr_entries_ahead)
+{
+    prefetcher.reset();
+    prefetcher.emplace(source, nr_entries_ahead);
+}
+
+void Extracter::stop_prefetching() noexcept
+{
+    prefetcher.reset();
+}
+
+Stat Extracter::read_references(const EntryIterator& it, std::vector<EntryReference>& references)
+{
+    auto& [pos, entry_header] = *it;
+    references.clear();
+    if (entry_header.content_layout != EntryContentLayout::References &&
+        entry_header.content_layout != EntryContentLayout::Delta &&
+        entry_header.content_layout != EntryContentLayout::Duplicate)
+        return success;
+
+    EntryContentStream input(source, pos + entry_header.get_encoded_header_size(), entry_header.framed);
+    Stat s = success;
+    if (entry_header.content_layout != EntryContentLayout::References)
+        s = EntryReference::decode(input, references.emplace_back());
+    else
+        s = EntryReference::decode_list(input, entry_header.content_size, references);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed reading references");
+        return {"failed reading references", s};
+    }
+    return success;
+}
+
+Stat Extracter::extract_stream(const EntryHeader& entry_header, std::istream& input, std::ostream& output)
 {
     SQUEEZE_TRACE();
 
-    auto s = decode(output, entry_header.content_size, source, entry_header.compression);
+    if (entry_header.content_layout == EntryContentLayout::References)
+        return extract_references(entry_header, input, output);
+    if (entry_header.content_layout == EntryContentLayout::Delta)
+        return extract_delta(entry_header, input, output);
+    if (entry_header.content_layout == EntryContentLayout::Duplicate)
+        return extract_duplicate(entry_header, input, output);
+
+    auto s = decode(output, entry_header.content_size, input, entry_header.compression);
     if (s.failed()) {
         SQUEEZE_ERROR("Failed decoding entry");
         return {"failed decoding entry", s};
@@ -106,7 +172,251 @@ Stat Extracter::extract_stream(const EntryHeader& entry_header, std::ostream& ou
     return success;
 }
 
-Stat Extracter::extract_symlink(const EntryHeader& entry_header, std::string& target)
+Stat Extracter::extract_sparse(const EntryHeader& entry_header, std::istream& input, std::ostream& output,
+                               EntryOutput& entry_output)
+{
+    SQUEEZE_TRACE();
+
+    EntryExtentMap map;
+    Stat s = EntryExtentMap::decode(input, map);
+    if (s.failed() || map.get_encoded_size() > entry_header.content_size) [[unlikely]] {
+        SQUEEZE_ERROR("Failed reading the extent map");
+        return {"failed reading the extent map", s ? StatStr("invalid extent map") : std::move(s)};
+    }
+
+    Stat hole_stat = success;
+    SparseOutputStreambuf sparse_streambuf(output, map,
+        [&entry_output, &hole_stat](std::ostream& stream, uint64_t size)
+        {
+            hole_stat = entry_output.skip_hole(stream, size);
+            return hole_stat.successful();
+        }
+    );
+    std::ostream sparse_output(&sparse_streambuf);
+
+    EntryHeader data_header = entry_header;
+    data_header.content_layout = EntryContentLayout::Plain;
+    if (data_header.content_size != unknown_size)
+        data_header.content_size -= map.get_encoded_size();
+    s = extract_stream(data_header, input, sparse_output);
+    if (s.successful() && not sparse_streambuf.finish()) [[unlikely]]
+        s = "failed skipping the trailing hole";
+    if (hole_stat.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed skipping a hole");
+        return {"failed skipping a hole", std::move(hole_stat)};
+    }
+    return s;
+}
+
+Stat Extracter::extract_references(const EntryHeader& entry_header, std::istream& input, std::ostream& output)
+{
+    SQUEEZE_TRACE();
+
+    std::vector<EntryReference> references;
+    Stat s = EntryReference::decode_list(input, entry_header.content_size, references);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed reading references");
+        return {"failed reading references", s};
+    }
+
+    for (const auto& reference : references) {
+        std::string_view blob;
+        s = load_blob(reference.blob_id, blob);
+        if (s.failed()) [[unlikely]] {
+            SQUEEZE_ERROR("Failed loading blob {}", reference.blob_id.to_path());
+            return {"failed loading blob " + reference.blob_id.to_path(), s};
+        }
+
+        if (reference.offset > blob.size() || reference.size > blob.size() - reference.offset) [[unlikely]] {
+            SQUEEZE_ERROR("Reference out of the blob bounds");
+            return "reference out of the blob bounds";
+        }
+
+        output.write(blob.data() + reference.offset, reference.size);
+        if (utils::validate_stream_fail_eof(output)) [[unlikely]] {
+            SQUEEZE_ERROR("Output write error");
+            return "output write error";
+        }
+    }
+    return success;
+}
+
+Stat Extracter::extract_delta(const EntryHeader& entry_header, std::istream& input, std::ostream& output)
+{
+    SQUEEZE_TRACE();
+
+    if (entry_header.content_size < EntryReference::encoded_size) [[unlikely]] {
+        SQUEEZE_ERROR("Delta entry with no base reference");
+        return "delta entry with no base reference";
+    }
+
+    EntryReference base;
+    Stat s = EntryReference::decode(input, base);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed reading the base reference");
+        return {"failed reading the base reference", s};
+    }
+
+    const auto delta_pos = input.tellg();
+    std::string_view blob;
+    s = load_blob(base.blob_id, blob);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed loading base blob {}", base.blob_id.to_path());
+        return {"failed loading base blob " + base.blob_id.to_path(), s};
+    }
+    if (base.offset > blob.size() || base.size > blob.size() - base.offset) [[unlikely]] {
+        SQUEEZE_ERROR("Reference out of the blob bounds");
+        return "reference out of the blob bounds";
+    }
+
+    // loading the blob may have moved the source
+    input.clear();
+    input.seekg(delta_pos);
+    const std::size_t delta_size = entry_header.content_size == unknown_size ?
+        unknown_size : entry_header.content_size - EntryReference::encoded_size;
+    s = decode_delta(output, delta_size, input, entry_header.compression,
+                     std::span(blob).subspan(base.offset, base.size));
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed decoding delta");
+        return {"failed decoding delta", s};
+    }
+    return success;
+}
+
+Stat Extracter::extract_duplicate(const EntryHeader& entry_header, std::istream& input, std::ostream& output)
+{
+    SQUEEZE_TRACE();
+
+    if (entry_header.content_size < EntryReference::encoded_size) [[unlikely]] {
+        SQUEEZE_ERROR("Duplicate entry with no content reference");
+        return "duplicate entry with no content reference";
+    }
+
+    EntryReference reference;
+    Stat s = EntryReference::decode(input, reference);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed reading the content reference");
+        return {"failed reading the content reference", s};
+    }
+
+    // the referred content is verified against its hash, as it's a content of another entry
+    misc::HashingOutputStreambuf hashing_streambuf(output);
+    std::ostream hashing_output(&hashing_streambuf);
+    s = decode_referred_content(reference, entry_header.compression, hashing_output);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed decoding the referred content");
+        return {"failed decoding the referred content", s};
+    }
+    if (BlobId{hashing_streambuf.digest()} != reference.blob_id || (entry_header.has_original_size() &&
+            hashing_streambuf.get_written_size() != entry_header.original_size)) [[unlikely]] {
+        SQUEEZE_ERROR("Referred content mismatch");
+        return "referred content mismatch";
+    }
+    return success;
+}
+
+Stat Extracter::decode_referred_content(const EntryReference& reference, const CompressionParams& compression,
+                                        std::ostream& output)
+{
+    EntryContentStream content(source, reference.offset, false);
+    return decode(output, reference.size, content, compression);
+}
+
+Stat Extracter::load_blob(const BlobId& blob_id, std::string_view& blob)
+{
+    if (const std::string *cached_blob = blob_cache.find(blob_id)) {
+        blob = *cached_blob;
+        return success;
+    }
+
+    SQUEEZE_TRACE("Loading blob {}", blob_id.to_path());
+
+    uint64_t pos;
+    EntryHeader entry_header;
+    Stat s = find_blob(blob_id, pos, entry_header);
+    if (s.failed()) [[unlikely]]
+        return s;
+
+    EntryContentStream input(source, pos + entry_header.get_encoded_header_size(), entry_header.framed);
+    std::string content;
+    s = decode_blob(entry_header, input, content);
+    if (s.failed()) [[unlikely]]
+        return s;
+
+    blob = blob_cache.insert(blob_id, std::move(content));
+    return success;
+}
+
+Stat Extracter::decode_blob(const EntryHeader& entry_header, std::istream& input, std::string& blob)
+{
+    Stat s = success;
+    if (can_preallocate(entry_header)) {
+        // decoded right into the blob buffer, which is of the exact size
+        blob.resize(entry_header.original_size);
+        utils::SpanOutputStreambuf streambuf(blob);
+        std::ostream content(&streambuf);
+        s = decode_chained(content, entry_header.content_size, input, entry_header.compression);
+        if (s.successful() && streambuf.get_written_size() != blob.size()) [[unlikely]]
+            s = "blob size mismatch";
+    } else {
+        std::ostringstream content;
+        s = decode_chained(content, entry_header.content_size, input, entry_header.compression);
+        blob = std::move(content).str();
+        const bool size_mismatch = entry_header.has_original_size() && blob.size() != entry_header.original_size;
+        if (s.successful() && size_mismatch) [[unlikely]]
+            s = "blob size mismatch";
+    }
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed decoding blob");
+        return {"failed decoding blob", s};
+    }
+    return success;
+}
+
+Stat Extracter::find_blob(const BlobId& blob_id, uint64_t& pos, EntryHeader& entry_header)
+{
+    // the indexed position is validated as the source might have been modified since the indexing
+    auto try_find = [this, &blob_id, &pos, &entry_header]() -> bool
+    {
+        auto it = blob_positions.find(blob_id);
+        if (it == blob_positions.end())
+            return false;
+        pos = it->second;
+        source.clear();
+        source.seekg(pos);
+        return EntryHeader::decode(source, entry_header).successful() &&
+               (not entry_header.framed || EntryFrames::measure(source, entry_header).successful()) &&
+               entry_header.attributes.get_type() == EntryType::Blob &&
+               entry_header.path == blob_id.to_path();
+    };
+
+    if (blobs_indexed && try_find())
+        return success;
+
+    index_blobs();
+    if (try_find())
+        return success;
+
+    SQUEEZE_ERROR("No blob found");
+    return "no blob found";
+}
+
+void Extracter::index_blobs()
+{
+    SQUEEZE_TRACE();
+
+    blob_positions.clear();
+    source.clear();
+    for (EntryScanner scanner(source); scanner.next();) {
+        if (scanner.get_header().attributes.get_type() != EntryType::Blob)
+            continue;
+        if (auto blob_id = BlobId::from_path(scanner.get_path()))
+            blob_positions[*blob_id] = scanner.get_pos();
+    }
+    blobs_indexed = true;
+}
+
+Stat Extracter::extract_symlink(const EntryHeader& entry_header, std::istream& input, std::string& target)
 {
     SQUEEZE_TRACE();
 
@@ -115,8 +425,8 @@ Stat Extracter::extract_symlink(const EntryHeader& entry_header, std::string& ta
         return "symlink entry with no content";
     }
     target.resize(static_cast<std::size_t>(entry_header.content_size) - 1);
-    source.read(target.data(), target.size());
-    if (utils::validate_stream_fail(source)) [[unlikely]] {
+    input.read(target.data(), target.size());
+    if (utils::validate_stream_fail(input)) [[unlikely]] {
         SQUEEZE_ERROR("Input read error");
         return "input read error";
     }
@@ -0,0 +1,71 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/misc/chunker.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+
+namespace squeeze::misc {
+
+namespace {
+
+/** Table of random values per byte, generated with splitmix64. */
+constexpr std::array<uint64_t, 256> gear = []()
+{
+    std::array<uint64_t, 256> table {};
+    uint64_t state = 0x5EED5EED5EED5EEDULL;
+    for (auto& val : table) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        val = z ^ (z >> 31);
+    }
+    return table;
+}();
+
+/** Make a mask of the given number of the most significant bits,
+ * as those of the gear hash depend on the most bytes. */
+constexpr uint64_t make_mask(unsigned nr_bits)
+{
+    return nr_bits == 0 ? 0 : ~uint64_t(0) << (64 - nr_bits);
+}
+
+}
+
+Chunker::Chunker(std::size_t avg_size)
+    :   avg_size(std::bit_ceil(std::max<std::size_t>(avg_size, 64)))
+{
+    min_size = this->avg_size / 4;
+    max_size = this->avg_size * 4;
+    const unsigned nr_bits = std::countr_zero(this->avg_size);
+    mask_s = make_mask(nr_bits + 2);
+    mask_l = make_mask(nr_bits - 2);
+}
+
+std::size_t Chunker::find_chunk_size(std::span<const char> data) const noexcept
+{
+    if (data.size() <= min_size)
+        return data.size();
+
+    const std::size_t limit = std::min(data.size(), max_size);
+    const std::size_t normal_limit = std::min(avg_size, limit);
+
+    uint64_t hash = 0;
+    std::size_t i = min_size;
+    for (; i < normal_limit; ++i) {
+        hash = (hash << 1) + gear[static_cast<unsigned char>(data[i])];
+        if ((hash & mask_s) == 0)
+            return i + 1;
+    }
+    for (; i < limit; ++i) {
+        hash = (hash << 1) + gear[static_cast<unsigned char>(data[i])];
+        if ((hash & mask_l) == 0)
+            return i + 1;
+    }
+    return limit;
+}
+
+}
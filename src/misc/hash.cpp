@@ -0,0 +1,111 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/misc/hash.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "squeeze/utils/endian.h"
+
+namespace squeeze::misc {
+
+namespace {
+
+inline uint64_t fmix64(uint64_t k)
+{
+    k ^= k >> 33;
+    k *= 0xFF51AFD7ED558CCDULL;
+    k ^= k >> 33;
+    k *= 0xC4CEB9FE1A85EC53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+inline uint64_t load64(const char *p)
+{
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return utils::from_endian_val<std::endian::little>(v);
+}
+
+constexpr uint64_t c1 = 0x87C37B91114253D5ULL;
+constexpr uint64_t c2 = 0x4CF5AD432745937FULL;
+
+}
+
+Murmur3Hasher::Murmur3Hasher(uint64_t seed) : h1(seed), h2(seed)
+{
+}
+
+void Murmur3Hasher::update(std::span<const char> data)
+{
+    length += data.size();
+
+    if (tail_size != 0) {
+        const std::size_t size = std::min(tail.size() - tail_size, data.size());
+        std::copy_n(data.begin(), size, tail.begin() + tail_size);
+        tail_size += size;
+        data = data.subspan(size);
+        if (tail_size < tail.size())
+            return;
+        process_block(tail.data());
+        tail_size = 0;
+    }
+
+    const std::size_t nr_blocks = data.size() / 16;
+    for (std::size_t i = 0; i < nr_blocks; ++i)
+        process_block(data.data() + i * 16);
+
+    tail_size = data.size() % 16;
+    std::copy_n(data.begin() + nr_blocks * 16, tail_size, tail.begin());
+}
+
+Hash128 Murmur3Hasher::digest() const
+{
+    uint64_t h1 = this->h1, h2 = this->h2;
+    const auto *tail = reinterpret_cast<const unsigned char *>(this->tail.data());
+    uint64_t k1 = 0, k2 = 0;
+
+    for (std::size_t i = tail_size; i > 8; --i)
+        k2 ^= uint64_t(tail[i - 1]) << ((i - 9) * 8);
+    if (tail_size > 8) {
+        k2 *= c2; k2 = std::rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    }
+
+    for (std::size_t i = std::min<std::size_t>(tail_size, 8); i > 0; --i)
+        k1 ^= uint64_t(tail[i - 1]) << ((i - 1) * 8);
+    if (tail_size > 0) {
+        k1 *= c1; k1 = std::rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    }
+
+    h1 ^= length; h2 ^= length;
+    h1 += h2; h2 += h1;
+    h1 = fmix64(h1); h2 = fmix64(h2);
+    h1 += h2; h2 += h1;
+
+    return {h1, h2};
+}
+
+inline void Murmur3Hasher::process_block(const char *block)
+{
+    uint64_t k1 = load64(block);
+    uint64_t k2 = load64(block + 8);
+
+    k1 *= c1; k1 = std::rotl(k1, 31); k1 *= c2; h1 ^= k1;
+    h1 = std::rotl(h1, 27); h1 += h2; h1 = h1 * 5 + 0x52DCE729;
+
+    k2 *= c2; k2 = std::rotl(k2, 33); k2 *= c1; h2 ^= k2;
+    h2 = std::rotl(h2, 31); h2 += h1; h2 = h2 * 5 + 0x38495AB5;
+}
+
+Hash128 murmur3_128(std::span<const char> data, uint64_t seed)
+{
+    Murmur3Hasher hasher(seed);
+    hasher.update(data);
+    return hasher.digest();
+}
+
+}
@@ -0,0 +1,62 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/misc/hashing_streambuf.h"
+
+#include <algorithm>
+#include <span>
+
+namespace squeeze::misc {
+
+HashingInputStreambuf::int_type HashingInputStreambuf::underflow()
+{
+    const std::streamsize read = read_source(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    setg(buffer.data(), buffer.data(), buffer.data() + read);
+    return read == 0 ? traits_type::eof() : traits_type::to_int_type(buffer.front());
+}
+
+std::streamsize HashingInputStreambuf::xsgetn(char_type *s, std::streamsize n)
+{
+    const std::streamsize buffered = std::min<std::streamsize>(n, egptr() - gptr());
+    std::copy(gptr(), gptr() + buffered, s);
+    gbump(static_cast<int>(buffered));
+    if (n - buffered < static_cast<std::streamsize>(buffer.size()))
+        return buffered + std::streambuf::xsgetn(s + buffered, n - buffered);
+
+    // the reads larger than the buffer go directly from the source
+    return buffered + read_source(s + buffered, n - buffered);
+}
+
+std::streamsize HashingInputStreambuf::read_source(char *s, std::streamsize n)
+{
+    source.read(s, n);
+    const std::streamsize read = source.gcount();
+    // the stream reading through the buffer gets its badbit set by the exception
+    if (source.bad()) [[unlikely]]
+        throw std::ios_base::failure("source read error");
+    source.clear();
+    hasher.update(std::span(s, static_cast<std::size_t>(read)));
+    read_size += read;
+    return read;
+}
+
+HashingOutputStreambuf::int_type HashingOutputStreambuf::overflow(int_type ch)
+{
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+    const char c = traits_type::to_char_type(ch);
+    return xsputn(&c, 1) == 1 ? ch : traits_type::eof();
+}
+
+std::streamsize HashingOutputStreambuf::xsputn(const char_type *s, std::streamsize n)
+{
+    target.write(s, n);
+    if (not target) [[unlikely]]
+        return 0;
+    hasher.update(std::span(s, static_cast<std::size_t>(n)));
+    written_size += n;
+    return n;
+}
+
+}
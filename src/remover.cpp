@@ -7,17 +7,20 @@
 #include "squeeze/logging.h"
 #include "squeeze/utils/io.h"
 
+#include <algorithm>
 #include <cassert>
 
 namespace squeeze {
 
 struct Remover::FutureRemove {
     mutable std::string path;
+    /** Path of the entry preceding the removed one, which the next entry gets front-coded against. */
+    mutable std::string previous_path;
     uint64_t pos, len;
     Stat *status;
 
-    FutureRemove(std::string&& path, uint64_t pos, uint64_t len, Stat *status)
-        : path(std::move(path)), pos(pos), len(len), status(status)
+    FutureRemove(std::string&& path, std::string&& previous_path, uint64_t pos, uint64_t len, Stat *status)
+        : path(std::move(path)), previous_path(std::move(previous_path)), pos(pos), len(len), status(status)
     {
     }
 };
@@ -32,7 +35,7 @@ inline bool Remover::FutureRemoveCompare::operator()(const FutureRemove& a, cons
 
 Remover::Remover(std::iostream& target) : target(target)
 {
-    future_removes.emplace(std::string(), EntryIterator::npos, EntryIterator::npos, nullptr);
+    future_removes.emplace(std::string(), std::string(), EntryIterator::npos, EntryIterator::npos, nullptr);
 }
 
 Remover::~Remover() = default;
@@ -40,7 +43,14 @@ Remover::~Remover() = default;
 void Remover::will_remove(const EntryIterator& it, Stat *stat)
 {
     SQUEEZE_TRACE("Will remove {}", it->second.path);
-    future_removes.emplace(std::string(it->second.path), it->first, it->second.get_encoded_full_size(), stat);
+    future_removes.emplace(std::string(it->second.path), std::string(it.get_previous_path()),
+                           it->first, it->second.get_encoded_full_size(), stat);
+    future_remove_positions.insert(it->first);
+}
+
+bool Remover::has_future_removes() const
+{
+    return future_removes.size() > 1;
 }
 
 Remover::Stat Remover::remove(const EntryIterator& it)
@@ -52,22 +62,33 @@ Remover::Stat Remover::remove(const EntryIterator& it)
 }
 
 bool Remover::perform_removes()
+{
+    target.seekp(0, std::ios_base::end);
+    return perform_removes(target.tellp());
+}
+
+bool Remover::perform_removes(const uint64_t initial_endp)
 {
     SQUEEZE_TRACE("Removing {} entries", future_removes.size() - 1);
+    future_remove_positions.clear();
+    moves.clear();
 
     // linear-time algorithm for removing multiple chunks of data from the stream at once
 
-    target.seekp(0, std::ios_base::end);
-    const uint64_t initial_endp = target.tellp();
     SQUEEZE_DEBUG("initial_endp={}", initial_endp);
 
     uint64_t gap_len = 0; // gap length: the increasing size of the gap that gets pushed to the right
+    // path of the last entry preceding the gap, which the entry following the gap gets front-coded against
+    std::string gap_previous_path;
+    bool gap_continued = false; // whether the current remove directly follows the previous one
 
     // future remove operations are stored in a priority queue based on their positions
 
     while (future_removes.size() > 1) {
         std::string path;
         future_removes.top().path.swap(path);
+        if (not gap_continued)
+            gap_previous_path.swap(future_removes.top().previous_path);
         uint64_t pos = future_removes.top().pos;
         uint64_t len = future_removes.top().len;
         Stat *stat = future_removes.top().status;
@@ -101,8 +122,16 @@ bool Remover::perform_removes()
         const uint64_t mov_pos = pos + len;
         // the length of the following non-gap data
         const uint64_t mov_len = std::min(next_pos, initial_endp) - mov_pos;
-        // pos - gap_len is the destination of the following non-gap data to move to
-        Stat s = utils::iosmove(target, pos - gap_len, mov_pos, mov_len); // do the move
+        // pos - gap_len is the destination of the following non-gap data to move to,
+        // the header at the beginning of which may need re-encoding, changing its size
+        uint64_t header_len = 0, new_header_len = 0;
+        Stat s = success;
+        if (mov_len != 0)
+            s = reencode_following_header(pos - gap_len, mov_pos, mov_len, path, gap_previous_path,
+                                          header_len, new_header_len);
+        if (s.successful())
+            s = utils::iosmove(target, pos - gap_len + new_header_len, mov_pos + header_len,
+                               mov_len - header_len); // do the move
 
         if (s.failed()) [[unlikely]] {
             SQUEEZE_ERROR("Failed performing removes starting from '{}'", path);
@@ -114,11 +143,14 @@ bool Remover::perform_removes()
 
             while (future_removes.size() > 1)
                 future_removes.pop();
+            moves.clear();
 
             return false;
         }
 
-        gap_len += len; // increase the gap size
+        moves.push_back({mov_pos, mov_pos + mov_len, gap_len + len, gap_len + len + header_len - new_header_len});
+        gap_len += len + header_len - new_header_len; // increase the gap size
+        gap_continued = next_pos == mov_pos;
     }
 
     assert(future_removes.size() == 1 && "The last element in the priority queue of future removes must remain after performing all the remove operations.");
@@ -126,4 +158,61 @@ bool Remover::perform_removes()
     return true;
 }
 
+EntryIterator Remover::get_first_future_remove() const
+{
+    if (future_removes.size() == 1)
+        return EntryIterator::end;
+    return EntryIterator(target, future_removes.top().pos, future_removes.top().previous_path);
+}
+
+uint64_t Remover::get_moved_pos(uint64_t pos) const
+{
+    auto it = std::upper_bound(moves.begin(), moves.end(), pos,
+                               [](uint64_t pos, const Move& move) { return pos < move.pos; });
+    // the data preceding the first removed entry stays in place
+    if (it == moves.begin())
+        return moves.empty() || pos < moves.front().pos - moves.front().header_distance ? pos : EntryIterator::npos;
+    --it;
+    if (pos >= it->end)
+        return EntryIterator::npos;
+    return pos - (pos == it->pos ? it->header_distance : it->distance);
+}
+
+Remover::Stat Remover::reencode_following_header(uint64_t dst_pos, uint64_t src_pos, uint64_t len,
+        std::string_view removed_path, std::string_view previous_path,
+        uint64_t& header_len, uint64_t& new_header_len)
+{
+    header_len = new_header_len = 0;
+
+    EntryHeader entry_header;
+    target.seekg(src_pos);
+    if (EntryHeader::decode(target, entry_header, removed_path).failed()) {
+        // not an entry, e.g. a trailing garbage, so just moved as is
+        target.clear();
+        return success;
+    }
+    if (not entry_header.compact || entry_header.path_prefix_size == 0)
+        return success;
+
+    const uint64_t prefix_size = EntryHeader::get_shared_path_prefix_size(previous_path, entry_header.path);
+    if (prefix_size == entry_header.path_prefix_size)
+        return success;
+
+    SQUEEZE_TRACE("Re-encoding the header of {}", entry_header.path);
+    const uint64_t encoded_len = entry_header.get_encoded_header_size();
+    entry_header.path_prefix_size = prefix_size;
+    const uint64_t new_encoded_len = entry_header.get_encoded_header_size();
+    // the path characters dropped from the prefix are found in the removed headers, so it must fit
+    if (encoded_len > len || dst_pos + new_encoded_len > src_pos + encoded_len) [[unlikely]]
+        return "no room for re-encoding the header of the entry following the removed one";
+
+    target.seekp(dst_pos);
+    Stat s = EntryHeader::encode(target, entry_header);
+    if (s.failed()) [[unlikely]]
+        return {"failed re-encoding the header of the entry following the removed one", std::move(s)};
+    header_len = encoded_len;
+    new_header_len = new_encoded_len;
+    return success;
+}
+
 }
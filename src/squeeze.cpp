@@ -4,9 +4,13 @@
 
 #include "squeeze/squeeze.h"
 
+#include <algorithm>
+#include <sstream>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "squeeze/logging.h"
+#include "squeeze/utils/io.h"
 
 namespace squeeze {
 
@@ -19,20 +23,350 @@ bool Squeeze::update()
 
     std::unordered_multimap<std::string_view, FutureAppend *> appendee_path_map;
     appendee_path_map.reserve(future_appends.size());
+    std::vector<std::pair<FutureAppend *, EntryIterator>> delta_updates;
 
     for (auto& future_append : future_appends)
         appendee_path_map.emplace(future_append.entry_input.get_path(), &future_append);
 
-    for (auto it = this->begin(); it != this->end() && !appendee_path_map.empty(); ++it) {
+    // the existing blobs are looked for only if the appended contents may refer to them
+    const bool finds_blobs = not future_appends.empty() && params.stores_blobs();
+    for (auto it = this->begin(); it != this->end() && (!appendee_path_map.empty() || finds_blobs); ++it) {
         auto& entry_header = it->second;
+        if (entry_header.attributes.get_type() == EntryType::Blob) {
+            auto blob_id = BlobId::from_path(entry_header.path);
+            if (blob_id && not will_be_removed(it->first))
+                known_blob_ids.insert(*blob_id);
+            continue;
+        }
+
         auto node = appendee_path_map.extract(entry_header.path);
         if (node.empty())
             continue;
+        // the entries referring to blobs would get out of the blobs shared with the rest if delta encoded
+        const auto layout = entry_header.content_layout;
+        if (params.delta.enabled && entry_header.attributes.get_type() == EntryType::RegularFile &&
+                (layout == EntryContentLayout::Plain || layout == EntryContentLayout::Delta))
+            delta_updates.emplace_back(node.mapped(), it);
         will_remove(it, node.mapped()->status);
         SQUEEZE_INFO("Will update {}", it->second.path);
     }
 
-    return this->write();
+    bool succeeded = perform_delta_updates(delta_updates);
+    return this->write() && succeeded;
+}
+
+bool Squeeze::perform_delta_updates(std::span<const std::pair<FutureAppend *, EntryIterator>> delta_updates)
+{
+    if (delta_updates.empty())
+        return true;
+
+    SQUEEZE_TRACE();
+
+    // the delta updates are appended one by one ahead of the rest, while the previous contents are still
+    // in place, so that each base is loaded only right before its entry append and released right after
+    const auto all_appends = std::move(future_appends);
+    auto owned_entry_inputs = std::move(this->owned_entry_inputs);
+    const auto known_blob_ids = this->known_blob_ids;
+
+    bool succeeded = true;
+    for (const auto& [future_append, it] : delta_updates) {
+        DeltaBase base;
+        StatStr s = load_delta_base(it, base);
+        Extracter::source.clear();
+        if (s.successful()) {
+            delta_bases.emplace(&future_append->entry_input, std::move(base));
+        } else {
+            SQUEEZE_WARN("Failed loading the base of {}, not delta encoding it: {}",
+                         it->second.path, stringify(s));
+        }
+
+        future_appends.clear();
+        future_appends.push_back(*future_append);
+        this->known_blob_ids = known_blob_ids;
+        // the loading may have moved the put pointer along with the get pointer
+        Appender::target.clear();
+        Appender::target.seekp(0, std::ios_base::end);
+        succeeded = perform_appends() && succeeded;
+    }
+
+    future_appends.clear();
+    for (const auto& future_append : all_appends) {
+        if (std::none_of(delta_updates.begin(), delta_updates.end(),
+                [&future_append](const auto& delta_update) { return delta_update.first == &future_append; }))
+            future_appends.push_back(future_append);
+    }
+    this->owned_entry_inputs = std::move(owned_entry_inputs);
+    this->known_blob_ids = known_blob_ids;
+    // the appended bases may duplicate the existing blobs
+    blobs_may_be_unreferred = true;
+    return succeeded;
+}
+
+bool Squeeze::write()
+{
+    SQUEEZE_TRACE();
+
+    if (not future_appends.empty() && params.stores_blobs())
+        blobs_may_be_unreferred = true;
+    uint64_t end_pos = EntryIterator::npos;
+    bool succeeded = prepare_duplicates(end_pos);
+    succeeded = Writer::write() && succeeded;
+    succeeded = update_duplicates() && succeeded;
+    // the blobs are collected after the appends as the new entries may refer to the existing ones
+    return remove_unreferred_blobs() && succeeded;
+}
+
+void Squeeze::will_remove(const EntryIterator& it, Remover::Stat *err)
+{
+    const auto layout = it->second.content_layout;
+    if (layout == EntryContentLayout::References || layout == EntryContentLayout::Delta)
+        blobs_may_be_unreferred = true;
+    Remover::will_remove(it, err);
+}
+
+Remover::Stat Squeeze::remove(const EntryIterator& it)
+{
+    Remover::Stat stat;
+    will_remove(it, &stat);
+    perform_removes();
+    return stat;
+}
+
+bool Squeeze::perform_removes()
+{
+    SQUEEZE_TRACE();
+
+    uint64_t end_pos = EntryIterator::npos;
+    bool succeeded = prepare_duplicates(end_pos);
+    succeeded = Remover::perform_removes() && succeeded;
+    succeeded = update_duplicates() && succeeded;
+    return remove_unreferred_blobs() && succeeded;
+}
+
+StatStr Squeeze::load_delta_base(const EntryIterator& it, DeltaBase& base)
+{
+    SQUEEZE_TRACE();
+
+    auto& [pos, entry_header] = *it;
+    StatStr s = success;
+    if (entry_header.content_layout == EntryContentLayout::Delta) {
+        std::vector<EntryReference> references;
+        uint64_t blob_pos;
+        EntryHeader blob_header;
+        if (not (s = read_references(it, references)) ||
+            not (s = find_blob(references.front().blob_id, blob_pos, blob_header))) [[unlikely]]
+            return s;
+
+        // the deltas grow as the content drifts away from the base, so at some point it's rebased
+        if (entry_header.content_size * 100 <= blob_header.content_size * params.delta.max_delta_percent) {
+            std::string_view blob;
+            if (not (s = load_blob(references.front().blob_id, blob))) [[unlikely]]
+                return s;
+            base.blob_id = references.front().blob_id;
+            base.content = blob;
+            return success;
+        }
+        SQUEEZE_DEBUG("Rebasing {}", entry_header.path);
+    }
+
+    if (can_preallocate(entry_header)) {
+        base.content.resize(entry_header.original_size);
+        utils::SpanOutputStreambuf streambuf(base.content);
+        std::ostream content(&streambuf);
+        if (not (s = extract(it, content))) [[unlikely]]
+            return s;
+        if (streambuf.get_written_size() != base.content.size()) [[unlikely]]
+            return "content size mismatch";
+    } else {
+        std::ostringstream content;
+        if (not (s = extract(it, content))) [[unlikely]]
+            return s;
+        base.content = std::move(content).str();
+        if (entry_header.has_original_size() && base.content.size() != entry_header.original_size) [[unlikely]]
+            return "content size mismatch";
+    }
+    base.blob_id = BlobId::of(base.content);
+    base.content_id = base.blob_id;
+    base.compression = entry_header.compression;
+
+    if (entry_header.content_layout == EntryContentLayout::Plain && not entry_header.framed) {
+        // the encoded content gets reused as the blob content as is, instead of being encoded again
+        base.encoded.resize(entry_header.content_size);
+        Extracter::source.seekg(pos + entry_header.get_encoded_header_size());
+        Extracter::source.read(base.encoded.data(), base.encoded.size());
+        if (utils::validate_stream_fail(Extracter::source)) [[unlikely]]
+            return "input read error";
+    }
+    return success;
+}
+
+bool Squeeze::remove_unreferred_blobs()
+{
+    SQUEEZE_TRACE();
+
+    if (not blobs_may_be_unreferred)
+        return true;
+    blobs_may_be_unreferred = false;
+
+    // the stream may still hold stale data past the new end left by the previous removes
+    uint64_t end_pos = Remover::target.tellp();
+
+    std::vector<EntryIterator> blob_its;
+    std::unordered_set<BlobId, BlobId::Hasher> referred_blob_ids;
+    std::vector<EntryReference> references;
+
+    for (auto it = this->begin(); it != this->end() && it->first < end_pos; ++it) {
+        auto& entry_header = it->second;
+        if (entry_header.attributes.get_type() == EntryType::Blob) {
+            blob_its.push_back(it);
+            continue;
+        }
+        // the duplicates refer to the contents of other entries rather than to blobs
+        if (entry_header.content_layout == EntryContentLayout::Plain ||
+            entry_header.content_layout == EntryContentLayout::Duplicate)
+            continue;
+
+        // keep the blobs if any references are unreadable, as there's no telling which are referred to
+        if (read_references(it, references).failed()) [[unlikely]] {
+            SQUEEZE_WARN("Failed reading references of {}, not removing any blob", entry_header.path);
+            return false;
+        }
+        for (const auto& reference : references)
+            referred_blob_ids.insert(reference.blob_id);
+    }
+
+    bool any_removes = false;
+    for (const auto& blob_it : blob_its) {
+        auto blob_id = BlobId::from_path(blob_it->second.path);
+        // a blob is kept only once, as its duplicates hold the same content
+        if (blob_id && referred_blob_ids.erase(*blob_id))
+            continue;
+        SQUEEZE_INFO("Will remove unreferred or duplicate blob {}", blob_it->second.path);
+        will_remove(blob_it);
+        any_removes = true;
+    }
+
+    if (not any_removes) {
+        Remover::target.seekp(end_pos);
+        return true;
+    }
+    // the blobs aren't referred to by the duplicates, but the contents following them get moved
+    bool succeeded = prepare_duplicates(end_pos);
+    succeeded = Remover::perform_removes(end_pos) && succeeded;
+    return update_duplicates() && succeeded;
+}
+
+bool Squeeze::prepare_duplicates(uint64_t& end_pos)
+{
+    moved_duplicates.clear();
+    if (not has_future_removes())
+        return true;
+
+    SQUEEZE_TRACE();
+
+    if (end_pos == EntryIterator::npos) {
+        Remover::target.seekp(0, std::ios_base::end);
+        end_pos = Remover::target.tellp();
+    }
+    const uint64_t initial_end_pos = end_pos;
+
+    // contents of the removed entries, and the contents taken over from them by their positions
+    std::unordered_set<uint64_t> removed_contents;
+    std::unordered_map<uint64_t, uint64_t> taken_over_contents;
+    std::vector<EntryReference> references;
+
+    auto it = get_first_future_remove();
+    const uint64_t first_pos = it->first;
+    for (; it != EntryIterator::end && it->first < initial_end_pos; ++it) {
+        auto& [pos, entry_header] = *it;
+        const uint64_t content_pos = pos + entry_header.get_encoded_header_size();
+        if (will_be_removed(pos)) {
+            removed_contents.insert(content_pos);
+            continue;
+        }
+        if (entry_header.content_layout != EntryContentLayout::Duplicate)
+            continue;
+
+        if (read_references(it, references).failed()) [[unlikely]] {
+            SQUEEZE_ERROR("Failed reading the reference of {}", entry_header.path);
+            return false;
+        }
+        EntryReference& reference = references.front();
+        if (reference.offset < first_pos)
+            continue;
+
+        if (removed_contents.contains(reference.offset)) {
+            auto [taken_over, inserted] = taken_over_contents.try_emplace(reference.offset);
+            if (not inserted) {
+                reference.offset = taken_over->second;
+            } else {
+                SQUEEZE_DEBUG("Taking over the content referred to by {}", entry_header.path);
+                EntryHeader plain_header = entry_header;
+                plain_header.content_layout = EntryContentLayout::Plain;
+                plain_header.content_size = reference.size;
+                plain_header.compact = false;
+                plain_header.path_prefix_size = 0;
+                taken_over->second = end_pos + plain_header.get_encoded_header_size();
+
+                Remover::target.seekp(end_pos);
+                Remover::Stat s = EntryHeader::encode(Remover::target, plain_header);
+                if (s.successful())
+                    s = utils::iosmove(Remover::target, taken_over->second, reference.offset, reference.size);
+                if (s.failed()) [[unlikely]] {
+                    SQUEEZE_ERROR("Failed taking over the content referred to by {}: {}",
+                                  entry_header.path, stringify(s));
+                    Remover::target.clear();
+                    Remover::target.seekp(end_pos);
+                    return false;
+                }
+                end_pos = taken_over->second + reference.size;
+                will_remove(it);
+                continue;
+            }
+        }
+        moved_duplicates.push_back({content_pos, reference});
+    }
+    Extracter::source.clear();
+    return true;
+}
+
+bool Squeeze::update_duplicates()
+{
+    if (moved_duplicates.empty())
+        return true;
+
+    SQUEEZE_TRACE();
+
+    // the removes leave no moves only if they failed, in which case there's no telling where the contents are
+    if (moves.empty()) [[unlikely]] {
+        SQUEEZE_ERROR("The removes failed, not updating the duplicates");
+        moved_duplicates.clear();
+        return false;
+    }
+
+    const std::streampos end_pos = Remover::target.tellp();
+    bool succeeded = true;
+    for (auto& [pos, reference] : moved_duplicates) {
+        const uint64_t moved_pos = get_moved_pos(pos);
+        reference.offset = get_moved_pos(reference.offset);
+        if (moved_pos == EntryIterator::npos || reference.offset == EntryIterator::npos) [[unlikely]] {
+            SQUEEZE_ERROR("Duplicate at {} or its content removed", pos);
+            succeeded = false;
+            continue;
+        }
+
+        Buffer encoded;
+        EntryReference::encode(encoded, reference);
+        Remover::target.seekp(moved_pos);
+        Remover::target.write(encoded.data(), encoded.size());
+        if (utils::validate_stream_fail_eof(Remover::target)) [[unlikely]] {
+            SQUEEZE_ERROR("Failed updating the duplicate at {}", pos);
+            succeeded = false;
+        }
+    }
+    moved_duplicates.clear();
+    Remover::target.seekp(end_pos);
+    return succeeded;
 }
 
 }
@@ -0,0 +1,112 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/stats.h"
+
+#include <atomic>
+
+namespace squeeze {
+
+#ifdef SQUEEZE_USE_STATS
+
+namespace {
+
+enum Counter {
+    NrCalls,
+    BytesIn,
+    BytesOut,
+    Nanoseconds,
+    nr_counters,
+};
+
+/** Counters of the threads assigned to the shard, each shard on its own cache lines,
+ * so that the threads don't contend for them as long as there are enough shards. */
+struct alignas(64) Shard {
+    std::array<std::array<std::atomic_uint64_t, nr_counters>, nr_stats_stages> counters {};
+};
+
+constexpr std::size_t nr_shards = 64;
+
+std::array<Shard, nr_shards> shards;
+std::atomic_size_t next_shard = 0;
+
+inline Shard& get_thread_shard() noexcept
+{
+    thread_local Shard& shard = shards[next_shard.fetch_add(1, std::memory_order::relaxed) % nr_shards];
+    return shard;
+}
+
+}
+
+namespace stats {
+
+void record(StatsStage stage, uint64_t bytes_in, uint64_t bytes_out, uint64_t nanoseconds) noexcept
+{
+    auto& counters = get_thread_shard().counters[static_cast<std::size_t>(stage)];
+    counters[NrCalls].fetch_add(1, std::memory_order::relaxed);
+    counters[BytesIn].fetch_add(bytes_in, std::memory_order::relaxed);
+    counters[BytesOut].fetch_add(bytes_out, std::memory_order::relaxed);
+    counters[Nanoseconds].fetch_add(nanoseconds, std::memory_order::relaxed);
+}
+
+}
+
+Stats get_stats()
+{
+    Stats stats;
+    for (const Shard& shard : shards) {
+        for (std::size_t i = 0; i < nr_stats_stages; ++i) {
+            const auto& counters = shard.counters[i];
+            StageStats& stage = stats.stages[i];
+            stage.nr_calls += counters[NrCalls].load(std::memory_order::relaxed);
+            stage.bytes_in += counters[BytesIn].load(std::memory_order::relaxed);
+            stage.bytes_out += counters[BytesOut].load(std::memory_order::relaxed);
+            stage.nanoseconds += counters[Nanoseconds].load(std::memory_order::relaxed);
+        }
+    }
+    return stats;
+}
+
+void reset_stats()
+{
+    for (Shard& shard : shards)
+        for (auto& counters : shard.counters)
+            for (auto& counter : counters)
+                counter.store(0, std::memory_order::relaxed);
+}
+
+#else
+
+Stats get_stats()
+{
+    return {};
+}
+
+void reset_stats()
+{
+}
+
+#endif /** SQUEEZE_USE_STATS */
+
+template<> void print_to(std::ostream& os, const StatsStage& stage)
+{
+    switch (stage) {
+    case StatsStage::FileRead:
+        return print_to(os, "file read");
+    case StatsStage::LZ77Encode:
+        return print_to(os, "LZ77 encode");
+    case StatsStage::HuffmanEncode:
+        return print_to(os, "Huffman encode");
+    case StatsStage::AppendWait:
+        return print_to(os, "append wait");
+    case StatsStage::AppendWrite:
+        return print_to(os, "append write");
+    case StatsStage::Decode:
+        return print_to(os, "decode");
+    default:
+        return print_to(os, "[unknown]");
+    }
+}
+
+}
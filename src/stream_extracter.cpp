@@ -0,0 +1,236 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/stream_extracter.h"
+
+#include <iterator>
+#include <limits>
+
+#include "squeeze/logging.h"
+#include "squeeze/decode.h"
+
+namespace squeeze {
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::StreamExtracter::"
+
+using Stat = StreamExtracter::Stat;
+
+namespace {
+
+/** The encoded contents are kept by their positions and sizes, which is what the duplicate entries refer by,
+ * the hash of the decoded content being verified once decoded. */
+inline BlobId get_content_key(uint64_t pos, uint64_t size) noexcept
+{
+    return BlobId{{pos, size}};
+}
+
+}
+
+// the extracter only keeps the reference to the forward source, which gets constructed right after it
+StreamExtracter::StreamExtracter(std::istream& source)
+    : Extracter(forward_source), forward_streambuf(source), forward_source(&forward_streambuf),
+      original_source(source)
+{
+}
+
+bool StreamExtracter::next()
+{
+    if (corrupted || (started && pos == npos))
+        return false;
+    if (started && not skip_content()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed skipping the entry content");
+        corrupted = true;
+        pos = npos;
+        return false;
+    }
+    started = true;
+    pos = npos;
+    content_read = false;
+    framed_streambuf.reset();
+    read_ahead.reset();
+    content_kept = false;
+
+    forward_source.clear();
+    const uint64_t header_pos = forward_source.tellg();
+    if (std::istream::traits_type::eq_int_type(forward_source.peek(), std::istream::traits_type::eof())) {
+        corrupted = original_source.bad();
+        return false;
+    }
+
+    // the path of the previous entry is the context of the front-coded path of a compact header
+    previous_path.swap(entry_header.path);
+    Stat s = EntryHeader::decode(forward_source, entry_header, previous_path);
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed decoding the entry header: {}", s.report());
+        corrupted = true;
+        return false;
+    }
+    pos = header_pos;
+    SQUEEZE_TRACE("Read entry_header = {}", stringify(entry_header));
+
+    if (entry_header.framed) {
+        framed_streambuf.emplace(forward_source, pos + entry_header.get_encoded_header_size());
+        entry_header.content_size = unknown_size;
+        if ((s = read_ahead_content()).failed()) [[unlikely]] {
+            SQUEEZE_ERROR("Failed reading the framed content: {}", s.report());
+            corrupted = true;
+            pos = npos;
+            return false;
+        }
+    }
+
+    // the blobs are kept for the entries referring to them, which follow them
+    if (entry_header.attributes.get_type() == EntryType::Blob) {
+        if (auto blob_id = BlobId::from_path(entry_header.path)) {
+            content_read = true;
+            std::istream input(get_content_streambuf());
+            std::string blob;
+            if ((s = decode_blob(entry_header, input, blob)).failed()) [[unlikely]] {
+                SQUEEZE_ERROR("Failed decoding the blob: {}", s.report());
+                corrupted = true;
+                pos = npos;
+                return false;
+            }
+            blob_cache.insert(*blob_id, std::move(blob));
+            passed_blob_ids.insert(*blob_id);
+        }
+    } else if (can_be_referred()) {
+        // so are the plain contents, for the duplicate entries referring to them, see EntryContentLayout::Duplicate
+        if ((s = read_referable_content()).failed()) [[unlikely]] {
+            SQUEEZE_ERROR("Failed reading the content: {}", s.report());
+            corrupted = true;
+            pos = npos;
+            return false;
+        }
+    }
+    return true;
+}
+
+Stat StreamExtracter::extract()
+{
+    FileEntryOutput entry_output;
+    return extract(entry_output);
+}
+
+Stat StreamExtracter::extract(std::ostream& output)
+{
+    CustomStreamEntryOutput entry_output(output);
+    return extract(entry_output);
+}
+
+Stat StreamExtracter::extract(EntryOutput& entry_output)
+{
+    if (pos == npos) [[unlikely]]
+        return "no entry to extract";
+    // the blobs aren't extracted on their own, so their content having been read doesn't matter
+    if (content_read && entry_header.attributes.get_type() != EntryType::Blob) [[unlikely]]
+        return "the entry content has already been read";
+
+    SQUEEZE_INFO("Extracting {}", entry_header.path);
+
+    content_read = true;
+    std::istream input(get_content_streambuf());
+    return extract_entry(entry_header, input, entry_output);
+}
+
+Stat StreamExtracter::decode_referred_content(const EntryReference& reference, const CompressionParams& compression,
+                                              std::ostream& output)
+{
+    const std::string *content = content_cache.find(get_content_key(reference.offset, reference.size));
+    if (content == nullptr) [[unlikely]] {
+        SQUEEZE_ERROR("No referred content kept");
+        return "the referred content hasn't been kept, the blob cache capacity may be too small";
+    }
+    utils::SpanInputStreambuf content_streambuf(*content);
+    std::istream input(&content_streambuf);
+    return decode(output, reference.size, input, compression);
+}
+
+Stat StreamExtracter::load_blob(const BlobId& blob_id, std::string_view& blob)
+{
+    const std::string *cached_blob = blob_cache.find(blob_id);
+    if (cached_blob == nullptr) [[unlikely]] {
+        if (passed_blob_ids.contains(blob_id)) {
+            SQUEEZE_ERROR("Blob evicted");
+            return "the blob has been evicted from the blob cache, its capacity is too small";
+        }
+        SQUEEZE_ERROR("No blob found");
+        return "no blob found";
+    }
+    blob = *cached_blob;
+    return success;
+}
+
+std::streambuf *StreamExtracter::get_content_streambuf()
+{
+    if (read_ahead || content_kept)
+        return &read_ahead_streambuf;
+    if (framed_streambuf)
+        return &*framed_streambuf;
+    return &forward_streambuf;
+}
+
+Stat StreamExtracter::read_ahead_content()
+{
+    // these contents are read whole anyway, and their sizes are needed for decoding them
+    const EntryType type = entry_header.attributes.get_type();
+    if (type != EntryType::Symlink && type != EntryType::Blob &&
+        entry_header.content_layout != EntryContentLayout::References)
+        return success;
+
+    std::istream content(&*framed_streambuf);
+    read_ahead.emplace(std::istreambuf_iterator<char>(content), std::istreambuf_iterator<char>());
+    if (not read_frames_trailer()) [[unlikely]]
+        return "invalid frames";
+    entry_header.content_size = read_ahead->size();
+    read_ahead_streambuf.reset(*read_ahead);
+    return success;
+}
+
+bool StreamExtracter::can_be_referred() const noexcept
+{
+    return not entry_header.framed && entry_header.attributes.get_type() == EntryType::RegularFile &&
+           entry_header.content_layout == EntryContentLayout::Plain && entry_header.content_size != 0 &&
+           entry_header.content_size <= content_cache.get_capacity();
+}
+
+Stat StreamExtracter::read_referable_content()
+{
+    std::string content(entry_header.content_size, '\0');
+    forward_source.read(content.data(), static_cast<std::streamsize>(content.size()));
+    if (utils::validate_stream_fail_eof(forward_source)) [[unlikely]]
+        return "failed reading the content";
+    const uint64_t content_pos = pos + entry_header.get_encoded_header_size();
+    const std::string& kept_content = content_cache.insert(get_content_key(content_pos, content.size()),
+                                                           std::move(content));
+    read_ahead_streambuf.reset(kept_content);
+    content_kept = true;
+    return success;
+}
+
+bool StreamExtracter::skip_content()
+{
+    if (not entry_header.framed) {
+        forward_source.clear();
+        forward_source.seekg(pos + entry_header.get_encoded_full_size());
+        return not utils::validate_stream_fail(forward_source);
+    }
+    if (read_ahead)
+        return true;
+
+    std::istream content(&*framed_streambuf);
+    content.ignore(std::numeric_limits<std::streamsize>::max());
+    return read_frames_trailer();
+}
+
+bool StreamExtracter::read_frames_trailer()
+{
+    uint64_t content_size = 0;
+    forward_source.clear();
+    return EntryFrames::read_content_size(forward_source, content_size) &&
+           content_size == framed_streambuf->get_read_size();
+}
+
+}
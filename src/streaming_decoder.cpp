@@ -0,0 +1,178 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/streaming_decoder.h"
+
+#include "squeeze/logging.h"
+#include "squeeze/stats.h"
+#include "squeeze/compression/compression.h"
+#include "squeeze/utils/io.h"
+
+namespace squeeze {
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::StreamingDecoder::"
+
+using Stat = StreamingDecoder::Stat;
+
+namespace {
+
+/** The data not compressed is passed right through, so it isn't decoded by blocks. */
+std::size_t get_streaming_block_size(const CompressionParams& compression)
+{
+    return compression.method == compression::CompressionMethod::None ?
+        0 : compression::get_block_size(compression);
+}
+
+}
+
+StreamingDecoder::StreamingDecoder(const CompressionParams& compression)
+    : compression(compression), block_size(get_streaming_block_size(compression)), block(block_size)
+{
+}
+
+Stat StreamingDecoder::feed(std::span<const char> data, Buffer& output)
+{
+    if (finished) [[unlikely]]
+        return "the decoding has been finished";
+    if (failed) [[unlikely]]
+        return "the decoding has failed earlier";
+
+    input_size += data.size();
+    if (block_size == 0) {
+        output.insert(output.end(), data.begin(), data.end());
+        output_size += data.size();
+        return success;
+    }
+
+    pending.insert(pending.end(), data.begin(), data.end());
+    return decode_pending(output, false);
+}
+
+Stat StreamingDecoder::finish(Buffer& output)
+{
+    if (finished) [[unlikely]]
+        return "the decoding has been finished";
+    if (failed) [[unlikely]]
+        return "the decoding has failed earlier";
+    finished = true;
+    return decode_pending(output, true);
+}
+
+Stat StreamingDecoder::decode_pending(Buffer& output, bool final)
+{
+    using namespace compression;
+    using CompressionFlags::ExpectFinalBlock;
+
+    while (pending_pos < pending.size() && (final || pending.size() - pending_pos >= retry_size)) {
+        const char *in_begin = pending.data() + pending_pos, *in_end = pending.data() + pending.size();
+        auto bit_decoder = misc::make_bit_decoder(in_begin, in_end);
+        const stats::StageTimer timer;
+        auto [out_it, result] = Decompressor(bit_decoder)
+            .decompress(block.begin(), block.end(), compression, ExpectFinalBlock);
+        const std::size_t consumed = bit_decoder.get_it() - in_begin;
+
+        if (result.status.failed()) {
+            // running out of the input means the block hasn't fully arrived yet
+            if (not final && bit_decoder.get_it() == in_end) {
+                retry_size = consumed + consumed / 2 + 1;
+                break;
+            }
+            SQUEEZE_ERROR("Failed decoding block");
+            failed = true;
+            return {"failed decoding block", std::move(result.status)};
+        }
+
+        timer.record(StatsStage::Decode, consumed, std::distance(block.begin(), out_it));
+        output.insert(output.end(), block.begin(), out_it);
+        output_size += std::distance(block.begin(), out_it);
+        pending_pos += consumed;
+        retry_size = 0;
+    }
+
+    // the decoded data is dropped once it takes the most of the pending buffer, keeping the moves amortized
+    if (pending_pos == pending.size()) {
+        pending.clear();
+        pending_pos = 0;
+    } else if (pending_pos > pending.size() / 2) {
+        pending.erase(pending.begin(), pending.begin() + pending_pos);
+        pending_pos = 0;
+    }
+    return success;
+}
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::DecoderStreambuf::"
+
+DecoderStreambuf::DecoderStreambuf(std::ostream& output, const CompressionParams& compression,
+                                   std::size_t buffer_size)
+    : output(output), decoder(compression), buffer(buffer_size)
+{
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+DecoderStreambuf::~DecoderStreambuf()
+{
+    push();
+}
+
+Stat DecoderStreambuf::finish()
+{
+    if (not push()) [[unlikely]]
+        return "failed pushing the data to the decoder";
+    Stat s = decoder.finish(decoded);
+    if (s.failed()) [[unlikely]]
+        return s;
+
+    output.write(decoded.data(), static_cast<std::streamsize>(decoded.size()));
+    decoded.clear();
+    if (utils::validate_stream_fail_eof(output)) [[unlikely]] {
+        SQUEEZE_ERROR("Output write error");
+        return "output write error";
+    }
+    return success;
+}
+
+int DecoderStreambuf::sync()
+{
+    if (not push()) [[unlikely]]
+        return -1;
+    output.flush();
+    return utils::validate_stream_fail_eof(output) ? -1 : 0;
+}
+
+DecoderStreambuf::int_type DecoderStreambuf::overflow(int_type ch)
+{
+    if (not push()) [[unlikely]]
+        return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize DecoderStreambuf::xsputn(const char_type *s, std::streamsize n)
+{
+    if (n <= epptr() - pptr())
+        return std::streambuf::xsputn(s, n);
+    // the data larger than the rest of the put area is pushed right through
+    return push(std::span(s, static_cast<std::size_t>(n))) ? n : 0;
+}
+
+bool DecoderStreambuf::push(std::span<const char> data)
+{
+    const std::size_t size = pptr() - pbase();
+    setp(buffer.data(), buffer.data() + buffer.size());
+    if (size != 0 && decoder.feed(std::span(buffer.data(), size), decoded).failed()) [[unlikely]]
+        return false;
+    if (not data.empty() && decoder.feed(data, decoded).failed()) [[unlikely]]
+        return false;
+
+    output.write(decoded.data(), static_cast<std::streamsize>(decoded.size()));
+    decoded.clear();
+    return not utils::validate_stream_fail_eof(output);
+}
+
+}
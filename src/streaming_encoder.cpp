@@ -0,0 +1,238 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/streaming_encoder.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+#include "squeeze/logging.h"
+#include "squeeze/compression/config.h"
+#include "squeeze/misc/cpu_info.h"
+#include "squeeze/utils/io.h"
+
+namespace squeeze {
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::StreamingEncoder::"
+
+using Stat = StreamingEncoder::Stat;
+
+namespace {
+
+/** The data not to be compressed is written right through, so it isn't gathered into blocks. */
+std::size_t get_streaming_block_size(const CompressionParams& compression)
+{
+    return compression.method == compression::CompressionMethod::None ?
+        0 : compression::get_block_size(compression);
+}
+
+}
+
+StreamingEncoder::StreamingEncoder(std::ostream& output, const CompressionParams& compression)
+    :
+        output(output), compression(compression), encoder_pool(own_encoder_pool.emplace()),
+        block_size(get_streaming_block_size(compression)),
+        max_pending_blocks(max_pending_blocks_per_thread *
+                           std::max<std::size_t>(misc::get_nr_available_cpu_cores(), 1))
+{
+    block.reserve(block_size);
+}
+
+StreamingEncoder::StreamingEncoder(std::ostream& output, const CompressionParams& compression,
+                                   EncoderPool& encoder_pool)
+    :
+        output(output), compression(compression), encoder_pool(encoder_pool),
+        block_size(get_streaming_block_size(compression)),
+        max_pending_blocks(max_pending_blocks_per_thread *
+                           std::max<std::size_t>(misc::get_nr_available_cpu_cores(), 1))
+{
+    block.reserve(block_size);
+}
+
+StreamingEncoder::~StreamingEncoder()
+{
+    if (not finished)
+        finish();
+}
+
+Stat StreamingEncoder::write(std::span<const char> data)
+{
+    if (finished) [[unlikely]]
+        return "the encoding has been finished";
+    if (failed) [[unlikely]]
+        return "the encoding has failed earlier";
+
+    input_size += data.size();
+    if (block_size == 0) {
+        output.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (utils::validate_stream_fail_eof(output)) [[unlikely]] {
+            SQUEEZE_ERROR("Output write error");
+            failed = true;
+            return "output write error";
+        }
+        output_size += data.size();
+        return success;
+    }
+
+    while (not data.empty()) {
+        const std::size_t size = std::min(data.size(), block_size - block.size());
+        block.insert(block.end(), data.begin(), data.begin() + size);
+        data = data.subspan(size);
+        if (block.size() == block_size) {
+            Stat s = schedule_block();
+            if (s.failed()) [[unlikely]]
+                return s;
+        }
+    }
+    return success;
+}
+
+Stat StreamingEncoder::flush()
+{
+    if (finished) [[unlikely]]
+        return "the encoding has been finished";
+    if (not block.empty()) {
+        Stat s = schedule_block();
+        if (s.failed()) [[unlikely]]
+            return s;
+    }
+    Stat s = write_out(true);
+    if (s.failed()) [[unlikely]]
+        return s;
+
+    output.flush();
+    if (utils::validate_stream_fail_eof(output)) [[unlikely]] {
+        SQUEEZE_ERROR("Output flush error");
+        failed = true;
+        return "output flush error";
+    }
+    return success;
+}
+
+Stat StreamingEncoder::finish()
+{
+    if (finished) [[unlikely]]
+        return "the encoding has been finished";
+    Stat s = flush();
+    finished = true;
+    return s;
+}
+
+Stat StreamingEncoder::schedule_block()
+{
+    while (pending_blocks.size() >= max_pending_blocks) {
+        Stat s = write_out_front();
+        if (s.failed()) [[unlikely]]
+            return s;
+    }
+
+    Buffer next_block;
+    next_block.reserve(block_size);
+    pending_blocks.push_back(encoder_pool.schedule_buffer_encode(std::exchange(block, std::move(next_block)),
+                                                                 compression));
+    return write_out(false);
+}
+
+Stat StreamingEncoder::write_out(bool wait_for_all)
+{
+    using namespace std::chrono_literals;
+    while (not pending_blocks.empty() &&
+           (wait_for_all || pending_blocks.front().wait_for(0s) == std::future_status::ready)) {
+        Stat s = write_out_front();
+        if (s.failed()) [[unlikely]]
+            return s;
+    }
+    return success;
+}
+
+Stat StreamingEncoder::write_out_front()
+{
+    auto [encoded, s] = pending_blocks.front().get();
+    pending_blocks.pop_front();
+    // the blocks following a failed one are dropped, as the output can't be decoded past it anyway
+    if (failed) [[unlikely]]
+        return "the encoding has failed earlier";
+
+    if (s.failed()) [[unlikely]] {
+        SQUEEZE_ERROR("Failed encoding block");
+        failed = true;
+        return {"failed encoding block", s};
+    }
+
+    output.write(encoded.data(), static_cast<std::streamsize>(encoded.size()));
+    if (utils::validate_stream_fail_eof(output)) [[unlikely]] {
+        SQUEEZE_ERROR("Output write error");
+        failed = true;
+        return "output write error";
+    }
+    output_size += encoded.size();
+    return success;
+}
+
+#undef SQUEEZE_LOG_FUNC_PREFIX
+#define SQUEEZE_LOG_FUNC_PREFIX "squeeze::EncoderStreambuf::"
+
+EncoderStreambuf::EncoderStreambuf(std::ostream& output, const CompressionParams& compression,
+                                   std::size_t buffer_size)
+    : encoder(output, compression), buffer(buffer_size)
+{
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+EncoderStreambuf::EncoderStreambuf(std::ostream& output, const CompressionParams& compression,
+                                   EncoderPool& encoder_pool, std::size_t buffer_size)
+    : encoder(output, compression, encoder_pool), buffer(buffer_size)
+{
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+EncoderStreambuf::~EncoderStreambuf()
+{
+    // the encoder finishes on its own
+    push();
+}
+
+Stat EncoderStreambuf::finish()
+{
+    if (not push()) [[unlikely]]
+        return "failed pushing the data to the encoder";
+    return encoder.finish();
+}
+
+int EncoderStreambuf::sync()
+{
+    return push() && encoder.flush().successful() ? 0 : -1;
+}
+
+EncoderStreambuf::int_type EncoderStreambuf::overflow(int_type ch)
+{
+    if (not push()) [[unlikely]]
+        return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+std::streamsize EncoderStreambuf::xsputn(const char_type *s, std::streamsize n)
+{
+    if (n <= epptr() - pptr())
+        return std::streambuf::xsputn(s, n);
+    // the data larger than the rest of the put area is pushed right through
+    if (not push() || encoder.write(std::span(s, static_cast<std::size_t>(n))).failed()) [[unlikely]]
+        return 0;
+    return n;
+}
+
+bool EncoderStreambuf::push()
+{
+    const std::size_t size = pptr() - pbase();
+    setp(buffer.data(), buffer.data() + buffer.size());
+    return size == 0 || encoder.write(std::span(buffer.data(), size)).successful();
+}
+
+}
@@ -0,0 +1,441 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/utils/direct_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <system_error>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace squeeze::utils {
+
+namespace {
+
+/** Pool of the aligned windows, so that the files accessed one after another reuse them. */
+class WindowPool {
+public:
+    ~WindowPool()
+    {
+        for (char *window : windows)
+            ::operator delete(window, std::align_val_t(DirectFileStreambuf::alignment));
+    }
+
+    char *acquire()
+    {
+        {
+            std::scoped_lock lock(mutex);
+            if (not windows.empty()) {
+                char *window = windows.back();
+                windows.pop_back();
+                return window;
+            }
+        }
+        return static_cast<char *>(::operator new(DirectFileStreambuf::window_size,
+                                                  std::align_val_t(DirectFileStreambuf::alignment)));
+    }
+
+    void release(char *window) noexcept
+    {
+        {
+            std::scoped_lock lock(mutex);
+            if (windows.size() < max_nr_windows) {
+                windows.push_back(window);
+                return;
+            }
+        }
+        ::operator delete(window, std::align_val_t(DirectFileStreambuf::alignment));
+    }
+
+    static constexpr std::size_t max_nr_windows = 4;
+
+private:
+    std::mutex mutex;
+    std::vector<char *> windows;
+};
+
+WindowPool window_pool;
+
+constexpr uint64_t align_down(uint64_t pos) noexcept
+{
+    return pos / DirectFileStreambuf::alignment * DirectFileStreambuf::alignment;
+}
+
+constexpr uint64_t align_up(uint64_t pos) noexcept
+{
+    return align_down(pos + DirectFileStreambuf::alignment - 1);
+}
+
+[[maybe_unused]] inline StatCode last_error()
+{
+    return std::error_code(errno, std::system_category());
+}
+
+}
+
+DirectFileStreambuf::~DirectFileStreambuf()
+{
+    if (is_open())
+        close();
+}
+
+#if defined(__linux__)
+
+StatCode DirectFileStreambuf::open(const std::filesystem::path& path, std::ios_base::openmode open_mode)
+{
+    if (is_open()) [[unlikely]]
+        return std::make_error_code(std::errc::device_or_resource_busy);
+
+    writable = (open_mode & std::ios_base::out) != 0;
+    int flags = O_DIRECT | O_CLOEXEC | (writable ? O_RDWR : O_RDONLY);
+    if (writable && (open_mode & std::ios_base::trunc))
+        flags |= O_CREAT | O_TRUNC;
+    fd = ::open(path.c_str(), flags, 0666);
+    if (fd < 0)
+        return last_error();
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+        StatCode sc = last_error();
+        ::close(fd);
+        fd = -1;
+        return sc;
+    }
+    file_size = static_cast<uint64_t>(st.st_size);
+    read_window = window_pool.acquire();
+    read_window_pos = 0;
+    read_data_size = 0;
+    read_pos = 0;
+    write_pos = 0;
+    dirty_begin = window_size;
+    dirty_end = 0;
+    padded = false;
+    if (writable) {
+        write_window = window_pool.acquire();
+        write_window_pos = 0;
+        if (not move_write_window(0)) {
+            StatCode sc = last_error();
+            window_pool.release(write_window);
+            write_window = nullptr;
+            window_pool.release(read_window);
+            read_window = nullptr;
+            ::close(fd);
+            fd = -1;
+            return sc;
+        }
+        setp(write_window, write_window + window_size);
+    }
+    return success;
+}
+
+StatCode DirectFileStreambuf::close()
+{
+    if (not is_open())
+        return success;
+
+    StatCode sc = sync() == 0 ? StatCode(success) : last_error();
+    setg(nullptr, nullptr, nullptr);
+    setp(nullptr, nullptr);
+    window_pool.release(read_window);
+    read_window = nullptr;
+    if (write_window != nullptr) {
+        window_pool.release(write_window);
+        write_window = nullptr;
+    }
+    if (::close(fd) != 0 && sc.successful())
+        sc = last_error();
+    fd = -1;
+    file_size = 0;
+    return sc;
+}
+
+StatCode DirectFileStreambuf::resize(uint64_t size)
+{
+    if (not is_open() || not writable) [[unlikely]]
+        return std::make_error_code(std::errc::bad_file_descriptor);
+    note_written();
+    if (not write_out() || ::ftruncate(fd, static_cast<off_t>(size)) != 0) [[unlikely]]
+        return last_error();
+    file_size = size;
+    padded = false;
+    // both windows get read anew, as their data past the new size is gone
+    drop_get_area();
+    read_data_size = 0;
+    write_pos = get_write_pos();
+    setp(nullptr, nullptr);
+    if (not move_write_window(write_pos) || not seek_write(write_pos)) [[unlikely]]
+        return last_error();
+    return success;
+}
+
+int DirectFileStreambuf::sync()
+{
+    if (not is_open())
+        return 0;
+    note_written();
+    if (not write_out()) [[unlikely]]
+        return -1;
+    // the tail written out is padded up to the alignment
+    if (padded) {
+        if (::ftruncate(fd, static_cast<off_t>(file_size)) != 0) [[unlikely]]
+            return -1;
+        padded = false;
+    }
+    return 0;
+}
+
+bool DirectFileStreambuf::write_out()
+{
+    if (dirty_begin >= dirty_end)
+        return true;
+
+    const uint64_t begin = align_down(dirty_begin), end = align_up(dirty_end);
+    for (uint64_t written = begin; written < end;) {
+        const ssize_t n = ::pwrite(fd, write_window + written, end - written,
+                                   static_cast<off_t>(write_window_pos + written));
+        if (n <= 0) [[unlikely]] {
+            if (n < 0 && errno == EINTR)
+                continue;
+            return false;
+        }
+        written += static_cast<uint64_t>(n);
+    }
+    padded = padded || write_window_pos + end > file_size;
+    dirty_begin = window_size;
+    dirty_end = 0;
+
+    // the data read before is outdated where it's been written over
+    if (read_data_size != 0 && read_window_pos < write_window_pos + end
+            && write_window_pos + begin < read_window_pos + read_data_size) {
+        if (eback() == read_window)
+            drop_get_area();
+        read_data_size = 0;
+    }
+    return true;
+}
+
+bool DirectFileStreambuf::move_write_window(uint64_t pos)
+{
+    if (not write_out()) [[unlikely]]
+        return false;
+    if (eback() == write_window)
+        drop_get_area();
+
+    write_window_pos = align_down(pos);
+    const std::size_t data_size = file_size <= write_window_pos ? 0 :
+        static_cast<std::size_t>(std::min<uint64_t>(file_size - write_window_pos, window_size));
+    if (not read_in(write_window, write_window_pos, data_size)) [[unlikely]]
+        return false;
+
+    // the data read past the writing window mustn't be read where it's to be written over
+    if (eback() == read_window && read_window_pos + static_cast<uint64_t>(egptr() - eback()) > write_window_pos
+            && write_window_pos + window_size > read_window_pos)
+        drop_get_area();
+    return true;
+}
+
+bool DirectFileStreambuf::move_read_window(uint64_t pos)
+{
+    read_data_size = 0;
+    read_window_pos = align_down(pos);
+    // the data within the writing window is read from it, as it may be written over there
+    uint64_t data_end = std::min(file_size, read_window_pos + window_size);
+    if (write_window != nullptr && write_window_pos > read_window_pos)
+        data_end = std::min(data_end, write_window_pos);
+    const std::size_t data_size = data_end <= read_window_pos ? 0 :
+        static_cast<std::size_t>(data_end - read_window_pos);
+    if (not read_in(read_window, read_window_pos, data_size)) [[unlikely]]
+        return false;
+    read_data_size = data_size;
+    return true;
+}
+
+bool DirectFileStreambuf::read_in(char *buffer, uint64_t pos, std::size_t data_size)
+{
+    const std::size_t read_size = align_up(data_size);
+    std::size_t read = 0;
+    while (read < data_size) {
+        const ssize_t n = ::pread(fd, buffer + read, read_size - read, static_cast<off_t>(pos + read));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) [[unlikely]]
+            return false;
+        if (n == 0)
+            break;
+        read += static_cast<std::size_t>(n);
+    }
+    // the gaps seeked over past the end of the file read as zeros
+    read = std::min(read, data_size);
+    std::memset(buffer + read, 0, window_size - read);
+    return true;
+}
+
+#else
+
+StatCode DirectFileStreambuf::open(const std::filesystem::path&, std::ios_base::openmode)
+{
+    return std::make_error_code(std::errc::not_supported);
+}
+
+StatCode DirectFileStreambuf::close()
+{
+    return success;
+}
+
+StatCode DirectFileStreambuf::resize(uint64_t)
+{
+    return std::make_error_code(std::errc::not_supported);
+}
+
+int DirectFileStreambuf::sync()
+{
+    return 0;
+}
+
+bool DirectFileStreambuf::write_out()
+{
+    return false;
+}
+
+bool DirectFileStreambuf::move_write_window(uint64_t)
+{
+    return false;
+}
+
+bool DirectFileStreambuf::move_read_window(uint64_t)
+{
+    return false;
+}
+
+bool DirectFileStreambuf::read_in(char *, uint64_t, std::size_t)
+{
+    return false;
+}
+
+#endif
+
+void DirectFileStreambuf::drop_get_area() noexcept
+{
+    read_pos = get_read_pos();
+    setg(nullptr, nullptr, nullptr);
+}
+
+void DirectFileStreambuf::note_written() noexcept
+{
+    if (pptr() == pbase())
+        return;
+    dirty_begin = std::min(dirty_begin, static_cast<std::size_t>(pbase() - write_window));
+    const auto end = static_cast<std::size_t>(pptr() - write_window);
+    dirty_end = std::max(dirty_end, end);
+    file_size = std::max(file_size, write_window_pos + end);
+    setp(pptr(), epptr());
+}
+
+bool DirectFileStreambuf::seek_write(uint64_t pos)
+{
+    note_written();
+    // the seeks within the writing window, e.g. the position queries, don't touch the file
+    if (pos < write_window_pos || pos >= write_window_pos + window_size) {
+        setp(nullptr, nullptr);
+        write_pos = pos;
+        if (not move_write_window(pos)) [[unlikely]]
+            return false;
+    }
+    setp(write_window + (pos - write_window_pos), write_window + window_size);
+    return true;
+}
+
+DirectFileStreambuf::int_type DirectFileStreambuf::underflow()
+{
+    if (not is_open()) [[unlikely]]
+        return traits_type::eof();
+    drop_get_area();
+    note_written();
+    const uint64_t pos = read_pos;
+    if (pos >= file_size)
+        return traits_type::eof();
+
+    if (write_window != nullptr && write_window_pos <= pos && pos < write_window_pos + window_size) {
+        const auto data_size = static_cast<std::size_t>(std::min<uint64_t>(file_size - write_window_pos,
+                                                                           window_size));
+        setg(write_window, write_window + (pos - write_window_pos), write_window + data_size);
+        return traits_type::to_int_type(*gptr());
+    }
+
+    if (pos < read_window_pos || pos >= read_window_pos + read_data_size) {
+        if (not move_read_window(pos)) [[unlikely]]
+            return traits_type::eof();
+    }
+    // the data within the writing window is read from it, as it may have been written over there
+    std::size_t data_size = read_data_size;
+    if (write_window != nullptr && write_window_pos > pos)
+        data_size = static_cast<std::size_t>(std::min<uint64_t>(data_size, write_window_pos - read_window_pos));
+    setg(read_window, read_window + (pos - read_window_pos), read_window + data_size);
+    return gptr() < egptr() ? traits_type::to_int_type(*gptr()) : traits_type::eof();
+}
+
+DirectFileStreambuf::int_type DirectFileStreambuf::overflow(int_type ch)
+{
+    if (not is_open() || not writable) [[unlikely]]
+        return traits_type::eof();
+    if (pptr() == epptr() && not seek_write(get_write_pos())) [[unlikely]]
+        return traits_type::eof();
+    if (not traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+DirectFileStreambuf::pos_type DirectFileStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                           std::ios_base::openmode which)
+{
+    if (not is_open()) [[unlikely]]
+        return pos_type(off_type(-1));
+    note_written();
+
+    off_type pos = off;
+    if (dir == std::ios_base::cur)
+        pos += static_cast<off_type>(which & std::ios_base::in ? get_read_pos() : get_write_pos());
+    else if (dir == std::ios_base::end)
+        pos += static_cast<off_type>(file_size);
+    if (pos < 0) [[unlikely]]
+        return pos_type(off_type(-1));
+
+    const auto new_pos = static_cast<uint64_t>(pos);
+    if (which & std::ios_base::in) {
+        // the seeks within the get area keep it
+        const uint64_t area_pos = eback() == write_window ? write_window_pos : read_window_pos;
+        if (eback() != nullptr && area_pos <= new_pos
+                && new_pos <= area_pos + static_cast<uint64_t>(egptr() - eback()))
+            setg(eback(), eback() + (new_pos - area_pos), egptr());
+        else {
+            setg(nullptr, nullptr, nullptr);
+            read_pos = new_pos;
+        }
+    }
+    if (which & std::ios_base::out) {
+        if (not writable)
+            write_pos = new_pos;
+        else if (not seek_write(new_pos)) [[unlikely]]
+            return pos_type(off_type(-1));
+    }
+    return pos_type(pos);
+}
+
+DirectFileStreambuf::pos_type DirectFileStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    return seekoff(off_type(sp), std::ios_base::beg, which);
+}
+
+}
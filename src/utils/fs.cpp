@@ -4,10 +4,24 @@
 
 #include "squeeze/utils/fs.h"
 
+#include <algorithm>
 #include <filesystem>
 #include <system_error>
 
+#if __has_include(<unistd.h>)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#if __has_include(<sys/stat.h>)
+#include <sys/stat.h>
+#endif
+#if __has_include(<sys/sendfile.h>)
+#include <sys/sendfile.h>
+#endif
+
 #include "squeeze/utils/enum.h"
+#include "squeeze/utils/defer.h"
+#include "squeeze/utils/defer_macros.h"
 
 namespace squeeze::utils {
 
@@ -28,9 +42,8 @@ std::variant<std::fstream, StatCode> make_regular_file(std::string_view path_str
     return file;
 }
 
-std::variant<std::ofstream, StatCode> make_regular_file_out(std::string_view path_str)
+StatCode prepare_regular_file_out(const std::filesystem::path& path)
 {
-    fs::path path(path_str);
     std::error_code ec = utils::create_directories(path.parent_path());
     if (ec)
         return ec;
@@ -42,6 +55,15 @@ std::variant<std::ofstream, StatCode> make_regular_file_out(std::string_view pat
         if (ec)
             return ec;
     }
+    return success;
+}
+
+std::variant<std::ofstream, StatCode> make_regular_file_out(std::string_view path_str)
+{
+    fs::path path(path_str);
+    StatCode sc = prepare_regular_file_out(path);
+    if (sc.failed())
+        return sc;
 
     std::ofstream file(path, std::ios_base::binary);
     if (!file)
@@ -100,6 +122,292 @@ StatCode set_permissions(const fs::path &path, EntryPermissions entry_perms)
     return success;
 }
 
+StatCode get_data_extents(const fs::path& path, EntryExtentMap& map)
+{
+    std::error_code ec;
+    map.size = fs::file_size(path, ec);
+    map.extents.clear();
+    if (ec)
+        return ec;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return std::error_code(errno, std::system_category());
+    DEFER( ::close(fd) );
+
+    const auto size = static_cast<off_t>(map.size);
+    bool holes_supported = true;
+    for (off_t pos = 0; pos < size;) {
+        const off_t data = ::lseek(fd, pos, SEEK_DATA);
+        if (data < 0) {
+            // no more data till the end of the file
+            if (errno == ENXIO)
+                break;
+            // holes aren't supported by the file system
+            if (errno == EINVAL) {
+                holes_supported = false;
+                break;
+            }
+            return std::error_code(errno, std::system_category());
+        }
+        const off_t hole = ::lseek(fd, data, SEEK_HOLE);
+        if (hole < 0)
+            return std::error_code(errno, std::system_category());
+        if (data >= size)
+            break;
+
+        const off_t end = std::min(hole, size);
+        map.extents.push_back({static_cast<uint64_t>(data), static_cast<uint64_t>(end - data)});
+        pos = end;
+    }
+    if (holes_supported)
+        return success;
+    map.extents.clear();
+#endif
+
+    if (map.size != 0)
+        map.extents.push_back({0, map.size});
+    return success;
+}
+
+StatCode preallocate_file(const fs::path& path, uint64_t size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_KEEP_SIZE)
+    const int fd = ::open(path.c_str(), O_WRONLY);
+    if (fd < 0)
+        return std::error_code(errno, std::system_category());
+    DEFER( ::close(fd) );
+
+    // the size is kept, so that the file doesn't end up with trailing zeros if written less
+    if (::fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size)) != 0 && errno != EOPNOTSUPP)
+        return std::error_code(errno, std::system_category());
+#endif
+    return success;
+}
+
+namespace {
+
+#if defined(__GLIBCXX__) && __has_include(<unistd.h>)
+/** Accessor of the file of a std::filebuf, which libstdc++ keeps in a protected member. */
+struct FilebufAccess : std::filebuf {
+    static int get_fd(std::filebuf& filebuf)
+    {
+        return (filebuf.*&FilebufAccess::_M_file).fd();
+    }
+};
+#endif
+
+}
+
+int get_file_descriptor(std::ios& stream)
+{
+#if defined(__GLIBCXX__) && __has_include(<unistd.h>)
+    if (auto *filebuf = dynamic_cast<std::filebuf *>(stream.rdbuf()); filebuf && filebuf->is_open())
+        return FilebufAccess::get_fd(*filebuf);
+#endif
+    return -1;
+}
+
+bool is_regular_file(int fd)
+{
+#if __has_include(<sys/stat.h>)
+    struct stat st;
+    return fd >= 0 && ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode);
+#else
+    return false;
+#endif
+}
+
+int duplicate_file_descriptor(int fd)
+{
+#if __has_include(<unistd.h>)
+    return ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+#else
+    return -1;
+#endif
+}
+
+void close_file_descriptor(int fd) noexcept
+{
+#if __has_include(<unistd.h>)
+    ::close(fd);
+#endif
+}
+
+StatCode copy_file_data(int src_fd, uint64_t src_pos, int dst_fd, uint64_t dst_pos, uint64_t size)
+{
+#if __has_include(<unistd.h>)
+    const uint64_t end_pos = src_pos + size;
+    auto src_off = static_cast<off_t>(src_pos), dst_off = static_cast<off_t>(dst_pos);
+    auto get_remaining = [&]() { return static_cast<std::size_t>(end_pos - static_cast<uint64_t>(src_off)); };
+
+#if defined(__linux__)
+    // fails across file systems on the older kernels, and on some special files
+    while (get_remaining() != 0) {
+        const ssize_t copied = ::copy_file_range(src_fd, &src_off, dst_fd, &dst_off, get_remaining(), 0);
+        if (copied <= 0)
+            break;
+    }
+#endif
+#if __has_include(<sys/sendfile.h>)
+    // writes at the file offset of the destination
+    if (get_remaining() != 0 && ::lseek(dst_fd, dst_off, SEEK_SET) == dst_off) {
+        while (get_remaining() != 0) {
+            const ssize_t copied = ::sendfile(dst_fd, src_fd, &src_off, get_remaining());
+            if (copied <= 0)
+                break;
+            dst_off += copied;
+        }
+    }
+#endif
+
+    char buffer[BUFSIZ];
+    while (get_remaining() != 0) {
+        const ssize_t read = ::pread(src_fd, buffer, std::min(get_remaining(), sizeof(buffer)), src_off);
+        if (read < 0)
+            return std::error_code(errno, std::system_category());
+        if (read == 0)
+            return std::make_error_code(std::errc::io_error);
+        for (ssize_t written = 0; written < read;) {
+            const ssize_t n = ::pwrite(dst_fd, buffer + written, read - written, dst_off);
+            if (n < 0)
+                return std::error_code(errno, std::system_category());
+            written += n;
+            dst_off += n;
+        }
+        src_off += read;
+    }
+    return success;
+#else
+    return std::make_error_code(std::errc::not_supported);
+#endif
+}
+
+void advise_sequential(int fd)
+{
+#if defined(POSIX_FADV_SEQUENTIAL)
+    if (fd >= 0)
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+}
+
+void advise_will_need(int fd, uint64_t pos, uint64_t size)
+{
+#if defined(POSIX_FADV_WILLNEED)
+    if (fd >= 0 && size != 0)
+        ::posix_fadvise(fd, static_cast<off_t>(pos), static_cast<off_t>(size), POSIX_FADV_WILLNEED);
+#endif
+}
+
+PositionalInputStreambuf::PositionalInputStreambuf(int fd, std::size_t buffer_size) : fd(fd), buffer(buffer_size)
+{
+    setg(buffer.data(), buffer.data(), buffer.data());
+}
+
+PositionalInputStreambuf::int_type PositionalInputStreambuf::underflow()
+{
+    buffer_pos += egptr() - eback();
+    setg(buffer.data(), buffer.data(), buffer.data());
+#if __has_include(<unistd.h>)
+    ssize_t read = 0;
+    do {
+        read = ::pread(fd, buffer.data(), buffer.size(), static_cast<off_t>(buffer_pos));
+    } while (read < 0 && errno == EINTR);
+    if (read <= 0)
+        return traits_type::eof();
+    setg(buffer.data(), buffer.data(), buffer.data() + read);
+    return traits_type::to_int_type(buffer.front());
+#else
+    return traits_type::eof();
+#endif
+}
+
+PositionalInputStreambuf::pos_type PositionalInputStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                                     std::ios_base::openmode which)
+{
+    const auto pos = static_cast<off_type>(buffer_pos + (gptr() - eback()));
+    if (not (which & std::ios_base::in) || dir == std::ios_base::end)
+        return pos_type(off_type(-1));
+    return seekpos(pos_type(dir == std::ios_base::cur ? pos + off : off), which);
+}
+
+PositionalInputStreambuf::pos_type PositionalInputStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    const auto pos = static_cast<off_type>(sp);
+    if (not (which & std::ios_base::in) || pos < 0)
+        return pos_type(off_type(-1));
+    // the seeks within the buffer keep it
+    const auto begin_pos = static_cast<off_type>(buffer_pos);
+    if (begin_pos <= pos && pos <= begin_pos + (egptr() - eback())) {
+        setg(eback(), eback() + (pos - begin_pos), egptr());
+    } else {
+        buffer_pos = static_cast<uint64_t>(pos);
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+    return sp;
+}
+
+ReadaheadInputStreambuf::ReadaheadInputStreambuf(std::istream& source, int fd, uint64_t file_offset,
+                                                 uint64_t file_end, uint64_t window_size, std::size_t buffer_size)
+    : source(source), fd(fd), file_offset(file_offset), file_end(file_end),
+      window_size(std::max<uint64_t>(window_size, 1)), buffer(buffer_size)
+{
+    const auto pos = source.tellg();
+    buffer_pos = pos < 0 ? 0 : static_cast<uint64_t>(pos);
+    setg(buffer.data(), buffer.data(), buffer.data());
+}
+
+ReadaheadInputStreambuf::int_type ReadaheadInputStreambuf::underflow()
+{
+    buffer_pos += egptr() - eback();
+    setg(buffer.data(), buffer.data(), buffer.data());
+
+    // the hint gets renewed once the reading gets halfway through the window hinted last
+    const uint64_t file_pos = buffer_pos + file_offset;
+    if (file_pos + window_size / 2 >= hinted_end && hinted_end < file_end) {
+        const uint64_t begin = std::max(hinted_end, file_pos);
+        hinted_end = std::min(file_pos + window_size, file_end);
+        if (begin < hinted_end)
+            advise_will_need(fd, begin, hinted_end - begin);
+    }
+
+    source.clear();
+    source.seekg(static_cast<std::streamoff>(buffer_pos));
+    source.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    const std::streamsize read = source.gcount();
+    source.clear();
+    if (read <= 0)
+        return traits_type::eof();
+    setg(buffer.data(), buffer.data(), buffer.data() + read);
+    return traits_type::to_int_type(buffer.front());
+}
+
+ReadaheadInputStreambuf::pos_type ReadaheadInputStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                                   std::ios_base::openmode which)
+{
+    const auto pos = static_cast<off_type>(buffer_pos + (gptr() - eback()));
+    if (not (which & std::ios_base::in) || dir == std::ios_base::end)
+        return pos_type(off_type(-1));
+    return seekpos(pos_type(dir == std::ios_base::cur ? pos + off : off), which);
+}
+
+ReadaheadInputStreambuf::pos_type ReadaheadInputStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    const auto pos = static_cast<off_type>(sp);
+    if (not (which & std::ios_base::in) || pos < 0)
+        return pos_type(off_type(-1));
+    // the seeks within the buffer keep it
+    const auto begin_pos = static_cast<off_type>(buffer_pos);
+    if (begin_pos <= pos && pos <= begin_pos + (egptr() - eback())) {
+        setg(eback(), eback() + (pos - begin_pos), egptr());
+    } else {
+        buffer_pos = static_cast<uint64_t>(pos);
+        setg(buffer.data(), buffer.data(), buffer.data());
+    }
+    return sp;
+}
+
 void convert(const EntryPermissions& from, fs::perms& to)
 {
     using enum EntryPermissions;
@@ -4,10 +4,49 @@
 
 #include "squeeze/utils/io.h"
 
+#include <algorithm>
 #include <cstdint>
 
+#include "squeeze/utils/fs.h"
+#include "squeeze/stats.h"
+
 namespace squeeze::utils {
 
+namespace {
+
+/** Copy the data right between the files underlying the streams, if both are files, see copy_file_data().
+ * Returns false if they aren't, leaving the copy to the streams. */
+bool ioscopy_files(std::istream& src_stream, std::streampos src_pos,
+                   std::ostream& dst_stream, std::streampos dst_pos,
+                   std::streamsize cpy_len, StatStr& stat)
+{
+    const int src_fd = get_file_descriptor(src_stream), dst_fd = get_file_descriptor(dst_stream);
+    if (src_fd < 0 || dst_fd < 0 || src_pos < 0 || dst_pos < 0)
+        return false;
+    // the data buffered by the destination goes in front of the copied one
+    dst_stream.flush();
+    if (validate_stream_fail_eof(dst_stream)) [[unlikely]] {
+        stat = "output write error";
+        return true;
+    }
+
+    StatCode sc = copy_file_data(src_fd, src_pos, dst_fd, dst_pos, cpy_len);
+    if (sc.failed()) [[unlikely]] {
+        stat = {"failed copying file data", sc};
+        return true;
+    }
+    // the streams reposition the file offsets on seeking
+    src_stream.seekg(src_pos + cpy_len);
+    dst_stream.seekp(dst_pos + cpy_len);
+    if (validate_stream_fail(src_stream) || validate_stream_fail(dst_stream)) [[unlikely]]
+        stat = "stream seek error";
+    else
+        stat = success;
+    return true;
+}
+
+}
+
 StatStr iosmove(std::iostream& ios, std::streampos dst, std::streampos src, std::streamsize len)
 {
     thread_local char buffer[BUFSIZ] {};
@@ -39,6 +78,11 @@ StatStr ioscopy(std::istream& src_stream, std::streampos src_pos,
     src_stream.seekg(src_pos);
     dst_stream.seekp(dst_pos);
 
+    StatStr stat;
+    if (static_cast<uint64_t>(cpy_len) >= min_file_copy_size &&
+            ioscopy_files(src_stream, src_pos, dst_stream, dst_pos, cpy_len, stat))
+        return stat;
+
     while (cpy_len) {
         const std::streamsize step_len = std::min(cpy_len, (std::streamsize)BUFSIZ);
 
@@ -56,4 +100,255 @@ StatStr ioscopy(std::istream& src_stream, std::streampos src_pos,
     return success;
 }
 
+StatStr ioscopy_till_end(std::istream& src_stream, std::ostream& dst_stream)
+{
+    thread_local char buffer[BUFSIZ] {};
+    while (true) {
+        src_stream.read(buffer, BUFSIZ);
+        const std::streamsize step_len = src_stream.gcount();
+        if (utils::validate_stream_bad(src_stream)) [[unlikely]]
+            return "input read error";
+
+        dst_stream.write(buffer, step_len);
+        if (utils::validate_stream_fail_eof(dst_stream)) [[unlikely]]
+            return "output write error";
+
+        if (step_len < BUFSIZ)
+            return success;
+    }
+}
+
+std::streamsize get_remaining_size(std::istream& stream)
+{
+    const std::streampos pos = stream.tellg();
+    if (pos == std::streampos(-1))
+        return -1;
+    stream.seekg(0, std::ios_base::end);
+    const std::streampos end_pos = stream.tellg();
+    stream.clear();
+    stream.seekg(pos);
+    if (end_pos == std::streampos(-1) || end_pos < pos || stream.fail())
+        return -1;
+    return end_pos - pos;
+}
+
+ForwardInputStreambuf::int_type ForwardInputStreambuf::underflow()
+{
+    buffer_pos += egptr() - eback();
+    source.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+    const std::streamsize read = source.gcount();
+    source.clear(source.rdstate() & std::ios_base::badbit);
+    setg(buffer.data(), buffer.data(), buffer.data() + read);
+    return read == 0 ? traits_type::eof() : traits_type::to_int_type(buffer.front());
+}
+
+std::streamsize ForwardInputStreambuf::xsgetn(char_type *s, std::streamsize n)
+{
+    const std::streamsize buffered = std::min<std::streamsize>(n, egptr() - gptr());
+    std::copy(gptr(), gptr() + buffered, s);
+    gbump(static_cast<int>(buffered));
+    if (n - buffered < static_cast<std::streamsize>(buffer.size()))
+        return buffered + std::streambuf::xsgetn(s + buffered, n - buffered);
+
+    // the reads larger than the buffer go directly from the source
+    const off_type pos = get_pos();
+    source.read(s + buffered, n - buffered);
+    const std::streamsize read = source.gcount();
+    source.clear(source.rdstate() & std::ios_base::badbit);
+    buffer_pos = pos + read;
+    setg(buffer.data(), buffer.data(), buffer.data());
+    return buffered + read;
+}
+
+ForwardInputStreambuf::pos_type ForwardInputStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                               std::ios_base::openmode which)
+{
+    if (not (which & std::ios_base::in) || dir == std::ios_base::end) [[unlikely]]
+        return pos_type(off_type(-1));
+    const off_type pos = dir == std::ios_base::beg ? off : get_pos() + off;
+    if (pos < buffer_pos) [[unlikely]]
+        return pos_type(off_type(-1));
+
+    const off_type buffer_end = buffer_pos + (egptr() - eback());
+    if (pos <= buffer_end) {
+        setg(eback(), eback() + (pos - buffer_pos), egptr());
+        return pos_type(pos);
+    }
+
+    source.ignore(pos - buffer_end);
+    const std::streamsize skipped = source.gcount();
+    source.clear(source.rdstate() & std::ios_base::badbit);
+    buffer_pos = buffer_end + skipped;
+    setg(buffer.data(), buffer.data(), buffer.data());
+    return skipped == pos - buffer_end ? pos_type(pos) : pos_type(off_type(-1));
+}
+
+ForwardInputStreambuf::pos_type ForwardInputStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    return seekoff(off_type(sp), std::ios_base::beg, which);
+}
+
+BatchOutputStreambuf::BatchOutputStreambuf(std::ostream& target, std::size_t batch_size)
+    : target(target), batch(batch_size), batch_pos(target.tellp()), seekable(batch_pos >= 0)
+{
+    if (not seekable) {
+        target.clear();
+        batch_pos = 0;
+    }
+    setp(batch.data(), batch.data() + batch.size());
+}
+
+BatchOutputStreambuf::~BatchOutputStreambuf()
+{
+    write_out();
+}
+
+int BatchOutputStreambuf::sync()
+{
+    return write_out() ? 0 : -1;
+}
+
+BatchOutputStreambuf::int_type BatchOutputStreambuf::overflow(int_type ch)
+{
+    if (not write_out()) [[unlikely]]
+        return traits_type::eof();
+    if (not traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize BatchOutputStreambuf::xsputn(const char_type *s, std::streamsize n)
+{
+    if (n > epptr() - pptr()) {
+        if (not write_out()) [[unlikely]]
+            return 0;
+        if (n >= static_cast<std::streamsize>(batch.size())) {
+            const stats::StageTimer timer;
+            target.write(s, n);
+            if (validate_stream_fail_eof(target)) [[unlikely]]
+                return 0;
+            timer.record(StatsStage::AppendWrite, static_cast<uint64_t>(n), static_cast<uint64_t>(n));
+            batch_pos += n;
+            return n;
+        }
+    }
+    std::copy(s, s + n, pptr());
+    pbump(static_cast<int>(n));
+    return n;
+}
+
+BatchOutputStreambuf::pos_type BatchOutputStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                             std::ios_base::openmode which)
+{
+    if (not (which & std::ios_base::out)) [[unlikely]]
+        return pos_type(off_type(-1));
+
+    const auto offset = static_cast<off_type>(pptr() - pbase());
+    batch_data_size = std::max(batch_data_size, static_cast<std::size_t>(offset));
+    off_type pos = 0;
+    switch (dir) {
+    case std::ios_base::beg:
+        pos = off;
+        break;
+    case std::ios_base::cur:
+        pos = batch_pos + offset + off;
+        break;
+    default:
+        if (not seekable || not write_out()) [[unlikely]]
+            return pos_type(off_type(-1));
+        target.seekp(off, dir);
+        batch_pos = target.tellp();
+        return pos_type(batch_pos);
+    }
+
+    if (batch_pos <= pos && pos <= batch_pos + static_cast<off_type>(batch_data_size)) {
+        pbump(static_cast<int>(pos - batch_pos - offset));
+        return pos_type(pos);
+    }
+    if (not seekable || not write_out()) [[unlikely]]
+        return pos_type(off_type(-1));
+    target.seekp(pos);
+    if (validate_stream_fail(target)) [[unlikely]]
+        return pos_type(off_type(-1));
+    batch_pos = pos;
+    return pos_type(pos);
+}
+
+BatchOutputStreambuf::pos_type BatchOutputStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    return seekoff(off_type(sp), std::ios_base::beg, which);
+}
+
+StatStr BatchOutputStreambuf::write_file_data(int fd, uint64_t pos, uint64_t size)
+{
+    const int target_fd = get_file_descriptor(target);
+    if (not seekable || target_fd < 0) [[unlikely]]
+        return "the target isn't a seekable file";
+    if (not write_out()) [[unlikely]]
+        return "output write error";
+    target.flush();
+    if (validate_stream_fail_eof(target)) [[unlikely]]
+        return "output write error";
+
+    const stats::StageTimer timer;
+    StatCode sc = copy_file_data(fd, pos, target_fd, static_cast<uint64_t>(batch_pos), size);
+    if (sc.failed()) [[unlikely]]
+        return {"failed copying file data", sc};
+    timer.record(StatsStage::AppendWrite, size, size);
+    batch_pos += static_cast<off_type>(size);
+    target.seekp(batch_pos);
+    if (validate_stream_fail(target)) [[unlikely]]
+        return "output seek error";
+    return success;
+}
+
+bool BatchOutputStreambuf::write_out()
+{
+    const auto offset = static_cast<std::size_t>(pptr() - pbase());
+    // the data past the position can't be written over later if the target isn't seekable
+    const std::size_t size = seekable ? std::max(batch_data_size, offset) : offset;
+    setp(batch.data(), batch.data() + batch.size());
+    batch_data_size = 0;
+    if (size == 0)
+        return true;
+
+    const stats::StageTimer timer;
+    target.write(batch.data(), static_cast<std::streamsize>(size));
+    if (validate_stream_fail_eof(target)) [[unlikely]]
+        return false;
+    timer.record(StatsStage::AppendWrite, size, size);
+    // continue where the batch was left, as it may have been rewound
+    if (offset != size)
+        target.seekp(batch_pos + static_cast<off_type>(offset));
+    batch_pos += static_cast<off_type>(offset);
+    return not validate_stream_fail(target);
+}
+
+#ifdef SQUEEZE_USE_STATS
+
+StatsInputFilebuf::int_type StatsInputFilebuf::underflow()
+{
+    if (reading)
+        return std::filebuf::underflow();
+    const stats::StageTimer timer;
+    const int_type ch = std::filebuf::underflow();
+    const auto size = static_cast<uint64_t>(egptr() - gptr());
+    timer.record(StatsStage::FileRead, size, size);
+    return ch;
+}
+
+std::streamsize StatsInputFilebuf::xsgetn(char_type *s, std::streamsize n)
+{
+    const stats::StageTimer timer;
+    reading = true;
+    const std::streamsize read = std::filebuf::xsgetn(s, n);
+    reading = false;
+    timer.record(StatsStage::FileRead, static_cast<uint64_t>(read), static_cast<uint64_t>(read));
+    return read;
+}
+
+#endif /** SQUEEZE_USE_STATS */
+
 }
@@ -0,0 +1,219 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#include "squeeze/utils/mapped_file.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace squeeze::utils {
+
+MappedFileStreambuf::~MappedFileStreambuf()
+{
+    if (is_open())
+        close();
+}
+
+#if __has_include(<sys/mman.h>)
+
+namespace {
+
+inline StatCode last_error()
+{
+    return std::error_code(errno, std::system_category());
+}
+
+/** Allocate the range of the file, extending it if needed, setting errno on failure. The pages of a mapping
+ * beyond the allocated space would raise SIGBUS once written if the file system ran out of space.
+ * Where posix_fallocate() isn't available, e.g. on macOS, the file is only extended to the end of the range,
+ * which keeps the pages within the file, but doesn't reserve the space for them. */
+inline bool allocate(int fd, uint64_t pos, uint64_t size)
+{
+#if defined(__linux__)
+    const int error = ::posix_fallocate(fd, static_cast<off_t>(pos), static_cast<off_t>(size));
+    errno = error;
+    return error == 0;
+#else
+    return ::ftruncate(fd, static_cast<off_t>(pos + size)) == 0;
+#endif
+}
+
+}
+
+StatCode MappedFileStreambuf::open(const std::filesystem::path& path, uint64_t expected_size)
+{
+    if (is_open()) [[unlikely]]
+        return std::make_error_code(std::errc::device_or_resource_busy);
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0)
+        return last_error();
+
+    data_size = 0;
+    map_size = expected_size;
+    if (map_size != 0 && (not allocate(fd, 0, map_size) || not map_file(0))) {
+        StatCode sc = last_error();
+        ::close(fd);
+        fd = -1;
+        map_size = 0;
+        return sc;
+    }
+    return success;
+}
+
+StatCode MappedFileStreambuf::close()
+{
+    if (not is_open())
+        return success;
+
+    unmap_file();
+    StatCode sc = success;
+    if (::ftruncate(fd, static_cast<off_t>(data_size)) != 0)
+        sc = last_error();
+    if (::close(fd) != 0 && sc.successful())
+        sc = last_error();
+    fd = -1;
+    map_size = 0;
+    data_size = 0;
+    return sc;
+}
+
+std::span<char> MappedFileStreambuf::reserve(std::size_t size)
+{
+    if (not is_open() || (static_cast<std::size_t>(epptr() - pptr()) < size && not grow(get_pos() + size)))
+        return {};
+    return {pptr(), epptr()};
+}
+
+MappedFileStreambuf::int_type MappedFileStreambuf::overflow(int_type ch)
+{
+    if (not is_open())
+        return traits_type::eof();
+    if (traits_type::eq_int_type(ch, traits_type::eof()))
+        return traits_type::not_eof(ch);
+    if (not grow(get_pos() + 1))
+        return traits_type::eof();
+    *pptr() = traits_type::to_char_type(ch);
+    pbump(1);
+    return ch;
+}
+
+MappedFileStreambuf::pos_type MappedFileStreambuf::seekoff(off_type off, std::ios_base::seekdir dir,
+                                                           std::ios_base::openmode which)
+{
+    if (not is_open() || not (which & std::ios_base::out))
+        return pos_type(off_type(-1));
+
+    const uint64_t pos = get_pos();
+    data_size = std::max(data_size, pos);
+    const off_type base = dir == std::ios_base::beg ? 0 : static_cast<off_type>(dir == std::ios_base::cur ?
+                                                                                pos : data_size);
+    if (off < -base)
+        return pos_type(off_type(-1));
+    const auto new_pos = static_cast<uint64_t>(base + off);
+
+    // seeking past the mapped size grows the file, the data up to where is then zeros
+    if (new_pos > map_size && not grow(new_pos))
+        return pos_type(off_type(-1));
+    setp(map + new_pos, map + map_size);
+    return pos_type(static_cast<off_type>(new_pos));
+}
+
+MappedFileStreambuf::pos_type MappedFileStreambuf::seekpos(pos_type sp, std::ios_base::openmode which)
+{
+    return seekoff(off_type(sp), std::ios_base::beg, which);
+}
+
+bool MappedFileStreambuf::grow(uint64_t size)
+{
+    const uint64_t pos = get_pos();
+    const uint64_t new_map_size = std::max(size, map_size + std::max(map_size / 2, grow_step));
+    unmap_file();
+    if (not allocate(fd, map_size, new_map_size - map_size))
+        return false;
+    map_size = new_map_size;
+    return map_file(pos);
+}
+
+bool MappedFileStreambuf::map_file(uint64_t pos)
+{
+    void *addr = ::mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+        return false;
+    map = static_cast<char *>(addr);
+#ifdef MADV_SEQUENTIAL
+    // a hint only, so its failure doesn't matter
+    ::madvise(map, map_size, MADV_SEQUENTIAL);
+#endif
+    setp(map + pos, map + map_size);
+    return true;
+}
+
+void MappedFileStreambuf::unmap_file() noexcept
+{
+    if (map == nullptr)
+        return;
+    data_size = std::max(data_size, get_pos());
+    ::munmap(map, map_size);
+    map = nullptr;
+    setp(nullptr, nullptr);
+}
+
+#else
+
+StatCode MappedFileStreambuf::open(const std::filesystem::path&, uint64_t)
+{
+    return std::make_error_code(std::errc::not_supported);
+}
+
+StatCode MappedFileStreambuf::close()
+{
+    return success;
+}
+
+std::span<char> MappedFileStreambuf::reserve(std::size_t)
+{
+    return {};
+}
+
+MappedFileStreambuf::int_type MappedFileStreambuf::overflow(int_type)
+{
+    return traits_type::eof();
+}
+
+MappedFileStreambuf::pos_type MappedFileStreambuf::seekoff(off_type, std::ios_base::seekdir,
+                                                           std::ios_base::openmode)
+{
+    return pos_type(off_type(-1));
+}
+
+MappedFileStreambuf::pos_type MappedFileStreambuf::seekpos(pos_type, std::ios_base::openmode)
+{
+    return pos_type(off_type(-1));
+}
+
+bool MappedFileStreambuf::grow(uint64_t)
+{
+    return false;
+}
+
+bool MappedFileStreambuf::map_file(uint64_t)
+{
+    return false;
+}
+
+void MappedFileStreambuf::unmap_file() noexcept
+{
+}
+
+#endif
+
+}
@@ -4,6 +4,9 @@
 
 #include "squeeze/wrap/file_extracter.h"
 
+#include "squeeze/utils/defer.h"
+#include "squeeze/utils/defer_macros.h"
+
 namespace squeeze::wrap {
 
 using Stat = FileExtracter::Stat;
@@ -18,7 +21,12 @@ bool FileExtracter::extract_recursively(const std::string_view path,
         const std::function<Stat *()>& get_stat_ptr)
 {
     bool at_least_one_path_extracted = false;
+    if (prefetch_entries != 0)
+        reader.start_prefetching(prefetch_entries);
+    DEFER( reader.stop_prefetching() );
     for (auto it = reader.begin(); it != reader.end(); ++it) {
+        if (it->second.attributes.get_type() == EntryType::Blob)
+            continue;
         if (!utils::path_within_dir(it->second.path, path))
             continue;
         at_least_one_path_extracted = true;
@@ -38,9 +46,13 @@ bool FileExtracter::extract_recursively(const std::string_view path,
 
 void FileExtracter::extract_all(const std::function<Stat *()>& get_stat_ptr)
 {
+    if (prefetch_entries != 0)
+        reader.start_prefetching(prefetch_entries);
+    DEFER( reader.stop_prefetching() );
     for (auto it = reader.begin(); it != reader.end(); ++it)
-        if (auto *stat = get_stat_ptr())
-            *stat = reader.extract(it);
+        if (it->second.attributes.get_type() != EntryType::Blob)
+            if (auto *stat = get_stat_ptr())
+                *stat = reader.extract(it);
 }
 
 }
@@ -25,7 +25,8 @@ bool FileRemover::will_remove_recursively(std::string_view path,
 {
     bool at_least_one_path_removed = false;
     for (auto it = squeeze.begin(); it != squeeze.end(); ++it) {
-        if (utils::path_within_dir(it->second.path, path)) {
+        if (it->second.attributes.get_type() != EntryType::Blob &&
+            utils::path_within_dir(it->second.path, path)) {
             squeeze.will_remove(it, get_stat_ptr());
             at_least_one_path_removed = true;
         }
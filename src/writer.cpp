@@ -20,6 +20,7 @@ bool Writer::write()
         SQUEEZE_TRACE("No entry to append, performing removes synchronously");
         succeeded = perform_removes() && succeeded;
     } else {
+        inspect_target();
         auto fut_succeeded = std::async(std::launch::async, [this](){ return perform_scheduled_writes(); });
 
         SQUEEZE_TRACE("Scheduling appends");
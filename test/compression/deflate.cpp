@@ -66,4 +66,28 @@ SQUEEZE_COMPRESSION_TESTING_INSTANTIATE_DEFLATE_TEST(8);
 
 #undef SQUEEZE_COMPRESSION_TESTING_INSTANTIATE_DEFLATE_TEST
 
+TEST(DeflateRunTest, EncodeDecode)
+{
+    for (std::size_t size : {1, 2, 1000, 1 << 16}) {
+        std::vector<char> data(size, '\x7F');
+        DeflateParams deflate_params = get_deflate_params_for_level(4);
+        deflate_params.header_bits = DeflateHeaderBits::FinalBlock | DeflateHeaderBits::DynamicHuffman;
+        std::vector<char> buffer;
+
+        auto [in_it, out_it, s] = deflate(deflate_params, data.begin(), data.end(), std::back_inserter(buffer));
+        EXPECT_EQ(in_it, data.end());
+        EXPECT_TRUE(s.successful()) << s.report();
+        // header bits, the byte and the size
+        EXPECT_EQ(buffer.size(), 6) << "constant data of size " << size << " wasn't encoded as a run";
+
+        std::vector<char> rest_data (data.size());
+        auto [rest_out_it, rest_in_it, header_bits, rest_s] =
+            inflate(rest_data.begin(), rest_data.end(), buffer.begin(), buffer.end());
+        EXPECT_EQ(rest_out_it, rest_data.end());
+        EXPECT_EQ(header_bits, DeflateHeaderBits::FinalBlock | DeflateHeaderBits::Run);
+        EXPECT_TRUE(rest_s.successful()) << rest_s.report();
+        ASSERT_THAT(rest_data, Pointwise(Eq(), data));
+    }
+}
+
 }
@@ -5,12 +5,21 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <future>
+#include <memory>
 #include <sstream>
+#include <thread>
 #include <utility>
 
 #include "squeeze/compression/params.h"
 #include "squeeze/encode.h"
 #include "squeeze/decode.h"
+#include "squeeze/encoder_pool.h"
+#include "squeeze/streaming_encoder.h"
+#include "squeeze/streaming_decoder.h"
 
 #include "test_tools/generators/test_gen.h"
 
@@ -55,6 +64,151 @@ TEST_P(EncodeDecodeTest, EncodeDecode)
     ASSERT_THAT(restored_content.view(), Pointwise(Eq(), content.view()));
 }
 
+TEST_P(EncodeDecodeTest, EncodeDecodeBuffer)
+{
+    const CompressionParams compression = std::get<1>(GetParam());
+
+    std::vector<char> data {std::get<0>(GetParam())->get_data()};
+
+    Buffer compressed(compress_bound(data.size(), compression));
+    std::size_t compressed_size = 0;
+    EncodeStat en_stat = encode_buffer(data, compressed, compressed_size, compression);
+    ASSERT_TRUE(en_stat.successful()) << en_stat.report();
+    ASSERT_LE(compressed_size, compressed.size());
+    compressed.resize(compressed_size);
+
+    // the output is the same as of the stream encoding
+    std::stringstream content, stream_compressed;
+    content.write(data.data(), data.size());
+    en_stat = encode(content, data.size(), stream_compressed, compression);
+    EXPECT_TRUE(en_stat.successful()) << en_stat.report();
+    EXPECT_THAT(stream_compressed.view(), Pointwise(Eq(), compressed));
+
+    Buffer restored(data.size());
+    std::size_t restored_size = 0;
+    DecodeStat de_stat = decode_buffer(compressed, restored, restored_size, compression);
+    ASSERT_TRUE(de_stat.successful()) << de_stat.report();
+    EXPECT_EQ(restored_size, data.size());
+    ASSERT_THAT(restored, Pointwise(Eq(), data));
+
+    if (not data.empty()) {
+        Buffer short_output(data.size() - 1);
+        EXPECT_TRUE(decode_buffer(compressed, short_output, restored_size, compression).failed());
+        Buffer short_compressed(compressed.size() - 1);
+        EXPECT_TRUE(encode_buffer(data, short_compressed, compressed_size, compression).failed());
+    }
+}
+
+TEST_P(EncodeDecodeTest, BatchEncodeDecode)
+{
+    const CompressionParams compression = std::get<1>(GetParam());
+
+    std::vector<char> data {std::get<0>(GetParam())->get_data()};
+
+    // the data is split into messages of varying sizes, including empty ones
+    std::vector<std::span<const char>> inputs;
+    std::size_t pos = 0, piece_size = 0;
+    while (pos < data.size()) {
+        const std::size_t size = std::min(piece_size, data.size() - pos);
+        inputs.push_back(std::span(data).subspan(pos, size));
+        pos += size;
+        piece_size = (piece_size * 31 + 1000) % 16411;
+    }
+
+    EncoderPool encoder_pool;
+    Buffer arena;
+    std::vector<uint64_t> offsets;
+    EncodeStat en_stat = encoder_pool.encode_batch(inputs, arena, offsets, compression);
+    ASSERT_TRUE(en_stat.successful()) << en_stat.report();
+    ASSERT_EQ(offsets.size(), inputs.size() + 1);
+    ASSERT_EQ(offsets.back(), arena.size());
+
+    for (std::size_t i = 0; i < inputs.size(); ++i) {
+        const std::span<const char> encoded = std::span(arena).subspan(offsets[i], offsets[i + 1] - offsets[i]);
+        Buffer restored(inputs[i].size());
+        std::size_t restored_size = 0;
+        DecodeStat de_stat = decode_buffer(encoded, restored, restored_size, compression);
+        ASSERT_TRUE(de_stat.successful()) << de_stat.report();
+        ASSERT_EQ(restored_size, inputs[i].size());
+        ASSERT_THAT(restored, Pointwise(Eq(), inputs[i]));
+    }
+}
+
+TEST_P(EncodeDecodeTest, StreamingEncodeDecode)
+{
+    const CompressionParams compression = std::get<1>(GetParam());
+
+    std::vector<char> data {std::get<0>(GetParam())->get_data()};
+
+    std::stringstream compressed;
+    EncoderStreambuf encoder_streambuf(compressed, compression, 1000);
+    std::ostream encoder_stream(&encoder_streambuf);
+    // the data is pushed in pieces of varying sizes, with a flush cutting a block short halfway
+    std::size_t pos = 0, piece_size = 1;
+    bool flushed = false;
+    while (pos < data.size()) {
+        const std::size_t size = std::min(piece_size, data.size() - pos);
+        encoder_stream.write(data.data() + pos, size);
+        pos += size;
+        piece_size = piece_size * 7 % 4099 + 1;
+        if (not flushed && pos >= data.size() / 2) {
+            encoder_stream.flush();
+            flushed = true;
+        }
+    }
+    ASSERT_TRUE(encoder_stream.good());
+    EncodeStat en_stat = encoder_streambuf.finish();
+    EXPECT_TRUE(en_stat.successful()) << en_stat.report();
+    EXPECT_EQ(encoder_streambuf.get_encoder().get_input_size(), data.size());
+
+    const std::size_t compressed_size = compressed.tellp();
+    EXPECT_EQ(encoder_streambuf.get_encoder().get_output_size(), compressed_size);
+
+    std::stringstream restored_content;
+    DecodeStat de_stat = decode(restored_content, compressed_size, compressed, compression);
+    EXPECT_TRUE(de_stat.successful()) << de_stat.report();
+
+    ASSERT_THAT(restored_content.view(), Pointwise(Eq(), std::string_view(data.data(), data.size())));
+}
+
+TEST_P(EncodeDecodeTest, EncodeStreamingDecode)
+{
+    const CompressionParams compression = std::get<1>(GetParam());
+
+    std::vector<char> data {std::get<0>(GetParam())->get_data()};
+    std::stringstream content;
+    content.write(data.data(), data.size());
+
+    std::stringstream compressed;
+    EncodeStat en_stat = encode(content, data.size(), compressed, compression);
+    EXPECT_TRUE(en_stat.successful()) << en_stat.report();
+    const std::string_view encoded = compressed.view();
+
+    std::stringstream restored_content;
+    DecoderStreambuf decoder_streambuf(restored_content, compression, 1000);
+    std::ostream decoder_stream(&decoder_streambuf);
+    // the encoded data arrives in pieces of varying sizes, with a flush halfway
+    std::size_t pos = 0, piece_size = 1;
+    bool flushed = false;
+    while (pos < encoded.size()) {
+        const std::size_t size = std::min(piece_size, encoded.size() - pos);
+        decoder_stream.write(encoded.data() + pos, size);
+        pos += size;
+        piece_size = piece_size * 7 % 4099 + 1;
+        if (not flushed && pos >= encoded.size() / 2) {
+            decoder_stream.flush();
+            flushed = true;
+        }
+    }
+    ASSERT_TRUE(decoder_stream.good());
+    DecodeStat de_stat = decoder_streambuf.finish();
+    EXPECT_TRUE(de_stat.successful()) << de_stat.report();
+    EXPECT_EQ(decoder_streambuf.get_decoder().get_input_size(), encoded.size());
+    EXPECT_EQ(decoder_streambuf.get_decoder().get_output_size(), data.size());
+
+    ASSERT_THAT(restored_content.view(), Pointwise(Eq(), std::string_view(data.data(), data.size())));
+}
+
 static const auto test_inputs = make_generated_test_on_data_inputs(128, 1234, 16);
 
 #define SQUEEZE_TESTING_INSTANTIATE_COMPRESSION_TEST(method, level) \
@@ -83,4 +237,46 @@ SQUEEZE_TESTING_INSTANTIATE_COMPRESSION_TEST(Deflate, 8);
 
 #undef SQUEEZE_TESTING_INSTANTIATE_COMPRESSION_TEST
 
+TEST(EncoderPoolTest, ScheduleWhileWorkersLeave)
+{
+    using namespace std::chrono_literals;
+    const Buffer input(100, 'x');
+    const CompressionParams compression {CompressionMethod::None, 0};
+
+    for (unsigned concurrency : {1u, 2u}) {
+        misc::ThreadPool thread_pool(concurrency);
+        for (std::size_t i = 0; i < 2000; ++i) {
+            auto encoder_pool = std::make_unique<EncoderPool>(thread_pool);
+            // each task is scheduled right as a worker is done with the previous one, so that at times
+            // it's on its way out of the pool, neither taking tasks from it nor free to be assigned another one
+            std::vector<std::future<EncodedBuffer>> future_outputs;
+            for (std::size_t j = 0; j < 4; ++j) {
+                future_outputs.push_back(encoder_pool->schedule_buffer_encode(Buffer(input), compression));
+                if (j % 2 == 0) {
+                    ASSERT_EQ(future_outputs.back().wait_for(5s), std::future_status::ready)
+                        << "task " << j << " of pool " << i << " got stranded";
+                }
+            }
+
+            // the pool is destroyed right after scheduling the tasks, at times while they're being taken by a worker
+            // on its way out, or while the second worker assigned to it hasn't started yet, as the first one has
+            // taken all of them, on another thread, so that waiting for the tasks forever fails rather than hangs
+            std::promise<void> destroyed;
+            auto future_destroyed = destroyed.get_future();
+            std::jthread destroying_thread([&encoder_pool, &destroyed] {
+                encoder_pool.reset();
+                destroyed.set_value();
+            });
+            if (future_destroyed.wait_for(5s) != std::future_status::ready) {
+                // the stuck thread could neither be joined nor be left to outlive the thread pool
+                ADD_FAILURE() << "pool " << i << " got stuck waiting for its tasks";
+                std::abort();
+            }
+            destroying_thread.join();
+            for (auto& future_output : future_outputs)
+                ASSERT_TRUE(future_output.get().second.successful());
+        }
+    }
+}
+
 }
@@ -32,6 +32,7 @@ TEST(EntryHeader, EncodeDecode)
             EntryType(prng(0, 3)),
             EntryPermissions(prng(permissions_min, permissions_max)),
         },
+        .original_size = static_cast<uint64_t>(prng(0, std::numeric_limits<int>::max())),
         .path = test_tools::generators::gen_alphanumeric_string(prng(32, 64), prng),
     }, restored_entry_header;
 
@@ -61,6 +62,9 @@ TEST(EntryHeader, EncodeDecode)
     EXPECT_EQ(original_entry_header.attributes.get_permissions(),
               restored_entry_header.attributes.get_permissions());
 
+    EXPECT_EQ(original_entry_header.original_size,
+              restored_entry_header.original_size);
+
     EXPECT_EQ(original_entry_header.path.size(),
               restored_entry_header.path.size());
 
@@ -68,4 +72,98 @@ TEST(EntryHeader, EncodeDecode)
               restored_entry_header.path);
 }
 
+TEST(EntryHeader, EncodeDecodeWithoutOriginalSize)
+{
+    const SemVer older_version = {0, 2, 0};
+    ASSERT_LT(older_version, EntryHeader::original_size_version);
+
+    EntryHeader original_entry_header = {
+        .version = older_version,
+        .content_size = 1234,
+        .compression = {
+            .method = compression::CompressionMethod::None,
+            .level = 0,
+        },
+        .attributes = {EntryType::RegularFile, EntryPermissions::OwnerRead},
+        .original_size = 5678,
+        .path = "path",
+    }, restored_entry_header;
+
+    std::stringstream stream;
+
+    EntryHeader::encode(stream, original_entry_header);
+    EXPECT_EQ(stream.tellp(), original_entry_header.get_encoded_header_size());
+
+    EXPECT_TRUE(EntryHeader::decode(stream, restored_entry_header).successful());
+    EXPECT_EQ(stream.tellg(), original_entry_header.get_encoded_header_size());
+    EXPECT_FALSE(restored_entry_header.has_original_size());
+    EXPECT_EQ(original_entry_header.content_size, restored_entry_header.content_size);
+    EXPECT_EQ(original_entry_header.path, restored_entry_header.path);
+}
+
+TEST(EntryHeader, EncodeDecodeCompact)
+{
+    EntryHeader previous_entry_header = {
+        .version = version,
+        .content_size = 1234,
+        .compression = {
+            .method = compression::CompressionMethod::Deflate,
+            .level = 4,
+        },
+        .attributes = {EntryType::RegularFile, EntryPermissions::OwnerRead},
+        .original_size = 5678,
+        .compact = true,
+        .path = "dir/subdir/file",
+    };
+    EntryHeader original_entry_header = {
+        .version = version,
+        .content_size = 4321,
+        .compression = {
+            .method = compression::CompressionMethod::Huffman,
+            .level = 2,
+        },
+        .attributes = {EntryType::Symlink, EntryPermissions::All},
+        .original_size = 8765,
+        .compact = true,
+        .path = "dir/subdir/other",
+    }, restored_entry_header;
+    original_entry_header.path_prefix_size =
+        EntryHeader::get_shared_path_prefix_size(previous_entry_header.path, original_entry_header.path);
+    EXPECT_EQ(original_entry_header.path_prefix_size, 11);
+
+    std::stringstream stream;
+
+    EXPECT_TRUE(EntryHeader::encode(stream, previous_entry_header).successful());
+    EXPECT_EQ(stream.tellp(), previous_entry_header.get_encoded_header_size());
+    EXPECT_TRUE(EntryHeader::encode(stream, original_entry_header).successful());
+    EXPECT_EQ(stream.tellp(), previous_entry_header.get_encoded_header_size() +
+                              original_entry_header.get_encoded_header_size());
+
+    // the content size gets re-encoded in place, within the width reserved for it
+    original_entry_header.content_size = 6789;
+    stream.seekp(previous_entry_header.get_encoded_header_size());
+    EXPECT_TRUE(EntryHeader::encode_content_size(stream, original_entry_header).successful());
+
+    stream.seekg(previous_entry_header.get_encoded_header_size());
+    EXPECT_TRUE(EntryHeader::decode(stream, restored_entry_header, previous_entry_header.path).successful());
+    EXPECT_EQ(stream.tellg(), previous_entry_header.get_encoded_header_size() +
+                              original_entry_header.get_encoded_header_size());
+
+    EXPECT_TRUE(restored_entry_header.compact);
+    EXPECT_EQ(original_entry_header.version.data, restored_entry_header.version.data);
+    EXPECT_EQ(original_entry_header.content_size, restored_entry_header.content_size);
+    EXPECT_EQ(original_entry_header.compression.method, restored_entry_header.compression.method);
+    EXPECT_EQ(original_entry_header.compression.level, restored_entry_header.compression.level);
+    EXPECT_EQ(original_entry_header.attributes.get_type(), restored_entry_header.attributes.get_type());
+    EXPECT_EQ(original_entry_header.attributes.get_permissions(),
+              restored_entry_header.attributes.get_permissions());
+    EXPECT_EQ(original_entry_header.original_size, restored_entry_header.original_size);
+    EXPECT_EQ(original_entry_header.path_prefix_size, restored_entry_header.path_prefix_size);
+    EXPECT_EQ(original_entry_header.path, restored_entry_header.path);
+
+    // the prefix can't be longer than the previous path
+    stream.seekg(previous_entry_header.get_encoded_header_size());
+    EXPECT_TRUE(EntryHeader::decode(stream, restored_entry_header, "dir").failed());
+}
+
 }
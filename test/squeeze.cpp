@@ -5,23 +5,57 @@
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
 
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
 #include <sstream>
+#include <thread>
+#include <unordered_set>
 
 #include "squeeze/squeeze.h"
+#include "squeeze/entry_frames.h"
+#include "squeeze/stream_extracter.h"
 #include "squeeze/printing.h"
+#include "squeeze/stats.h"
+#include "squeeze/utils/fs.h"
+#include "squeeze/utils/mapped_file.h"
+#include "squeeze/utils/direct_file.h"
+#include "squeeze/utils/io.h"
+#include "squeeze/wrap/file_remover.h"
 
+#include "test_tools/generators/data_gen.h"
 #include "test_tools/generators/mockfs_gen.h"
 #include "test_tools/mock/entry_input.h"
 #include "test_tools/mock/entry_output.h"
+#include "test_common/temp_dir.h"
 #include "test_common/test_data.h"
 
 namespace squeeze::testing {
 
 using ::testing::Eq;
+using ::testing::HasSubstr;
 using ::testing::Pointwise;
 using namespace test_tools;
 using namespace test_common;
 
+/** Stream buffer of a string behaving like a pipe, refusing to seek or even report the position. */
+class NonSeekableStringbuf : public std::stringbuf {
+public:
+    using std::stringbuf::stringbuf;
+
+protected:
+    pos_type seekoff(off_type, std::ios_base::seekdir, std::ios_base::openmode) override
+    {
+        return pos_type(off_type(-1));
+    }
+
+    pos_type seekpos(pos_type, std::ios_base::openmode) override
+    {
+        return pos_type(off_type(-1));
+    }
+};
+
 static void observe_mockfs(const mock::FileSystem& mockfs, std::ostream& os)
 {
     auto observer =
@@ -137,15 +171,30 @@ static void decode_mockfs(Squeeze& squeeze, mock::FileSystem& restored_mockfs)
     }
 }
 
+static void stream_decode_mockfs(std::string_view content, mock::FileSystem& restored_mockfs)
+{
+    NonSeekableStringbuf pipe_buf{std::string(content), std::ios_base::in};
+    std::istream pipe(&pipe_buf);
+    StreamExtracter extracter(pipe);
+    while (extracter.next()) {
+        mock::EntryOutput mock_entry_output(restored_mockfs);
+        auto err = extracter.extract(mock_entry_output);
+        EXPECT_FALSE(err.failed()) << err.report();
+    }
+    EXPECT_FALSE(extracter.is_corrupted());
+}
+
 struct TestInput {
     int prng_seed;
     CompressionParams compression;
+    AppendParams append = {};
 };
 
 void PrintTo(const TestInput& test_input, std::ostream *os)
 {
     print_to(*os, "Squeeze test input: {prng_seed=", test_input.prng_seed,
-                                     ", compression=", test_input.compression, '}');
+                                     ", compression=", test_input.compression,
+                                     ", append=", test_input.append, '}');
 }
 
 class SqueezeTest : public ::testing::TestWithParam<TestInput> {
@@ -154,7 +203,9 @@ protected:
         prng(GetParam().prng_seed),
         content(std::ios_base::binary | std::ios_base::in | std::ios_base::out),
         squeeze(content)
-    {}
+    {
+        squeeze.set_params(GetParam().append);
+    }
 
     inline mock::FileSystem generate_mockfs()
     {
@@ -165,6 +216,12 @@ protected:
     {
         content.seekp(0, std::ios_base::beg);
         testing::encode_mockfs(squeeze, original_mockfs, GetParam().compression);
+        truncate_content();
+    }
+
+    /** Cut off the stale data the removes leave past the put pointer. */
+    inline void truncate_content()
+    {
         if (content.tellp() < content.view().size())
             content.str(std::string(content.view().substr(0, content.tellp())));
     }
@@ -174,6 +231,15 @@ protected:
         testing::decode_mockfs(squeeze, restored_mockfs);
     }
 
+    inline std::size_t count_blobs()
+    {
+        return std::count_if(squeeze.begin(), squeeze.end(),
+            [](const std::pair<uint64_t, EntryHeader>& pos_and_entry_header)
+            {
+                return pos_and_entry_header.second.attributes.get_type() == EntryType::Blob;
+            });
+    }
+
     inline void assert_if_corrupted()
     {
         content.seekg(0, std::ios_base::end);
@@ -205,6 +271,8 @@ TEST_P(SqueezeTest, WriteRead)
 
     encode_mockfs(generated_mockfs);
     assert_if_corrupted();
+    for (const auto& [pos, entry_header] : squeeze)
+        EXPECT_TRUE(entry_header.has_original_size()) << entry_header.path;
     decode_mockfs(recreated_mockfs);
 
     test_mockfs(generated_mockfs, recreated_mockfs);
@@ -237,6 +305,88 @@ TEST_P(SqueezeTest, WriteUpdateRead)
     }
 }
 
+TEST_P(SqueezeTest, WriteUpdateStreamRead)
+{
+    mock::FileSystem generated_mockfs = generate_mockfs(), recreated_mockfs;
+
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+    generated_mockfs.update(generate_mockfs());
+
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+    stream_decode_mockfs(content.view(), recreated_mockfs);
+
+    test_mockfs(generated_mockfs, recreated_mockfs);
+}
+
+TEST_P(SqueezeTest, WriteUpdateUpdateRead)
+{
+    mock::FileSystem generated_mockfs = generate_mockfs(), recreated_mockfs;
+
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+    generated_mockfs.update(generate_mockfs());
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+    generated_mockfs.update(generate_mockfs());
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+    decode_mockfs(recreated_mockfs);
+
+    test_mockfs(generated_mockfs, recreated_mockfs);
+}
+
+TEST_P(SqueezeTest, WriteRewriteRead)
+{
+    mock::FileSystem generated_mockfs = generate_mockfs(), recreated_mockfs;
+
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+    const std::size_t nr_blobs = count_blobs();
+
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+    EXPECT_EQ(count_blobs(), nr_blobs) << "unreferred blobs weren't removed";
+    decode_mockfs(recreated_mockfs);
+
+    test_mockfs(generated_mockfs, recreated_mockfs);
+}
+
+TEST_P(SqueezeTest, WriteRemoveRead)
+{
+    mock::FileSystem generated_mockfs = generate_mockfs(), recreated_mockfs;
+
+    encode_mockfs(generated_mockfs);
+    assert_if_corrupted();
+
+    wrap::FileRemover remover(squeeze);
+    std::deque<Writer::Stat> remove_stats;
+    generated_mockfs.list_recursively<mock::RegularFile>(
+        [&remover, &remove_stats](const std::string& path, auto)
+        {
+            remove_stats.emplace_back();
+            remover.will_remove(path, &remove_stats.back());
+        }
+    );
+    EXPECT_TRUE(squeeze.perform_removes());
+    truncate_content();
+    assert_if_corrupted();
+    for (const auto& stat : remove_stats)
+        EXPECT_FALSE(stat.failed()) << stat.report();
+    EXPECT_EQ(count_blobs(), 0) << "unreferred blobs weren't removed";
+
+    decode_mockfs(recreated_mockfs);
+    std::size_t nr_regular_files = 0;
+    recreated_mockfs.list_recursively<mock::RegularFile>(
+        [&nr_regular_files](const std::string&, auto)
+        {
+            ++nr_regular_files;
+        }
+    );
+    EXPECT_EQ(nr_regular_files, 0);
+}
+
 static constexpr int prng_seed = 1234;
 
 #define SQUEEZE_TESTING_INSTANTIATE_COMPRESSION_TEST(method, level) \
@@ -264,4 +414,1001 @@ SQUEEZE_TESTING_INSTANTIATE_COMPRESSION_TEST(Deflate, 8);
 
 #undef SQUEEZE_TESTING_INSTANTIATE_COMPRESSION_TEST
 
+static constexpr std::size_t solid_group_size = 1 << 15;
+
+#define SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST(method, level) \
+    INSTANTIATE_TEST_SUITE_P(Solid_##method##_##level, SqueezeTest, \
+            ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::method, level}, \
+                                         {.solid = {solid_group_size, true}}}))
+
+SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST(None,    0);
+SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST(Huffman, 1);
+SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST(Huffman, 8);
+SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST(Deflate, 0);
+SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST(Deflate, 4);
+SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST(Deflate, 8);
+
+#undef SQUEEZE_TESTING_INSTANTIATE_SOLID_TEST
+
+static constexpr std::size_t dedup_avg_chunk_size = 1 << 12;
+
+#define SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(method, level) \
+    INSTANTIATE_TEST_SUITE_P(Dedup_##method##_##level, SqueezeTest, \
+            ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::method, level}, \
+                                         {.dedup = {dedup_avg_chunk_size}}}))
+
+SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(None,    0);
+SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(Huffman, 4);
+SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(Deflate, 0);
+SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(Deflate, 8);
+
+#undef SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST
+
+#define SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(method, level) \
+    INSTANTIATE_TEST_SUITE_P(DedupFiles_##method##_##level, SqueezeTest, \
+            ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::method, level}, \
+                                         {.dedup = {.whole_files = true}}}))
+
+SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(None,    0);
+SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(Huffman, 4);
+SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST(Deflate, 8);
+
+#undef SQUEEZE_TESTING_INSTANTIATE_DEDUP_TEST
+
+#define SQUEEZE_TESTING_INSTANTIATE_SOLID_DEDUP_TEST(method, level) \
+    INSTANTIATE_TEST_SUITE_P(SolidDedup_##method##_##level, SqueezeTest, \
+            ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::method, level}, \
+                                         {{solid_group_size, true}, {dedup_avg_chunk_size}}}))
+
+#define SQUEEZE_TESTING_INSTANTIATE_SOLID_DEDUP_FILES_TEST(method, level) \
+    INSTANTIATE_TEST_SUITE_P(SolidDedupFiles_##method##_##level, SqueezeTest, \
+            ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::method, level}, \
+                                         {{solid_group_size, true}, {.whole_files = true}}}))
+
+SQUEEZE_TESTING_INSTANTIATE_SOLID_DEDUP_TEST(Deflate, 4);
+SQUEEZE_TESTING_INSTANTIATE_SOLID_DEDUP_FILES_TEST(Deflate, 4);
+
+#undef SQUEEZE_TESTING_INSTANTIATE_SOLID_DEDUP_FILES_TEST
+
+#undef SQUEEZE_TESTING_INSTANTIATE_SOLID_DEDUP_TEST
+
+#define SQUEEZE_TESTING_INSTANTIATE_DELTA_TEST(method, level) \
+    INSTANTIATE_TEST_SUITE_P(Delta_##method##_##level, SqueezeTest, \
+            ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::method, level}, \
+                                         {.delta = {.enabled = true}}}))
+
+SQUEEZE_TESTING_INSTANTIATE_DELTA_TEST(None,    0);
+SQUEEZE_TESTING_INSTANTIATE_DELTA_TEST(Huffman, 4);
+SQUEEZE_TESTING_INSTANTIATE_DELTA_TEST(Deflate, 0);
+SQUEEZE_TESTING_INSTANTIATE_DELTA_TEST(Deflate, 4);
+SQUEEZE_TESTING_INSTANTIATE_DELTA_TEST(Deflate, 8);
+
+#undef SQUEEZE_TESTING_INSTANTIATE_DELTA_TEST
+
+INSTANTIATE_TEST_SUITE_P(DedupDelta_Deflate_4, SqueezeTest,
+        ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::Deflate, 4},
+                                     {.dedup = {dedup_avg_chunk_size}, .delta = {.enabled = true}}}));
+
+#define SQUEEZE_TESTING_INSTANTIATE_COMPACT_TEST(method, level) \
+    INSTANTIATE_TEST_SUITE_P(Compact_##method##_##level, SqueezeTest, \
+            ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::method, level}, \
+                                         {.compact_headers = true}}))
+
+SQUEEZE_TESTING_INSTANTIATE_COMPACT_TEST(None,    0);
+SQUEEZE_TESTING_INSTANTIATE_COMPACT_TEST(Huffman, 4);
+SQUEEZE_TESTING_INSTANTIATE_COMPACT_TEST(Deflate, 4);
+
+#undef SQUEEZE_TESTING_INSTANTIATE_COMPACT_TEST
+
+INSTANTIATE_TEST_SUITE_P(CompactSolidDedupDelta_Deflate_4, SqueezeTest,
+        ::testing::Values(TestInput {prng_seed, {compression::CompressionMethod::Deflate, 4},
+                                     {.solid = {solid_group_size, true}, .dedup = {dedup_avg_chunk_size},
+                                      .delta = {.enabled = true}, .compact_headers = true}}));
+
+TEST(SqueezeDedupTest, StoreRepeatedChunkOnce)
+{
+    std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    squeeze.set_params({.dedup = {dedup_avg_chunk_size}});
+    test_tools::generators::PRNG prng(1234);
+
+    // incompressible data repeated within a file and across the files
+    std::string repeated(16 * dedup_avg_chunk_size, '\0');
+    for (char& c : repeated)
+        c = static_cast<char>(prng(0, 255));
+    const std::vector<std::string> contents = {repeated + repeated + repeated, repeated};
+
+    std::vector<Writer::Stat> stats(contents.size());
+    std::vector<std::istringstream> streams(contents.size());
+    for (std::size_t i = 0; i < contents.size(); ++i) {
+        streams[i].str(contents[i]);
+        squeeze.will_append<CustomContentEntryInput>(stats[i], "file" + stringify(i),
+                CompressionParams{compression::CompressionMethod::None, 0}, &streams[i],
+                EntryAttributes{EntryType::RegularFile, EntryPermissions::OwnerRead});
+    }
+    EXPECT_TRUE(squeeze.update());
+    for (const auto& stat : stats)
+        ASSERT_FALSE(stat.failed()) << stat.report();
+    EXPECT_FALSE(squeeze.is_corrupted());
+
+    std::size_t nr_blobs = 0, nr_references = 0;
+    std::unordered_set<std::string> referred_blob_paths;
+    std::vector<EntryReference> references;
+    for (auto it = squeeze.begin(); it != squeeze.end(); ++it) {
+        if (it->second.attributes.get_type() == EntryType::Blob) {
+            ++nr_blobs;
+            continue;
+        }
+        ASSERT_FALSE(squeeze.read_references(it, references).failed());
+        nr_references += references.size();
+        for (const auto& reference : references)
+            referred_blob_paths.insert(reference.blob_id.to_path());
+    }
+    EXPECT_EQ(nr_blobs, referred_blob_paths.size()) << "a chunk was stored more than once";
+    EXPECT_GT(nr_references, 2 * nr_blobs);
+    EXPECT_LT(content.view().size(), 2 * repeated.size());
+
+    // the chunks are referred to back and forth, so they get evicted from a small blob cache and decoded again
+    for (std::size_t capacity : {BlobCache::default_capacity, std::size_t(1)}) {
+        squeeze.set_blob_cache_capacity(capacity);
+        for (std::size_t i = 0; i < contents.size(); ++i) {
+            std::ostringstream output;
+            auto s = squeeze.extract(squeeze.find("file" + stringify(i)), output);
+            ASSERT_FALSE(s.failed()) << s.report();
+            EXPECT_TRUE(output.view() == contents[i]) << "file" << i << ", capacity=" << capacity;
+        }
+    }
+
+    // the blobs can't be decoded again from a stream, so the ones evicted from a small blob cache are missed
+    for (std::size_t capacity : {BlobCache::default_capacity, std::size_t(1)}) {
+        NonSeekableStringbuf stream_buf{std::string(content.view()), std::ios_base::in};
+        std::istream stream(&stream_buf);
+        StreamExtracter extracter(stream);
+        extracter.set_blob_cache_capacity(capacity);
+        std::size_t nr_failed = 0;
+        while (extracter.next()) {
+            if (extracter.get_header().attributes.get_type() == EntryType::Blob)
+                continue;
+            const std::size_t i = extracter.get_path() == "file0" ? 0 : 1;
+            std::ostringstream output;
+            auto s = extracter.extract(output);
+            if (s.failed()) {
+                ++nr_failed;
+                EXPECT_THAT(s.report(), HasSubstr("evicted")) << "file" << i;
+                continue;
+            }
+            EXPECT_TRUE(output.view() == contents[i]) << "file" << i << ", capacity=" << capacity;
+        }
+        EXPECT_FALSE(extracter.is_corrupted());
+        EXPECT_EQ(nr_failed > 0, capacity == 1);
+    }
+}
+
+TEST(SqueezeDedupTest, StoreDuplicateFilesOnce)
+{
+    test_tools::generators::PRNG prng(1234);
+    auto generate = [&prng](std::size_t size)
+    {
+        std::string content(size, '\0');
+        for (char& c : content)
+            c = static_cast<char>(prng(0, 255));
+        return content;
+    };
+
+    // incompressible files of the same content, with another one of the same size, which gets hashed ahead
+    const std::string duplicated = generate(1 << 16);
+    std::vector<std::pair<std::string, std::string>> files = {
+        {"other", generate(duplicated.size())}, {"first", duplicated}, {"smaller", generate(1000)},
+        {"second", duplicated}, {"third", duplicated},
+    };
+
+    auto append = [](Squeeze& squeeze, const std::vector<std::pair<std::string, std::string>>& files)
+    {
+        std::vector<Writer::Stat> stats(files.size());
+        std::vector<std::istringstream> streams(files.size());
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            streams[i].str(files[i].second);
+            squeeze.will_append<CustomContentEntryInput>(stats[i], std::string(files[i].first),
+                    CompressionParams{compression::CompressionMethod::Deflate, 4}, &streams[i],
+                    EntryAttributes{EntryType::RegularFile, EntryPermissions::OwnerRead});
+        }
+        EXPECT_TRUE(squeeze.update());
+        for (const auto& stat : stats)
+            EXPECT_FALSE(stat.failed()) << stat.report();
+    };
+    auto expect_files = [&files](Squeeze& squeeze)
+    {
+        for (const auto& [path, content] : files) {
+            std::ostringstream output;
+            auto s = squeeze.extract(squeeze.find(path), output);
+            ASSERT_FALSE(s.failed()) << path << ": " << s.report();
+            EXPECT_TRUE(output.view() == content) << path;
+        }
+    };
+
+    std::stringstream plain_content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze plain_squeeze(plain_content);
+    append(plain_squeeze, files);
+
+    std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    squeeze.set_params({.dedup = {.whole_files = true}});
+    append(squeeze, files);
+    EXPECT_FALSE(squeeze.is_corrupted());
+    EXPECT_LT(content.view().size() + 3 * duplicated.size() / 2, plain_content.view().size());
+
+    // the first copy is stored as is, without any blob
+    for (auto it = squeeze.begin(); it != squeeze.end(); ++it) {
+        const bool duplicate = it->second.path == "second" || it->second.path == "third";
+        EXPECT_EQ(it->second.content_layout,
+                  duplicate ? EntryContentLayout::Duplicate : EntryContentLayout::Plain) << it->second.path;
+    }
+    expect_files(squeeze);
+
+    // the referred content has gone by in a stream, so it's kept for the duplicates unless the capacity is too small
+    for (std::size_t capacity : {BlobCache::default_capacity, std::size_t(1)}) {
+        NonSeekableStringbuf stream_buf{std::string(content.view()), std::ios_base::in};
+        std::istream stream(&stream_buf);
+        StreamExtracter extracter(stream);
+        extracter.set_blob_cache_capacity(capacity);
+        for (const auto& [path, file_content] : files) {
+            ASSERT_TRUE(extracter.next());
+            ASSERT_EQ(extracter.get_path(), path);
+            // the first copy is skipped, which the duplicates don't depend on
+            if (path == "first")
+                continue;
+            std::ostringstream output;
+            auto s = extracter.extract(output);
+            const bool duplicate = path == "second" || path == "third";
+            if (duplicate && capacity == 1) {
+                EXPECT_TRUE(s.failed()) << path;
+                continue;
+            }
+            ASSERT_FALSE(s.failed()) << path << ": " << s.report();
+            EXPECT_TRUE(output.view() == file_content) << path << ", capacity=" << capacity;
+        }
+        EXPECT_FALSE(extracter.next());
+        EXPECT_FALSE(extracter.is_corrupted());
+    }
+
+    // cuts off the stale data the removes leave past the put pointer
+    auto truncate = [&content]()
+    {
+        content.str(std::string(content.view().substr(0, content.tellp())));
+    };
+
+    // the contents following the removed entry get moved, so the references to them get updated
+    squeeze.will_remove(squeeze.find("other"));
+    EXPECT_TRUE(squeeze.perform_removes());
+    truncate();
+    files.erase(files.begin());
+    expect_files(squeeze);
+
+    // the content of the updated first copy gets taken over by the following duplicate
+    files[0].second = generate(duplicated.size());
+    append(squeeze, {files[0]});
+    truncate();
+    EXPECT_EQ(squeeze.find("second")->second.content_layout, EntryContentLayout::Plain);
+    EXPECT_EQ(squeeze.find("third")->second.content_layout, EntryContentLayout::Duplicate);
+    expect_files(squeeze);
+}
+
+TEST(SqueezeDeltaTest, UpdateSlightlyChangedFile)
+{
+    const generators::PRNG prng(1234);
+    const std::vector<char> data = generators::gen_data(prng, TestData::get_data_seed(), std::size_t(1) << 18);
+    std::string original(data.begin(), data.end()), changed = original;
+    for (int i = 0; i < 16; ++i)
+        changed[prng(std::size_t(0), changed.size() - 1)] ^= 0x5a;
+
+    // the stale data the removes leave past the put pointer gets cut off after each update
+    auto update = [](Squeeze& squeeze, std::stringstream& squeeze_content, const std::string& content)
+    {
+        Writer::Stat stat;
+        std::istringstream stream(content);
+        squeeze.will_append<CustomContentEntryInput>(stat, "file",
+                CompressionParams{compression::CompressionMethod::Deflate, 4}, &stream,
+                EntryAttributes{EntryType::RegularFile, EntryPermissions::OwnerRead});
+        EXPECT_TRUE(squeeze.update());
+        EXPECT_FALSE(stat.failed()) << stat.report();
+        squeeze_content.str(std::string(squeeze_content.view().substr(0, squeeze_content.tellp())));
+    };
+    auto expect_file = [](Squeeze& squeeze, const std::string& content)
+    {
+        std::ostringstream output;
+        auto s = squeeze.extract(squeeze.find("file"), output);
+        ASSERT_FALSE(s.failed()) << s.report();
+        EXPECT_TRUE(output.view() == content);
+    };
+
+    std::stringstream plain_content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze plain_squeeze(plain_content);
+    update(plain_squeeze, plain_content, original);
+    update(plain_squeeze, plain_content, changed);
+
+    std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    squeeze.set_params({.delta = {.enabled = true}});
+    update(squeeze, content, original);
+
+    // an unchanged content is stored as before, without any base
+    update(squeeze, content, original);
+    EXPECT_EQ(std::distance(squeeze.begin(), squeeze.end()), 1);
+    EXPECT_EQ(squeeze.find("file")->second.content_layout, EntryContentLayout::Plain);
+    expect_file(squeeze, original);
+
+    update(squeeze, content, changed);
+    EXPECT_FALSE(squeeze.is_corrupted());
+    const EntryHeader& delta_header = squeeze.find("file")->second;
+    EXPECT_EQ(delta_header.content_layout, EntryContentLayout::Delta);
+    EXPECT_LT(4 * delta_header.content_size, plain_squeeze.find("file")->second.content_size);
+    expect_file(squeeze, changed);
+}
+
+/** Entry input claiming a huge original size, as a corrupted entry header would. */
+class HugeOriginalSizeEntryInput : public CustomContentEntryInput {
+public:
+    using CustomContentEntryInput::CustomContentEntryInput;
+
+    Stat init(EntryHeader& entry_header, ContentType& content) override
+    {
+        Stat s = CustomContentEntryInput::init(entry_header, content);
+        entry_header.original_size = uint64_t(1) << 62;
+        return s;
+    }
+};
+
+TEST(SqueezeDeltaTest, UpdateFileOfCorruptedOriginalSize)
+{
+    std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    squeeze.set_params({.delta = {.enabled = true}});
+
+    const std::string original(1000, 'a'), updated(1000, 'b');
+    std::istringstream original_stream(original), updated_stream(updated);
+    const CompressionParams compression {compression::CompressionMethod::Deflate, 4};
+    const EntryAttributes attributes {EntryType::RegularFile, EntryPermissions::OwnerRead};
+    ASSERT_FALSE(squeeze.append<HugeOriginalSizeEntryInput>(
+                "file", compression, &original_stream, attributes).failed());
+
+    // the base isn't allocated by the original size, which doesn't match, so the file is updated as is
+    Writer::Stat stat;
+    squeeze.will_append<CustomContentEntryInput>(stat, "file", compression, &updated_stream, attributes);
+    EXPECT_NO_THROW(EXPECT_TRUE(squeeze.update()));
+    ASSERT_FALSE(stat.failed()) << stat.report();
+    content.str(std::string(content.view().substr(0, content.tellp())));
+
+    const EntryHeader& entry_header = squeeze.find("file")->second;
+    EXPECT_EQ(entry_header.content_layout, EntryContentLayout::Plain);
+    std::ostringstream output;
+    ASSERT_FALSE(squeeze.extract(squeeze.find("file"), output).failed());
+    EXPECT_TRUE(output.view() == updated);
+}
+
+TEST(SqueezeSparseTest, WriteReadSparseFile)
+{
+    namespace fs = std::filesystem;
+    const TempDir dir("squeeze_sparse_test");
+    const std::string path = (dir / "sparse").string();
+
+    // data at the beginning and in the middle, with holes in between and at the end
+    static constexpr uint64_t mid_pos = 1 << 20, size = 4 << 20;
+    {
+        std::ofstream file(path, std::ios_base::binary);
+        file << "head";
+        file.seekp(mid_pos);
+        file << "middle";
+    }
+    fs::resize_file(path, size);
+    EntryExtentMap map;
+    ASSERT_FALSE(utils::get_data_extents(path, map).failed());
+    ASSERT_EQ(map.size, size);
+    if (map.get_data_size() == map.size) {
+        GTEST_SKIP() << "the file system doesn't report the holes";
+    }
+    std::string original(size, '\0');
+    std::ifstream(path, std::ios_base::binary).read(original.data(), original.size());
+
+    std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    Writer::Stat write_stat;
+    squeeze.will_append<FileEntryInput>(write_stat, std::string(path),
+                                        CompressionParams{compression::CompressionMethod::Deflate, 4});
+    EXPECT_TRUE(squeeze.update());
+    ASSERT_FALSE(write_stat.failed()) << write_stat.report();
+
+    auto it = squeeze.find(path);
+    ASSERT_NE(it, squeeze.end());
+    EXPECT_EQ(it->second.content_layout, EntryContentLayout::Sparse);
+    EXPECT_EQ(it->second.original_size, size);
+
+    fs::remove(path);
+    auto s = squeeze.extract(it);
+    ASSERT_FALSE(s.failed()) << s.report();
+    ASSERT_EQ(fs::file_size(path), size);
+    std::string restored(size, '\1');
+    std::ifstream(path, std::ios_base::binary).read(restored.data(), restored.size());
+    EXPECT_TRUE(restored == original) << "sparse file didn't restore properly";
+
+    std::ostringstream custom_output;
+    s = squeeze.extract(it, custom_output);
+    ASSERT_FALSE(s.failed()) << s.report();
+    EXPECT_TRUE(custom_output.str() == original) << "sparse file didn't restore properly to a custom stream";
+}
+
+TEST(SqueezeMappedTest, ExtractMappedFile)
+{
+    if (not utils::MappedFileStreambuf::is_supported())
+        GTEST_SKIP() << "memory mapping isn't supported";
+
+    namespace fs = std::filesystem;
+    const TempDir dir("squeeze_mapped_test");
+    const std::string path = (dir / "large").string();
+
+    static constexpr std::size_t size = (3 << 20) + 12345;
+    static_assert(size >= FileEntryOutput::mapped_output_min_size);
+    const generators::PRNG prng(1234);
+    const std::vector<char> data = generators::gen_data(prng, TestData::get_data_seed(), size);
+    std::string original(data.begin(), data.end());
+
+    for (const auto method : {compression::CompressionMethod::Deflate, compression::CompressionMethod::None}) {
+        std::ofstream(path, std::ios_base::binary).write(original.data(), original.size());
+
+        std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+        Squeeze squeeze(content);
+        Writer::Stat write_stat;
+        squeeze.will_append<FileEntryInput>(write_stat, std::string(path), CompressionParams{method, 4});
+        EXPECT_TRUE(squeeze.update());
+        ASSERT_FALSE(write_stat.failed()) << write_stat.report();
+
+        auto it = squeeze.find(path);
+        ASSERT_NE(it, squeeze.end());
+        fs::remove(path);
+        auto s = squeeze.extract(it);
+        ASSERT_FALSE(s.failed()) << s.report();
+        ASSERT_EQ(fs::file_size(path), size);
+        std::string restored(size, '\1');
+        std::ifstream(path, std::ios_base::binary).read(restored.data(), restored.size());
+        EXPECT_TRUE(restored == original) << "mapped file didn't restore properly";
+    }
+
+    // a file whose space can't be allocated, e.g. of a corrupted original size, is written as usual instead
+    {
+        std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+        Squeeze squeeze(content);
+        std::istringstream original_stream(original);
+        auto s = squeeze.append<HugeOriginalSizeEntryInput>(std::string(path),
+                CompressionParams{compression::CompressionMethod::Deflate, 4}, &original_stream,
+                EntryAttributes{EntryType::RegularFile, EntryPermissions::OwnerRead | EntryPermissions::OwnerWrite});
+        ASSERT_FALSE(s.failed()) << s.report();
+        fs::remove(path);
+        s = squeeze.extract(squeeze.find(path));
+        ASSERT_FALSE(s.failed()) << s.report();
+        ASSERT_EQ(fs::file_size(path), size);
+        std::string restored(size, '\1');
+        std::ifstream(path, std::ios_base::binary).read(restored.data(), restored.size());
+        EXPECT_TRUE(restored == original) << "unmappable file didn't restore properly";
+    }
+
+    // a file of an unknown size grows past its mapping and gets truncated to the size written up to
+    {
+        utils::MappedFileStreambuf mapped_file;
+        ASSERT_FALSE(mapped_file.open(path, 0).failed());
+        std::ostream output(&mapped_file);
+        output.write(original.data(), original.size());
+        output.seekp(4);
+        output << "seek";
+        EXPECT_FALSE(output.fail());
+        ASSERT_FALSE(mapped_file.close().failed());
+    }
+    ASSERT_EQ(fs::file_size(path), size);
+    std::string restored(size, '\1');
+    std::ifstream(path, std::ios_base::binary).read(restored.data(), restored.size());
+    original.replace(4, 4, "seek");
+    EXPECT_TRUE(restored == original) << "mapped file wasn't written properly";
+}
+
+TEST(SqueezeFileCopyTest, AppendExtractStoredFiles)
+{
+    namespace fs = std::filesystem;
+    const TempDir dir("squeeze_file_copy_test");
+    const std::string archive_path = (dir / "archive.sqz").string();
+
+    // stored files large enough to be copied right between the files, around a small and a compressed one
+    const std::vector<std::pair<std::string, compression::CompressionMethod>> files = {
+        {(dir / "large").string(), compression::CompressionMethod::None},
+        {(dir / "small").string(), compression::CompressionMethod::None},
+        {(dir / "compressed").string(), compression::CompressionMethod::Deflate},
+        {(dir / "large2").string(), compression::CompressionMethod::None},
+    };
+    const std::vector<std::size_t> sizes = {(1 << 20) + 3, 100, 1 << 17, utils::min_file_copy_size};
+    const generators::PRNG prng(1234);
+    std::vector<std::string> originals;
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        const std::vector<char> data = generators::gen_data(prng, TestData::get_data_seed(), sizes[i]);
+        const std::string& original = originals.emplace_back(data.begin(), data.end());
+        std::ofstream(files[i].first, std::ios_base::binary).write(original.data(), original.size());
+    }
+
+    std::fstream archive(archive_path, std::ios_base::binary | std::ios_base::in |
+                                       std::ios_base::out | std::ios_base::trunc);
+    ASSERT_TRUE(archive.is_open());
+    Squeeze squeeze(archive);
+    std::vector<Writer::Stat> stats(files.size());
+    for (std::size_t i = 0; i < files.size(); ++i)
+        squeeze.will_append<FileEntryInput>(stats[i], std::string(files[i].first),
+                                            CompressionParams{files[i].second, 0});
+    EXPECT_TRUE(squeeze.update());
+    for (const auto& stat : stats)
+        ASSERT_FALSE(stat.failed()) << stat.report();
+
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        auto it = squeeze.find(files[i].first);
+        ASSERT_NE(it, squeeze.end());
+        EXPECT_EQ(it->second.original_size, sizes[i]);
+
+        fs::remove(files[i].first);
+        auto s = squeeze.extract(it);
+        ASSERT_FALSE(s.failed()) << s.report();
+        ASSERT_EQ(fs::file_size(files[i].first), sizes[i]);
+        std::string restored(sizes[i], '\1');
+        std::ifstream(files[i].first, std::ios_base::binary).read(restored.data(), restored.size());
+        EXPECT_TRUE(restored == originals[i]) << "'" << files[i].first << "' didn't restore properly";
+
+        std::ostringstream custom_output;
+        s = squeeze.extract(it, custom_output);
+        ASSERT_FALSE(s.failed()) << s.report();
+        EXPECT_TRUE(custom_output.str() == originals[i]) << "'" << files[i].first << "' didn't restore properly";
+    }
+}
+
+TEST(SqueezePrefetchTest, ExtractWithPrefetching)
+{
+    const TempDir dir("squeeze_prefetch_test");
+    const std::string archive_path = (dir / "archive.sqz").string();
+
+    const generators::PRNG prng(1234);
+    std::vector<std::string> contents;
+    for (std::size_t i = 0; i < 40; ++i) {
+        const std::vector<char> data = generators::gen_data(prng, TestData::get_data_seed(), (i * 7919) % 300000);
+        contents.emplace_back(data.begin(), data.end());
+    }
+
+    std::fstream archive(archive_path, std::ios_base::binary | std::ios_base::in |
+                                       std::ios_base::out | std::ios_base::trunc);
+    ASSERT_TRUE(archive.is_open());
+    Squeeze squeeze(archive);
+    std::vector<Writer::Stat> stats(contents.size());
+    std::vector<std::istringstream> inputs;
+    inputs.reserve(contents.size());
+    for (std::size_t i = 0; i < contents.size(); ++i)
+        squeeze.will_append<CustomContentEntryInput>(stats[i], "entry" + std::to_string(i),
+                CompressionParams{i % 2 ? compression::CompressionMethod::Deflate :
+                                          compression::CompressionMethod::None, 1},
+                &inputs.emplace_back(contents[i]),
+                EntryAttributes{EntryType::RegularFile, EntryPermissions::OwnerRead});
+    EXPECT_TRUE(squeeze.update());
+    for (const auto& stat : stats)
+        ASSERT_FALSE(stat.failed()) << stat.report();
+
+    // few entries ahead, so that the prefetching waits on the extraction
+    squeeze.start_prefetching(2);
+    std::size_t i = 0;
+    for (auto it = squeeze.begin(); it != squeeze.end(); ++it, ++i) {
+        ASSERT_LT(i, contents.size());
+        EXPECT_EQ(it->second.path, "entry" + std::to_string(i));
+        std::ostringstream output;
+        auto s = squeeze.extract(it, output);
+        ASSERT_FALSE(s.failed()) << s.report();
+        EXPECT_TRUE(output.str() == contents[i]) << "entry" << i << " didn't restore properly";
+    }
+    EXPECT_EQ(i, contents.size());
+    squeeze.stop_prefetching();
+
+    // stopping right away doesn't wait for the prefetching to get anywhere
+    squeeze.start_prefetching();
+    squeeze.stop_prefetching();
+
+    // the readahead of a content larger than the window gets hinted as it's decoded
+    squeeze.set_readahead(1 << 16);
+    i = 0;
+    for (auto it = squeeze.begin(); it != squeeze.end(); ++it, ++i) {
+        std::ostringstream output;
+        auto s = squeeze.extract(it, output);
+        ASSERT_FALSE(s.failed()) << s.report();
+        EXPECT_TRUE(output.str() == contents[i]) << "entry" << i << " didn't restore properly with readahead";
+    }
+    squeeze.set_readahead(0);
+
+    // the entries get read ahead up to the number asked for, then past the position advanced to
+    {
+        auto wait_for_prefetched = [](const EntryPrefetcher& prefetcher, std::size_t nr_entries)
+        {
+            using namespace std::chrono_literals;
+            const auto deadline = std::chrono::steady_clock::now() + 10s;
+            while (prefetcher.get_nr_entries_prefetched() < nr_entries && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(1ms);
+            return prefetcher.get_nr_entries_prefetched();
+        };
+        archive.flush();
+        EntryPrefetcher prefetcher(archive, 2);
+        ASSERT_TRUE(prefetcher.is_active());
+        EXPECT_EQ(wait_for_prefetched(prefetcher, 2), 2);
+        prefetcher.advance(std::next(squeeze.begin(), 2)->first);
+        EXPECT_EQ(wait_for_prefetched(prefetcher, 4), 4);
+    }
+
+    EXPECT_TRUE(EntryPrefetcher(archive).is_active());
+    std::stringstream non_file;
+    EXPECT_FALSE(EntryPrefetcher(non_file).is_active());
+}
+
+TEST(SqueezeDirectIOTest, UpdateExtractDirectly)
+{
+    namespace fs = std::filesystem;
+    const TempDir dir("squeeze_direct_io_test");
+    const fs::path archive_path = dir / "archive.sqz";
+
+    utils::DirectFileStreambuf direct_file;
+    StatCode sc = direct_file.open(archive_path, std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
+    if (sc.failed())
+        GTEST_SKIP() << "direct I/O isn't supported here: " << sc.report();
+
+    // contents spanning several windows, and ones ending at unaligned positions
+    const std::vector<std::size_t> sizes = {utils::DirectFileStreambuf::window_size + 12345, 1, 4095, 70000,
+                                            2 * utils::DirectFileStreambuf::window_size - 7};
+    const generators::PRNG prng(1234);
+    std::vector<std::string> contents;
+    for (std::size_t size : sizes) {
+        const std::vector<char> data = generators::gen_data(prng, TestData::get_data_seed(), size);
+        contents.emplace_back(data.begin(), data.end());
+    }
+    std::vector<std::istringstream> inputs;
+    inputs.reserve(contents.size());
+    {
+        std::iostream archive(&direct_file);
+        Squeeze squeeze(archive);
+        std::vector<Writer::Stat> stats(contents.size());
+        for (std::size_t i = 0; i < contents.size(); ++i)
+            squeeze.will_append<CustomContentEntryInput>(stats[i], "entry" + std::to_string(i),
+                    CompressionParams{i % 2 ? compression::CompressionMethod::Deflate :
+                                              compression::CompressionMethod::None, 2},
+                    &inputs.emplace_back(contents[i]),
+                    EntryAttributes{EntryType::RegularFile, EntryPermissions::OwnerRead});
+        EXPECT_TRUE(squeeze.update());
+        for (const auto& stat : stats)
+            ASSERT_FALSE(stat.failed()) << stat.report();
+
+        // the entries following the removed one get moved back through the window
+        squeeze.will_remove(squeeze.find("entry1"));
+        EXPECT_TRUE(squeeze.update());
+        ASSERT_FALSE(direct_file.resize(archive.tellp()).failed());
+    }
+    ASSERT_FALSE(direct_file.close().failed());
+    const uint64_t archive_size = fs::file_size(archive_path);
+
+    ASSERT_FALSE(direct_file.open(archive_path, std::ios_base::in).failed());
+    {
+        std::istream archive(&direct_file);
+        Reader reader(archive);
+        std::size_t nr_entries = 0;
+        for (auto it = reader.begin(); it != reader.end(); ++it, ++nr_entries) {
+            const std::size_t i = std::stoul(it->second.path.substr(std::string_view("entry").size()));
+            ASSERT_LT(i, contents.size());
+            EXPECT_NE(i, 1);
+            std::ostringstream output;
+            auto s = reader.extract(it, output);
+            ASSERT_FALSE(s.failed()) << s.report();
+            EXPECT_TRUE(output.str() == contents[i]) << it->second.path << " didn't restore properly";
+        }
+        EXPECT_EQ(nr_entries, contents.size() - 1);
+        EXPECT_FALSE(reader.is_corrupted());
+        archive.seekg(0, std::ios_base::end);
+        EXPECT_EQ(static_cast<uint64_t>(archive.tellg()), archive_size);
+    }
+    ASSERT_FALSE(direct_file.close().failed());
+}
+
+TEST(SqueezeDirectIOTest, MoveAndMixReadsWritesLikeStringstream)
+{
+    const TempDir dir("squeeze_direct_io_mix_test");
+    utils::DirectFileStreambuf direct_file;
+    StatCode sc = direct_file.open(dir / "file", std::ios_base::in | std::ios_base::out | std::ios_base::trunc);
+    if (sc.failed())
+        GTEST_SKIP() << "direct I/O isn't supported here: " << sc.report();
+
+    constexpr std::size_t window_size = utils::DirectFileStreambuf::window_size;
+    const generators::PRNG data_prng(1234);
+    const std::vector<char> data = generators::gen_data(data_prng, TestData::get_data_seed(), 3 * window_size);
+    std::iostream direct(&direct_file);
+    std::stringstream expected(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    direct.write(data.data(), static_cast<std::streamsize>(data.size()));
+    expected.write(data.data(), static_cast<std::streamsize>(data.size()));
+
+    // the data moved back by more than a window, reading at the source and writing at the destination
+    for (std::iostream *ios : {&direct, static_cast<std::iostream *>(&expected)}) {
+        auto s = utils::iosmove(*ios, 100, 2 * window_size + 333, window_size - 5000);
+        ASSERT_FALSE(s.failed()) << s.report();
+    }
+
+    // the reads and writes mixed at random positions, half of them around a window boundary
+    test_tools::generators::PRNG prng(4321);
+    std::string direct_read, expected_read;
+    for (std::size_t i = 0; i < 1000; ++i) {
+        const std::size_t pos = prng(0, 1) ? prng(std::size_t(0), 3 * window_size)
+                                           : prng(window_size - 100000, window_size + 100000);
+        const std::size_t size = prng(std::size_t(1), std::size_t(70000));
+        if (prng(0, 1)) {
+            const std::string_view written(data.data() + prng(std::size_t(0), data.size() - size), size);
+            direct.seekp(static_cast<std::streamoff>(pos));
+            direct.write(written.data(), static_cast<std::streamsize>(size));
+            expected.seekp(static_cast<std::streamoff>(pos));
+            expected.write(written.data(), static_cast<std::streamsize>(size));
+        } else {
+            direct_read.assign(size, '\0');
+            expected_read.assign(size, '\0');
+            direct.seekg(static_cast<std::streamoff>(pos));
+            direct.read(direct_read.data(), static_cast<std::streamsize>(size));
+            expected.seekg(static_cast<std::streamoff>(pos));
+            expected.read(expected_read.data(), static_cast<std::streamsize>(size));
+            ASSERT_EQ(direct.gcount(), expected.gcount()) << "read " << i << " at " << pos;
+            ASSERT_TRUE(direct_read == expected_read) << "read " << i << " at " << pos << " differs";
+            direct.clear();
+            expected.clear();
+        }
+        ASSERT_TRUE(direct.good());
+        ASSERT_EQ(direct.tellp(), expected.tellp());
+    }
+    ASSERT_FALSE(direct_file.close().failed());
+
+    std::ifstream file(dir / "file", std::ios_base::binary);
+    const std::string file_content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    EXPECT_EQ(file_content.size(), expected.view().size());
+    EXPECT_TRUE(file_content == expected.view());
+}
+
+TEST(SqueezeStatsTest, CountStagesOfRoundTrip)
+{
+    if constexpr (not stats_enabled)
+        GTEST_SKIP() << "statistics are compiled out";
+
+    namespace fs = std::filesystem;
+    const TempDir dir("squeeze_stats_test");
+    const fs::path file_path = dir / "file";
+
+    const generators::PRNG prng(1234);
+    const std::vector<char> data = generators::gen_data(prng, TestData::get_data_seed(),
+                                                        std::size_t(3 * BUFSIZ * 17 + 5));
+    const std::string content(data.begin(), data.end());
+    std::ofstream(file_path, std::ios_base::binary).write(content.data(), content.size());
+
+    reset_stats();
+    std::stringstream archive;
+    {
+        Squeeze squeeze(archive);
+        Writer::Stat stat;
+        squeeze.will_append<FileEntryInput>(stat, file_path.string(),
+                                            CompressionParams{compression::CompressionMethod::Deflate, 4});
+        EXPECT_TRUE(squeeze.update());
+        ASSERT_FALSE(stat.failed()) << stat.report();
+
+        std::ostringstream output;
+        auto s = squeeze.extract(squeeze.find(file_path.string()), output);
+        ASSERT_FALSE(s.failed()) << s.report();
+        EXPECT_TRUE(output.str() == content);
+    }
+    const Stats stats = get_stats();
+
+    EXPECT_EQ(stats[StatsStage::FileRead].bytes_in, content.size());
+    EXPECT_GT(stats[StatsStage::LZ77Encode].nr_calls, 0);
+    EXPECT_EQ(stats[StatsStage::LZ77Encode].bytes_in, content.size());
+    EXPECT_GT(stats[StatsStage::HuffmanEncode].nr_calls, 0);
+    EXPECT_EQ(stats[StatsStage::HuffmanEncode].bytes_in, stats[StatsStage::LZ77Encode].bytes_out);
+    EXPECT_GT(stats[StatsStage::AppendWait].nr_calls, 0);
+    EXPECT_GT(stats[StatsStage::AppendWrite].bytes_in, 0);
+    EXPECT_LT(stats[StatsStage::AppendWrite].bytes_in, content.size());
+    EXPECT_EQ(stats[StatsStage::Decode].nr_calls, 1);
+    EXPECT_EQ(stats[StatsStage::Decode].bytes_out, content.size());
+    EXPECT_GT(stats[StatsStage::Decode].nanoseconds, 0);
+
+    reset_stats();
+    EXPECT_EQ(get_stats()[StatsStage::Decode].nr_calls, 0);
+}
+
+TEST(SqueezeCompactTest, RemoveFrontCodedEntries)
+{
+    std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    squeeze.set_params({.compact_headers = true});
+
+    // paths sharing long prefixes, with some of the prefixes only shared with the removed entries
+    const std::vector<std::string> paths = {
+        "a", "dir/subdir/x", "dir/subdir/xy", "dir/subdir/xyz/file", "dir/subdir/xyz/file2",
+        "dir/subdir/xyz/other", "dir/subdir/xyz/file3", "dir/subdir/xyz/file4", "e",
+    };
+    const std::vector<std::size_t> removed = {2, 3, 4, 6};
+
+    std::vector<Writer::Stat> stats(paths.size());
+    for (std::size_t i = 0; i < paths.size(); ++i)
+        squeeze.will_append<CustomContentEntryInput>(stats[i], std::string(paths[i]),
+                CompressionParams{compression::CompressionMethod::Deflate, 4}, "content of " + paths[i],
+                EntryAttributes{EntryType::Symlink, EntryPermissions::OwnerRead});
+    EXPECT_TRUE(squeeze.update());
+    for (const auto& stat : stats)
+        ASSERT_FALSE(stat.failed()) << stat.report();
+
+    std::size_t nr_prefixed = 0;
+    for (const auto& [pos, entry_header] : squeeze) {
+        EXPECT_TRUE(entry_header.compact);
+        nr_prefixed += entry_header.path_prefix_size != 0;
+    }
+    EXPECT_GT(nr_prefixed, 0);
+
+    for (std::size_t i : removed)
+        squeeze.will_remove(squeeze.find(paths[i]));
+    EXPECT_TRUE(squeeze.update());
+    content.str(std::string(content.view().substr(0, content.tellp())));
+    EXPECT_FALSE(squeeze.is_corrupted());
+
+    // the entries following the removed ones get front-coded against their new previous entries
+    std::vector<std::string> remaining_paths;
+    for (auto it = squeeze.begin(); it != squeeze.end(); ++it) {
+        remaining_paths.push_back(it->second.path);
+        EXPECT_EQ(it->second.path_prefix_size,
+                  EntryHeader::get_shared_path_prefix_size(it.get_previous_path(), it->second.path));
+    }
+    std::vector<std::string> expected_paths;
+    for (std::size_t i = 0; i < paths.size(); ++i)
+        if (std::find(removed.begin(), removed.end(), i) == removed.end())
+            expected_paths.push_back(paths[i]);
+    EXPECT_EQ(remaining_paths, expected_paths);
+
+    for (const auto& path : expected_paths) {
+        std::ostringstream output;
+        auto it = squeeze.find(path);
+        ASSERT_NE(it, squeeze.end());
+        auto s = squeeze.extract(it, output);
+        ASSERT_FALSE(s.failed()) << s.report();
+        EXPECT_EQ(output.str(), "content of " + path);
+    }
+}
+
+TEST(SqueezeScanTest, ScanMatchesIteration)
+{
+    std::stringstream content(std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    test_tools::generators::PRNG prng(1234);
+
+    // enough entries for the scanner to refill its buffer, with the fixed headers followed by compact ones,
+    // and a content larger than the buffer for it to seek past
+    for (bool compact : {false, true}) {
+        squeeze.set_params({.compact_headers = compact});
+        std::vector<Writer::Stat> stats(300);
+        for (std::size_t i = 0; i < stats.size(); ++i) {
+            const std::size_t content_size = i == 150 ? 3 * EntryScanner::default_buffer_size / 2 : prng(0, 2048);
+            squeeze.will_append<CustomContentEntryInput>(stats[i],
+                    std::string(compact ? "compact/" : "fixed/") + stringify(i),
+                    CompressionParams{compression::CompressionMethod::None, 0}, std::string(content_size, 'c'),
+                    EntryAttributes{EntryType::Symlink, EntryPermissions::OwnerRead});
+        }
+        EXPECT_TRUE(squeeze.update());
+        for (const auto& stat : stats)
+            ASSERT_FALSE(stat.failed()) << stat.report();
+    }
+
+    auto it = squeeze.begin();
+    std::size_t nr_entries = 0;
+    for (auto scanner = squeeze.scan(); scanner.next(); ++it, ++nr_entries) {
+        ASSERT_NE(it, squeeze.end());
+        EXPECT_EQ(scanner.get_pos(), it->first);
+        EXPECT_EQ(scanner.get_path(), it->second.path);
+        EXPECT_EQ(scanner.get_header().content_size, it->second.content_size);
+        EXPECT_EQ(scanner.get_header().compact, it->second.compact);
+        EXPECT_EQ(scanner.get_iterator(), it);
+        EXPECT_EQ(scanner.get_iterator()->second.path, it->second.path);
+    }
+    EXPECT_EQ(it, squeeze.end());
+    EXPECT_EQ(nr_entries, 600);
+    EXPECT_FALSE(squeeze.is_corrupted());
+
+    auto found_it = squeeze.find("compact/151");
+    ASSERT_NE(found_it, squeeze.end());
+    EXPECT_EQ(found_it->second.path, "compact/151");
+    EXPECT_EQ(squeeze.find("compact/300"), squeeze.end());
+}
+
+
+TEST(SqueezeStreamingTest, AppendToNonSeekable)
+{
+    NonSeekableStringbuf pipe_buf;
+    std::ostream pipe(&pipe_buf);
+    Appender appender(pipe);
+    test_tools::generators::PRNG prng(4321);
+
+    // contents larger than a frame are split into several ones
+    std::vector<std::string> contents;
+    for (std::size_t i = 0; i < 20; ++i) {
+        const std::size_t content_size = i == 7 ? 5 * EntryFrames::max_frame_size / 2 : prng(0, 4096);
+        std::string content(content_size, '\0');
+        for (char& c : content)
+            c = static_cast<char>(prng(0, 3));
+        contents.push_back(std::move(content));
+    }
+
+    for (bool compact : {false, true}) {
+        appender.set_params({.compact_headers = compact});
+        std::vector<Writer::Stat> stats(contents.size());
+        std::vector<std::istringstream> streams(contents.size());
+        for (std::size_t i = 0; i < contents.size(); ++i) {
+            streams[i].str(contents[i]);
+            appender.will_append<CustomContentEntryInput>(stats[i],
+                    std::string(compact ? "compact/" : "fixed/") + stringify(i),
+                    CompressionParams{i % 2 ? compression::CompressionMethod::Deflate
+                                            : compression::CompressionMethod::None, 0},
+                    &streams[i], EntryAttributes{EntryType::RegularFile, EntryPermissions::OwnerRead});
+        }
+        EXPECT_TRUE(appender.perform_appends());
+        for (const auto& stat : stats)
+            ASSERT_FALSE(stat.failed()) << stat.report();
+    }
+
+    std::stringstream content(std::move(pipe_buf).str(), std::ios_base::binary | std::ios_base::in | std::ios_base::out);
+    Squeeze squeeze(content);
+    EXPECT_FALSE(squeeze.is_corrupted());
+
+    auto it = squeeze.begin();
+    std::size_t nr_entries = 0;
+    for (auto scanner = squeeze.scan(); scanner.next(); ++it, ++nr_entries) {
+        ASSERT_NE(it, squeeze.end());
+        EXPECT_TRUE(it->second.framed);
+        EXPECT_EQ(scanner.get_pos(), it->first);
+        EXPECT_EQ(scanner.get_path(), it->second.path);
+        EXPECT_EQ(scanner.get_header().content_size, it->second.content_size);
+        EXPECT_EQ(scanner.get_header().framing_size, it->second.framing_size);
+    }
+    EXPECT_EQ(it, squeeze.end());
+    EXPECT_EQ(nr_entries, 2 * contents.size());
+
+    for (const char *prefix : {"fixed/", "compact/"}) {
+        for (std::size_t i = 0; i < contents.size(); ++i) {
+            auto found_it = squeeze.find(prefix + stringify(i));
+            ASSERT_NE(found_it, squeeze.end());
+            std::stringstream extracted;
+            auto stat = squeeze.extract(found_it, extracted);
+            ASSERT_FALSE(stat.failed()) << stat.report();
+            EXPECT_TRUE(extracted.view() == contents[i]) << prefix << i;
+        }
+    }
+
+    // the framed entries are read sequentially as well, e.g. right from the pipe
+    NonSeekableStringbuf stream_buf{std::string(content.view()), std::ios_base::in};
+    std::istream stream(&stream_buf);
+    StreamExtracter extracter(stream);
+    for (const char *prefix : {"fixed/", "compact/"}) {
+        for (std::size_t i = 0; i < contents.size(); ++i) {
+            ASSERT_TRUE(extracter.next());
+            EXPECT_EQ(extracter.get_path(), prefix + stringify(i));
+            // some of the contents are skipped, which the following entries don't depend on
+            if (i % 3 == 2)
+                continue;
+            std::stringstream extracted;
+            auto stat = extracter.extract(extracted);
+            ASSERT_FALSE(stat.failed()) << stat.report();
+            EXPECT_TRUE(extracted.view() == contents[i]) << prefix << i;
+        }
+    }
+    EXPECT_FALSE(extracter.next());
+    EXPECT_FALSE(extracter.is_corrupted());
+
+    // the framed entries are removed as a whole, the following ones staying readable
+    auto stat = squeeze.remove(squeeze.find("fixed/7"));
+    ASSERT_FALSE(stat.failed()) << stat.report();
+    EXPECT_EQ(squeeze.find("fixed/7"), squeeze.end());
+    auto found_it = squeeze.find("compact/19");
+    ASSERT_NE(found_it, squeeze.end());
+    std::stringstream extracted;
+    ASSERT_FALSE(squeeze.extract(found_it, extracted).failed());
+    EXPECT_TRUE(extracted.view() == contents[19]);
+}
+
 }
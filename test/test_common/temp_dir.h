@@ -0,0 +1,51 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <filesystem>
+#include <random>
+#include <string>
+#include <string_view>
+
+namespace squeeze::test_common {
+
+namespace fs = std::filesystem;
+
+/** Directory made anew within the temporary directory under a unique name, so that the tests running
+ * at the same time don't share it, and removed along with its contents once the test is done with it. */
+class TempDir {
+public:
+    explicit TempDir(std::string_view name_prefix = "squeeze_test")
+    {
+        std::random_device random_device;
+        do {
+            path = fs::temp_directory_path() / (std::string(name_prefix) + '_' + std::to_string(random_device()));
+        } while (not fs::create_directories(path));
+    }
+
+    ~TempDir()
+    {
+        std::error_code ec;
+        fs::remove_all(path, ec);
+    }
+
+    TempDir(const TempDir&) = delete;
+    TempDir& operator=(const TempDir&) = delete;
+
+    inline const fs::path& get_path() const noexcept
+    {
+        return path;
+    }
+
+    inline fs::path operator/(const fs::path& name) const
+    {
+        return path / name;
+    }
+
+private:
+    fs::path path;
+};
+
+}
@@ -4,6 +4,8 @@
 
 #pragma once
 
+#include <cstddef>
+
 #include "test_tools/mock/fs.h"
 #include "prng.h"
 
@@ -11,4 +13,18 @@ namespace squeeze::test_tools::generators {
 
 mock::FileSystem gen_mockfs(const std::string_view content_seed, const PRNG& prng = {});
 
+/** Shape and scale of a generated mock file system. */
+struct MockFSParams {
+    std::size_t nr_regular_files = 20;
+    std::size_t nr_symlinks = 20;
+    /** Range of the regular file sizes. The sizes are drawn log-uniformly, the small files being the common ones,
+     * as they are on real file systems. */
+    std::size_t min_file_size = 0;
+    std::size_t max_file_size = 64 << 10;
+    int max_breadth = 3;
+    int depth = 4;
+};
+
+mock::FileSystem gen_mockfs(const MockFSParams& params, const std::string_view content_seed, const PRNG& prng = {});
+
 }
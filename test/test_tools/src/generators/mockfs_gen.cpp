@@ -2,6 +2,9 @@
 // Distributed under the MIT License (https://opensource.org/licenses/MIT).
 // See the LICENSE file in the top-level directory for more information.
 
+#include <algorithm>
+#include <bit>
+
 #include "test_tools/generators/data_gen.h"
 #include "test_tools/generators/mockfs_gen.h"
 #include "test_tools/generators/prng.h"
@@ -65,6 +68,14 @@ mock::RegularFile gen_mock_regular_file(const PRNG& prng, const std::string_view
     return regular_file;
 }
 
+std::size_t gen_log_uniform_size(const PRNG& prng, std::size_t min_size, std::size_t max_size)
+{
+    const int width = prng(int(std::bit_width(min_size)), int(std::bit_width(max_size)));
+    const std::size_t width_min = width ? std::size_t(1) << (width - 1) : 0;
+    const std::size_t width_max = width ? (std::size_t(1) << (width - 1)) * 2 - 1 : 0;
+    return prng(std::max(min_size, width_min), std::min(max_size, width_max));
+}
+
 std::shared_ptr<mock::Symlink> gen_mock_symlink(const PRNG& prng, std::string&& target)
 {
     return std::make_shared<mock::Symlink>(gen_permissions(prng), std::move(target));
@@ -112,4 +123,41 @@ mock::FileSystem gen_mockfs(const std::string_view data_seed, const PRNG& prng)
     return mockfs;
 }
 
+mock::FileSystem gen_mockfs(const MockFSParams& params, const std::string_view data_seed, const PRNG& prng)
+{
+    mock::FileSystem mockfs {gen_mockfs_entries(prng, params.max_breadth, params.depth)};
+
+    std::vector<std::shared_ptr<mock::Directory>> directories;
+    mockfs.list_recursively<mock::Directory>(
+        [&directories](const std::string&, std::shared_ptr<mock::Directory> directory)
+        {
+            directories.push_back(directory);
+        }
+    );
+
+    // the contents are written in place, as the large files are too costly to copy around
+    for (std::size_t i = 0; i < params.nr_regular_files; ++i) {
+        std::string file_name = gen_regular_file_name(prng);
+        mock::Directory& dir = *directories[prng(std::size_t(0), directories.size() - 1)];
+        auto regular_file = dir.make<mock::RegularFile>(file_name, gen_permissions(prng));
+        const std::size_t size = gen_log_uniform_size(prng, params.min_file_size, params.max_file_size);
+        const std::vector<char> data {gen_data(prng, data_seed, size)};
+        regular_file->contents.write(data.data(), data.size());
+    }
+
+    std::size_t nr_symlinks_left = params.nr_symlinks;
+    auto symlink_make = [&prng, &directories, &nr_symlinks_left](const std::string& path, auto&)
+    {
+        if (!nr_symlinks_left)
+            return;
+        --nr_symlinks_left;
+
+        directories[prng(std::size_t(0), directories.size() - 1)]->
+            entries.symlinks[gen_symlink_name(prng)] = gen_mock_symlink(prng, std::string(path));
+    };
+    mockfs.list_recursively<mock::RegularFile, mock::Directory>(symlink_make, symlink_make);
+
+    return mockfs;
+}
+
 }
@@ -8,16 +8,29 @@
 #include <deque>
 #include <filesystem>
 #include <charconv>
+#include <iomanip>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 #include "squeeze/squeeze.h"
+#include "squeeze/stream_extracter.h"
 #include "squeeze/logging.h"
+#include "squeeze/stats.h"
 #include "squeeze/wrap/file_squeeze.h"
 #include "squeeze/exception.h"
 #include "squeeze/compression/config.h"
+#include "squeeze/misc/cpu_info.h"
 #include "squeeze/utils/defer.h"
 #include "squeeze/utils/defer_macros.h"
+#include "squeeze/utils/fs.h"
+#include "squeeze/utils/direct_file.h"
 
 #include "utils/argparser.h"
+#include "utils/bench.h"
 
 namespace {
 
@@ -30,6 +43,7 @@ public:
         Append = 1,
         Remove = 2,
         Extract = 4,
+        Bench = 8,
         Read = Extract,
         Write = Append | Remove,
     };
@@ -39,10 +53,18 @@ public:
         Processing = 2,
         Dirty = 4,
         RecurseFlag = 8,
+        SolidFlag = 16,
+        DedupFlag = 32,
+        DedupFilesFlag = 64,
+        DeltaFlag = 128,
+        CompactFlag = 256,
+        StreamingFlag = 512,
+        DirectIOFlag = 1024,
+        StatsFlag = 2048,
     };
 
     enum class Option {
-        Append, Remove, Extract, List, Recurse, NoRecurse, Compression, LogLevel, Directory, Help
+        Append, Remove, Extract, List, Recurse, NoRecurse, Solid, NoSolid, Dedup, DedupFiles, NoDedup, Delta, NoDelta, Compact, NoCompact, DirectIO, Bench, Stats, Compression, LogLevel, Directory, Help
     };
 
 public:
@@ -59,6 +81,8 @@ public:
                 short_options, long_options, long_options + std::size(long_options));
         int exit_code = handle_arguments();
         arg_parser.reset();
+        if (state.flags & StatsFlag)
+            print_stats();
 
         state.flags = 0;
         state.compression = default_compression;
@@ -72,8 +96,8 @@ public:
         .level = 8,
     };
 
-    static constexpr char short_options[] = "ARXLhrClD";
-    static constexpr std::string_view long_options[] = {"append", "remove", "extract", "list", "help", "recurse", "no-recurse", "compression", "log-level", "dir"};
+    static constexpr char short_options[] = "ARXLhrSClDb";
+    static constexpr std::string_view long_options[] = {"append", "remove", "extract", "list", "help", "recurse", "no-recurse", "solid", "no-solid", "dedup", "dedup-files", "no-dedup", "delta", "no-delta", "compact-headers", "no-compact-headers", "direct-io", "bench", "stats", "compression", "log-level", "dir"};
 
 private:
     int handle_arguments()
@@ -104,6 +128,8 @@ private:
             if (exit_code != EXIT_SUCCESS)
                 return exit_code;
         }
+        if (mode == Bench)
+            return run_bench();
         return deinit_sqz();
     }
 
@@ -116,6 +142,9 @@ private:
     {
         int exit_code = EXIT_SUCCESS;
 
+        if (mode == Bench)
+            return load_bench_sample(arg_value);
+
         if (!(state.flags & Processing)) {
             exit_code = init_sqz(arg_value);
             if (exit_code != EXIT_SUCCESS)
@@ -124,6 +153,9 @@ private:
             return EXIT_SUCCESS;
         }
 
+        if (state.flags & StreamingFlag)
+            return handle_streaming(arg_value);
+
         if (Read & mode) {
             if ((exit_code = run_update()))
                 return exit_code;
@@ -165,6 +197,10 @@ private:
                 std::cerr << "Error: no file specified.\n";
                 return EXIT_FAILURE;
             }
+            if (state.flags & StreamingFlag) {
+                report_streaming_mode();
+                return EXIT_FAILURE;
+            }
             int exit_code = run_update();
             if (exit_code != EXIT_SUCCESS)
                 return exit_code;
@@ -177,6 +213,70 @@ private:
         case Option::NoRecurse:
             state.flags &= ~RecurseFlag;
             break;
+        case Option::Solid:
+        case Option::NoSolid:
+        case Option::Dedup:
+        case Option::DedupFiles:
+        case Option::NoDedup:
+        case Option::Delta:
+        case Option::NoDelta:
+        case Option::Compact:
+        case Option::NoCompact:
+        {
+            // append params apply to all the appends performed at once, so the pending ones are run beforehand
+            int exit_code = run_update();
+            if (exit_code != EXIT_SUCCESS)
+                return exit_code;
+            switch (option) {
+            case Option::Solid:
+                state.flags |= SolidFlag;
+                break;
+            case Option::NoSolid:
+                state.flags &= ~SolidFlag;
+                break;
+            case Option::Dedup:
+                state.flags = (state.flags & ~DedupFilesFlag) | DedupFlag;
+                break;
+            case Option::DedupFiles:
+                state.flags = (state.flags & ~DedupFlag) | DedupFilesFlag;
+                break;
+            case Option::NoDedup:
+                state.flags &= ~(DedupFlag | DedupFilesFlag);
+                break;
+            case Option::Delta:
+                state.flags |= DeltaFlag;
+                break;
+            case Option::NoDelta:
+                state.flags &= ~DeltaFlag;
+                break;
+            case Option::Compact:
+                state.flags |= CompactFlag;
+                break;
+            default:
+                state.flags &= ~CompactFlag;
+                break;
+            }
+            update_append_params();
+            break;
+        }
+        case Option::DirectIO:
+            if (not utils::DirectFileStreambuf::is_supported()) {
+                std::cerr << "Error: direct I/O isn't supported on this platform.\n";
+                return EXIT_FAILURE;
+            }
+            state.flags |= DirectIOFlag;
+            break;
+        case Option::Bench:
+            if (state.flags & Processing) {
+                std::cerr << "Error: the benchmark mode must precede the files.\n";
+                return EXIT_FAILURE;
+            }
+            mode = Bench;
+            break;
+        case Option::Stats:
+            state.flags |= StatsFlag;
+            reset_stats();
+            break;
         case Option::Compression:
         {
             auto arg = arg_parser->raw_next();
@@ -231,15 +331,14 @@ private:
 
     int handle_append(const std::string_view path)
     {
-        assert(sqz.has_value());
-        assert(fsqz.has_value());
+        wrap::FileAppender& fappender = get_file_appender();
         state.flags |= Dirty;
 
         if (state.flags & RecurseFlag) {
-            fsqz->will_append_recursively(path, state.compression, make_back_inserter_lambda(write_stats));
+            fappender.will_append_recursively(path, state.compression, make_back_inserter_lambda(write_stats));
         } else {
             write_stats.emplace_back();
-            fsqz->will_append(path, state.compression, &write_stats.back());
+            fappender.will_append(path, state.compression, &write_stats.back());
         }
 
         return EXIT_SUCCESS;
@@ -298,6 +397,15 @@ private:
     int init_sqz(std::string_view filename)
     {
         deinit_sqz();
+
+        // the entries can be either appended to the standard output, framed as it may not be seekable,
+        // or extracted from the standard input as it arrives, which one is decided by the first file
+        if (filename == "-") {
+            redirect_logging_to_stderr();
+            state.flags |= StreamingFlag;
+            return EXIT_SUCCESS;
+        }
+
         sqz_fn = std::filesystem::absolute(filename);
 
         std::ios_base::openmode file_mode = std::ios_base::in | std::ios_base::out | std::ios_base::binary;
@@ -306,24 +414,148 @@ private:
             state.flags |= FileCreated;
         }
 
-        sqz_file.open(sqz_fn, file_mode);
-        if (!sqz_file) {
-            std::cerr << "Error: failed opening a file - " << sqz_fn << '\n';
-            return EXIT_FAILURE;
+        if (state.flags & DirectIOFlag) {
+            if (auto sc = sqz_direct_file.open(sqz_fn, file_mode); sc.failed()) {
+                std::cerr << "Error: failed opening a file for direct I/O - " << sqz_fn << ": " << sc.report() << '\n';
+                return EXIT_FAILURE;
+            }
+            sqz_direct_stream.emplace(&sqz_direct_file);
+        } else {
+            sqz_file.open(sqz_fn, file_mode);
+            if (!sqz_file) {
+                std::cerr << "Error: failed opening a file - " << sqz_fn << '\n';
+                return EXIT_FAILURE;
+            }
         }
 
-        sqz.emplace(sqz_file);
+        sqz.emplace(get_sqz_stream());
 
         if (sqz->is_corrupted())
             std::cerr << "WARNING: corrupted sqz file - " << sqz_fn << std::endl;
 
         fsqz.emplace(*sqz);
+        update_append_params();
 
         return EXIT_SUCCESS;
     }
 
+    void update_append_params()
+    {
+        if (!sqz && !stream_appender)
+            return;
+        AppendParams params;
+        if (state.flags & SolidFlag)
+            params.solid = {.group_size = default_solid_group_size, .sort_by_extension = true};
+        if (state.flags & DedupFlag)
+            params.dedup = {.avg_chunk_size = default_dedup_avg_chunk_size};
+        else if (state.flags & DedupFilesFlag)
+            params.dedup = {.whole_files = true};
+        params.delta.enabled = state.flags & DeltaFlag;
+        params.compact_headers = state.flags & CompactFlag;
+        if (stream_appender)
+            stream_appender->set_params(params);
+        else
+            sqz->set_params(params);
+    }
+
+    wrap::FileAppender& get_file_appender()
+    {
+        if (stream_fappender)
+            return *stream_fappender;
+        assert(fsqz.has_value());
+        return *fsqz;
+    }
+
+    static void report_streaming_mode()
+    {
+        std::cerr << "Error: the files can be either appended to the standard output "
+                     "or extracted from the standard input.\n";
+    }
+
+    int handle_streaming(const std::string_view path)
+    {
+        switch (mode) {
+        case Append:
+            if (!stream_extract_paths.empty())
+                break;
+            if (!stream_appender) {
+#ifdef _WIN32
+                // the text mode would translate the line feeds of the binary data written
+                _setmode(_fileno(stdout), _O_BINARY);
+#endif
+                stream_appender.emplace(std::cout);
+                stream_fappender.emplace(*stream_appender);
+                update_append_params();
+            }
+            return handle_append(path);
+        case Extract:
+            if (stream_appender)
+                break;
+            // the entries go by only once, so they're matched against all the paths at the end
+            stream_extract_paths.emplace_back(path, state.flags & RecurseFlag);
+            return EXIT_SUCCESS;
+        default:
+            break;
+        }
+        report_streaming_mode();
+        return EXIT_FAILURE;
+    }
+
+    int run_stream_extract()
+    {
+        if (stream_extract_paths.empty())
+            return EXIT_SUCCESS;
+
+        int exit_code = EXIT_SUCCESS;
+        std::vector<bool> paths_matched(stream_extract_paths.size());
+#ifdef _WIN32
+        // the text mode would translate the line feeds and stop at the first Ctrl+Z of the binary data read
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        StreamExtracter extracter(std::cin);
+        while (extracter.next()) {
+            if (extracter.get_header().attributes.get_type() == EntryType::Blob)
+                continue;
+            bool matched = false;
+            for (std::size_t i = 0; i < stream_extract_paths.size(); ++i) {
+                const auto& [path, recursive] = stream_extract_paths[i];
+                if (path == "*" || path == extracter.get_path() ||
+                        (recursive && squeeze::utils::path_within_dir(extracter.get_path(), path)))
+                    matched = paths_matched[i] = true;
+            }
+            if (!matched)
+                continue;
+            Reader::Stat stat = extracter.extract();
+            if (stat.failed()) {
+                exit_code = EXIT_FAILURE;
+                print_to(std::cerr, stat, '\n');
+            }
+        }
+
+        if (extracter.is_corrupted()) {
+            exit_code = EXIT_FAILURE;
+            std::cerr << "Error: corrupted sqz stream.\n";
+        }
+        for (std::size_t i = 0; i < stream_extract_paths.size(); ++i) {
+            if (!paths_matched[i]) {
+                exit_code = EXIT_FAILURE;
+                std::cerr << "Error: non-existent path - " << stream_extract_paths[i].first << '\n';
+            }
+        }
+        stream_extract_paths.clear();
+        return exit_code;
+    }
+
     int deinit_sqz()
     {
+        if (state.flags & StreamingFlag) {
+            int exit_code = stream_appender ? run_update() : run_stream_extract();
+            stream_fappender.reset();
+            stream_appender.reset();
+            state.flags &= ~StreamingFlag;
+            return exit_code;
+        }
+
         if (!sqz)
             return EXIT_SUCCESS;
         int exit_code = run_update();
@@ -332,13 +564,19 @@ private:
 
         bool delete_file = false;
         if (state.flags & FileCreated) {
-            sqz_file.seekp(0, std::ios_base::end);
-            if (sqz_file.tellp() == 0)
+            std::iostream& sqz_stream = get_sqz_stream();
+            sqz_stream.seekp(0, std::ios_base::end);
+            if (sqz_stream.tellp() == 0)
                 delete_file = true;
             state.flags &= ~FileCreated;
         }
 
-        sqz_file.close();
+        if (sqz_direct_stream) {
+            sqz_direct_stream.reset();
+            sqz_direct_file.close();
+        } else {
+            sqz_file.close();
+        }
 
         if (delete_file)
             std::filesystem::remove(sqz_fn);
@@ -347,13 +585,25 @@ private:
         return exit_code;
     }
 
+    std::iostream& get_sqz_stream()
+    {
+        if (sqz_direct_stream)
+            return *sqz_direct_stream;
+        return sqz_file;
+    }
+
     int run_update()
     {
         if (!(state.flags & Dirty))
             return EXIT_SUCCESS;
 
         int exit_code = EXIT_SUCCESS;
-        fsqz->update();
+        if (stream_fappender) {
+            stream_fappender->perform_appends();
+            std::cout.flush();
+        } else {
+            fsqz->update();
+        }
 
         for (auto& stat : write_stats) {
             if (stat.failed()) {
@@ -363,12 +613,141 @@ private:
         }
         write_stats.clear();
 
-        std::filesystem::resize_file(sqz_fn, sqz_file.tellp());
+        // the direct file gets resized on its own, as its data may be pending in its window
+        if (sqz_direct_stream) {
+            if (auto sc = sqz_direct_file.resize(sqz_direct_stream->tellp()); sc.failed()) {
+                std::cerr << "Error: failed resizing the file - " << sqz_fn << ": " << sc.report() << '\n';
+                exit_code = EXIT_FAILURE;
+            }
+        } else if (!stream_fappender)
+            std::filesystem::resize_file(sqz_fn, sqz_file.tellp());
 
         state.flags &= ~Dirty;
         return exit_code;
     }
 
+    /** Load the file, or all the regular files within the directory, into the benchmark sample. */
+    int load_bench_sample(const std::string_view path)
+    {
+        namespace fs = std::filesystem;
+
+        auto load_file = [this](const fs::path& file_path)
+        {
+            std::ifstream file(file_path, std::ios_base::binary);
+            if (!file) {
+                std::cerr << "Error: failed opening a file - " << file_path.string() << '\n';
+                return false;
+            }
+            bench_sample.insert(bench_sample.end(), std::istreambuf_iterator<char>(file),
+                                std::istreambuf_iterator<char>());
+            ++nr_bench_files;
+            return true;
+        };
+
+        std::error_code ec;
+        if (fs::is_directory(path, ec)) {
+            for (const auto& dir_entry : fs::recursive_directory_iterator(path, ec))
+                if (dir_entry.is_regular_file() && !load_file(dir_entry.path()))
+                    return EXIT_FAILURE;
+        } else if (!load_file(path)) {
+            return EXIT_FAILURE;
+        }
+        if (ec) {
+            std::cerr << "Error: failed reading a directory - " << path << ": " << ec.message() << '\n';
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    /** Encode and decode the sample at every level of every compression method, with the numbers of threads
+     * doubling up to the number of cores, and print the throughputs, the ratios and the scaling efficiencies. */
+    int run_bench()
+    {
+        if (bench_sample.empty()) {
+            std::cerr << "Error: no sample files specified, or all of them are empty.\n";
+            return EXIT_FAILURE;
+        }
+
+        std::vector<unsigned> nr_threads_list;
+        const auto nr_cores = static_cast<unsigned>(std::max<std::size_t>(misc::get_nr_available_cpu_cores(), 1));
+        for (unsigned nr_threads = 1; nr_threads < nr_cores; nr_threads *= 2)
+            nr_threads_list.push_back(nr_threads);
+        nr_threads_list.push_back(nr_cores);
+
+        std::cout << "Sample: " << nr_bench_files << " files, " << bench_sample.size() << " bytes\n"
+                  << std::left << std::setw(9) << "method" << std::right << std::setw(6) << "level"
+                  << std::setw(9) << "threads" << std::setw(9) << "ratio" << std::setw(12) << "comp MB/s"
+                  << std::setw(13) << "decomp MB/s" << std::setw(14) << "comp scaling" << std::setw(16)
+                  << "decomp scaling" << '\n';
+
+        const std::ios_base::fmtflags flags = std::cout.flags();
+        DEFER( std::cout.flags(flags) );
+        std::cout << std::fixed << std::setprecision(2);
+
+        int exit_code = EXIT_SUCCESS;
+        BufferBench bench(bench_sample);
+        for (auto [method, method_name] : {std::pair(compression::CompressionMethod::Huffman, "huffman"),
+                                           std::pair(compression::CompressionMethod::Deflate, "deflate")}) {
+            auto [min_level, max_level] = compression::get_min_max_levels(method);
+            for (int level = min_level; level <= max_level; ++level) {
+                const compression::CompressionParams compression {.method = method, .level = uint8_t(level)};
+                double encode_speed_1 = 0, decode_speed_1 = 0;
+                for (unsigned nr_threads : nr_threads_list) {
+                    const BenchResult result = bench.run(compression, nr_threads, bench_min_time);
+                    const double encode_speed = double(bench_sample.size()) / result.encode_seconds / 1e6;
+                    const double decode_speed = double(bench_sample.size()) / result.decode_seconds / 1e6;
+                    if (nr_threads == 1)
+                        encode_speed_1 = encode_speed, decode_speed_1 = decode_speed;
+                    std::cout << std::left << std::setw(9) << method_name << std::right << std::setw(6) << level
+                              << std::setw(9) << nr_threads
+                              << std::setw(9) << double(bench_sample.size()) / double(result.encoded_size)
+                              << std::setw(12) << encode_speed << std::setw(13) << decode_speed
+                              << std::setw(13) << 100 * encode_speed / (encode_speed_1 * nr_threads) << '%'
+                              << std::setw(15) << 100 * decode_speed / (decode_speed_1 * nr_threads) << '%';
+                    if (!result.round_trip) {
+                        std::cout << "  round trip FAILED";
+                        exit_code = EXIT_FAILURE;
+                    }
+                    std::cout << std::endl;
+                }
+            }
+        }
+        return exit_code;
+    }
+
+    /** Print the counters of the pipeline stages collected since the statistics were enabled,
+     * to the standard error output, as the standard output may be taken by the data. */
+    static void print_stats()
+    {
+        if constexpr (not stats_enabled) {
+            std::cerr << "Statistics were compiled out, see the USE_STATS build option.\n";
+            return;
+        }
+
+        const std::ios_base::fmtflags flags = std::cerr.flags();
+        const std::streamsize precision = std::cerr.precision();
+        DEFER( std::cerr.flags(flags); std::cerr.precision(precision) );
+
+        std::cerr << std::left << std::setw(16) << "stage" << std::right << std::setw(10) << "calls"
+                  << std::setw(15) << "bytes in" << std::setw(15) << "bytes out" << std::setw(12) << "time ms"
+                  << std::setw(14) << "avg call us" << std::setw(10) << "MB/s" << '\n'
+                  << std::fixed << std::setprecision(2);
+
+        const Stats stats = get_stats();
+        for (std::size_t i = 0; i < nr_stats_stages; ++i) {
+            const auto stage = static_cast<StatsStage>(i);
+            const StageStats& stage_stats = stats[stage];
+            // the throughput is of the larger size, i.e. of the decoded data for both the encoding and the decoding
+            const double seconds = double(stage_stats.nanoseconds) / 1e9;
+            const uint64_t bytes = std::max(stage_stats.bytes_in, stage_stats.bytes_out);
+            std::cerr << std::left << std::setw(16) << stringify(stage) << std::right
+                      << std::setw(10) << stage_stats.nr_calls << std::setw(15) << stage_stats.bytes_in
+                      << std::setw(15) << stage_stats.bytes_out << std::setw(12) << seconds * 1e3
+                      << std::setw(14) << (stage_stats.nr_calls ? seconds * 1e6 / double(stage_stats.nr_calls) : 0)
+                      << std::setw(10) << (seconds > 0 ? double(bytes) / seconds / 1e6 : 0) << '\n';
+        }
+    }
+
     void run_list()
     {
         assert(sqz.has_value());
@@ -377,17 +756,46 @@ private:
         set_log_level(LogLevel::Off);
         DEFER( set_log_level(log_level) );
 
-        for (auto it = sqz->begin(); it != sqz->end(); ++it) {
-            const auto& entry_header = it->second;
-            std::stringstream extra;
+        for (auto scanner = sqz->scan(); scanner.next();) {
+            const auto& entry_header = scanner.get_header();
+            if (entry_header.attributes.get_type() == EntryType::Blob)
+                continue;
+            print_to(std::cout, entry_header.attributes, "  ");
+            print_size_column(std::cout, entry_header);
+            print_to(std::cout, "  ", entry_header.path);
             if (entry_header.attributes.get_type() == EntryType::Symlink) {
-                extra << " -> ";
-                sqz->extract(it, extra);
+                std::stringstream target;
+                sqz->extract(scanner.get_iterator(), target);
+                print_to(std::cout, " -> ", target.view());
             }
-            print_to(std::cout, entry_header.attributes, "    ", entry_header.path, extra.view(), '\n');
+            std::cout << '\n';
         }
     }
 
+    /** Print the original size of the regular file entries, followed by the ratio of the size of their
+     * content to it, unless the content is held by blobs or by another entry, which may be shared. */
+    static void print_size_column(std::ostream& column, const EntryHeader& entry_header)
+    {
+        const std::ios_base::fmtflags flags = column.flags();
+        const std::streamsize precision = column.precision();
+        DEFER( column.flags(flags); column.precision(precision) );
+
+        column << std::setw(12);
+        if (entry_header.attributes.get_type() == EntryType::RegularFile && entry_header.has_original_size())
+            column << entry_header.original_size;
+        else
+            column << "";
+        column << std::setw(8);
+        if (entry_header.attributes.get_type() == EntryType::RegularFile && entry_header.has_original_size() &&
+                entry_header.original_size != 0 &&
+                entry_header.content_layout != EntryContentLayout::References &&
+                entry_header.content_layout != EntryContentLayout::Duplicate)
+            column << std::fixed << std::setprecision(1)
+                   << 100.0 * entry_header.content_size / entry_header.original_size << '%';
+        else
+            column << "" << ' ';
+    }
+
     static Option parse_short_option(char o)
     {
         switch (o) {
@@ -401,12 +809,16 @@ private:
             return Option::List;
         case 'r':
             return Option::Recurse;
+        case 'S':
+            return Option::Solid;
         case 'C':
             return Option::Compression;
         case 'l':
             return Option::LogLevel;
         case 'D':
             return Option::Directory;
+        case 'b':
+            return Option::Bench;
         case 'h':
             return Option::Help;
         default:
@@ -428,6 +840,30 @@ private:
             return Option::Recurse;
         if (option == "no-recurse")
             return Option::NoRecurse;
+        if (option == "solid")
+            return Option::Solid;
+        if (option == "no-solid")
+            return Option::NoSolid;
+        if (option == "dedup")
+            return Option::Dedup;
+        if (option == "dedup-files")
+            return Option::DedupFiles;
+        if (option == "no-dedup")
+            return Option::NoDedup;
+        if (option == "delta")
+            return Option::Delta;
+        if (option == "no-delta")
+            return Option::NoDelta;
+        if (option == "compact-headers")
+            return Option::Compact;
+        if (option == "no-compact-headers")
+            return Option::NoCompact;
+        if (option == "direct-io")
+            return Option::DirectIO;
+        if (option == "bench")
+            return Option::Bench;
+        if (option == "stats")
+            return Option::Stats;
         if (option == "compression")
             return Option::Compression;
         if (option == "log-level")
@@ -548,13 +984,41 @@ private:
 R""""(Usage: sqz <sqz-file> <files...> [-options]
 By default the append mode is enabled, so even without specifying -A or --append
 at first, the files listed after the sqz file are assumed to be appended or updated.
+If the sqz file is '-', the files are either appended to the standard output, which may be a pipe,
+as a new sqz file, or extracted from the standard input as it arrives, in a single pass.
 Options:
     -A, --append        Append (or update) the following files to the sqz file
     -R, --remove        Remove the following files from the sqz file
     -X, --extract       Extract the following files from the sqz file
-    -L, --list          List all entries in the sqz file
+    -L, --list          List all entries in the sqz file, with the file sizes and compression ratios
     -r, --recurse       Enable recursive mode: directories will be processed recursively
         --no-recurse    Disable non-recursive mode: directories won't be processed recursively
+    -S, --solid         Enable solid mode: the following files are compressed together in solid groups,
+                        ordered by their extensions, which improves the compression of many similar small files
+        --no-solid      Disable solid mode: the following files are compressed separately
+        --dedup         Enable deduplication: the following files are split into content-defined chunks,
+                        and chunks already stored in the sqz file are referred to instead of being stored again
+        --dedup-files   Enable whole file deduplication: the following files of the same content as some files
+                        appended along with them refer to the content of those instead of storing it again
+        --no-dedup      Disable deduplication
+        --delta         Enable delta updates: the following files updated in the sqz file are compressed
+                        against their previous contents, which are kept as their bases
+        --no-delta      Disable delta updates
+        --compact-headers
+                        Enable compact headers: the headers of the following files are encoded with varints
+                        and their paths are front-coded against the paths of the preceding files
+        --no-compact-headers
+                        Disable compact headers
+        --direct-io     Read and write the sqz file with direct I/O, bypassing the page cache, so that processing
+                        huge sqz files doesn't evict everything else from it; must precede the sqz file
+    -b, --bench         Benchmark mode: instead of a sqz file, the following files, or the files within
+                        the following directories, are loaded into memory as a sample, which is compressed
+                        and decompressed at every level of each method with the numbers of threads doubling
+                        up to the number of cores, printing the throughputs, the ratios and the scaling
+                        efficiencies relative to a single thread, e.g. 'sqz -b samples/'
+        --stats         Print the bytes processed and the time spent by each stage of the pipeline: reading
+                        the files, LZ77 and Huffman encoding, waiting for and writing the encoded blocks,
+                        and decoding, to tell which one bounds the run; counted from this option on
     -C, --compression   Specify compression info in the form of 'method' or 'level' or 'method/level',
                         where method is one of the following: {none, huffman, deflate}; and level is an integer with
                         the following bounds for each method: {[0-0], [1-8], [0-8]}
@@ -578,9 +1042,22 @@ private:
     std::optional<ArgParser> arg_parser;
     std::filesystem::path sqz_fn;
     std::fstream sqz_file;
+    /** The sqz file opened with direct I/O instead, with the stream over it, if --direct-io is specified */
+    utils::DirectFileStreambuf sqz_direct_file;
+    std::optional<std::iostream> sqz_direct_stream;
     std::optional<Squeeze> sqz;
     std::optional<wrap::FileSqueeze> fsqz;
+    /** Appender to the standard output, used instead of the squeeze when the sqz file is "-" */
+    std::optional<Appender> stream_appender;
+    std::optional<wrap::FileAppender> stream_fappender;
+    /** Paths to extract from the standard input when the sqz file is "-", and whether recursively */
+    std::vector<std::pair<std::string, bool>> stream_extract_paths;
     std::deque<Writer::Stat> write_stats;
+    /** Files loaded into memory to benchmark the compression on, if --bench is specified */
+    std::vector<char> bench_sample;
+    std::size_t nr_bench_files = 0;
+    /** Min time to run each compression and decompression of the sample for, repeatedly, in seconds */
+    static constexpr double bench_min_time = 0.5;
 };
 
 }
@@ -49,18 +49,13 @@ public:
         if (!curr_arg && !*curr_arg)
             return next();
 
-        if (*curr_arg != '-') {
+        // a lone dash is positional, conventionally standing for the standard input or output
+        if (*curr_arg != '-' || !curr_arg[1]) {
             curr_arg_type = ArgType::Positional;
             return Arg{ ArgType::Positional, curr_arg };
         }
 
         if (curr_arg[1] != '-') {
-            if (!curr_arg[1]) {
-                const bool valid_option = short_options.find('\0') != std::string::npos;
-                return Arg {valid_option ? ArgType::ShortOption : ArgType::UnknownShortOption,
-                            std::string_view(curr_arg + 1, 1)};
-            }
-
             curr_arg_type = ArgType::ShortOption;
             return next();
         }
@@ -0,0 +1,114 @@
+// Copyright (c) 2024-Present David Simoniants
+// Distributed under the MIT License (https://opensource.org/licenses/MIT).
+// See the LICENSE file in the top-level directory for more information.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include "squeeze/encode.h"
+#include "squeeze/decode.h"
+#include "squeeze/compression/config.h"
+
+namespace squeeze::tools::utils {
+
+/** Result of benchmarking the encoding and the decoding of a sample at a compression and a number of threads. */
+struct BenchResult {
+    std::size_t encoded_size = 0;
+    double encode_seconds = 0;
+    double decode_seconds = 0;
+    bool round_trip = false;
+};
+
+/** Benchmark of encode_buffer() and decode_buffer() on a sample held in memory. The sample is split into blocks
+ * of the compression block size, like the content of a file is, which the threads take in turn. */
+class BufferBench {
+public:
+    explicit BufferBench(std::span<const char> sample) : sample(sample)
+    {}
+
+    /** Encode and decode the sample repeatedly for at least the given time each, and verify the round trip. */
+    BenchResult run(const CompressionParams& compression, unsigned nr_threads, double min_seconds)
+    {
+        const std::size_t block_size = compression::get_block_size(compression);
+        const std::size_t nr_blocks = (sample.size() + block_size - 1) / block_size;
+        const std::size_t block_bound = compress_bound(block_size, compression);
+        arena.resize(nr_blocks * block_bound);
+        encoded_sizes.assign(nr_blocks, 0);
+        output.assign(sample.size(), 0);
+
+        auto get_block = [block_size]<typename Char>(std::span<Char> data, std::size_t i)
+        {
+            return data.subspan(i * block_size, std::min(block_size, data.size() - i * block_size));
+        };
+
+        BenchResult result;
+        bool succeeded = true;
+        result.encode_seconds = measure(nr_threads, nr_blocks, min_seconds, succeeded,
+            [&](std::size_t i)
+            {
+                return encode_buffer(get_block(sample, i), std::span(arena).subspan(i * block_bound, block_bound),
+                                     encoded_sizes[i], compression).successful();
+            });
+        for (std::size_t encoded_size : encoded_sizes)
+            result.encoded_size += encoded_size;
+
+        result.decode_seconds = measure(nr_threads, nr_blocks, min_seconds, succeeded,
+            [&](std::size_t i)
+            {
+                const std::span<char> out = get_block(std::span(output), i);
+                std::size_t decoded_size = 0;
+                return decode_buffer(std::span(arena).subspan(i * block_bound, encoded_sizes[i]), out,
+                                     decoded_size, compression).successful() && decoded_size == out.size();
+            });
+        result.round_trip = succeeded && std::equal(output.begin(), output.end(), sample.begin(), sample.end());
+        return result;
+    }
+
+private:
+    /** Measure the average time of running the function on all the blocks, spread over the given number of
+     * threads, the calling one included, running it repeatedly for at least the given time. */
+    template<typename F>
+    static double measure(unsigned nr_threads, std::size_t nr_blocks, double min_seconds, bool& succeeded, F&& f)
+    {
+        using Clock = std::chrono::steady_clock;
+        std::atomic_size_t next_block;
+        std::atomic_bool failed = false;
+        auto work = [&]()
+        {
+            for (std::size_t i; (i = next_block.fetch_add(1, std::memory_order::relaxed)) < nr_blocks;)
+                if (not f(i)) [[unlikely]]
+                    failed.store(true, std::memory_order::relaxed);
+        };
+
+        std::size_t nr_runs = 0;
+        const auto start = Clock::now();
+        std::chrono::duration<double> elapsed {};
+        do {
+            next_block.store(0, std::memory_order::relaxed);
+            {
+                std::vector<std::jthread> threads;
+                for (unsigned t = 1; t < nr_threads; ++t)
+                    threads.emplace_back(work);
+                work();
+            }
+            ++nr_runs;
+            elapsed = Clock::now() - start;
+        } while (elapsed.count() < min_seconds);
+
+        succeeded = succeeded && not failed.load(std::memory_order::relaxed);
+        return elapsed.count() / static_cast<double>(nr_runs);
+    }
+
+    std::span<const char> sample;
+    std::vector<char> arena;
+    std::vector<std::size_t> encoded_sizes;
+    std::vector<char> output;
+};
+
+}